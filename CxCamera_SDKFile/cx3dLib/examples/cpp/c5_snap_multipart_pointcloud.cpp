@@ -204,6 +204,7 @@ int main(int argc, char* argv[])
 			images.resize(numAOIs);
 
 			cx::Image rangeImg;
+			cx::ImagePool pool;		// the AOIs have the same size, the buffers of the point clouds are recycled
 
 			// split the multichannel/multiaoi image into separate images for each available data channel
 			for (unsigned int aoi = 0; aoi < numAOIs; aoi++)
@@ -223,13 +224,14 @@ int main(int argc, char* argv[])
 							rangeImg = cx::cvUtils::imageCreate(images[aoi][imgCh]);
 
 							// 8. calculate point cloud
-							cx::c3d::PointCloud pc(rangeImg.height(), rangeImg.width());
+							cx::c3d::PointCloud::Ptr pcPtr = cx::c3d::PointCloud::createShared(rangeImg.height(), rangeImg.width(), CX_PF_COORD3D_ABC32f, pool);
+							cx::c3d::PointCloud& pc = *pcPtr;
 							cx::c3d::calculatePointCloud(*calibs[aoi], rangeImg, pc);
 
 							// 9. show point cloud using OpenCV Viz3d module
 							cv::viz::Viz3d viz("Point Cloud");
 							pc.computeNormals();											// compute normals from point cloud points
-							cx::normalizeMinMax8U(rangeImg, pc.colors);						// compute colors from height values of range map. Function defined in cx_3d_common.
+							cx::normalizeMinMax8U(rangeImg, pc, pool);						// compute colors from height values of range map into a pooled buffer. Function defined in cx_3d_common.
 							//pc.save("pc.ply");
 							cx::showPointCloud(viz, pc, "pc1", 2, cv::COLORMAP_JET + 1);	// 0=only show points without normals and static color, 1=use colors, 2=use colors and normals. Function from cx_3d_common.
 
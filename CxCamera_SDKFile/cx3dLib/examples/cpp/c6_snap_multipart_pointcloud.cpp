@@ -47,6 +47,8 @@ using namespace cv;
 #include "AT/cx/c3d/Calib.h"
 #include "AT/cx/c3d/PointCloud.h"
 #include "cx_3d_common.h"
+#include "AT/cx/ParamSnapshot.h"
+#include "AT/cx/c3d/MultipartRouter.h"
 using namespace AT;
 
 int main(int argc, char* argv[])
@@ -172,6 +174,8 @@ int main(int argc, char* argv[])
 		std::vector<cx::c3d::CalibPtr> calibs;
 		double dy = std::numeric_limits<double>::quiet_NaN();
 
+		// camera settings of all regions are read once and shared by the calibrations
+		cx::ParamSnapshot params(*cam);
 		for (unsigned int region = 0; region < numRegions; region++)
 		{
 			calibs.push_back(cx::c3d::Calib::createShared());     //ӦþǴĳcalib
@@ -187,7 +191,7 @@ int main(int argc, char* argv[])
 			}
 
 			// 3. set relevant acquisition parameters in calibration, we assume we have only one aoi active
-			cx::updateCalibC6(cam->getHandle(), *calibs[region], region);       //Ӧǿ˶ӦȨ
+			cx::updateCalibC6(params, *calibs[region], region);       //Ӧǿ˶ӦȨ
 
 			// set the profile-step-width scaling
 			calibs[region]->getParam(CX_3D_PARAM_SY, val);
@@ -226,6 +230,20 @@ int main(int argc, char* argv[])
 			calibs[region]->setParam(CX_3D_PARAM_METRIC_CACHE_MODE, int(1));
 		}
 
+		// the range part of every region is dispatched to the calibration of the region, the point clouds of the regions are computed concurrently
+		cx::ThreadPool pool(numRegions);
+		cx::c3d::MultipartRouter router(&pool);
+		router.configure(params);
+		std::vector<cx::c3d::MetricContextPtr> contexts;
+		for (unsigned int region = 0; region < numRegions; region++)
+		{
+			contexts.push_back(cx::c3d::MetricContext::createShared(calibs[region], cx::Point3f(1.0f, 1.0f, 1.0f), cx::Point3f(0.0f, 0.0f, 0.0f), NAN));
+			router.addRoute(region, contexts[region], [](const cx::c3d::MultipartRouter::Part&, const cx::Image& rangeImg, cx::c3d::PointCloud& pc) {
+				pc.computeNormals();								// compute normals from point cloud points
+				cx::normalizeMinMax8U(rangeImg, pc.colors);			// compute colors from height values of range map. Function defined in cx_3d_common.
+			});
+		}
+
 		// 4. Allocate and queue internal acquisition buffers
 		cam->allocAndQueueBuffers();
 
@@ -250,56 +268,26 @@ int main(int argc, char* argv[])
 		int numChunks = val;
 		std::cout << "Number of Chunks: " << numChunks << "\n\n";
 
-		// 7. Iterate the buffer parts and do some processing on the image data or get a copy for later use.
-		// \note img holds a reference to the image data in the DeviceBuffer, if you need the image data after cx_queueBuffer you need to clone the image!
+		// 7. Dispatch the buffer parts to the regions, the router matches the parts by region id and purpose id.
+		// \note the handlers get a reference to the image data in the DeviceBuffer, if you need the image data after cx_queueBuffer you need to clone the image!
+		router.dispatch(buffer);
 
-		std::string title = "";
-		unsigned int region = 0;
-		bool isImagePart = false;
-		bool isRangeImage = false;
-
-		for (int partIdx = 0; partIdx < numParts; partIdx++)
+		for (const cx::c3d::MultipartRouter::Part& part : router.layout())
 		{
-			title = "";
-			isImagePart = false;
-
-			title += "Part: " + std::to_string(partIdx) + ", ";
-			std::cout << "Part " << partIdx << ":\n";
-
-			buffer.getPartInfo(partIdx, CX_BUFFER_PART_INFO_REGION_ID, val);
-			title += "RegionID:" + std::to_string((int)val) + ", ";
-			std::cout << " RegionID: " << (int)val << "\n";
-			region = (unsigned int)val & 0xf;
-
-			buffer.getPartInfo(partIdx, CX_BUFFER_PART_INFO_TYPE_ID, val);
-			if ((int)val == CX_BUFFER_PART_TYPE_ID_IMAGE2D)
+			std::string title = "Part: " + std::to_string(part.index) + ", RegionID:" + std::to_string((long long)part.regionId) + ", ";
+			title += "TypeID: " + cx::partTypeIDToStr((cx_buffer_part_type)part.typeId) + ", ";
+			title += "PurposeID: " + cx::partPurposeIDToStr((cx_buffer_part_purpose)part.purposeId);
+			std::cout << "Part " << part.index << ":\n";
+			std::cout << " RegionID: " << part.regionId << "\n";
+			std::cout << " TypeID: " << cx::partTypeIDToStr((cx_buffer_part_type)part.typeId) << "\n";
+			std::cout << " PurposeID: " << cx::partPurposeIDToStr((cx_buffer_part_purpose)part.purposeId) << "\n\n";
+
+			if (part.route >= 0)
 			{
-				isImagePart = true;
-			}
-			title += "TypeID: " + cx::partTypeIDToStr((cx_buffer_part_type)((int32_t)val)) + ", ";
-			std::cout << " TypeID: " << cx::partTypeIDToStr((cx_buffer_part_type)((int32_t)val)) << "\n";
-
-			buffer.getPartInfo(partIdx, CX_BUFFER_PART_INFO_DATA_PURPOSE_ID, val);
-			title += "PurposeID: " + cx::partPurposeIDToStr((cx_buffer_part_purpose)((int32_t)val));
-			std::cout << " PurposeID: " << cx::partPurposeIDToStr((cx_buffer_part_purpose)((int32_t)val)) << "\n\n";
-			if ((int)val == CX_BUFFER_PART_PURPOSE_ID_RANGE)
-			{
-				isRangeImage = true;
-			}
-
-			if (isImagePart && isRangeImage)
-			{
-				auto rangeImg = buffer.getImage(partIdx);
-
-				// 8. calculate point cloud
-				cx::c3d::PointCloud pc(rangeImg->height(), rangeImg->width());
-				cx::c3d::calculatePointCloud(*calibs[region], *rangeImg, pc);
+				cx::c3d::PointCloud& pc = contexts[part.route]->pointCloud();
 
 				// 9. show point cloud using OpenCV Viz3d module
 				cv::viz::Viz3d viz("Point Cloud");
-				pc.computeNormals();											// compute normals from point cloud points
-				cx::normalizeMinMax8U(*rangeImg, pc.colors);					// compute colors from height values of range map. Function defined in cx_3d_common.
-				//pc.save("pc.ply");
 				cx::showPointCloud(viz, pc, "pc1", 2, cv::COLORMAP_JET + 1);	// 0=only show points without normals and static color, 1=use colors, 2=use colors and normals. Function from cx_3d_common.
 
 				cv::imshow(title, cx::cvUtils::imageCopyToMat(pc.colors, false));	// show range image in OpenCV window
@@ -312,7 +300,6 @@ int main(int argc, char* argv[])
 				std::cout << "3D-View: press 'q' for quit or 'h' for help" << endl << endl;
 				viz.spin();	// Wait for a keystroke in the OpenCV window
 			}
-
 		}
 
 		// 8. Queue back the buffer to the devices acquisition engine.
@@ -0,0 +1,390 @@
+/**
+@package : cx_3d library
+@file : cx_3d_cloud_fusion_test.cpp
+@brief C++ test of cx::c3d::CloudFusion with two sensor heads of known relative position.
+
+This example fuses two heads which see the same range image. The calibration of the second head is a copy of the first one shifted by dz in world z,
+so both heads put their points into the same Z-Map cells and every cell has a known result.
+The following steps are demonstrated:
+	1. Load 3d calibration from file, clone it for both heads and shift the second head by dz
+	2. Fusion into a point cloud: the rows of every head against the points of cx_3d_range2calibratedABC in world coordinates, NaN padding of the narrower head
+	3. Fusion into a Z-Map with FUSION_Z_MAX, FUSION_Z_MIN and FUSION_Z_MEAN, with and without thread pool: every cell against a scalar rasterization of the fused points
+	   and against the fusion of the first head alone, max must be higher by dz, min the same, mean higher by dz / 2.
+	   Z-Maps of type CX_PF_COORD3D_C16 are checked for FUSION_Z_MAX.
+	4. Aliasing: a fusion into a point cloud leaves the head clouds as views into that output. A following fusion into a Z-Map must neither write into
+	   the point cloud nor into its released buffer (run it with AddressSanitizer), a fusion into another point cloud must not modify the first one.
+
+The example returns -1 if a result differs from the expected result by more than the tolerance.
+
+Usage: cx_3d_cloud_fusion_test [calib.xml] [seed]
+
+@copyright (c) 2026, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// C++ Wrapper
+#include "cx_3d_common.h"
+#include "AT/cx/ThreadPool.h"
+#include "AT/cx/c3d/CloudFusion.h"
+
+using namespace std;
+using namespace AT;
+
+static int g_numFailed = 0;
+
+static const float g_dz = 4.0f;		// shift of the second head in world z
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		cerr << "FAILED: " << what << endl;
+		g_numFailed++;
+	}
+}
+
+static bool near(float a, float b, float tol = 1e-5f)
+{
+	return std::fabs(a - b) <= tol * std::max(1.0f, std::fabs(b));
+}
+
+static bool sameBits(const cx::Image& a, const cx::Image& b)
+{
+	if (a.width() != b.width() || a.height() != b.height() || a.pixelFormat() != b.pixelFormat())
+		return false;
+	size_t rowSize = size_t(a.width()) * ((a.pixelFormat() == CX_PF_COORD3D_ABC32f) ? 3 * sizeof(float) : sizeof(float));
+	for (unsigned r = 0; r < a.height(); r++)
+		if (memcmp(a.row<uint8_t>(r), b.row<uint8_t>(r), rowSize) != 0)
+			return false;
+	return true;
+}
+
+static void setParam3(cx::c3d::Calib& calib, cx_3d_calib_param_t param, double a, double b, double c)
+{
+	cx::Variant val;
+	val = std::vector<double>{ a, b, c };
+	calib.setParam(param, val);
+}
+
+/* world coordinates of the points of one head computed with cx_3d_range2calibratedABC and the metric scale and offset of the calibration,
+	invalid points get NaN in z. Returns the number of valid points.
+*/
+static size_t worldPoints(cx::c3d::Calib& calib, const cx::Image& range, cx::Image& world)
+{
+	cx::Variant val;
+	std::vector<double> s, o;
+	calib.getParam(CX_3D_PARAM_METRIC_S, val);
+	val.get(s);
+	calib.getParam(CX_3D_PARAM_METRIC_O, val);
+	val.get(o);
+	calib.getParam(CX_3D_PARAM_METRIC_IDV, val);
+	float idv = float(double(val));
+
+	world.create(range.height(), range.width(), CX_PF_COORD3D_ABC32f);
+	cx::checkOk(cx_3d_range2calibratedABC(calib.getHandle(), range, world, CX_3D_METRIC_MARK_Z_INVALID_DATA));
+	size_t n = 0;
+	for (unsigned r = 0; r < world.height(); r++)
+	{
+		float* p = world.row<float>(r);
+		for (unsigned c = 0; c < world.width(); c++, p += 3)
+		{
+			if (std::isnan(p[2]) || p[2] == idv)
+			{
+				p[2] = NAN;
+				continue;
+			}
+			for (int k = 0; k < 3; k++)
+				p[k] = p[k] * float(s[k]) + float(o[k]);
+			n++;
+		}
+	}
+	return n;
+}
+
+// 2. fusion into a point cloud
+static void testPointCloud(cx::c3d::Calib& cal0, cx::c3d::Calib& cal1, const cx::Image& range, cx::ThreadPool* pool)
+{
+	const std::string name = std::string("point cloud") + (pool ? " with thread pool" : "");
+	// the second head is narrower, its rows are padded with NaN points
+	unsigned w1 = range.width() - 37;
+	cx::Image narrow(range.height(), w1, CX_PF_MONO_16);
+	for (unsigned r = 0; r < range.height(); r++)
+		memcpy(narrow.row<uint16_t>(r), range.row<uint16_t>(r), size_t(w1) * sizeof(uint16_t));
+
+	cx::Image world0, world1;
+	size_t n0 = worldPoints(cal0, range, world0);
+	size_t n1 = worldPoints(cal1, narrow, world1);
+
+	cx::c3d::CloudFusion fusion(cx::c3d::FUSION_Z_MAX, pool);
+	cx::c3d::PointCloud pc;
+	std::vector<cx::c3d::FusionHead> heads = { { &cal0, &range }, { &cal1, &narrow } };
+	size_t n = fusion.fuse(heads, pc);
+	unsigned h = range.height();
+	check(n == n0 + n1 && pc.points.height() == 2 * h && pc.points.width() == range.width() && pc.points.pixelFormat() == CX_PF_COORD3D_ABC32f,
+		name + ": size and number of valid points");
+	if (pc.points.height() != 2 * h || pc.points.width() != range.width())
+		return;
+
+	bool ok = true;
+	for (unsigned r = 0; r < 2 * h && ok; r++)
+	{
+		const cx::Image& world = (r < h) ? world0 : world1;
+		const float* p = pc.points.row<float>(r);
+		const float* q = world.row<float>(r % h);
+		for (unsigned c = 0; c < pc.points.width() && ok; c++, p += 3)
+		{
+			if (c >= world.width())
+				ok = std::isnan(p[0]) && std::isnan(p[1]) && std::isnan(p[2]);
+			else if (std::isnan(q[3 * c + 2]))
+				ok = std::isnan(p[2]);
+			else
+				ok = near(p[0], q[3 * c]) && near(p[1], q[3 * c + 1]) && near(p[2], q[3 * c + 2]);
+		}
+		if (!ok)
+			cerr << "row " << r << " differs" << endl;
+	}
+	check(ok, name + ": points against cx_3d_range2calibratedABC");
+	check(pc.scale.x == 1.0f && pc.scale.z == 1.0f && pc.offset.x == 0.0f && pc.offset.z == 0.0f, name + ": identity scale and offset");
+}
+
+struct Cell
+{
+	float max = -INFINITY;
+	float min = INFINITY;
+	double sum = 0.0;
+	unsigned count = 0;
+};
+
+// scalar rasterization of the fused points into the geometry of zmap
+static std::vector<Cell> rasterize(const cx::c3d::PointCloud& pc, const cx::c3d::ZMap& zmap)
+{
+	unsigned w = zmap.img.width(), h = zmap.img.height();
+	std::vector<Cell> cells(size_t(w) * h);
+	for (unsigned r = 0; r < pc.points.height(); r++)
+	{
+		const float* p = pc.points.row<float>(r);
+		for (unsigned c = 0; c < pc.points.width(); c++, p += 3)
+		{
+			if (std::isnan(p[2]))
+				continue;
+			float fc = std::floor((p[0] - zmap.offset.x) / zmap.scale.x + 0.5f);
+			float fr = std::floor((p[1] - zmap.offset.y) / zmap.scale.y + 0.5f);
+			if (!(fc >= 0.0f && fr >= 0.0f && fc < float(w) && fr < float(h)))
+				continue;
+			Cell& cell = cells[size_t(fr) * w + size_t(fc)];
+			cell.max = std::max(cell.max, p[2]);
+			cell.min = std::min(cell.min, p[2]);
+			cell.sum += p[2];
+			cell.count++;
+		}
+	}
+	return cells;
+}
+
+static float cellValue(const cx::c3d::ZMap& zmap, size_t i)
+{
+	unsigned r = unsigned(i / zmap.img.width()), c = unsigned(i % zmap.img.width());
+	float v = zmap.img.row<float>(r)[c];
+	return v * zmap.scale.z + zmap.offset.z;
+}
+
+// 3. fusion into a Z-Map
+static void testZMap(cx::c3d::Calib& cal0, cx::c3d::Calib& cal1, const cx::Image& range, cx::ThreadPool* pool)
+{
+	const std::string name = std::string("Z-Map") + (pool ? " with thread pool" : "");
+	std::vector<cx::c3d::FusionHead> heads = { { &cal0, &range }, { &cal1, &range } };
+	std::vector<cx::c3d::FusionHead> head0 = { { &cal0, &range } };
+	cx::c3d::CloudFusion fusion(cx::c3d::FUSION_Z_MAX, pool);
+
+	// geometry from the heads, cell size twice the point spacing so cells get several points of each head
+	cx::c3d::PointCloud pc;
+	fusion.fuse(heads, pc);
+	cx::c3d::ZMap geometry;
+	geometry.scale = cx::Point3f(0.0f, 0.0f, 1.0f);
+	fusion.fuse(heads, geometry);
+	const unsigned w = geometry.img.width() / 2 + 1, h = geometry.img.height() / 2 + 1;
+	const cx::Point3f scale(2.0f * geometry.scale.x, 2.0f * geometry.scale.y, 1.0f);
+
+	const cx::c3d::fusion_z_policy policies[] = { cx::c3d::FUSION_Z_MAX, cx::c3d::FUSION_Z_MIN, cx::c3d::FUSION_Z_MEAN };
+	const char* policyNames[] = { "FUSION_Z_MAX", "FUSION_Z_MIN", "FUSION_Z_MEAN" };
+	for (int k = 0; k < 3; k++)
+	{
+		const std::string policyName = name + ", " + policyNames[k];
+		fusion.setPolicy(policies[k]);
+		cx::c3d::ZMap zmap(h, w, CX_PF_COORD3D_C32f, scale, geometry.offset);
+		cx::c3d::ZMap zmap0(h, w, CX_PF_COORD3D_C32f, scale, geometry.offset);
+		size_t n = fusion.fuse(heads, zmap);
+		size_t n0 = fusion.fuse(head0, zmap0);
+
+		std::vector<Cell> cells = rasterize(pc, zmap);
+		size_t numValid = 0;
+		bool ok = true, okShift = true, okEmpty = true;
+		for (size_t i = 0; i < cells.size(); i++)
+		{
+			const Cell& cell = cells[i];
+			float v = cellValue(zmap, i), v0 = cellValue(zmap0, i);
+			if (cell.count == 0)
+			{
+				okEmpty = okEmpty && std::isnan(v) && std::isnan(v0);
+				continue;
+			}
+			numValid++;
+			if (policies[k] == cx::c3d::FUSION_Z_MAX)
+				ok = ok && v == cell.max;
+			else if (policies[k] == cx::c3d::FUSION_Z_MIN)
+				ok = ok && v == cell.min;
+			else
+				ok = ok && near(v, float(cell.sum / cell.count), 2e-5f);
+
+			// both heads hit the cell with the same points, the points of the second head are shifted by dz
+			float shift = (policies[k] == cx::c3d::FUSION_Z_MAX) ? g_dz : (policies[k] == cx::c3d::FUSION_Z_MIN) ? 0.0f : 0.5f * g_dz;
+			okShift = okShift && cell.count % 2 == 0 && std::fabs(v - v0 - shift) <= 1e-4f * std::max(1.0f, std::fabs(v));
+		}
+		check(numValid > 0, policyName + ": cells with points");
+		check(n == numValid && n0 == numValid, policyName + ": number of valid cells " + std::to_string(n) + ", first head " + std::to_string(n0)
+			+ ", expected " + std::to_string(numValid));
+		check(ok, policyName + ": cells against the scalar rasterization");
+		check(okShift, policyName + ": cells against the cells of the first head");
+		check(okEmpty, policyName + ": cells without points get the invalid data value");
+	}
+
+	// CX_PF_COORD3D_C16 with z in steps of 0.01 mm
+	cx::c3d::ZMap z16(h, w, CX_PF_COORD3D_C16, cx::Point3f(scale.x, scale.y, 0.01f), cx::Point3f(geometry.offset.x, geometry.offset.y, -300.0f));
+	z16.ivd = 0.0f;
+	fusion.setPolicy(cx::c3d::FUSION_Z_MAX);
+	fusion.fuse(heads, z16);
+	std::vector<Cell> cells = rasterize(pc, z16);
+	bool ok16 = true;
+	for (size_t i = 0; i < cells.size() && ok16; i++)
+	{
+		uint16_t v = z16.img.row<uint16_t>(unsigned(i / w))[i % w];
+		if (cells[i].count == 0)
+			ok16 = v == 0;
+		else
+			ok16 = std::abs(int(v) - int(std::min(std::max((cells[i].max + 300.0f) / 0.01f + 0.5f, 0.0f), 65535.0f))) <= 1;
+	}
+	check(ok16, name + ": CX_PF_COORD3D_C16");
+}
+
+// 4. head clouds aliased to the output of a fusion into a point cloud
+static void testAliasing(cx::c3d::Calib& cal0, cx::c3d::Calib& cal1, const cx::Image& range, cx::ThreadPool* pool)
+{
+	const std::string name = std::string("aliasing") + (pool ? " with thread pool" : "");
+	std::vector<cx::c3d::FusionHead> heads = { { &cal0, &range }, { &cal1, &range } };
+
+	cx::c3d::ZMap expected;
+	{
+		cx::c3d::CloudFusion fusion(cx::c3d::FUSION_Z_MAX, pool);
+		fusion.fuse(heads, expected);
+	}
+
+	cx::c3d::CloudFusion fusion(cx::c3d::FUSION_Z_MAX, pool);
+	cx::c3d::PointCloud pc;
+	fusion.fuse(heads, pc);
+	cx::Image before(pc.points, true);
+
+	// the head clouds have the size of the Z-Map heads, the fusion into the Z-Map must not reuse the views into pc
+	cx::c3d::ZMap zmap;
+	zmap.create(expected.img.height(), expected.img.width(), CX_PF_COORD3D_C32f, expected.scale, expected.offset);
+	fusion.fuse(heads, zmap);
+	check(sameBits(pc.points, before), name + ": point cloud unchanged by the fusion into a Z-Map");
+	check(sameBits(zmap.img, expected.img), name + ": Z-Map after a fusion into a point cloud");
+
+	// the output is released before the next fusion
+	cx::c3d::PointCloud* released = new cx::c3d::PointCloud;
+	fusion.fuse(heads, *released);
+	delete released;
+	zmap.create(expected.img.height(), expected.img.width(), CX_PF_COORD3D_C32f, expected.scale, expected.offset);
+	fusion.fuse(heads, zmap);
+	check(sameBits(zmap.img, expected.img), name + ": Z-Map after a fusion into a released point cloud");
+
+	// a fusion into another point cloud writes only into the new output
+	cx::c3d::PointCloud other;
+	std::vector<cx::c3d::FusionHead> swapped = { { &cal1, &range }, { &cal0, &range } };
+	fusion.fuse(swapped, other);
+	check(sameBits(pc.points, before), name + ": point cloud unchanged by the fusion into another point cloud");
+	check(other.points.height() == pc.points.height() && !sameBits(other.points, before), name + ": second point cloud");
+}
+
+int main(int argc, char* argv[])
+{
+	std::string basePath = "../../../cx3dLib/data/";
+	std::string calib_fname = basePath + "img/AT-050614-2_Linear_Full.xml";
+	unsigned seed = 1;
+
+	if (argc > 1)
+		calib_fname = argv[1];
+	if (argc > 2)
+		seed = unsigned(atoi(argv[2]));
+
+	try
+	{
+		// 1. load calibration, two heads with metric scale and offset, the second one shifted by dz
+		cx::c3d::Calib calib;
+		calib.load(calib_fname, "factory");
+		cx::c3d::CalibPtr cal0 = calib.clone();
+		cx::c3d::CalibPtr cal1 = calib.clone();
+		cx::Variant val;
+		std::vector<double> t;
+		cal1->getParam(CX_3D_PARAM_T, val);
+		val.get(t);
+		t.resize(3, 0.0);
+		setParam3(*cal1, CX_3D_PARAM_T, t[0], t[1], t[2] + g_dz);
+		for (cx::c3d::Calib* cal : { cal0.get(), cal1.get() })
+		{
+			setParam3(*cal, CX_3D_PARAM_METRIC_S, 0.5, 0.25, 0.125);
+			setParam3(*cal, CX_3D_PARAM_METRIC_O, 10.0, -20.0, 30.0);
+			val = -1.0;
+			cal->setParam(CX_3D_PARAM_METRIC_IDV, val);
+		}
+
+		// random range image, every 10th pixel is invalid
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<int> value(2000, 30000);
+		cx::Image range(48, 320, CX_PF_MONO_16);
+		for (unsigned r = 0; r < range.height(); r++)
+			for (unsigned c = 0; c < range.width(); c++)
+				range.row<uint16_t>(r)[c] = (rng() % 10 == 0) ? 0 : uint16_t(value(rng));
+
+		cx::ThreadPool pool(4);
+		for (cx::ThreadPool* p : { (cx::ThreadPool*)nullptr, &pool })
+		{
+			testPointCloud(*cal0, *cal1, range, p);
+			testZMap(*cal0, *cal1, range, p);
+			testAliasing(*cal0, *cal1, range, p);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		cout << "exception caught, msg:" << e.what() << endl;
+		exit(-3);
+	}
+
+	if (g_numFailed)
+	{
+		cerr << g_numFailed << " checks failed" << endl;
+		return -1;
+	}
+	cout << "all checks passed" << endl;
+	return 0;
+}
@@ -66,7 +66,8 @@ namespace AT {
 			}
 		}
 
-		void normalizeMinMax8U(const cx::Image& in, cx::Image& out, bool excludeZeros)
+		// normalizes in into the buffer of out, out must be a CX_PF_MONO_8 image of the size of in
+		static void normalizeMinMax8UInto(const cx::Image& in, cx::Image& out, bool excludeZeros)
 		{
 			// use OpenCV functions for implementation
 			double minR = 0.0;
@@ -82,9 +83,21 @@ namespace AT {
 				cv::minMaxIdx(in_cv, &minR, &maxR);
 			}
 			double s = (maxR == minR) ? 1.0 : 255.0 / (maxR - minR);
-			cv::Mat out_cv;
+			cv::Mat out_cv = cx::cvUtils::imageCopyToMat(out, false);
 			in_cv.convertTo(out_cv, CV_8U, s, -minR * s);
-			cx::cvUtils::imageCopyFromMat(out_cv, out, true);
+		}
+
+		void normalizeMinMax8U(const cx::Image& in, cx::Image& out, bool excludeZeros)
+		{
+			// the buffer of out is reused if it matches, no temporary image is allocated
+			out.create(in.height(), in.width(), CX_PF_MONO_8);
+			normalizeMinMax8UInto(in, out, excludeZeros);
+		}
+
+		void normalizeMinMax8U(const cx::Image& in, cx::c3d::PointCloud& pc, cx::ImagePool& pool, bool excludeZeros)
+		{
+			pc.createPooled(pc.colors, in.height(), in.width(), CX_PF_MONO_8, pool);
+			normalizeMinMax8UInto(in, pc.colors, excludeZeros);
 		}
 
 		void normalizeMinMax8U(const cv::Mat& in, cv::Mat& out, bool excludeZeros)
@@ -35,6 +35,8 @@ POSSIBILITY OF SUCH DAMAGE.
 namespace AT {
 	namespace cx {
 
+		class ParamSnapshot;
+
 		//! @addtogroup cx_wrapper_cpp
 		//! @{
 
@@ -58,8 +60,15 @@ namespace AT {
 
 		void printTargetInfo(CX_TARGET_HANDLE hTarget, std::ostream& os = std::cout);
 		
+		/** Normalizes in to the range [0, 255] of a CX_PF_MONO_8 image.
+			The buffer of out is reused if out is owner of its buffer and has the size of in and pixel format CX_PF_MONO_8, e.g. colors kept over several frames.
+		*/
 		void normalizeMinMax8U(const cx::Image& in, cx::Image& out, bool excludeZeros = true);
 
+		/** Normalizes in into pc.colors, the colors are created with a buffer of pool, see \ref cx::c3d::PointCloud::createPooled.
+		*/
+		void normalizeMinMax8U(const cx::Image& in, cx::c3d::PointCloud& pc, cx::ImagePool& pool, bool excludeZeros = true);
+
 #ifdef HAVE_OPENCV_VIZ
 		/** Show Point Cloud optional with colors and normals
 			@param viz			viewer object
@@ -115,6 +124,16 @@ namespace AT {
 		*/
 		void updateCalibC6(CX_DEVICE_HANDLE hDevice, CX_CALIB_HANDLE hCalib, int regionId = 0);
 
+		/** Update calibration settings with acquisition settings read through a parameter snapshot, see updateCalibC6(CX_DEVICE_HANDLE, CX_CALIB_HANDLE, int).
+			The extraction sources of all extraction modules are read in one pass, the coordinate scale and offset only for the extraction modules of the region.
+			The values are cached in the snapshot, updating the calibrations of several regions with the same snapshot reads each camera setting only once.
+
+			@param params	parameter snapshot of the camera device
+			@param hCalib	handle of the calibration
+			@param regionId	region of the camera
+		*/
+		void updateCalibC6(cx::ParamSnapshot& params, CX_CALIB_HANDLE hCalib, int regionId = 0);
+
 		//! @} cx_wrapper_cpp
 	}
 }
@@ -26,6 +26,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "cx_cam.h"
 #include "cx_cam_param.h"
 #include "cx_3d_common.h"
+#include "AT/cx/ParamSnapshot.h"
 
 namespace AT {
 	namespace cx {
@@ -389,5 +390,73 @@ namespace AT {
 			cx::checkOk(cx_setParam(hDevice, "RegionSelector", cx::Variant(storedRegion)));
 		}
 
+		// returns the product of the optional resolution reduction parameters that are available
+		static unsigned resolutionReduction(cx::ParamSnapshot& params, const char* binning, const char* decimation)
+		{
+			unsigned rr = 1;
+			const char* prms[] = { binning, decimation };
+			for (const char* prm : prms)
+			{
+				if (params.isAvailable(prm) && (unsigned)params.get(prm) > 0)
+					rr *= (unsigned)params.get(prm);
+			}
+			return rr;
+		}
+
+		void updateCalibC6(cx::ParamSnapshot& params, CX_CALIB_HANDLE hCalib, int regionId)
+		{
+			const int optional = cx::ParamSnapshot::FETCH_VALUE | cx::ParamSnapshot::FETCH_ACCESS_MODE | cx::ParamSnapshot::FETCH_VISIBILITY;
+			params.add({ "SensorWidth", "SensorHeight", CX_CAM_IMAGE_OFFSET_X });
+			params.add({ "BinningHorizontal", "DecimationHorizontal", "BinningVertical", "DecimationVertical" }, optional);
+			params.addSelected("Scan3dExtractionSelector", { "Scan3dExtractionSource" }, cx::ParamSnapshot::FETCH_ENUM_INT_VALUE);
+			params.addSelected("RegionSelector", { CX_CAM_IMAGE_REVERSE_X, CX_CAM_IMAGE_WIDTH, CX_CAM_IMAGE_REVERSE_Y, "Height" }, cx::ParamSnapshot::FETCH_VALUE, { regionId });
+			params.fetch();
+
+			// set sensor size parameter from camera (requires for LUT_mode, binary calibration format does not include this parameter)
+			std::vector<int64_t> s_size = { params.get("SensorWidth"), params.get("SensorHeight") };
+			cx::Variant val;
+			val.set(s_size);
+			cx::checkOk(cx_3d_calib_set(hCalib, CX_3D_PARAM_S_SZ, val));	//set sensor size in pixel [width, height]	
+
+			// set resolution reduction caused by sensor binning or decimation
+			cx::checkOk(cx_3d_calib_set(hCalib, CX_3D_PARAM_S_RR_H, cx::Variant((int)resolutionReduction(params, "BinningHorizontal", "DecimationHorizontal"))));
+			cx::checkOk(cx_3d_calib_set(hCalib, CX_3D_PARAM_S_RR_V, cx::Variant((int)resolutionReduction(params, "BinningVertical", "DecimationVertical"))));
+
+			// seclect extraction module belonging to given AOI, scale and offset are read for these extraction modules only
+			std::vector<int64_t> extractions;
+			for (int64_t sel : params.selectorValues("Scan3dExtractionSelector"))
+			{
+				std::string source = cx::ParamSnapshot::selectedName("Scan3dExtractionSource", "Scan3dExtractionSelector", sel);
+				if ((int64_t)params.info(source, CX_PARAM_INFO_ENUM_INT_VALUE) == regionId)
+					extractions.push_back(sel);
+			}
+			if (!extractions.empty())
+			{
+				params.addSelected("Scan3dExtractionSelector", { "Scan3dCoordinateScale", "Scan3dCoordinateOffset" }, cx::ParamSnapshot::FETCH_VALUE, extractions);
+				params.fetch();
+			}
+			for (int64_t sel : extractions)
+			{
+				val = double(params.get("Scan3dCoordinateScale", "Scan3dExtractionSelector", sel));
+				cx::checkOk(cx_3d_calib_set(hCalib, CX_3D_PARAM_RANGE_SCALE, val));
+				cx::checkOk(cx_3d_calib_set(hCalib, CX_3D_PARAM_RANGE_OFFSET, params.get("Scan3dCoordinateOffset", "Scan3dExtractionSelector", sel)));
+			}
+
+			// set X offset in image space
+			cx::checkOk(cx_3d_calib_set(hCalib, CX_3D_PARAM_S_ROI_X, params.get(CX_CAM_IMAGE_OFFSET_X)));
+
+			// set image width and AOI height of the region, if reverse-x or reverse-y is true set negative
+			cx::Variant reverse;
+			int width = params.get(CX_CAM_IMAGE_WIDTH, "RegionSelector", regionId);
+			if (params.tryGet(cx::ParamSnapshot::selectedName(CX_CAM_IMAGE_REVERSE_X, "RegionSelector", regionId), reverse) && (int)reverse != 0)
+				width = -width;
+			cx::checkOk(cx_3d_calib_set(hCalib, CX_3D_PARAM_S_ROI_W, cx::Variant(width)));
+
+			int roiHeight = params.get("Height", "RegionSelector", regionId);
+			if (params.tryGet(cx::ParamSnapshot::selectedName(CX_CAM_IMAGE_REVERSE_Y, "RegionSelector", regionId), reverse) && (int)reverse != 0)
+				roiHeight = -roiHeight;
+			cx::checkOk(cx_3d_calib_set(hCalib, CX_3D_PARAM_S_ROI_H, cx::Variant(roiHeight)));
+		}
+
 	}
 }
\ No newline at end of file
@@ -143,7 +143,7 @@ int main(int argc, char* argv[])
 		bool new_buffer = true;
 		cx::ImagePtr rangeImg;
 		cx::ImagePtr reflectanceImg;
-
+		cx::c3d::PointCloud pc;			// kept over all frames, the buffers of points, normals and colors are reused while the image size does not change
 
 		while (true)
 		{
@@ -202,7 +202,7 @@ int main(int argc, char* argv[])
 					buffer.queueBuffer();
 
 					// 10. calculate point cloud
-					cx::c3d::PointCloud pc(rangeImg->height(), rangeImg->width());
+					pc.points.create(rangeImg->height(), rangeImg->width(), CX_PF_COORD3D_ABC32f);
 					cx::c3d::calculatePointCloud(calib, *rangeImg, pc);
 
 					// 11. show point cloud using OpenCV Viz3d module
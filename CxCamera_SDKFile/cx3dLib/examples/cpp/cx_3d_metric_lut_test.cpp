@@ -0,0 +1,249 @@
+/**
+@package : cx_3d library
+@file : cx_3d_metric_lut_test.cpp
+@brief C++ randomized comparison of the SIMD kernels of cx::c3d::MetricLut with the scalar kernel.
+
+This example checks the documented tolerance of the vectorized lookup table, see cx::c3d::MetricLut.
+The following steps are demonstrated:
+	1. Load 3d calibration from file
+	2. Per iteration randomize the calibration (R, T, SY, SXY, SZY and the division of the cache), the output scale and offset and the image width
+	3. Build the table and transform a random range image with the scalar kernel and with the kernel detected for the CPU
+	4. Compare both results for all supported output formats, with and without chunk y values
+
+The example returns -1 if the results differ by more than the documented tolerance: for 32-bit float output 1e-6 relative to the coordinate value
+or to the largest absolute value of the four grid nodes around the pixel if that is larger, for 16-bit output 1.
+
+Usage: cx_3d_metric_lut_test [calib.xml] [iterations] [seed]
+
+@copyright (c) 2026, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+
+// C++ Wrapper
+#include "cx_3d_common.h"
+#include "AT/cx/c3d/MetricLut.h"
+
+using namespace std;
+using namespace AT;
+
+// add a random value to every element of a real valued parameter, parameters not available in the calibration model are skipped
+static void randomizeParam(cx::c3d::Calib& calib, cx_3d_calib_param_t param, std::mt19937& rng, double range)
+{
+	cx::Variant val;
+	if (cx_3d_calib_get(calib, param, val) != CX_STATUS_OK)
+		return;
+	std::uniform_real_distribution<double> u(-range, range);
+	std::vector<double> v;
+	if (val.get(v) == CX_STATUS_OK)
+	{
+		for (size_t i = 0; i < v.size(); i++)
+			v[i] += u(rng);
+		val = v;
+	}
+	else
+	{
+		double d = 0.0;
+		if (val.get(d) != CX_STATUS_OK)
+			return;
+		val = d + u(rng);
+	}
+	cx_3d_calib_set(calib, param, val);
+}
+
+// largest absolute value of the four grid nodes around every pixel in output units, per component (CX_PF_COORD3D_ABC32f), see MetricLut::build
+static void nodeMagnitude(cx::c3d::Calib& cal, const cx::c3d::MetricLut& lut, const cx::Image& rangeImg, const cx::Point3f& scale, const cx::Point3f& offset, cx::Image& mag)
+{
+	unsigned divX = lut.divisionX(), divZ = lut.divisionZ();
+	std::vector<cx_point3r_t> pi(size_t(4) * rangeImg.width()), po(pi.size());
+	const double s[3] = { scale.x, scale.y, scale.z };
+	const double o[3] = { offset.x, offset.y, offset.z };
+	for (unsigned r = 0; r < rangeImg.height(); r++)
+	{
+		const uint16_t* range = rangeImg.row<uint16_t>(r);
+		for (unsigned x = 0; x < rangeImg.width(); x++)
+		{
+			for (unsigned k = 0; k < 4; k++)
+			{
+				cx_point3r_t& p = pi[4 * x + k];
+				p.a = double((x / divX + (k & 1)) * divX);
+				p.b = 0.0;
+				p.c = double((range[x] / divZ + (k >> 1)) * divZ);
+			}
+		}
+		cal.sensor2world(pi.data(), po.data(), unsigned(pi.size()));
+		float* m = mag.row<float>(r);
+		for (unsigned x = 0; x < rangeImg.width(); x++)
+		{
+			for (unsigned c = 0; c < 3; c++)
+			{
+				double v = 0.0;
+				for (unsigned k = 0; k < 4; k++)
+				{
+					const cx_point3r_t& p = po[4 * x + k];
+					double w = (c == 0) ? p.a : ((c == 1) ? p.b : p.c);
+					v = std::max(v, std::fabs(double(float((w - o[c]) / s[c]))));
+				}
+				m[3 * x + c] = float(v);
+			}
+		}
+	}
+}
+
+// maximum difference for 32-bit output relative to the coordinate value or the grid nodes around the pixel, absolute difference for 16-bit output.
+// Invalid points must match.
+static double compareKernels(const cx::Image& a, const cx::Image& b, const cx::Image& mag, bool& invalidMismatch)
+{
+	unsigned numComp = (a.pixelFormat() == CX_PF_COORD3D_ABC32f || a.pixelFormat() == CX_PF_COORD3D_ABC16) ? 3 : 1;
+	bool is16 = (a.pixelFormat() == CX_PF_COORD3D_ABC16 || a.pixelFormat() == CX_PF_COORD3D_C16);
+	double maxDiff = 0.0;
+	for (unsigned r = 0; r < a.height(); r++)
+	{
+		for (unsigned i = 0; i < a.width() * numComp; i++)
+		{
+			if (is16)
+			{
+				maxDiff = std::max(maxDiff, std::fabs(double(a.row<uint16_t>(r)[i]) - double(b.row<uint16_t>(r)[i])));
+				continue;
+			}
+			double va = a.row<float>(r)[i];
+			double vb = b.row<float>(r)[i];
+			if (std::isnan(va) || std::isnan(vb))
+			{
+				invalidMismatch |= (std::isnan(va) != std::isnan(vb));
+				continue;
+			}
+			double m = (numComp == 3) ? mag.row<float>(r)[i] : mag.row<float>(r)[3 * i + 2];
+			maxDiff = std::max(maxDiff, std::fabs(va - vb) / std::max(1.0, std::max(std::fabs(va), m)));
+		}
+	}
+	return maxDiff;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string basePath = "../../../cx3dLib/data/";
+	std::string calib_fname = basePath + "img/AT-050614-2_Linear_Full.xml";
+	int numIterations = 100;
+	unsigned seed = 1;
+
+	if (argc > 1)
+		calib_fname = argv[1];
+	if (argc > 2)
+		numIterations = std::max(1, atoi(argv[2]));
+	if (argc > 3)
+		seed = unsigned(atoi(argv[3]));
+
+	try
+	{
+		// 1. load calibration from file
+		cx::c3d::Calib calib;
+		calib.load(calib_fname, "factory");
+
+		cx::c3d::lut_kernel simdKernel = cx::c3d::MetricLut::detectKernel();
+		if (simdKernel == cx::c3d::LUT_KERNEL_SCALAR)
+			cout << "no SIMD kernel supported by this CPU, the scalar kernel is compared with itself" << endl;
+
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<double> u01(0.0, 1.0);
+		const cx_pixel_format formats[] = { CX_PF_COORD3D_ABC32f, CX_PF_COORD3D_ABC16, CX_PF_COORD3D_C32f, CX_PF_COORD3D_C16 };
+		const unsigned numProfiles = 32;
+		double maxDiff32 = 0.0, maxDiff16 = 0.0;
+		int numSkipped = 0;
+		bool failed = false;
+
+		for (int it = 0; it < numIterations; it++)
+		{
+			// 2. random calibration and geometry, always starting from the loaded calibration
+			cx::c3d::CalibPtr cal = calib.clone();
+			randomizeParam(*cal, CX_3D_PARAM_R, rng, 0.05);
+			randomizeParam(*cal, CX_3D_PARAM_T, rng, 10.0);
+			randomizeParam(*cal, CX_3D_PARAM_SY, rng, 0.05);
+			randomizeParam(*cal, CX_3D_PARAM_SXY, rng, 0.01);
+			randomizeParam(*cal, CX_3D_PARAM_SZY, rng, 0.01);
+			cx::Variant div;
+			div = std::vector<int64_t>{ int64_t(2 + rng() % 5), int64_t(2 + rng() % 6) };
+			cal->setParam(CX_3D_PARAM_METRIC_CACHE_PARAMS, div);
+
+			unsigned width = 1 + unsigned(rng() % 4096);
+			cx::Point3f scale(float(0.01 + u01(rng)), float(0.01 + u01(rng)), float(0.001 + 0.1 * u01(rng)));
+			cx::Point3f offset(float(200.0 * (u01(rng) - 0.5)), float(200.0 * (u01(rng) - 0.5)), float(200.0 * (u01(rng) - 0.5)));
+
+			cx::c3d::MetricLut lut;
+			if (!lut.build(*cal, width, scale, offset, NAN))
+			{
+				numSkipped++;		// calibration not affine in the profile coordinate
+				continue;
+			}
+
+			// 3. random range image with invalid pixels and random chunk y values
+			cx::Image rangeImg(numProfiles, width, CX_PF_MONO_16);
+			std::vector<int32_t> yValues(numProfiles);
+			for (unsigned r = 0; r < numProfiles; r++)
+			{
+				uint16_t* p = rangeImg.row<uint16_t>(r);
+				for (unsigned x = 0; x < width; x++)
+					p[x] = (rng() % 10 == 0) ? 0 : uint16_t(rng());
+				yValues[r] = int32_t(rng() % 200000) - 100000;
+			}
+
+			// 4. compare the kernels for all output formats
+			cx::Image mag(numProfiles, width, CX_PF_COORD3D_ABC32f);
+			nodeMagnitude(*cal, lut, rangeImg, scale, offset, mag);
+			std::vector<float> scratch(lut.scratchSize());
+			for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+			{
+				int flags = CX_3D_METRIC_MARK_Z_INVALID_DATA | ((it & 1) ? CX_3D_METRIC_USE_CHUNK_Y : 0);
+				int32_t y0 = int32_t(rng() % 10000);
+				cx::Image ref(numProfiles, width, formats[f]), res(numProfiles, width, formats[f]);
+				lut.setKernel(cx::c3d::LUT_KERNEL_SCALAR);
+				lut.transform(rangeImg, yValues.data(), ref, flags, y0);
+				lut.setKernel(simdKernel);
+				lut.transform(rangeImg, yValues.data(), res, flags, y0, scratch.data());
+
+				bool invalidMismatch = false;
+				double d = compareKernels(ref, res, mag, invalidMismatch);
+				bool is16 = (formats[f] == CX_PF_COORD3D_ABC16 || formats[f] == CX_PF_COORD3D_C16);
+				if (is16)
+					maxDiff16 = std::max(maxDiff16, d);
+				else
+					maxDiff32 = std::max(maxDiff32, d);
+				if (invalidMismatch || d > (is16 ? 1.0 : 1e-6))
+				{
+					cerr << "FAILED: iteration " << it << ", pixel format 0x" << hex << formats[f] << dec << ", width " << width << ", difference " << d
+						<< (invalidMismatch ? ", invalid points differ" : "") << endl;
+					failed = true;
+				}
+			}
+		}
+
+		cout << "kernel " << simdKernel << ": " << numIterations - numSkipped << " calibrations compared, " << numSkipped << " skipped" << endl;
+		cout << "max. relative difference 32-bit: " << maxDiff32 << ", max. difference 16-bit: " << maxDiff16 << endl;
+		if (failed)
+			return -1;
+	}
+	catch (std::exception& e)
+	{
+		cout << "exception caught, msg:" << e.what();
+		exit(-3);
+	}
+	return 0;
+}
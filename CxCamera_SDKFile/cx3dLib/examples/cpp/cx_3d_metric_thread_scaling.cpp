@@ -0,0 +1,205 @@
+/**
+@package : cx_3d library
+@file : cx_3d_metric_thread_scaling.cpp
+@brief C++ benchmark of the multi-threaded metric transformations of cx::c3d::MetricContext.
+
+This example measures how the calculation of point clouds and Z-Maps scales with the number of threads.
+The following steps are demonstrated:
+	1. Load 3d calibration from file
+	2. Create a synthetic range image (default 2048 x 1000 Mono16)
+	3. Calculate a single threaded point cloud and derive the Z-Map geometry from its bounding box
+	4. For 1, 2, 4, ... up to the maximum number of threads (default: number of hardware threads): prepare a MetricContext, time the point cloud and the Z-Map calculation
+	5. Compare every result with the single threaded result
+
+The example returns -1 if a multi-threaded result differs from the single threaded result by more than the tolerance
+or if the validity of a point differs.
+
+Usage: cx_3d_metric_thread_scaling [calib.xml] [width] [profiles] [iterations] [tolerance] [maxThreads]
+
+@copyright (c) 2026, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+
+// C++ Wrapper
+#include "cx_3d_common.h"
+#include "AT/cx/ThreadPool.h"
+#include "AT/cx/c3d/MetricContext.h"
+
+using namespace std;
+using namespace AT;
+
+// difference of two results of the same format, invalid points (NaN) must match
+struct CompareResult
+{
+	float maxDiff;
+	size_t numInvalidMismatch;
+};
+
+static CompareResult compareImages(const cx::Image& a, const cx::Image& b)
+{
+	CompareResult res = { 0.0f, 0 };
+	unsigned numComp = (a.pixelFormat() == CX_PF_COORD3D_ABC32f) ? 3 : 1;
+	for (unsigned r = 0; r < a.height(); r++)
+	{
+		const float* pa = a.row<float>(r);
+		const float* pb = b.row<float>(r);
+		for (unsigned i = 0; i < a.width() * numComp; i++)
+		{
+			if (std::isnan(pa[i]) || std::isnan(pb[i]))
+			{
+				if (std::isnan(pa[i]) != std::isnan(pb[i]))
+					res.numInvalidMismatch++;
+				continue;
+			}
+			res.maxDiff = std::max(res.maxDiff, std::fabs(pa[i] - pb[i]));
+		}
+	}
+	return res;
+}
+
+static double msSince(std::chrono::steady_clock::time_point t0)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+	std::string basePath = "../../../cx3dLib/data/";
+	std::string calib_fname = basePath + "img/AT-050614-2_Linear_Full.xml";
+	unsigned width = 2048;
+	unsigned numProfiles = 1000;
+	int numIterations = 20;
+	float tolerance = 1e-3f;
+	unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	if (argc > 1)
+		calib_fname = argv[1];
+	if (argc > 2)
+		width = unsigned(atoi(argv[2]));
+	if (argc > 3)
+		numProfiles = unsigned(atoi(argv[3]));
+	if (argc > 4)
+		numIterations = std::max(1, atoi(argv[4]));
+	if (argc > 5)
+		tolerance = float(atof(argv[5]));
+	if (argc > 6)
+		maxThreads = std::max(1, atoi(argv[6]));
+
+	try
+	{
+		// 1. load calibration from file
+		cx::c3d::CalibPtr calib = std::make_shared<cx::c3d::Calib>();
+		calib->load(calib_fname, "factory");
+
+		// 2. synthetic range image, a wavy surface with some invalid pixels
+		cx::Image rangeImg(numProfiles, width, CX_PF_MONO_16);
+		for (unsigned r = 0; r < numProfiles; r++)
+		{
+			uint16_t* p = rangeImg.row<uint16_t>(r);
+			for (unsigned x = 0; x < width; x++)
+				p[x] = ((x + 7 * r) % 97 == 0) ? 0 : uint16_t(30000.0 + 12000.0 * std::sin(x * 0.01) * std::cos(r * 0.02));
+		}
+
+		// 3. Z-Map geometry from the bounding box of the point cloud in world units
+		cx::Point3f min3, max3;
+		{
+			cx::c3d::MetricContext ref(calib);
+			ref.calculatePointCloud(rangeImg);
+			if (ref.pointCloud().computeBoundingBox(min3, max3) == 0)
+				throw std::runtime_error("no valid points in the range image");
+		}
+		cx::Point3f scale((max3.x - min3.x) / float(width - 1), (max3.y - min3.y) / float(numProfiles - 1), 1.0f);
+		if (scale.x == 0.0f)
+			scale.x = 1.0f;
+		if (scale.y == 0.0f)
+			scale.y = 1.0f;
+		cx::Point3f offset(min3.x, min3.y, 0.0f);
+
+		// 4. thread counts 1, 2, 4, ... and the maximum number of threads
+		std::vector<unsigned> threadCounts;
+		for (unsigned n = 1; n < maxThreads; n *= 2)
+			threadCounts.push_back(n);
+		threadCounts.push_back(maxThreads);
+
+		cout << "range image " << width << " x " << numProfiles << ", " << numIterations << " iterations, " << std::thread::hardware_concurrency() << " hardware threads" << endl;
+		cout << "threads   pointcloud[ms]  speedup   zmap[ms]  speedup   maxDiff(pc/zmap)" << endl;
+
+		cx::Image::Ptr refPoints, refZMap;
+		double pcMs1 = 0.0, zMapMs1 = 0.0;
+		bool failed = false;
+		for (size_t i = 0; i < threadCounts.size(); i++)
+		{
+			unsigned n = threadCounts[i];
+			cx::c3d::MetricContext ctx(calib, scale, offset, NAN);
+			ctx.setNumThreads(n);
+			ctx.createZMap(numProfiles, width);
+			ctx.prepare();
+
+			// warm up, allocates the outputs
+			ctx.calculatePointCloud(rangeImg);
+			ctx.calculateZMap(rangeImg);
+
+			auto t0 = std::chrono::steady_clock::now();
+			for (int it = 0; it < numIterations; it++)
+				ctx.calculatePointCloud(rangeImg);
+			double pcMs = msSince(t0) / numIterations;
+
+			t0 = std::chrono::steady_clock::now();
+			for (int it = 0; it < numIterations; it++)
+				ctx.calculateZMap(rangeImg);
+			double zMapMs = msSince(t0) / numIterations;
+
+			// 5. compare with the single threaded result
+			CompareResult pcDiff = { 0.0f, 0 }, zMapDiff = { 0.0f, 0 };
+			if (i == 0)
+			{
+				refPoints = cx::Image::createShared(ctx.pointCloud().points, true);
+				refZMap = cx::Image::createShared(ctx.zMap().img, true);
+				pcMs1 = pcMs;
+				zMapMs1 = zMapMs;
+			}
+			else
+			{
+				pcDiff = compareImages(*refPoints, ctx.pointCloud().points);
+				zMapDiff = compareImages(*refZMap, ctx.zMap().img);
+			}
+
+			printf("%7u   %14.2f  %7.2f  %9.2f  %7.2f   %g / %g\n", n, pcMs, pcMs1 / pcMs, zMapMs, zMapMs1 / zMapMs, pcDiff.maxDiff, zMapDiff.maxDiff);
+			if (pcDiff.maxDiff > tolerance || pcDiff.numInvalidMismatch || zMapDiff.maxDiff > tolerance || zMapDiff.numInvalidMismatch)
+			{
+				cerr << "FAILED: " << n << " threads differ from single threaded result, invalid points differing (pc/zmap): "
+					<< pcDiff.numInvalidMismatch << " / " << zMapDiff.numInvalidMismatch << endl;
+				failed = true;
+			}
+		}
+		if (failed)
+			return -1;
+	}
+	catch (std::exception& e)
+	{
+		cout << "exception caught, msg:" << e.what();
+		exit(-3);
+	}
+	return 0;
+}
@@ -0,0 +1,275 @@
+/**
+@package : cx_3d library
+@file : cx_3d_multipart_router_test.cpp
+@brief C++ test of the part routing of cx::c3d::MultipartRouter without camera.
+
+This example dispatches multipart buffers of a cx::BufferSource to the routes of a MultipartRouter. Every part image is filled with a value identifying the part,
+the handlers record which part they got.
+The following steps are demonstrated:
+	1. Routes for the range parts of region 0 and 1 and for the intensity part of region 0, parts of other type or purpose are not routed
+	2. The same parts in another order with the same number of parts: every route must get its part again
+	3. Buffers with fewer parts, two parts with the same region and purpose (the route gets the first one), region ids with bits outside the region mask
+	4. All steps with and without thread pool
+
+The example returns -1 if a route gets a wrong part.
+
+Usage: cx_3d_multipart_router_test
+
+@copyright (c) 2026, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <mutex>
+#include <cstdlib>
+
+// C++ Wrapper
+#include "cx_cam_common.h"
+#include "cx_3d_common.h"
+#include "AT/cx/ThreadPool.h"
+#include "AT/cx/c3d/MultipartRouter.h"
+
+using namespace std;
+using namespace AT;
+
+static int g_numFailed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		cerr << "FAILED: " << what << endl;
+		g_numFailed++;
+	}
+}
+
+struct TestPart
+{
+	int64_t regionId;
+	int64_t purposeId;
+	int64_t typeId;
+	uint16_t id;			// value of all pixels of the part image
+};
+
+/** Buffer source delivering one multipart buffer with the given parts.
+*/
+class MultipartSource : public cx::BufferSource
+{
+public:
+	static const unsigned WIDTH = 16;
+	static const unsigned HEIGHT = 4;
+
+	cx::DeviceBuffer buffer(const std::vector<TestPart>& parts)
+	{
+		m_parts = parts;
+		m_data.assign(parts.size(), std::vector<uint16_t>(WIDTH * HEIGHT));
+		for (size_t i = 0; i < parts.size(); i++)
+			m_data[i].assign(WIDTH * HEIGHT, parts[i].id);
+		return cx::DeviceBuffer((CX_BUFFER_HANDLE)(uintptr_t)1, this);
+	}
+
+	cx_status_t getBufferImage(CX_BUFFER_HANDLE, int partIdx, cx_img_t* img) override
+	{
+		if (partIdx < 0 || partIdx >= int(m_parts.size()) || img == nullptr)
+			return CX_STATUS_INVALID_PARAMETER;
+		img->pixelFormat = CX_PF_MONO_16;
+		img->width = WIDTH;
+		img->height = HEIGHT;
+		img->flag = 0;
+		img->linePitch = WIDTH * sizeof(uint16_t);
+		img->planePitch = 0;
+		img->dataSz = m_data[partIdx].size() * sizeof(uint16_t);
+		img->data = m_data[partIdx].data();
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t getBufferChunk(CX_BUFFER_HANDLE, int, cx_chunk_t*) override { return CX_STATUS_INVALID_PARAMETER; }
+
+	cx_status_t getBufferInfo(CX_BUFFER_HANDLE, int param, cx_variant_t* val) override
+	{
+		if (param != CX_BUFFER_INFO_NUM_PARTS || val == nullptr)
+			return CX_STATUS_INVALID_PARAMETER;
+		*static_cast<cx::Variant*>(val) = int64_t(m_parts.size());
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t getBufferPartInfo(CX_BUFFER_HANDLE, int partIdx, int param, cx_variant_t* val) override
+	{
+		if (partIdx < 0 || partIdx >= int(m_parts.size()) || val == nullptr)
+			return CX_STATUS_INVALID_PARAMETER;
+		const TestPart& p = m_parts[partIdx];
+		switch (param)
+		{
+		case CX_BUFFER_PART_INFO_REGION_ID:			*static_cast<cx::Variant*>(val) = p.regionId; break;
+		case CX_BUFFER_PART_INFO_DATA_PURPOSE_ID:	*static_cast<cx::Variant*>(val) = p.purposeId; break;
+		case CX_BUFFER_PART_INFO_TYPE_ID:			*static_cast<cx::Variant*>(val) = p.typeId; break;
+		default: return CX_STATUS_INVALID_PARAMETER;
+		}
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t queueBuffer(CX_BUFFER_HANDLE) override { return CX_STATUS_OK; }
+
+private:
+	std::vector<TestPart> m_parts;
+	std::vector<std::vector<uint16_t> > m_data;
+};
+
+// part ids
+enum { RANGE0 = 10, RANGE1 = 11, INTENSITY0 = 12, SCATTER0 = 13, CHUNK0 = 14, RANGE0_SECOND = 15 };
+
+static const TestPart g_range0 = { 0, CX_BUFFER_PART_PURPOSE_ID_RANGE, CX_BUFFER_PART_TYPE_ID_IMAGE2D, RANGE0 };
+static const TestPart g_range1 = { 1, CX_BUFFER_PART_PURPOSE_ID_RANGE, CX_BUFFER_PART_TYPE_ID_IMAGE2D, RANGE1 };
+static const TestPart g_intensity0 = { 0, CX_BUFFER_PART_PURPOSE_ID_INTENSITY, CX_BUFFER_PART_TYPE_ID_IMAGE2D, INTENSITY0 };
+static const TestPart g_scatter0 = { 0, CX_BUFFER_PART_PURPOSE_ID_SCATTER, CX_BUFFER_PART_TYPE_ID_IMAGE2D, SCATTER0 };
+static const TestPart g_chunk0 = { 0, CX_BUFFER_PART_PURPOSE_ID_METADATA, CX_BUFFER_PART_TYPE_ID_CHUNK, CHUNK0 };
+
+class Recorder
+{
+public:
+	explicit Recorder(size_t numRoutes) : m_ids(numRoutes, 0), m_calls(numRoutes, 0) {}
+
+	cx::c3d::MultipartRouter::Handler handler(int route)
+	{
+		return [this, route](const cx::c3d::MultipartRouter::Part& part, const cx::Image& img) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			// the part info must describe the image passed
+			uint16_t id = img.row<uint16_t>(0)[0];
+			m_ids[route] = (part.route == route && img.width() == MultipartSource::WIDTH) ? id : uint16_t(0xFFFF);
+			m_calls[route]++;
+		};
+	}
+
+	void clear()
+	{
+		m_ids.assign(m_ids.size(), 0);
+		m_calls.assign(m_calls.size(), 0);
+	}
+
+	// id of the part each route got, 0 if not called, 0xFFFF if the part info did not match
+	std::vector<uint16_t> ids() const { return m_ids; }
+	bool calledOnce() const
+	{
+		for (size_t i = 0; i < m_calls.size(); i++)
+			if (m_calls[i] > 1)
+				return false;
+		return true;
+	}
+
+private:
+	std::mutex m_mutex;
+	std::vector<uint16_t> m_ids;
+	std::vector<int> m_calls;
+};
+
+static void dispatch(cx::c3d::MultipartRouter& router, MultipartSource& source, Recorder& rec, const std::vector<TestPart>& parts, const std::vector<uint16_t>& expected,
+	const std::string& name)
+{
+	rec.clear();
+	cx::DeviceBuffer buffer = source.buffer(parts);
+	size_t n = router.dispatch(buffer);
+	size_t numExpected = 0;
+	for (size_t i = 0; i < expected.size(); i++)
+		numExpected += expected[i] ? 1 : 0;
+	std::vector<uint16_t> ids = rec.ids();
+	std::string got;
+	for (size_t i = 0; i < ids.size(); i++)
+		got += " " + std::to_string(ids[i]);
+	check(n == numExpected && ids == expected && rec.calledOnce(), name + ", routes got parts" + got);
+
+	// the part list describes the parts of this buffer in buffer order
+	const std::vector<cx::c3d::MultipartRouter::Part>& layout = router.layout();
+	bool ok = layout.size() == parts.size();
+	for (size_t i = 0; i < layout.size() && ok; i++)
+		ok = layout[i].index == int(i) && layout[i].regionId == parts[i].regionId && layout[i].purposeId == parts[i].purposeId && layout[i].typeId == parts[i].typeId;
+	check(ok, name + ", layout");
+}
+
+static void testRouting(cx::ThreadPool* pool)
+{
+	const std::string name = pool ? "thread pool" : "sequential";
+	MultipartSource source;
+	cx::c3d::MultipartRouter router(pool);
+	Recorder rec(3);
+	// 1. without configure() the extraction value is the region
+	router.addRoute(0, rec.handler(0));
+	router.addRoute(1, rec.handler(1));
+	router.addRoute(0, rec.handler(2), CX_BUFFER_PART_PURPOSE_ID_INTENSITY);
+
+	std::vector<TestPart> layout = { g_range0, g_range1, g_intensity0, g_scatter0, g_chunk0 };
+	dispatch(router, source, rec, layout, { RANGE0, RANGE1, INTENSITY0 }, name + ": first buffer");
+	dispatch(router, source, rec, layout, { RANGE0, RANGE1, INTENSITY0 }, name + ": second buffer");
+
+	// 2. reordered layout with the same number of parts
+	std::vector<TestPart> reordered = { g_intensity0, g_chunk0, g_range1, g_scatter0, g_range0 };
+	dispatch(router, source, rec, reordered, { RANGE0, RANGE1, INTENSITY0 }, name + ": reordered layout");
+	dispatch(router, source, rec, layout, { RANGE0, RANGE1, INTENSITY0 }, name + ": first layout again");
+	std::vector<TestPart> swapped = { g_range1, g_range0, g_intensity0, g_scatter0, g_chunk0 };
+	dispatch(router, source, rec, swapped, { RANGE0, RANGE1, INTENSITY0 }, name + ": swapped regions");
+	// same number of parts, region 1 replaced by a second scatter part
+	std::vector<TestPart> replaced = { g_range0, g_scatter0, g_intensity0, g_scatter0, g_chunk0 };
+	dispatch(router, source, rec, replaced, { RANGE0, 0, INTENSITY0 }, name + ": region 1 replaced");
+
+	// 3. fewer parts, no part for a route
+	dispatch(router, source, rec, { g_range1, g_range0 }, { RANGE0, RANGE1, 0 }, name + ": two parts");
+	dispatch(router, source, rec, { g_chunk0 }, { 0, 0, 0 }, name + ": chunk part only");
+	dispatch(router, source, rec, {}, { 0, 0, 0 }, name + ": no parts");
+
+	// two parts with the same region and purpose, the route gets the first one
+	TestPart second = g_range0;
+	second.id = RANGE0_SECOND;
+	dispatch(router, source, rec, { second, g_range1, g_range0 }, { RANGE0_SECOND, RANGE1, 0 }, name + ": two range parts of region 0");
+
+	// a part of another type with the key of a routed part is not routed after reset()
+	TestPart token = g_range1;
+	token.typeId = CX_BUFFER_PART_TYPE_ID_TOKEN;
+	router.reset();
+	dispatch(router, source, rec, { g_range0, token }, { RANGE0, 0, 0 }, name + ": token part after reset");
+	router.reset();
+	dispatch(router, source, rec, layout, { RANGE0, RANGE1, INTENSITY0 }, name + ": first layout after reset");
+
+	// region ids with bits outside the region mask
+	TestPart high0 = g_range0, high1 = g_range1;
+	high0.regionId |= 0x100;
+	high1.regionId |= 0x200;
+	dispatch(router, source, rec, { high1, g_scatter0, high0 }, { RANGE0, RANGE1, 0 }, name + ": region ids with high bits");
+	router.setRegionMask(0xfff);
+	dispatch(router, source, rec, { high1, g_scatter0, high0 }, { 0, 0, 0 }, name + ": region ids with high bits inside the mask");
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		cx::ThreadPool pool(4);
+		testRouting(nullptr);
+		testRouting(&pool);
+	}
+	catch (const std::exception& e)
+	{
+		cout << "exception caught, msg:" << e.what() << endl;
+		exit(-3);
+	}
+
+	if (g_numFailed)
+	{
+		cerr << g_numFailed << " checks failed" << endl;
+		return -1;
+	}
+	cout << "all checks passed" << endl;
+	return 0;
+}
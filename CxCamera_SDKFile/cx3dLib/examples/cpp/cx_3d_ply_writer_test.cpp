@@ -0,0 +1,348 @@
+/**
+@package : cx_3d library
+@file : cx_3d_ply_writer_test.cpp
+@brief C++ test of the binary PLY writer cx::c3d::PlyWriter against the previous writer cx_3d_pointcloud_save.
+
+This example writes point clouds with cx::c3d::PlyWriter and cx::c3d::PointCloud::save and compares the files byte by byte, header included,
+with the files written by the library function cx_3d_pointcloud_save.
+The following steps are demonstrated:
+	1. Binary PLY of CX_PF_COORD3D_ABC32f point clouds without scale and offset, with and without normals and colors: PointCloud::save must write the same file as before
+	2. All point formats (ABC8, ABC16, ABC32f packed and planar, ZMaps C16 and C32f) with scale, offset and invalid points: PlyWriter must write the same file
+	   as cx_3d_pointcloud_save writes for the valid points converted to world coordinates
+	3. Small output buffer: the file must not depend on the buffer size
+	4. ASCII PLY: PointCloud::save must write the same file as cx_3d_pointcloud_save
+
+The example returns -1 if a file differs.
+
+Usage: cx_3d_ply_writer_test [seed]
+
+@copyright (c) 2026, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// C++ Wrapper
+#include "cx_3d_common.h"
+#include "AT/cx/c3d/PointCloud.h"
+#include "AT/cx/c3d/ZMap.h"
+#include "AT/cx/c3d/PlyWriter.h"
+
+using namespace std;
+using namespace AT;
+
+static int g_numFailed = 0;
+
+static const char* g_fileName = "cx_3d_ply_writer_test.ply";
+static const char* g_refFileName = "cx_3d_ply_writer_test_ref.ply";
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		cerr << "FAILED: " << what << endl;
+		g_numFailed++;
+	}
+}
+
+static std::string readFile(const std::string& fileName)
+{
+	std::ifstream f(fileName, std::ios::binary);
+	return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+static std::string header(const std::string& file)
+{
+	size_t pos = file.find("end_header\n");
+	return (pos == std::string::npos) ? file : file.substr(0, pos + 11);
+}
+
+// compares the written file with the file of the previous writer, reports the headers if they differ
+static void checkSameFile(const std::string& name)
+{
+	std::string file = readFile(g_fileName);
+	std::string ref = readFile(g_refFileName);
+	if (file == ref && !file.empty())
+		return;
+	if (header(file) != header(ref))
+		cerr << "header:" << endl << header(file) << "previous header:" << endl << header(ref);
+	check(false, name + ": " + std::to_string(file.size()) + " bytes, previous writer " + std::to_string(ref.size()) + " bytes");
+}
+
+static void writeReference(cx::c3d::PointCloud& pc, bool binary)
+{
+	cx::checkOk(cx_3d_pointcloud_save(g_refFileName, pc.points, pc.hasColors() ? (cx_img_t*)pc.colors : nullptr, pc.hasNormals() ? (cx_img_t*)pc.normals : nullptr, binary));
+}
+
+static bool isPlanar(cx_pixel_format pf)
+{
+	return pf == CX_PF_COORD3D_ABC8_PLANAR || pf == CX_PF_COORD3D_ABC16_PLANAR || pf == CX_PF_COORD3D_ABC32f_PLANAR;
+}
+
+// raw value of coordinate k of point (r, c), the range maps return column and row for k = 0 and 1
+static float rawValue(const cx::Image& img, unsigned r, unsigned c, int k)
+{
+	cx_pixel_format pf = img.pixelFormat();
+	if (pf == CX_PF_COORD3D_C16 || pf == CX_PF_COORD3D_C32f)
+	{
+		if (k < 2)
+			return float(k == 0 ? c : r);
+		return (pf == CX_PF_COORD3D_C16) ? float(img.row<uint16_t>(r)[c]) : img.row<float>(r)[c];
+	}
+	const char* line = (const char*)img.data() + size_t(r) * img.linePitch();
+	size_t idx = isPlanar(pf) ? c : 3 * size_t(c) + k;
+	if (isPlanar(pf))
+		line += k * img.planePitch();
+	if (pf == CX_PF_COORD3D_ABC8 || pf == CX_PF_COORD3D_ABC8_PLANAR)
+		return float(((const uint8_t*)line)[idx]);
+	if (pf == CX_PF_COORD3D_ABC16 || pf == CX_PF_COORD3D_ABC16_PLANAR)
+		return float(((const uint16_t*)line)[idx]);
+	return ((const float*)line)[idx];
+}
+
+static void setRawValue(cx::Image& img, unsigned r, unsigned c, int k, float v)
+{
+	cx_pixel_format pf = img.pixelFormat();
+	if (pf == CX_PF_COORD3D_C16 || pf == CX_PF_COORD3D_C32f)
+	{
+		if (pf == CX_PF_COORD3D_C16)
+			img.row<uint16_t>(r)[c] = uint16_t(v);
+		else
+			img.row<float>(r)[c] = v;
+		return;
+	}
+	char* line = (char*)img.data() + size_t(r) * img.linePitch();
+	size_t idx = isPlanar(pf) ? c : 3 * size_t(c) + k;
+	if (isPlanar(pf))
+		line += k * img.planePitch();
+	if (pf == CX_PF_COORD3D_ABC8 || pf == CX_PF_COORD3D_ABC8_PLANAR)
+		((uint8_t*)line)[idx] = uint8_t(v);
+	else if (pf == CX_PF_COORD3D_ABC16 || pf == CX_PF_COORD3D_ABC16_PLANAR)
+		((uint16_t*)line)[idx] = uint16_t(v);
+	else
+		((float*)line)[idx] = v;
+}
+
+/* Point cloud of the valid points in world coordinates, the input of the previous writer.
+	The compacted layout does not depend on how the previous writer handles NaN points.
+*/
+static void referenceCloud(const cx::c3d::PointCloud& pc, float idv, cx::c3d::PointCloud& ref)
+{
+	unsigned w = pc.points.width(), h = pc.points.height();
+	std::vector<float> pts, nrm;
+	std::vector<uint8_t> col;
+	for (unsigned r = 0; r < h; r++)
+	{
+		for (unsigned c = 0; c < w; c++)
+		{
+			float z = rawValue(pc.points, r, c, 2);
+			if (std::isnan(z) || z == idv)
+				continue;
+			pts.push_back(rawValue(pc.points, r, c, 0) * pc.scale.x + pc.offset.x);
+			pts.push_back(rawValue(pc.points, r, c, 1) * pc.scale.y + pc.offset.y);
+			pts.push_back(z * pc.scale.z + pc.offset.z);
+			if (pc.hasNormals())
+				nrm.insert(nrm.end(), pc.normals.row<float>(r) + 3 * c, pc.normals.row<float>(r) + 3 * c + 3);
+			if (pc.hasColors())
+				col.push_back(pc.colors.row<uint8_t>(r)[c]);
+		}
+	}
+	unsigned n = unsigned(pts.size() / 3);
+	ref.points = cx::Image(1, n, CX_PF_COORD3D_ABC32f);
+	memcpy(ref.points.data(), pts.data(), pts.size() * sizeof(float));
+	if (pc.hasNormals())
+	{
+		ref.normals = cx::Image(1, n, CX_PF_COORD3D_ABC32f);
+		memcpy(ref.normals.data(), nrm.data(), nrm.size() * sizeof(float));
+	}
+	if (pc.hasColors())
+	{
+		ref.colors = cx::Image(1, n, CX_PF_MONO_8);
+		memcpy(ref.colors.data(), col.data(), col.size());
+	}
+}
+
+/* random cloud of format pf, every 5th point is invalid (z = idv), with NaN in z for float formats.
+	The raw values are small integers, so the world coordinates are the same however the previous writer would compute them.
+*/
+static void fillCloud(cx::c3d::PointCloud& pc, float idv, bool withNormals, bool withColors, std::mt19937& rng)
+{
+	std::uniform_int_distribution<int> value(1, 250);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	bool isFloat = pc.points.pixelFormat() == CX_PF_COORD3D_ABC32f || pc.points.pixelFormat() == CX_PF_COORD3D_ABC32f_PLANAR || pc.points.pixelFormat() == CX_PF_COORD3D_C32f;
+	unsigned w = pc.points.width(), h = pc.points.height();
+	if (withNormals)
+		pc.normals = cx::Image(h, w, CX_PF_COORD3D_ABC32f);
+	if (withColors)
+		pc.colors = cx::Image(h, w, CX_PF_MONO_8);
+	for (unsigned r = 0; r < h; r++)
+	{
+		for (unsigned c = 0; c < w; c++)
+		{
+			bool invalid = (r * w + c) % 5 == 2;
+			for (int k = 0; k < 3; k++)
+				setRawValue(pc.points, r, c, k, float(value(rng)));
+			if (invalid)
+				setRawValue(pc.points, r, c, 2, (isFloat && c % 2) ? NAN : idv);
+			if (withNormals)
+				for (int k = 0; k < 3; k++)
+					pc.normals.row<float>(r)[3 * c + k] = unit(rng);
+			if (withColors)
+				pc.colors.row<uint8_t>(r)[c] = uint8_t(value(rng));
+		}
+	}
+}
+
+static std::string formatName(cx_pixel_format pf)
+{
+	switch (pf)
+	{
+	case CX_PF_COORD3D_ABC8:			return "ABC8";
+	case CX_PF_COORD3D_ABC8_PLANAR:		return "ABC8_PLANAR";
+	case CX_PF_COORD3D_ABC16:			return "ABC16";
+	case CX_PF_COORD3D_ABC16_PLANAR:	return "ABC16_PLANAR";
+	case CX_PF_COORD3D_ABC32f:			return "ABC32f";
+	case CX_PF_COORD3D_ABC32f_PLANAR:	return "ABC32f_PLANAR";
+	case CX_PF_COORD3D_C16:				return "C16";
+	case CX_PF_COORD3D_C32f:			return "C32f";
+	default:							return std::to_string(pf);
+	}
+}
+
+// 1. PointCloud::save of ABC32f without scale and offset, this did go through cx_3d_pointcloud_save before
+static void testSave(std::mt19937& rng)
+{
+	for (int variant = 0; variant < 4; variant++)
+	{
+		bool withNormals = (variant & 1) != 0;
+		bool withColors = (variant & 2) != 0;
+		const std::string name = std::string("PointCloud::save binary") + (withNormals ? ", normals" : "") + (withColors ? ", colors" : "");
+		cx::c3d::PointCloud pc(13, 37, CX_PF_COORD3D_ABC32f);
+		fillCloud(pc, NAN, withNormals, withColors, rng);
+		cx::c3d::PointCloud ref;
+		referenceCloud(pc, NAN, ref);
+		pc.save(g_fileName);
+		writeReference(ref, true);
+		checkSameFile(name);
+
+		// without invalid points both writers get the same cloud
+		ref.save(g_fileName);
+		checkSameFile(name + ", compacted cloud");
+	}
+}
+
+// 2. all point formats with scale, offset and invalid points, 3. small output buffer
+static void testFormats(std::mt19937& rng)
+{
+	const cx_pixel_format formats[] = { CX_PF_COORD3D_ABC8, CX_PF_COORD3D_ABC8_PLANAR, CX_PF_COORD3D_ABC16, CX_PF_COORD3D_ABC16_PLANAR,
+		CX_PF_COORD3D_ABC32f, CX_PF_COORD3D_ABC32f_PLANAR, CX_PF_COORD3D_C16, CX_PF_COORD3D_C32f };
+	const unsigned widths[] = { 1, 3, 16, 251 };
+	cx::c3d::PlyWriter smallBuffer(4096);
+	for (cx_pixel_format pf : formats)
+	{
+		// integer formats mark invalid points with 0, C32f ZMaps with a negative value, ABC32f with NaN
+		float idv = (pf == CX_PF_COORD3D_ABC32f || pf == CX_PF_COORD3D_ABC32f_PLANAR) ? NAN : (pf == CX_PF_COORD3D_C32f) ? -1.0f : 0.0f;
+		for (unsigned w : widths)
+		{
+			for (int variant = 0; variant < 4; variant++)
+			{
+				bool withNormals = (variant & 1) != 0;
+				bool withColors = (variant & 2) != 0;
+				const std::string name = formatName(pf) + ", width " + std::to_string(w) + (withNormals ? ", normals" : "") + (withColors ? ", colors" : "");
+				cx::c3d::PointCloud pc(9, w, pf, cx::Point3f(0.5f, 0.25f, 0.125f), cx::Point3f(-10.0f, 20.0f, 300.0f));
+				fillCloud(pc, idv, withNormals, withColors, rng);
+				cx::c3d::PointCloud ref;
+				referenceCloud(pc, idv, ref);
+				writeReference(ref, true);
+
+				cx::c3d::PlyWriter writer;
+				size_t n = writer.write(g_fileName, pc.points, pc.scale, pc.offset, idv, pc.hasNormals() ? &pc.normals : nullptr, pc.hasColors() ? &pc.colors : nullptr);
+				check(n == ref.points.width(), name + ": number of vertices");
+				checkSameFile(name);
+
+				smallBuffer.write(g_fileName, pc.points, pc.scale, pc.offset, idv, pc.hasNormals() ? &pc.normals : nullptr, pc.hasColors() ? &pc.colors : nullptr);
+				checkSameFile(name + ", 4 kB buffer");
+			}
+		}
+	}
+
+	// ZMap::save writes .ply files with the PlyWriter too
+	cx::c3d::ZMap zmap(21, 45, CX_PF_COORD3D_C16, cx::Point3f(0.1f, 0.2f, 0.01f), cx::Point3f(5.0f, -7.0f, 100.0f));
+	zmap.ivd = 0.0f;
+	cx::c3d::PointCloud pc(21, 45, CX_PF_COORD3D_C16, zmap.scale, zmap.offset);
+	fillCloud(pc, zmap.ivd, false, false, rng);
+	for (unsigned r = 0; r < zmap.img.height(); r++)
+		memcpy(zmap.img.row<uint16_t>(r), pc.points.row<uint16_t>(r), size_t(zmap.img.width()) * sizeof(uint16_t));
+	cx::c3d::PointCloud ref;
+	referenceCloud(pc, zmap.ivd, ref);
+	writeReference(ref, true);
+	zmap.save(g_fileName);
+	checkSameFile("ZMap::save");
+}
+
+// 4. ASCII files are still written by cx_3d_pointcloud_save
+static void testAscii(std::mt19937& rng)
+{
+	for (int variant = 0; variant < 4; variant++)
+	{
+		bool withNormals = (variant & 1) != 0;
+		bool withColors = (variant & 2) != 0;
+		const std::string name = std::string("PointCloud::save ascii") + (withNormals ? ", normals" : "") + (withColors ? ", colors" : "");
+		cx::c3d::PointCloud pc(11, 17, CX_PF_COORD3D_ABC32f);
+		fillCloud(pc, NAN, withNormals, withColors, rng);
+		pc.save(g_fileName, false);
+		writeReference(pc, false);
+		checkSameFile(name);
+		const std::string format = "ply\nformat ascii 1.0\n";
+		check(readFile(g_fileName).compare(0, format.size(), format) == 0, name + ": ascii format");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		unsigned seed = (argc > 1) ? (unsigned)atoi(argv[1]) : 1;
+		std::mt19937 rng(seed);
+
+		testSave(rng);
+		testFormats(rng);
+		testAscii(rng);
+
+		remove(g_fileName);
+		remove(g_refFileName);
+	}
+	catch (const std::exception& e)
+	{
+		cout << "exception caught, msg:" << e.what() << endl;
+		exit(-3);
+	}
+
+	if (g_numFailed)
+	{
+		cerr << g_numFailed << " checks failed" << endl;
+		return -1;
+	}
+	cout << "all checks passed" << endl;
+	return 0;
+}
@@ -0,0 +1,455 @@
+/**
+@package : cx_3d library
+@file : cx_3d_pointcloud_normals_test.cpp
+@brief C++ golden tests and benchmark of cx::c3d::PointCloud::computeNormals and cx::c3d::PointCloud::computeBoundingBox.
+
+This example checks the vectorized normal and bounding box calculation of cx::c3d::PointCloud against known results and a scalar reference.
+The following steps are demonstrated:
+	1. Golden tests: a plane and a hemisphere in all supported pixel formats (packed and planar), with widths that are not a multiple of the SIMD width
+	2. Golden tests of the invalid point handling: invalid centre points, one-sided differences, points without valid neighbour
+	3. Golden tests of the bounding box: invalid points, negative scale and offset, centroid and number of valid points
+	4. Randomized comparison with a scalar reference implementation, with and without thread pool
+	5. Benchmark of both functions on a point cloud of default size 2048 x 1000, single threaded and with thread pool
+
+The example returns -1 if a result differs from the expected result by more than the tolerance or if the validity of a point differs.
+
+Usage: cx_3d_pointcloud_normals_test [width] [profiles] [iterations] [seed]
+
+@copyright (c) 2026, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+
+// C++ Wrapper
+#include "cx_3d_common.h"
+#include "AT/cx/ThreadPool.h"
+#include "AT/cx/c3d/PointCloud.h"
+
+using namespace std;
+using namespace AT;
+
+static int g_numFailed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		cerr << "FAILED: " << what << endl;
+		g_numFailed++;
+	}
+}
+
+static bool isPlanar(cx_pixel_format pf)
+{
+	return pf == CX_PF_COORD3D_ABC8_PLANAR || pf == CX_PF_COORD3D_ABC16_PLANAR || pf == CX_PF_COORD3D_ABC32f_PLANAR;
+}
+
+// write point (a, b, c) in raw point units to pixel (x, y) of a packed or planar point image
+static void setPoint(cx::Image& img, unsigned y, unsigned x, float a, float b, float c)
+{
+	const float v[3] = { a, b, c };
+	char* base = (char*)img.data() + size_t(y) * img.linePitch();
+	for (unsigned k = 0; k < 3; k++)
+	{
+		size_t step = isPlanar(img.pixelFormat()) ? 1 : 3;
+		size_t idx = size_t(x) * step + (isPlanar(img.pixelFormat()) ? 0 : k);
+		char* plane = base + (isPlanar(img.pixelFormat()) ? k * img.planePitch() : 0);
+		switch (img.pixelFormat())
+		{
+		case CX_PF_COORD3D_ABC8: case CX_PF_COORD3D_ABC8_PLANAR:		((uint8_t*)plane)[idx] = uint8_t(v[k]); break;
+		case CX_PF_COORD3D_ABC16: case CX_PF_COORD3D_ABC16_PLANAR:		((uint16_t*)plane)[idx] = uint16_t(v[k]); break;
+		default:														((float*)plane)[idx] = v[k]; break;
+		}
+	}
+}
+
+// read point of pixel (x, y) in raw point units
+static void getPoint(const cx::Image& img, unsigned y, unsigned x, float p[3])
+{
+	const char* base = (const char*)img.data() + size_t(y) * img.linePitch();
+	for (unsigned k = 0; k < 3; k++)
+	{
+		size_t step = isPlanar(img.pixelFormat()) ? 1 : 3;
+		size_t idx = size_t(x) * step + (isPlanar(img.pixelFormat()) ? 0 : k);
+		const char* plane = base + (isPlanar(img.pixelFormat()) ? k * img.planePitch() : 0);
+		switch (img.pixelFormat())
+		{
+		case CX_PF_COORD3D_ABC8: case CX_PF_COORD3D_ABC8_PLANAR:		p[k] = float(((const uint8_t*)plane)[idx]); break;
+		case CX_PF_COORD3D_ABC16: case CX_PF_COORD3D_ABC16_PLANAR:		p[k] = float(((const uint16_t*)plane)[idx]); break;
+		default:														p[k] = ((const float*)plane)[idx]; break;
+		}
+	}
+}
+
+// scalar reference of PointCloud::computeNormals, evaluated per pixel without any buffering
+static void referenceNormals(const cx::c3d::PointCloud& pc, float idv, cx::Image& ref)
+{
+	int h = int(pc.points.height()), w = int(pc.points.width());
+	const float s[3] = { pc.scale.x, pc.scale.y, pc.scale.z };
+	auto world = [&](int y, int x, float p[3]) -> bool {
+		if (y < 0 || y >= h || x < 0 || x >= w)
+			return false;
+		getPoint(pc.points, unsigned(y), unsigned(x), p);
+		if (std::isnan(p[2]) || p[2] == idv)
+			return false;
+		for (int k = 0; k < 3; k++)
+			p[k] *= s[k];
+		return true;
+	};
+	ref.create(unsigned(h), unsigned(w), CX_PF_COORD3D_ABC32f);
+	for (int y = 0; y < h; y++)
+	{
+		float* dst = ref.row<float>(unsigned(y));
+		for (int x = 0; x < w; x++)
+		{
+			float c[3], l[3], r[3], t[3], b[3];
+			bool cValid = world(y, x, c);
+			bool lValid = world(y, x - 1, l), rValid = world(y, x + 1, r);
+			bool tValid = world(y - 1, x, t), bValid = world(y + 1, x, b);
+			dst[3 * x] = dst[3 * x + 1] = dst[3 * x + 2] = NAN;
+			if (!cValid || !(lValid || rValid) || !(tValid || bValid))
+				continue;
+			float tx[3], ty[3];
+			for (int k = 0; k < 3; k++)
+			{
+				tx[k] = (rValid ? r[k] : c[k]) - (lValid ? l[k] : c[k]);
+				ty[k] = (bValid ? b[k] : c[k]) - (tValid ? t[k] : c[k]);
+			}
+			double n[3] = { double(tx[1]) * ty[2] - double(tx[2]) * ty[1], double(tx[2]) * ty[0] - double(tx[0]) * ty[2], double(tx[0]) * ty[1] - double(tx[1]) * ty[0] };
+			double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (len == 0.0)
+				continue;
+			if (n[2] < 0)
+				len = -len;
+			for (int k = 0; k < 3; k++)
+				dst[3 * x + k] = float(n[k] / len);
+		}
+	}
+}
+
+// maximum component difference of two normal images, the number of pixels with different validity is returned in numInvalidMismatch
+static double compareNormals(const cx::Image& a, const cx::Image& b, size_t& numInvalidMismatch)
+{
+	double maxDiff = 0.0;
+	numInvalidMismatch = 0;
+	for (unsigned y = 0; y < a.height(); y++)
+	{
+		const float* pa = a.row<float>(y);
+		const float* pb = b.row<float>(y);
+		for (unsigned i = 0; i < 3 * a.width(); i++)
+		{
+			if (std::isnan(pa[i]) || std::isnan(pb[i]))
+			{
+				if (std::isnan(pa[i]) != std::isnan(pb[i]))
+					numInvalidMismatch++;
+				continue;
+			}
+			maxDiff = std::max(maxDiff, std::fabs(double(pa[i]) - double(pb[i])));
+		}
+	}
+	return maxDiff;
+}
+
+static bool isNanNormal(const cx::Image& n, unsigned y, unsigned x)
+{
+	const float* p = n.row<float>(y) + 3 * x;
+	return std::isnan(p[0]) && std::isnan(p[1]) && std::isnan(p[2]);
+}
+
+static bool nearNormal(const cx::Image& n, unsigned y, unsigned x, const double e[3], double tol)
+{
+	const float* p = n.row<float>(y) + 3 * x;
+	for (int k = 0; k < 3; k++)
+	{
+		if (!(std::fabs(double(p[k]) - e[k]) <= tol))
+			return false;
+	}
+	return true;
+}
+
+static std::string formatName(cx_pixel_format pf)
+{
+	switch (pf)
+	{
+	case CX_PF_COORD3D_ABC8:			return "ABC8";
+	case CX_PF_COORD3D_ABC8_PLANAR:		return "ABC8_PLANAR";
+	case CX_PF_COORD3D_ABC16:			return "ABC16";
+	case CX_PF_COORD3D_ABC16_PLANAR:	return "ABC16_PLANAR";
+	case CX_PF_COORD3D_ABC32f:			return "ABC32f";
+	case CX_PF_COORD3D_ABC32f_PLANAR:	return "ABC32f_PLANAR";
+	default:							return "unknown";
+	}
+}
+
+static double msSince(std::chrono::steady_clock::time_point t0)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned width = 2048;
+	unsigned numProfiles = 1000;
+	int numIterations = 20;
+	unsigned seed = 1;
+
+	if (argc > 1)
+		width = std::max(1, atoi(argv[1]));
+	if (argc > 2)
+		numProfiles = std::max(1, atoi(argv[2]));
+	if (argc > 3)
+		numIterations = std::max(1, atoi(argv[3]));
+	if (argc > 4)
+		seed = unsigned(atoi(argv[4]));
+
+	try
+	{
+		const cx_pixel_format formats[] = { CX_PF_COORD3D_ABC8, CX_PF_COORD3D_ABC8_PLANAR, CX_PF_COORD3D_ABC16, CX_PF_COORD3D_ABC16_PLANAR,
+			CX_PF_COORD3D_ABC32f, CX_PF_COORD3D_ABC32f_PLANAR };
+		const size_t numFormats = sizeof(formats) / sizeof(formats[0]);
+		cx::ThreadPool::Ptr pool = cx::ThreadPool::createShared(std::max(2u, std::thread::hardware_concurrency()));
+
+		// 1. plane c = a + 2 * b + 20 in raw units, the normal in world units depends on the scale
+		for (size_t f = 0; f < numFormats; f++)
+		{
+			const unsigned h = 7, w = 13;		// width not a multiple of 4, the SIMD path and the scalar tail are used
+			const cx::Point3f s(0.5f, 0.25f, 2.0f);
+			cx::c3d::PointCloud pc(h, w, formats[f], s);
+			for (unsigned y = 0; y < h; y++)
+				for (unsigned x = 0; x < w; x++)
+					setPoint(pc.points, y, x, float(x), float(y), float(x + 2 * y + 20));
+			// world plane z = (sz / sx) * x + 2 * (sz / sy) * y + const, normal (-dz/dx, -dz/dy, 1)
+			double e[3] = { -s.z / s.x, -2.0 * s.z / s.y, 1.0 };
+			double len = std::sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+			for (int k = 0; k < 3; k++)
+				e[k] /= len;
+			pc.computeNormals();
+			bool ok = pc.normals.pixelFormat() == CX_PF_COORD3D_ABC32f && pc.normals.width() == w && pc.normals.height() == h;
+			for (unsigned y = 0; ok && y < h; y++)
+				for (unsigned x = 0; x < w; x++)
+					ok &= nearNormal(pc.normals, y, x, e, 1e-6);
+			check(ok, "plane normals, " + formatName(formats[f]));
+
+			// 3. bounding box of the plane with negative scale and offset
+			pc.scale = cx::Point3f(-0.5f, 0.25f, 2.0f);
+			pc.offset = cx::Point3f(10.0f, -5.0f, 1.0f);
+			cx::Point3f mn, mx, centroid;
+			size_t count = pc.computeBoundingBox(mn, mx, NAN, &centroid);
+			check(count == size_t(h) * w, "bounding box count, " + formatName(formats[f]));
+			check(mn.x == -0.5f * (w - 1) + 10.0f && mx.x == 10.0f, "bounding box x with negative scale, " + formatName(formats[f]));
+			check(mn.y == -5.0f && mx.y == 0.25f * (h - 1) - 5.0f, "bounding box y, " + formatName(formats[f]));
+			check(mn.z == 2.0f * 20 + 1.0f && mx.z == 2.0f * (w - 1 + 2 * (h - 1) + 20) + 1.0f, "bounding box z, " + formatName(formats[f]));
+			double cz = 2.0 * ((w - 1) / 2.0 + 2.0 * (h - 1) / 2.0 + 20.0) + 1.0;
+			check(std::fabs(centroid.x - (-0.5 * (w - 1) / 2.0 + 10.0)) < 1e-5 && std::fabs(centroid.y - (0.25 * (h - 1) / 2.0 - 5.0)) < 1e-5
+				&& std::fabs(centroid.z - cz) < 1e-4, "bounding box centroid, " + formatName(formats[f]));
+		}
+
+		// 1. hemisphere of radius 100, the normal of a sphere is the normalized position
+		for (size_t f = 0; f < numFormats; f++)
+		{
+			if (formats[f] != CX_PF_COORD3D_ABC32f && formats[f] != CX_PF_COORD3D_ABC32f_PLANAR)
+				continue;
+			const unsigned n = 61;
+			const double radius = 100.0;
+			cx::c3d::PointCloud pc(n, n, formats[f]);
+			for (unsigned y = 0; y < n; y++)
+				for (unsigned x = 0; x < n; x++)
+				{
+					double a = double(x) - n / 2, b = double(y) - n / 2;
+					setPoint(pc.points, y, x, float(a), float(b), float(std::sqrt(radius * radius - a * a - b * b)));
+				}
+			pc.computeNormals(NAN, pool.get());
+			// border points use one-sided differences, the error of the central differences is checked on the inner points only
+			double maxErr = 0.0;
+			for (unsigned y = 1; y + 1 < n; y++)
+				for (unsigned x = 1; x + 1 < n; x++)
+				{
+					float p[3];
+					getPoint(pc.points, y, x, p);
+					const float* nv = pc.normals.row<float>(y) + 3 * x;
+					for (int k = 0; k < 3; k++)
+						maxErr = std::max(maxErr, std::fabs(double(nv[k]) - p[k] / radius));
+				}
+			check(maxErr < 1e-3, "hemisphere normals, " + formatName(formats[f]) + ", max. error " + std::to_string(maxErr));
+		}
+
+		// 2. invalid points: idv and NaN centre points, one-sided differences and points without valid neighbour
+		for (size_t f = 0; f < numFormats; f++)
+		{
+			bool isFloat = formats[f] == CX_PF_COORD3D_ABC32f || formats[f] == CX_PF_COORD3D_ABC32f_PLANAR;
+			const unsigned h = 6, w = 9;
+			const float idv = 0.0f;
+			cx::c3d::PointCloud pc(h, w, formats[f]);
+			for (unsigned y = 0; y < h; y++)
+				for (unsigned x = 0; x < w; x++)
+					setPoint(pc.points, y, x, float(x), float(y), float(x + y + 10));
+			setPoint(pc.points, 2, 3, 3.0f, 2.0f, idv);					// invalid centre, neighbours (2, 2) and (2, 4) become one-sided in x
+			setPoint(pc.points, 4, 6, 6.0f, 4.0f, idv);					// (4, 7) has only a right neighbour in x
+			setPoint(pc.points, 4, 8, 8.0f, 4.0f, idv);					// (4, 7) is isolated in x
+			if (isFloat)
+				setPoint(pc.points, 0, 0, 0.0f, 0.0f, NAN);				// NaN is always invalid
+			pc.computeNormals(idv);
+
+			const double e[3] = { -1.0 / std::sqrt(3.0), -1.0 / std::sqrt(3.0), 1.0 / std::sqrt(3.0) };
+			check(isNanNormal(pc.normals, 2, 3), "normal of invalid point, " + formatName(formats[f]));
+			check(nearNormal(pc.normals, 2, 2, e, 1e-6) && nearNormal(pc.normals, 2, 4, e, 1e-6), "one-sided difference in x, " + formatName(formats[f]));
+			check(nearNormal(pc.normals, 1, 3, e, 1e-6) && nearNormal(pc.normals, 3, 3, e, 1e-6), "one-sided difference in y, " + formatName(formats[f]));
+			check(isNanNormal(pc.normals, 4, 7), "normal without valid neighbour in x, " + formatName(formats[f]));
+			if (isFloat)
+				check(isNanNormal(pc.normals, 0, 0) && nearNormal(pc.normals, 0, 1, e, 1e-6), "normal of NaN point, " + formatName(formats[f]));
+
+			// 3. bounding box skips the invalid points
+			cx::Point3f mn, mx, centroid;
+			size_t count = pc.computeBoundingBox(mn, mx, idv, &centroid);
+			size_t numInvalid = isFloat ? 4 : 3;
+			check(count == size_t(h) * w - numInvalid, "bounding box count with invalid points, " + formatName(formats[f]));
+			check(mn.z == (isFloat ? 11.0f : 10.0f) && mx.z == float(w - 1 + h - 1 + 10), "bounding box z with invalid points, " + formatName(formats[f]));
+		}
+
+		// 3. no valid point
+		{
+			cx::c3d::PointCloud pc(3, 5, CX_PF_COORD3D_ABC32f);
+			for (unsigned y = 0; y < 3; y++)
+				for (unsigned x = 0; x < 5; x++)
+					setPoint(pc.points, y, x, float(x), float(y), NAN);
+			cx::Point3f mn, mx, centroid;
+			size_t count = pc.computeBoundingBox(mn, mx, NAN, &centroid);
+			check(count == 0 && std::isnan(mn.x) && std::isnan(mx.z) && std::isnan(centroid.y), "bounding box without valid point");
+		}
+
+		// 4. randomized comparison with the scalar reference
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> u01(0.0f, 1.0f);
+		double maxNormalDiff = 0.0;
+		for (int it = 0; it < 50; it++)
+		{
+			cx_pixel_format pf = formats[rng() % numFormats];
+			bool isFloat = pf == CX_PF_COORD3D_ABC32f || pf == CX_PF_COORD3D_ABC32f_PLANAR;
+			unsigned h = 1 + rng() % 80, w = 1 + rng() % 150;
+			cx::Point3f s(0.01f + u01(rng), 0.01f + u01(rng), (rng() & 1) ? 0.01f + u01(rng) : -0.01f - u01(rng));
+			cx::Point3f o(100.0f * (u01(rng) - 0.5f), 100.0f * (u01(rng) - 0.5f), 100.0f * (u01(rng) - 0.5f));
+			float idv = isFloat ? -1.0f : 0.0f;
+			float maxVal = (pf == CX_PF_COORD3D_ABC8 || pf == CX_PF_COORD3D_ABC8_PLANAR) ? 255.0f : 65535.0f;
+			cx::c3d::PointCloud pc(h, w, pf, s, o);
+			for (unsigned y = 0; y < h; y++)
+				for (unsigned x = 0; x < w; x++)
+				{
+					// smooth random surface with noise and invalid points
+					float c = std::min(maxVal, std::max(1.0f, maxVal * (0.5f + 0.3f * std::sin(0.1f * x + 0.07f * y)) + 5.0f * (u01(rng) - 0.5f)));
+					if (u01(rng) < 0.1f)
+						c = idv;
+					else if (isFloat && u01(rng) < 0.05f)
+						c = NAN;
+					setPoint(pc.points, y, x, std::min(maxVal, float(x)), std::min(maxVal, float(y)), isFloat ? c : std::floor(c));
+				}
+
+			cx::Image ref;
+			referenceNormals(pc, idv, ref);
+			cx::ThreadPool* pools[2] = { nullptr, pool.get() };
+			for (int p = 0; p < 2; p++)
+			{
+				pc.computeNormals(idv, pools[p]);
+				size_t numInvalidMismatch = 0;
+				double d = compareNormals(ref, pc.normals, numInvalidMismatch);
+				maxNormalDiff = std::max(maxNormalDiff, d);
+				check(d < 1e-5 && numInvalidMismatch == 0, "random normals, " + formatName(pf) + ", " + std::to_string(w) + " x " + std::to_string(h)
+					+ (p ? ", thread pool" : "") + ", difference " + std::to_string(d) + ", invalid points differing " + std::to_string(numInvalidMismatch));
+			}
+
+			// reference bounding box in raw units, then scale and offset
+			double lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY }, sum[3] = { 0, 0, 0 };
+			size_t refCount = 0;
+			for (unsigned y = 0; y < h; y++)
+				for (unsigned x = 0; x < w; x++)
+				{
+					float q[3];
+					getPoint(pc.points, y, x, q);
+					if (std::isnan(q[2]) || q[2] == idv)
+						continue;
+					for (int k = 0; k < 3; k++)
+					{
+						lo[k] = std::min(lo[k], double(q[k]));
+						hi[k] = std::max(hi[k], double(q[k]));
+						sum[k] += q[k];
+					}
+					refCount++;
+				}
+			const float sv[3] = { s.x, s.y, s.z }, ov[3] = { o.x, o.y, o.z };
+			for (int p = 0; p < 2; p++)
+			{
+				cx::Point3f mn, mx, centroid;
+				size_t count = pc.computeBoundingBox(mn, mx, idv, &centroid, pools[p]);
+				bool ok = count == refCount;
+				const float rmn[3] = { mn.x, mn.y, mn.z }, rmx[3] = { mx.x, mx.y, mx.z }, rc[3] = { centroid.x, centroid.y, centroid.z };
+				for (int k = 0; ok && refCount && k < 3; k++)
+				{
+					float a = float(lo[k]) * sv[k] + ov[k], b = float(hi[k]) * sv[k] + ov[k];
+					if (sv[k] < 0)
+						std::swap(a, b);
+					double c = sum[k] / double(refCount) * sv[k] + ov[k];
+					double tol = 1e-6 * std::max(1.0, double(std::max(std::fabs(a), std::fabs(b))));
+					ok &= std::fabs(rmn[k] - a) <= tol && std::fabs(rmx[k] - b) <= tol && std::fabs(rc[k] - c) <= 1e-5 * std::max(1.0, std::fabs(hi[k] - lo[k]) * std::fabs(sv[k]) + std::fabs(c));
+				}
+				check(ok, "random bounding box, " + formatName(pf) + ", " + std::to_string(w) + " x " + std::to_string(h) + (p ? ", thread pool" : ""));
+			}
+		}
+		cout << "golden and randomized tests: " << (g_numFailed ? "FAILED" : "passed") << ", max. normal difference to reference " << maxNormalDiff << endl;
+
+		// 5. benchmark
+		cx::c3d::PointCloud pc(numProfiles, width, CX_PF_COORD3D_ABC32f);
+		for (unsigned y = 0; y < numProfiles; y++)
+			for (unsigned x = 0; x < width; x++)
+				setPoint(pc.points, y, x, float(x), float(y), ((x + 7 * y) % 97 == 0) ? NAN : float(300.0 + 120.0 * std::sin(x * 0.01) * std::cos(y * 0.02)));
+		double mpts = double(width) * numProfiles * 1e-6;
+		cout << "point cloud " << width << " x " << numProfiles << ", " << numIterations << " iterations, pool with " << pool->numThreads() << " threads" << endl;
+		cout << "function             threads   time[ms]   Mpts/s" << endl;
+		for (int p = 0; p < 2; p++)
+		{
+			cx::ThreadPool* tp = p ? pool.get() : nullptr;
+			unsigned numThreads = p ? pool->numThreads() : 1;
+			pc.computeNormals(NAN, tp);		// warm up, allocates the normals
+			auto t0 = std::chrono::steady_clock::now();
+			for (int it = 0; it < numIterations; it++)
+				pc.computeNormals(NAN, tp);
+			double ms = msSince(t0) / numIterations;
+			printf("computeNormals       %7u   %8.2f   %6.1f\n", numThreads, ms, mpts / ms * 1000.0);
+
+			cx::Point3f mn, mx, centroid;
+			t0 = std::chrono::steady_clock::now();
+			for (int it = 0; it < numIterations; it++)
+				pc.computeBoundingBox(mn, mx, NAN, &centroid, tp);
+			ms = msSince(t0) / numIterations;
+			printf("computeBoundingBox   %7u   %8.2f   %6.1f\n", numThreads, ms, mpts / ms * 1000.0);
+		}
+
+		if (g_numFailed)
+			return -1;
+	}
+	catch (std::exception& e)
+	{
+		cout << "exception caught, msg:" << e.what();
+		exit(-3);
+	}
+	return 0;
+}
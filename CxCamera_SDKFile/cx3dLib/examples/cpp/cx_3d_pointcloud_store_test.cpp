@@ -0,0 +1,447 @@
+/**
+@package : cx_3d library
+@file : cx_3d_pointcloud_store_test.cpp
+@brief C++ round trip tests of the point cloud store (AT/cx/c3d/PointCloudStore.h) including truncated and corrupt files.
+
+This example writes point clouds with cx::c3d::PointCloudStoreWriter and reads them back with cx::c3d::PointCloudStoreReader.
+The following steps are demonstrated:
+	1. Round trip of CX_PF_COORD3D_ABC8, ABC16 and ABC32f points with normals and colors, timestamps and encoder values, for row ranges within one block
+	   (zero copy) and across blocks (copied), forEachBlock and the encoder and timestamp index
+	2. Reading while writing: rows become visible with complete blocks and flush(), refresh() maps the grown file
+	3. Truncated files: a file cut in the last block, in the first block, behind the header and within the header. Only the rows of complete blocks
+	   are visible, reading them returns the written data
+	4. Corrupt headers: wrong magic and version, rows per block 0, block sizes which overflow, a row count larger than the file.
+	   Every corrupt file must be rejected with an exception or show only rows within the file.
+
+Run it with AddressSanitizer to detect out of bounds accesses. The example returns -1 if a check fails.
+
+Usage: cx_3d_pointcloud_store_test
+
+@copyright (c) 2026, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <functional>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+// C++ Wrapper
+#include "cx_3d_common.h"
+#include "AT/cx/c3d/PointCloudStore.h"
+
+using namespace std;
+using namespace AT;
+
+static int g_numFailed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		cerr << "FAILED: " << what << endl;
+		g_numFailed++;
+	}
+}
+
+static const std::string FILE_NAME = "cx_3d_pointcloud_store_test.cxpc";
+static const std::string COPY_NAME = "cx_3d_pointcloud_store_test_copy.cxpc";
+
+// value of byte i of row r of a section, the same function creates and checks the data
+static uint8_t pattern(uint64_t r, size_t i, unsigned section)
+{
+	return uint8_t(r * 131 + i * 7 + section * 53);
+}
+
+static void fillImage(cx::Image& img, uint64_t firstRow, unsigned section, size_t rowBytes)
+{
+	for (unsigned r = 0; r < img.height(); r++)
+		for (size_t i = 0; i < rowBytes; i++)
+			img.row<uint8_t>(r)[i] = pattern(firstRow + r, i, section);
+}
+
+static bool checkImage(const cx::Image& img, uint64_t firstRow, unsigned section, size_t rowBytes)
+{
+	for (unsigned r = 0; r < img.height(); r++)
+		for (size_t i = 0; i < rowBytes; i++)
+			if (img.row<uint8_t>(r)[i] != pattern(firstRow + r, i, section))
+				return false;
+	return true;
+}
+
+struct StoreFormat
+{
+	unsigned width;
+	cx_pixel_format pointFormat;
+	bool normals;
+	unsigned colorFormat;
+	unsigned rowsPerBlock;
+};
+
+static size_t pointBytes(const StoreFormat& f) { return size_t(f.width) * cx::c3d::pcsBytesPerPixel(f.pointFormat); }
+static size_t colorBytes(const StoreFormat& f) { return size_t(f.width) * cx::c3d::pcsBytesPerPixel(f.colorFormat); }
+
+// timestamps increase with the row, encoder values count down
+static uint64_t timestampOf(uint64_t r) { return 1000000 + r * 250; }
+static int32_t encoderOf(uint64_t r) { return 5000 - int32_t(r) * 3; }
+
+// append rows [firstRow, firstRow + n) as one point cloud
+static void appendRows(cx::c3d::PointCloudStoreWriter& writer, const StoreFormat& f, uint64_t firstRow, unsigned n)
+{
+	cx::c3d::PointCloud pc;
+	pc.points.create(n, f.width, f.pointFormat);
+	fillImage(pc.points, firstRow, 0, pointBytes(f));
+	if (f.normals)
+	{
+		pc.normals.create(n, f.width, CX_PF_COORD3D_ABC32f);
+		fillImage(pc.normals, firstRow, 1, size_t(f.width) * 12);
+	}
+	if (f.colorFormat)
+	{
+		pc.colors.create(n, f.width, (cx_pixel_format)f.colorFormat);
+		fillImage(pc.colors, firstRow, 2, colorBytes(f));
+	}
+	std::vector<uint64_t> ts(n);
+	std::vector<int32_t> enc(n);
+	for (unsigned i = 0; i < n; i++)
+	{
+		ts[i] = timestampOf(firstRow + i);
+		enc[i] = encoderOf(firstRow + i);
+	}
+	writer.append(pc, ts.data(), enc.data());
+}
+
+static void writeStore(const std::string& fileName, const StoreFormat& f, uint64_t numRows)
+{
+	cx::c3d::PointCloudStoreWriter writer(fileName, f.width, f.pointFormat, cx::Point3f(0.5f, 0.25f, 0.125f), cx::Point3f(1.0f, -2.0f, 3.0f), f.normals, f.colorFormat, f.rowsPerBlock);
+	// uneven chunks, so appends end inside and at the end of blocks
+	uint64_t r = 0;
+	unsigned chunk = 1;
+	while (r < numRows)
+	{
+		unsigned n = (unsigned)std::min<uint64_t>(chunk, numRows - r);
+		appendRows(writer, f, r, n);
+		r += n;
+		chunk = chunk % 13 + 4;
+	}
+	writer.close();
+}
+
+static bool checkRows(const cx::c3d::PointCloud& pc, const StoreFormat& f, uint64_t firstRow, const uint64_t* ts, const int32_t* enc)
+{
+	bool ok = pc.points.width() == f.width && pc.points.pixelFormat() == f.pointFormat && checkImage(pc.points, firstRow, 0, pointBytes(f));
+	if (f.normals)
+		ok = ok && pc.normals.height() == pc.points.height() && checkImage(pc.normals, firstRow, 1, size_t(f.width) * 12);
+	else
+		ok = ok && pc.normals.isEmpty();
+	if (f.colorFormat)
+		ok = ok && pc.colors.height() == pc.points.height() && checkImage(pc.colors, firstRow, 2, colorBytes(f));
+	for (unsigned i = 0; i < pc.points.height() && ok; i++)
+		ok = (!ts || ts[i] == timestampOf(firstRow + i)) && (!enc || enc[i] == encoderOf(firstRow + i));
+	ok = ok && pc.scale.x == 0.5f && pc.scale.y == 0.25f && pc.scale.z == 0.125f && pc.offset.x == 1.0f && pc.offset.y == -2.0f && pc.offset.z == 3.0f;
+	return ok;
+}
+
+static void checkStore(cx::c3d::PointCloudStoreReader& reader, const StoreFormat& f, size_t numRows, const std::string& name)
+{
+	check(reader.numRows() == numRows && reader.width() == f.width && reader.pointFormat() == f.pointFormat && reader.hasNormals() == f.normals
+		&& reader.hasColors() == (f.colorFormat != 0) && reader.rowsPerBlock() == f.rowsPerBlock, name + ": rows " + std::to_string(reader.numRows()) + ", expected " + std::to_string(numRows));
+	if (reader.numRows() != numRows)
+		return;
+	cx::c3d::PointCloud pc;
+	if (numRows == 0)
+	{
+		check(reader.numBlocks() == 0 && reader.getRows(0, 0, pc) && reader.findRowByTimestamp(0) == 0, name + ": empty store");
+		return;
+	}
+
+	// all rows, copied if there is more than one block
+	std::vector<uint64_t> ts;
+	std::vector<int32_t> enc;
+	bool zeroCopy = reader.getRows(0, numRows, pc, &ts, &enc);
+	check(zeroCopy == (numRows <= f.rowsPerBlock) && pc.isMapped() == zeroCopy && pc.points.height() == numRows, name + ": getRows of all rows");
+	check(checkRows(pc, f, 0, ts.data(), enc.data()), name + ": data of all rows");
+
+	// ranges within one block are views of the mapping
+	if (numRows > 2)
+	{
+		size_t r0 = std::min<size_t>(numRows - 2, f.rowsPerBlock - 1);
+		size_t r1 = std::min<size_t>(numRows, (r0 / f.rowsPerBlock + 1) * f.rowsPerBlock);
+		check(reader.getRows(r0, r1, pc, &ts, &enc) && pc.isMapped(), name + ": zero copy within a block");
+		check(checkRows(pc, f, r0, ts.data(), enc.data()), name + ": data within a block");
+	}
+
+	// forEachBlock visits every row once
+	size_t next = 1;
+	bool ok = true;
+	reader.forEachBlock(1, numRows, [&](size_t firstRow, const cx::c3d::PointCloud& part, const uint64_t* t, const int32_t* e) {
+		ok = ok && firstRow == next && part.isMapped() && checkRows(part, f, firstRow, t, e);
+		next += part.points.height();
+	});
+	check(ok && next == std::max<size_t>(numRows, 1), name + ": forEachBlock");
+
+	// index: encoder values count down by 3, timestamps go up by 250
+	size_t e0, e1;
+	uint64_t a = numRows / 3, b = numRows - 1;
+	check(reader.findRowsByEncoder(encoderOf(b), encoderOf(a), e0, e1) && e0 == a && e1 == b + 1, name + ": findRowsByEncoder");
+	check(!reader.findRowsByEncoder(encoderOf(0) + 1, encoderOf(0) + 100, e0, e1), name + ": findRowsByEncoder without match");
+	check(reader.findRowByTimestamp(timestampOf(a) - 10) == a && reader.findRowByTimestamp(timestampOf(b) + 1) == numRows, name + ": findRowByTimestamp");
+
+	bool thrown = false;
+	try
+	{
+		reader.getRows(0, numRows + 1, pc);
+	}
+	catch (const std::out_of_range&)
+	{
+		thrown = true;
+	}
+	check(thrown, name + ": range behind the last row");
+}
+
+static std::vector<uint8_t> readFile(const std::string& fileName)
+{
+	std::vector<uint8_t> data;
+	FILE* f = fopen(fileName.c_str(), "rb");
+	if (f == nullptr)
+		return data;
+	fseek(f, 0, SEEK_END);
+	data.resize((size_t)ftell(f));
+	fseek(f, 0, SEEK_SET);
+	if (!data.empty() && fread(data.data(), data.size(), 1, f) != 1)
+		data.clear();
+	fclose(f);
+	return data;
+}
+
+static void writeFile(const std::string& fileName, const std::vector<uint8_t>& data)
+{
+	FILE* f = fopen(fileName.c_str(), "wb");
+	if (f == nullptr)
+		throw std::runtime_error("can not write " + fileName);
+	if (!data.empty())
+		fwrite(data.data(), data.size(), 1, f);
+	fclose(f);
+}
+
+static void testRoundTrip()
+{
+	const StoreFormat formats[] = {
+		{ 100, CX_PF_COORD3D_ABC32f, true, CX_PF_MONO_16, 16 },
+		{ 33, CX_PF_COORD3D_ABC16, false, CX_PF_MONO_8, 7 },
+		{ 1, CX_PF_COORD3D_ABC8, false, 0, 1 },
+		{ 2048, CX_PF_COORD3D_ABC16, true, 0, 256 },
+	};
+	for (const StoreFormat& f : formats)
+	{
+		const uint64_t rowCounts[] = { 1, f.rowsPerBlock, uint64_t(f.rowsPerBlock) * 3 + 2 };
+		for (uint64_t numRows : rowCounts)
+		{
+			const std::string name = "round trip pf " + std::to_string(f.pointFormat) + ", width " + std::to_string(f.width) + ", rows/block " + std::to_string(f.rowsPerBlock)
+				+ ", rows " + std::to_string(numRows);
+			writeStore(FILE_NAME, f, numRows);
+			cx::c3d::PointCloudStoreReader reader(FILE_NAME);
+			checkStore(reader, f, size_t(numRows), name);
+		}
+	}
+}
+
+static void testReadWhileWriting()
+{
+	const StoreFormat f = { 64, CX_PF_COORD3D_ABC32f, false, CX_PF_MONO_8, 16 };
+	cx::c3d::PointCloudStoreWriter writer(FILE_NAME, f.width, f.pointFormat, cx::Point3f(0.5f, 0.25f, 0.125f), cx::Point3f(1.0f, -2.0f, 3.0f), f.normals, f.colorFormat, f.rowsPerBlock);
+	appendRows(writer, f, 0, 10);
+	cx::c3d::PointCloudStoreReader reader(FILE_NAME);
+	check(reader.numRows() == 0, "rows before the first block is complete are not visible");
+	appendRows(writer, f, 10, 30);
+	check(reader.refresh() == 32, "complete blocks are visible after refresh");
+	cx::c3d::PointCloud early;
+	reader.getRows(16, 32, early);
+	writer.flush();
+	check(reader.refresh() == 40, "flushed rows are visible after refresh");
+	appendRows(writer, f, 40, 100);
+	writer.close();
+	checkStore(reader, f, 40, "reader before refresh");
+	reader.refresh();
+	checkStore(reader, f, 140, "reader after refresh");
+	// a view taken before the file was mapped again keeps the old mapping alive
+	check(early.isMapped() && checkRows(early, f, 16, nullptr, nullptr), "view of a previous mapping");
+}
+
+static void testTruncated()
+{
+	const StoreFormat f = { 50, CX_PF_COORD3D_ABC16, true, CX_PF_MONO_16, 8 };
+	const uint64_t numRows = 8 * 5 + 3;
+	writeStore(FILE_NAME, f, numRows);
+	const std::vector<uint8_t> valid = readFile(FILE_NAME);
+	cx::c3d::PcsFileHeader hdr;
+	memcpy(&hdr, valid.data(), sizeof(hdr));
+	check(valid.size() == hdr.dataOffset + 6 * hdr.blockSize && hdr.numRows == numRows, "file size of the store");
+
+	// cut in the last, in the second and in the first block, directly behind the header page: only the rows of complete blocks are visible
+	const size_t cuts[] = { 5, 1, 0 };
+	for (size_t completeBlocks : cuts)
+	{
+		for (size_t extra : { size_t(0), size_t(100), size_t(hdr.blockSize - 1) })
+		{
+			std::vector<uint8_t> data(valid.begin(), valid.begin() + size_t(hdr.dataOffset + completeBlocks * hdr.blockSize + extra));
+			writeFile(COPY_NAME, data);
+			cx::c3d::PointCloudStoreReader reader(COPY_NAME);
+			checkStore(reader, f, completeBlocks * f.rowsPerBlock, "truncated to " + std::to_string(data.size()) + " bytes");
+		}
+	}
+
+	// cut within the header page, the header is complete
+	{
+		std::vector<uint8_t> data(valid.begin(), valid.begin() + 1000);
+		writeFile(COPY_NAME, data);
+		cx::c3d::PointCloudStoreReader reader(COPY_NAME);
+		check(reader.numRows() == 0 && reader.numBlocks() == 0, "truncated within the header page");
+	}
+
+	// cut within the header
+	for (size_t size : { size_t(0), size_t(4), sizeof(cx::c3d::PcsFileHeader) - 1 })
+	{
+		std::vector<uint8_t> data(valid.begin(), valid.begin() + size);
+		writeFile(COPY_NAME, data);
+		bool thrown = false;
+		try
+		{
+			cx::c3d::PointCloudStoreReader reader(COPY_NAME);
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+		check(thrown, "truncated to " + std::to_string(size) + " bytes, within the header");
+	}
+}
+
+// corrupt the header of a valid store, the reader must throw or show only rows within the file
+static void expectSafe(const std::vector<uint8_t>& valid, const std::string& what, bool mustThrow, const std::function<void(cx::c3d::PcsFileHeader&)>& corrupt)
+{
+	std::vector<uint8_t> data = valid;
+	cx::c3d::PcsFileHeader hdr;
+	memcpy(&hdr, data.data(), sizeof(hdr));
+	corrupt(hdr);
+	memcpy(data.data(), &hdr, sizeof(hdr));
+	writeFile(COPY_NAME, data);
+
+	bool thrown = false;
+	try
+	{
+		cx::c3d::PointCloudStoreReader reader(COPY_NAME);
+		// touch every visible row
+		size_t rows = reader.numRows();
+		reader.forEachBlock(0, rows, [](size_t, const cx::c3d::PointCloud& part, const uint64_t* ts, const int32_t* enc) {
+			volatile uint64_t sum = 0;
+			for (unsigned r = 0; r < part.points.height(); r++)
+				sum = sum + part.points.row<uint8_t>(r)[0] + ts[r] + uint64_t(enc[r]);
+		});
+		size_t e0, e1;
+		reader.findRowsByEncoder(-1000000, 1000000, e0, e1);
+		reader.findRowByTimestamp(~uint64_t(0));
+		reader.refresh();
+	}
+	catch (const std::exception&)
+	{
+		thrown = true;
+	}
+	check(thrown || !mustThrow, "corrupt header not rejected: " + what);
+}
+
+static void testCorrupt()
+{
+	const StoreFormat f = { 20, CX_PF_COORD3D_ABC32f, false, 0, 4 };
+	writeStore(FILE_NAME, f, 10);
+	const std::vector<uint8_t> valid = readFile(FILE_NAME);
+	typedef cx::c3d::PcsFileHeader Hdr;
+
+	expectSafe(valid, "wrong magic", true, [](Hdr& h) { h.magic = 0x12345678; });
+	expectSafe(valid, "wrong version", true, [](Hdr& h) { h.version = 7; });
+	expectSafe(valid, "unsupported point format", true, [](Hdr& h) { h.pointFormat = CX_PF_MONO_8; });
+	expectSafe(valid, "rows per block 0", true, [](Hdr& h) { h.rowsPerBlock = 0; });
+	expectSafe(valid, "width changed, layout does not match", true, [](Hdr& h) { h.width = 21; });
+	expectSafe(valid, "block size overflows 64 bit", true, [](Hdr& h) {
+		// consistent header whose section sizes wrap around when computed in 64 bit
+		h.width = 0xFFFFFFFFu;
+		h.rowsPerBlock = 0xFFFFFFFFu;
+		h.normalFormat = CX_PF_COORD3D_ABC32f;
+		h.colorFormat = CX_PF_MONO_16;
+		uint64_t pos = sizeof(cx::c3d::PcsBlockHeader);
+		const uint64_t bpp[cx::c3d::PCS_NUM_SECTIONS] = { 12, 12, 2, 0, 0 };
+		for (int s = 0; s < cx::c3d::PCS_NUM_SECTIONS; s++)
+		{
+			uint64_t rowBytes = (s == cx::c3d::PCS_SECTION_TIMESTAMPS) ? 8 : (s == cx::c3d::PCS_SECTION_ENCODER) ? 4 : uint64_t(h.width) * bpp[s];
+			pos = (pos + cx::c3d::PCS_ALIGN - 1) / cx::c3d::PCS_ALIGN * cx::c3d::PCS_ALIGN;
+			h.sectionOffset[s] = pos;
+			pos += rowBytes * h.rowsPerBlock;
+		}
+		h.blockSize = (pos + cx::c3d::PCS_PAGE - 1) / cx::c3d::PCS_PAGE * cx::c3d::PCS_PAGE;
+	});
+	expectSafe(valid, "row count within a block", false, [](Hdr& h) { h.numRows = 6; });
+	{
+		// the block headers are part of the data, they must not be used as row range
+		std::vector<uint8_t> data = valid;
+		cx::c3d::PcsFileHeader hdr;
+		memcpy(&hdr, data.data(), sizeof(hdr));
+		cx::c3d::PcsBlockHeader bh;
+		uint8_t* blk = data.data() + size_t(hdr.dataOffset + hdr.blockSize);
+		memcpy(&bh, blk, sizeof(bh));
+		bh.firstRow = ~uint64_t(0) - 1;
+		bh.numRows = 0xFFFFFFF0u;
+		bh.minEncoder = -1000000;
+		bh.maxEncoder = 1000000;
+		bh.maxTimestamp = ~uint64_t(0);
+		memcpy(blk, &bh, sizeof(bh));
+		expectSafe(data, "corrupt block header", false, [](Hdr&) {});
+		cx::c3d::PointCloudStoreReader reader(COPY_NAME);
+		size_t e0, e1;
+		check(reader.findRowsByEncoder(encoderOf(5), encoderOf(5), e0, e1) && e0 == 5 && e1 == 6, "findRowsByEncoder with corrupt block header");
+		check(reader.findRowByTimestamp(timestampOf(6)) == 6, "findRowByTimestamp with corrupt block header");
+	}
+	expectSafe(valid, "row count larger than the file", false, [](Hdr& h) { h.numRows = 1000; });
+	expectSafe(valid, "row count wraps the file size", false, [](Hdr& h) { h.numRows = ~uint64_t(0) - 2; });
+	expectSafe(valid, "row count 2^62", false, [](Hdr& h) { h.numRows = uint64_t(1) << 62; });
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		testRoundTrip();
+		testReadWhileWriting();
+		testTruncated();
+		testCorrupt();
+		remove(FILE_NAME.c_str());
+		remove(COPY_NAME.c_str());
+	}
+	catch (const std::exception& e)
+	{
+		cout << "exception caught, msg:" << e.what() << endl;
+		exit(-3);
+	}
+
+	if (g_numFailed)
+	{
+		cerr << g_numFailed << " checks failed" << endl;
+		return -1;
+	}
+	cout << "all checks passed" << endl;
+	return 0;
+}
@@ -0,0 +1,257 @@
+/**
+@package : cx_3d library
+@file : cx_3d_zmap_file_test.cpp
+@brief C++ round trip and corrupt header tests of the native Z-Map file format (AT/cx/c3d/ZMapFile.h).
+
+This example writes Z-Map images with cx::c3d::saveZMapFile and reads them back with cx::c3d::loadZMapFile and cx::c3d::mapZMapFile.
+The following steps are demonstrated:
+	1. Round trip of CX_PF_COORD3D_C32f and CX_PF_COORD3D_C16 images with row padding in the source image and in the file, widths 1 to 100
+	2. Round trip of zstd compressed files with different rows per block (only if built with CX_C3D_WITH_ZSTD)
+	3. Corrupt headers: wrong magic and version, truncated data, line pitch and height whose product overflows, block tables out of range,
+	   compressed files with row padding. Every corrupt file must be rejected with an exception instead of reading outside the file or the image.
+
+Run it with AddressSanitizer to detect out of bounds accesses. The example returns -1 if a check fails.
+
+Usage: cx_3d_zmap_file_test
+
+@copyright (c) 2026, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <functional>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+// C++ Wrapper
+#include "cx_3d_common.h"
+#include "AT/cx/c3d/ZMapFile.h"
+
+using namespace std;
+using namespace AT;
+
+static int g_numFailed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		cerr << "FAILED: " << what << endl;
+		g_numFailed++;
+	}
+}
+
+static const std::string FILE_NAME = "cx_3d_zmap_file_test.zmap";
+
+// Z-Map with row padding in the source image, values depend on row and column
+static cx::Image createZMap(unsigned h, unsigned w, cx_pixel_format pf, std::vector<uint8_t>& storage)
+{
+	unsigned bpp = cx::c3d::zmapBytesPerPixel(pf);
+	size_t pitch = size_t(w) * bpp + 24;
+	storage.assign(pitch * h, 0xEE);
+	cx::Image img(h, w, pf, storage.data(), storage.size(), pitch);
+	for (unsigned y = 0; y < h; y++)
+		for (unsigned x = 0; x < w; x++)
+		{
+			if (pf == CX_PF_COORD3D_C32f)
+				img.row<float>(y)[x] = ((x + y) % 11 == 0) ? -1.0f : float(y) * 100.0f + float(x) * 0.25f;
+			else
+				img.row<uint16_t>(y)[x] = uint16_t(y * 1000 + x);
+		}
+	return img;
+}
+
+static bool sameRows(const cx::Image& a, const cx::Image& b)
+{
+	if (a.width() != b.width() || a.height() != b.height() || a.pixelFormat() != b.pixelFormat())
+		return false;
+	size_t rowBytes = size_t(a.width()) * cx::c3d::zmapBytesPerPixel(a.pixelFormat());
+	for (unsigned y = 0; y < a.height(); y++)
+		if (memcmp(((cx::Image&)a).row<uint8_t>(y), ((cx::Image&)b).row<uint8_t>(y), rowBytes) != 0)
+			return false;
+	return true;
+}
+
+static void roundTrip(unsigned h, unsigned w, cx_pixel_format pf, cx::c3d::zmap_compression compression, unsigned rowsPerBlock)
+{
+	const std::string name = "round trip " + std::to_string(w) + "x" + std::to_string(h) + " pf " + std::to_string(pf) + " compression " + std::to_string(compression)
+		+ " rows/block " + std::to_string(rowsPerBlock);
+	std::vector<uint8_t> storage;
+	cx::Image img = createZMap(h, w, pf, storage);
+	const cx::Point3f scale(0.5f, 0.25f, 0.125f), offset(-10.0f, 20.0f, 5.5f);
+	cx::c3d::saveZMapFile(FILE_NAME, img, scale, offset, -1.0f, compression, rowsPerBlock);
+
+	cx::Image loaded;
+	cx::Point3f s, o;
+	float ivd = 0.0f;
+	cx::c3d::loadZMapFile(FILE_NAME, loaded, s, o, ivd);
+	check(sameRows(img, loaded), name + ": loaded data");
+	check(s.x == scale.x && s.y == scale.y && s.z == scale.z && o.x == offset.x && o.y == offset.y && o.z == offset.z && ivd == -1.0f, name + ": scale, offset and ivd");
+
+	cx::Image mapped;
+	cx::MappedFile::Ptr file = cx::c3d::mapZMapFile(FILE_NAME, mapped, s, o, ivd);
+	check(sameRows(img, mapped), name + ": mapped data");
+	if (compression == cx::c3d::ZMAP_COMPRESSION_NONE)
+		check(file && mapped.linePitch() % cx::c3d::ZMAP_FILE_ALIGN == 0 && mapped.data() == file->data() + sizeof(cx::c3d::ZMapFileHeader), name + ": mapped without copy");
+}
+
+static std::vector<uint8_t> readFile(const std::string& fileName)
+{
+	std::vector<uint8_t> data;
+	FILE* f = fopen(fileName.c_str(), "rb");
+	if (f == nullptr)
+		return data;
+	fseek(f, 0, SEEK_END);
+	data.resize((size_t)ftell(f));
+	fseek(f, 0, SEEK_SET);
+	if (!data.empty() && fread(data.data(), data.size(), 1, f) != 1)
+		data.clear();
+	fclose(f);
+	return data;
+}
+
+static void writeFile(const std::string& fileName, const std::vector<uint8_t>& data)
+{
+	FILE* f = fopen(fileName.c_str(), "wb");
+	if (f == nullptr)
+		throw std::runtime_error("can not write " + fileName);
+	if (!data.empty())
+		fwrite(data.data(), data.size(), 1, f);
+	fclose(f);
+}
+
+// modify a valid file, both load functions must throw std::runtime_error
+static void expectRejected(const std::vector<uint8_t>& valid, const std::string& what, const std::function<void(cx::c3d::ZMapFileHeader&, std::vector<uint8_t>&)>& corrupt)
+{
+	std::vector<uint8_t> data = valid;
+	cx::c3d::ZMapFileHeader hdr;
+	memcpy(&hdr, data.data(), sizeof(hdr));
+	corrupt(hdr, data);
+	if (data.size() >= sizeof(hdr))
+		memcpy(data.data(), &hdr, sizeof(hdr));
+	writeFile(FILE_NAME, data);
+
+	for (int mode = 0; mode < 2; mode++)
+	{
+		bool rejected = false;
+		try
+		{
+			cx::Image img;
+			cx::Point3f s, o;
+			float ivd;
+			if (mode == 0)
+				cx::c3d::loadZMapFile(FILE_NAME, img, s, o, ivd);
+			else
+				cx::MappedFile::Ptr file = cx::c3d::mapZMapFile(FILE_NAME, img, s, o, ivd);
+		}
+		catch (const std::runtime_error&)
+		{
+			rejected = true;
+		}
+		check(rejected, "corrupt file not rejected (" + std::string(mode == 0 ? "load" : "map") + "): " + what);
+	}
+}
+
+static void corruptHeaders()
+{
+	std::vector<uint8_t> storage;
+	const unsigned h = 20, w = 30;
+	cx::Image img = createZMap(h, w, CX_PF_COORD3D_C32f, storage);
+	cx::c3d::saveZMapFile(FILE_NAME, img, cx::Point3f(1, 1, 1), cx::Point3f(0, 0, 0), -1.0f);
+	const std::vector<uint8_t> valid = readFile(FILE_NAME);
+	typedef cx::c3d::ZMapFileHeader Hdr;
+	typedef std::vector<uint8_t> Data;
+
+	expectRejected(valid, "empty file", [](Hdr&, Data& d) { d.clear(); });
+	expectRejected(valid, "header only partially", [](Hdr&, Data& d) { d.resize(sizeof(Hdr) / 2); });
+	expectRejected(valid, "wrong magic", [](Hdr& hdr, Data&) { hdr.magic = 0x12345678; });
+	expectRejected(valid, "wrong version", [](Hdr& hdr, Data&) { hdr.version = 99; });
+	expectRejected(valid, "unsupported pixel format", [](Hdr& hdr, Data&) { hdr.pixelFormat = CX_PF_MONO_8; });
+	expectRejected(valid, "truncated data", [](Hdr&, Data& d) { d.resize(d.size() - 100); });
+	expectRejected(valid, "height larger than the data", [](Hdr& hdr, Data&) { hdr.height += 1; });
+	expectRejected(valid, "line pitch * height overflows 64 bit", [](Hdr& hdr, Data&) { hdr.linePitch = uint64_t(1) << 62; hdr.height = 8; });
+	expectRejected(valid, "line pitch * height wraps to the data size", [](Hdr& hdr, Data&) { hdr.height = 4; hdr.linePitch = (uint64_t(1) << 62) + hdr.dataSize / 4; });
+	expectRejected(valid, "line pitch smaller than a row", [](Hdr& hdr, Data&) { hdr.linePitch = hdr.width * 4 - 4; });
+	expectRejected(valid, "width * bytes per pixel larger than the line pitch", [](Hdr& hdr, Data&) { hdr.width = 0xFFFFFFFFu; });
+	expectRejected(valid, "data offset behind the end", [](Hdr& hdr, Data& d) { hdr.dataOffset = d.size() + 1; });
+	expectRejected(valid, "data offset inside the header", [](Hdr& hdr, Data&) { hdr.dataOffset = 16; });
+	expectRejected(valid, "data size larger than the file", [](Hdr& hdr, Data&) { hdr.dataSize += 1; });
+	expectRejected(valid, "data size wraps around", [](Hdr& hdr, Data&) { hdr.dataSize = ~uint64_t(0); });
+	expectRejected(valid, "rows per block 0", [](Hdr& hdr, Data&) { hdr.rowsPerBlock = 0; });
+	expectRejected(valid, "unknown compression", [](Hdr& hdr, Data&) { hdr.compression = 7; hdr.linePitch = hdr.width * 4; });
+
+	// compressed files: the header check runs before the decompression, so these are rejected also without zstd support
+	expectRejected(valid, "compressed rows with padding, decompressed rows larger than the image rows",
+		[](Hdr& hdr, Data&) { hdr.compression = cx::c3d::ZMAP_COMPRESSION_ZSTD; hdr.linePitch = hdr.width * 4 + 64; });
+
+#if defined(CX_C3D_WITH_ZSTD)
+	cx::c3d::saveZMapFile(FILE_NAME, img, cx::Point3f(1, 1, 1), cx::Point3f(0, 0, 0), -1.0f, cx::c3d::ZMAP_COMPRESSION_ZSTD, 8);
+	const std::vector<uint8_t> packed = readFile(FILE_NAME);
+	const size_t tablePos = sizeof(Hdr);
+	expectRejected(packed, "compressed, block offset behind the end", [tablePos](Hdr&, Data& d) { uint64_t v = d.size(); memcpy(&d[tablePos], &v, sizeof(v)); });
+	expectRejected(packed, "compressed, block size wraps around", [tablePos](Hdr&, Data& d) { uint64_t v = ~uint64_t(0) - 8; memcpy(&d[tablePos + 8], &v, sizeof(v)); });
+	expectRejected(packed, "compressed, block table larger than the data", [](Hdr& hdr, Data&) { hdr.dataSize = 8; });
+	expectRejected(packed, "compressed, rows per block overflows the row index", [](Hdr& hdr, Data&) { hdr.rowsPerBlock = 0xFFFFFFF0u; });
+	expectRejected(packed, "compressed, corrupt block data", [](Hdr& hdr, Data& d) { memset(&d[(size_t)hdr.dataOffset + 3 * sizeof(cx::c3d::ZMapFileBlock) + 4], 0x55, 16); });
+	expectRejected(packed, "compressed, more rows than compressed", [](Hdr& hdr, Data&) { hdr.height += 1; });
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// 1. uncompressed, widths with and without row padding in the file
+		const unsigned widths[] = { 1, 3, 16, 17, 100 };
+		for (unsigned w : widths)
+		{
+			roundTrip(5, w, CX_PF_COORD3D_C32f, cx::c3d::ZMAP_COMPRESSION_NONE, 64);
+			roundTrip(5, w, CX_PF_COORD3D_C16, cx::c3d::ZMAP_COMPRESSION_NONE, 64);
+		}
+		roundTrip(0, 10, CX_PF_COORD3D_C32f, cx::c3d::ZMAP_COMPRESSION_NONE, 64);
+
+#if defined(CX_C3D_WITH_ZSTD)
+		// 2. compressed, blocks smaller, equal and larger than the image
+		const unsigned rowsPerBlock[] = { 1, 7, 37, 1000 };
+		for (unsigned rpb : rowsPerBlock)
+		{
+			roundTrip(37, 17, CX_PF_COORD3D_C32f, cx::c3d::ZMAP_COMPRESSION_ZSTD, rpb);
+			roundTrip(37, 100, CX_PF_COORD3D_C16, cx::c3d::ZMAP_COMPRESSION_ZSTD, rpb);
+		}
+#else
+		cout << "built without CX_C3D_WITH_ZSTD, compressed round trips skipped" << endl;
+#endif
+
+		// 3. corrupt headers
+		corruptHeaders();
+		remove(FILE_NAME.c_str());
+	}
+	catch (const std::exception& e)
+	{
+		cout << "exception caught, msg:" << e.what() << endl;
+		exit(-3);
+	}
+
+	if (g_numFailed)
+	{
+		cerr << g_numFailed << " checks failed" << endl;
+		return -1;
+	}
+	cout << "all checks passed" << endl;
+	return 0;
+}
@@ -0,0 +1,257 @@
+/**
+@package : cx_3d library
+@file : cx_3d_zmap_pointcloud_test.cpp
+@brief C++ golden tests of cx::c3d::convertToPointCloud for the organized and the compacted point cloud layout.
+
+This example checks the conversion of a ZMap into a point cloud against a scalar reference implementation.
+The following steps are demonstrated:
+	1. Organized layout: every point against the scalar reference, invalid pixels keep the invalid data value, widths that are not a multiple of the SIMD width
+	2. Compacted layout: the points together with the index map must reproduce the organized output at the valid pixels, the index map must list
+	   every valid pixel once in row major order. This compares the prefix sum and SSE2 path with the scalar reference.
+	3. Special rows: rows without valid pixel, rows with valid pixels only, ZMaps without valid pixel, NaN values in CX_PF_COORD3D_C32f
+	4. Thread pool: organized and compacted output with thread pool must equal the single threaded output bit by bit
+
+The example returns -1 if a result differs from the expected result by more than the tolerance.
+
+Usage: cx_3d_zmap_pointcloud_test [seed]
+
+@copyright (c) 2026, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// C++ Wrapper
+#include "cx_3d_common.h"
+#include "AT/cx/ThreadPool.h"
+#include "AT/cx/c3d/ZMap.h"
+
+using namespace std;
+using namespace AT;
+
+static int g_numFailed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		cerr << "FAILED: " << what << endl;
+		g_numFailed++;
+	}
+}
+
+static bool near(float a, float b)
+{
+	if (std::isnan(a) || std::isnan(b))
+		return std::isnan(a) && std::isnan(b);
+	return std::fabs(a - b) <= 1e-5f * std::max(1.0f, std::fabs(b));
+}
+
+static float zValue(const cx::c3d::ZMap& zmap, unsigned r, unsigned c)
+{
+	if (zmap.img.pixelFormat() == CX_PF_COORD3D_C16)
+		return float(zmap.img.row<uint16_t>(r)[c]);
+	return zmap.img.row<float>(r)[c];
+}
+
+// scalar reference of one organized point
+static void referencePoint(const cx::c3d::ZMap& zmap, unsigned r, unsigned c, float ivd, float* p)
+{
+	float z = zValue(zmap, r, c);
+	p[0] = float(c) * zmap.scale.x + zmap.offset.x;
+	p[1] = float(r) * zmap.scale.y + zmap.offset.y;
+	p[2] = (z == ivd) ? z : z * zmap.scale.z + zmap.offset.z;
+}
+
+static bool isValid(const cx::c3d::ZMap& zmap, unsigned r, unsigned c, float ivd)
+{
+	float z = zValue(zmap, r, c);
+	return !std::isnan(z) && z != ivd;
+}
+
+/* random ZMap, row r % 7 == 3 has no valid pixel, row r % 7 == 5 has valid pixels only, other rows have the given ratio of invalid pixels.
+*/
+static void fillZMap(cx::c3d::ZMap& zmap, float ivd, double invalidRatio, std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> value(0.0f, 4000.0f);
+	std::uniform_real_distribution<double> coin(0.0, 1.0);
+	bool isFloat = zmap.img.pixelFormat() == CX_PF_COORD3D_C32f;
+	for (unsigned r = 0; r < zmap.img.height(); r++)
+	{
+		for (unsigned c = 0; c < zmap.img.width(); c++)
+		{
+			bool invalid = (r % 7 == 3) || ((r % 7 != 5) && coin(rng) < invalidRatio);
+			float v = invalid ? ivd : value(rng);
+			// NaN is invalid too, only representable in C32f
+			if (isFloat && invalid && coin(rng) < 0.3)
+				v = NAN;
+			if (isFloat)
+				zmap.img.row<float>(r)[c] = v;
+			else
+				zmap.img.row<uint16_t>(r)[c] = uint16_t(v);
+		}
+	}
+}
+
+static bool sameBits(const cx::Image& a, const cx::Image& b)
+{
+	if (a.width() != b.width() || a.height() != b.height())
+		return false;
+	for (unsigned r = 0; r < a.height(); r++)
+		if (memcmp(a.row<float>(r), b.row<float>(r), size_t(a.width()) * 3 * sizeof(float)) != 0)
+			return false;
+	return true;
+}
+
+static void testZMap(const cx::c3d::ZMap& zmap, float ivd, cx::ThreadPool& pool, const std::string& name)
+{
+	unsigned w = zmap.img.width();
+	unsigned h = zmap.img.height();
+
+	// 1. organized layout against the scalar reference
+	cx::c3d::PointCloud organized;
+	std::vector<uint32_t> indexMap(5, 7);
+	size_t n = cx::c3d::convertToPointCloud(zmap, organized, ivd, cx::c3d::POINTCLOUD_ORGANIZED, &indexMap);
+	check(n == size_t(w) * h && organized.points.width() == w && organized.points.height() == h && indexMap.empty(), name + ": organized size");
+	bool ok = true;
+	size_t numValid = 0;
+	for (unsigned r = 0; r < h && ok; r++)
+	{
+		for (unsigned c = 0; c < w; c++)
+		{
+			float ref[3];
+			referencePoint(zmap, r, c, ivd, ref);
+			const float* p = organized.points.row<float>(r) + 3 * c;
+			ok = ok && near(p[0], ref[0]) && near(p[1], ref[1]) && near(p[2], ref[2]);
+			numValid += isValid(zmap, r, c, ivd) ? 1 : 0;
+		}
+	}
+	check(ok, name + ": organized points vs scalar reference");
+
+	// 2. compacted layout with index map reproduces the organized output
+	cx::c3d::PointCloud compacted;
+	n = cx::c3d::convertToPointCloud(zmap, compacted, ivd, cx::c3d::POINTCLOUD_COMPACTED, &indexMap);
+	check(n == numValid && indexMap.size() == numValid && compacted.points.width() == numValid && compacted.points.height() == (numValid ? 1u : 0u),
+		name + ": compacted size " + std::to_string(n) + ", valid pixels " + std::to_string(numValid));
+	if (indexMap.size() == numValid && compacted.points.width() == numValid)
+	{
+		ok = true;
+		for (size_t k = 0; k < numValid && ok; k++)
+		{
+			uint32_t idx = indexMap[k];
+			ok = idx < size_t(w) * h && (k == 0 || idx > indexMap[k - 1]);
+			if (!ok)
+				break;
+			unsigned r = idx / w, c = idx % w;
+			const float* p = compacted.points.row<float>(0) + 3 * k;
+			const float* q = organized.points.row<float>(r) + 3 * c;
+			ok = isValid(zmap, r, c, ivd) && p[0] == q[0] && p[1] == q[1] && near(p[2], q[2]);
+		}
+		// strictly increasing indices of valid pixels only and as many as valid pixels: every valid pixel is listed once
+		check(ok, name + ": compacted points and index map vs organized points");
+	}
+
+	// the index map is optional
+	cx::c3d::PointCloud withoutMap;
+	n = cx::c3d::convertToPointCloud(zmap, withoutMap, ivd, cx::c3d::POINTCLOUD_COMPACTED);
+	check(n == numValid && sameBits(compacted.points, withoutMap.points), name + ": compacted without index map");
+
+	// 4. thread pool
+	cx::c3d::PointCloud parallel;
+	std::vector<uint32_t> parallelMap;
+	cx::c3d::convertToPointCloud(zmap, parallel, ivd, cx::c3d::POINTCLOUD_ORGANIZED, nullptr, &pool);
+	check(sameBits(organized.points, parallel.points), name + ": organized with thread pool");
+	cx::c3d::convertToPointCloud(zmap, parallel, ivd, cx::c3d::POINTCLOUD_COMPACTED, &parallelMap, &pool);
+	check(sameBits(compacted.points, parallel.points) && parallelMap == indexMap, name + ": compacted with thread pool");
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		unsigned seed = (argc > 1) ? (unsigned)atoi(argv[1]) : 1;
+		std::mt19937 rng(seed);
+		cx::ThreadPool pool(4);
+
+		const unsigned widths[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 64, 129, 1001 };
+		const unsigned heights[] = { 1, 7, 40 };
+		const double ratios[] = { 0.0, 0.1, 0.5, 0.95 };
+		for (cx_pixel_format pf : { CX_PF_COORD3D_C32f, CX_PF_COORD3D_C16 })
+		{
+			// C16 ZMaps mark invalid pixels with 0, C32f with a negative value
+			float ivd = (pf == CX_PF_COORD3D_C16) ? 0.0f : -1.0f;
+			for (unsigned w : widths)
+			{
+				for (unsigned h : heights)
+				{
+					for (double ratio : ratios)
+					{
+						cx::c3d::ZMap zmap(h, w, pf, cx::Point3f(0.05f, -0.1f, 0.002f), cx::Point3f(-12.5f, 300.0f, 17.0f));
+						fillZMap(zmap, ivd, ratio, rng);
+						testZMap(zmap, ivd, pool, "pf " + std::to_string(pf) + ", " + std::to_string(w) + "x" + std::to_string(h) + ", invalid " + std::to_string(ratio));
+					}
+				}
+			}
+
+			// 3. ZMap without valid pixel
+			cx::c3d::ZMap empty(9, 33, pf, cx::Point3f(1.0f, 1.0f, 1.0f), cx::Point3f(0.0f, 0.0f, 0.0f));
+			for (unsigned r = 0; r < empty.img.height(); r++)
+				for (unsigned c = 0; c < empty.img.width(); c++)
+				{
+					if (pf == CX_PF_COORD3D_C16)
+						empty.img.row<uint16_t>(r)[c] = uint16_t(ivd);
+					else
+						empty.img.row<float>(r)[c] = (c % 2) ? NAN : ivd;
+				}
+			cx::c3d::PointCloud pc;
+			std::vector<uint32_t> indexMap(3, 1);
+			size_t n = cx::c3d::convertToPointCloud(empty, pc, ivd, cx::c3d::POINTCLOUD_COMPACTED, &indexMap, &pool);
+			check(n == 0 && indexMap.empty() && pc.points.width() == 0 && pc.points.height() == 0, "ZMap without valid pixel, pf " + std::to_string(pf));
+		}
+
+		bool thrown = false;
+		try
+		{
+			cx::c3d::ZMap mono;
+			mono.img = cx::Image(2, 2, CX_PF_MONO_8);
+			cx::c3d::PointCloud pc;
+			cx::c3d::convertToPointCloud(mono, pc, 0.0f, cx::c3d::POINTCLOUD_COMPACTED);
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+		check(thrown, "unsupported pixel format");
+	}
+	catch (const std::exception& e)
+	{
+		cout << "exception caught, msg:" << e.what() << endl;
+		exit(-3);
+	}
+
+	if (g_numFailed)
+	{
+		cerr << g_numFailed << " checks failed" << endl;
+		return -1;
+	}
+	cout << "all checks passed" << endl;
+	return 0;
+}
@@ -0,0 +1,238 @@
+/** C++ test of the acquisition statistics.
+\example cx_cam_acquisition_stats_test.cpp
+
+This example checks the math of cx::LatencyHistogram and cx::AcquisitionStats without camera:
+- bucket index and lower bound of the histogram for all buckets and the values at the bucket borders,
+- percentiles of known distributions against the exact values within the bucket resolution,
+- unwrapping of 16, 32 and 64 bit frame counters, missing frames and resets,
+- enabling and reading the statistics of a device while another thread delivers buffers (run it with ThreadSanitizer).
+
+The example returns -1 if a check fails.
+
+Usage: cx_cam_acquisition_stats_test
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <limits>
+using namespace std;
+
+#include "cx_cam_common.h"
+#include "AT/cx/AcquisitionStats.h"
+using namespace AT;
+
+static int g_failed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		std::cerr << "FAILED: " << what << std::endl;
+		g_failed++;
+	}
+}
+
+static void testBuckets()
+{
+	typedef cx::LatencyHistogram H;
+	const uint64_t maxVal = std::numeric_limits<uint64_t>::max();
+	for (uint64_t v = 0; v < 2 * H::SUB_COUNT; v++)
+		check(H::index(v) == v && H::lowerBound(size_t(v)) == v, "exact bucket of " + std::to_string(v));
+	for (size_t i = 0; i < size_t(H::NUM_BUCKETS); i++)
+	{
+		uint64_t lo = H::lowerBound(i);
+		check(H::index(lo) == i, "index(lowerBound(" + std::to_string(i) + "))");
+		uint64_t hi = (i + 1 < size_t(H::NUM_BUCKETS)) ? H::lowerBound(i + 1) - 1 : maxVal;
+		check(hi >= lo && H::index(hi) == i, "upper border of bucket " + std::to_string(i));
+		// width of a bucket is at most 1/32 of its lower bound
+		if (i >= size_t(2 * H::SUB_COUNT))
+			check((hi - lo) <= lo / H::SUB_COUNT, "resolution of bucket " + std::to_string(i));
+	}
+	check(H::index(maxVal) == size_t(H::NUM_BUCKETS) - 1, "index of 2^64-1");
+	for (unsigned b = 6; b < 64; b++)
+	{
+		uint64_t p = uint64_t(1) << b;
+		check(H::index(p) == H::index(p - 1) + 1, "bucket step at 2^" + std::to_string(b));
+	}
+}
+
+// percentile must lie within the bucket of the exact value
+static void checkPercentile(const cx::LatencyHistogram::Snapshot& s, double p, uint64_t exact, const std::string& name)
+{
+	typedef cx::LatencyHistogram H;
+	uint64_t v = s.percentile(p);
+	check(H::index(v) == H::index(exact) || v == s.max || v == s.min, name + " p" + std::to_string(p) + " = " + std::to_string(v) + ", exact " + std::to_string(exact));
+}
+
+static void testPercentiles()
+{
+	{
+		cx::LatencyHistogram h;
+		check(h.snapshot().percentile(50) == 0 && h.snapshot().count == 0, "empty histogram");
+	}
+	{
+		cx::LatencyHistogram h;
+		h.record(12345);
+		cx::LatencyHistogram::Snapshot s = h.snapshot();
+		check(s.percentile(0) == 12345 && s.percentile(50) == 12345 && s.percentile(100) == 12345, "single value");
+	}
+	{
+		// exact range below 64
+		cx::LatencyHistogram h;
+		for (uint64_t v = 1; v <= 50; v++)
+			h.record(v);
+		cx::LatencyHistogram::Snapshot s = h.snapshot();
+		check(s.percentile(50) == 25 && s.percentile(10) == 5 && s.percentile(100) == 50, "percentiles of 1..50");
+		check(s.min == 1 && s.max == 50 && s.sum == 1275 && s.count == 50, "min/max/sum of 1..50");
+	}
+	{
+		// uniform 1..100000
+		cx::LatencyHistogram h;
+		const uint64_t n = 100000;
+		for (uint64_t v = 1; v <= n; v++)
+			h.record(v);
+		cx::LatencyHistogram::Snapshot s = h.snapshot();
+		const double ps[] = { 1, 10, 50, 90, 99, 99.9 };
+		for (double p : ps)
+			checkPercentile(s, p, uint64_t(p / 100.0 * double(n) + 0.5), "uniform");
+		check(s.percentile(100) == n && s.max == n && s.min == 1, "max of uniform");
+		check(s.mean() == double(n + 1) / 2.0, "mean of uniform");
+	}
+	{
+		// 990 fast values and 10 outliers: p99 is still fast, p99.5 is an outlier
+		cx::LatencyHistogram h;
+		for (int i = 0; i < 990; i++)
+			h.record(1000000);
+		for (int i = 0; i < 10; i++)
+			h.record(50000000);
+		cx::LatencyHistogram::Snapshot s = h.snapshot();
+		checkPercentile(s, 99, 1000000, "outliers");
+		checkPercentile(s, 99.5, 50000000, "outliers");
+		check(s.percentile(100) == 50000000, "max of outliers");
+	}
+}
+
+static void testFrameIds()
+{
+	typedef cx::AcquisitionStats S;
+	check(S::frameIdDelta(65535, 0, 16) == 1, "16 bit wrap");
+	check(S::frameIdDelta(65534, 2, 16) == 4, "16 bit wrap with gap");
+	check(S::frameIdDelta(100, 50, 16) == -50, "16 bit reset");
+	check(S::frameIdDelta(0xffffffffull, 0, 32) == 1, "32 bit wrap");
+	check(S::frameIdDelta(10, 10, 32) == 0, "32 bit repeat");
+	check(S::frameIdDelta(std::numeric_limits<uint64_t>::max(), 0, 64) == 1, "64 bit wrap");
+	check(S::frameIdDelta(1000, 10, 64) == -990, "64 bit reset");
+	check(S::frameIdDelta(5, 6, 0) == 1, "unknown width");
+
+	// 16 bit counter across the wrap: 65533, 65534, 65535, 0, 2 (1 missing), 0 (reset)
+	S stats;
+	const uint64_t ids[] = { 65533, 65534, 65535, 0, 2, 0 };
+	int64_t t = S::hostTime();
+	for (uint64_t id : ids)
+		stats.recordDelivery(false, true, id, 16, false, 0, t += 1000000);
+	S::Snapshot s = stats.snapshot();
+	check(s.delivered == 6 && s.missingFrames == 1 && s.frameIdResets == 1, "16 bit counter: missing " + std::to_string(s.missingFrames) + ", resets " + std::to_string(s.frameIdResets));
+	check(s.interval.count == 5 && s.interval.min == 1000000 && s.interval.max == 1000000, "interval of 1 ms");
+}
+
+/** Buffer source with one buffer, each buffer has a camera timestamp 1 ms after the previous one.
+*/
+class TimestampSource : public cx::BufferSource
+{
+public:
+	TimestampSource() : m_ticks(0) {}
+
+	cx_status_t getBufferImage(CX_BUFFER_HANDLE, int, cx_img_t*) override { return CX_STATUS_INVALID_PARAMETER; }
+	cx_status_t getBufferChunk(CX_BUFFER_HANDLE, int, cx_chunk_t*) override { return CX_STATUS_INVALID_PARAMETER; }
+	cx_status_t getBufferPartInfo(CX_BUFFER_HANDLE, int, int, cx_variant_t*) override { return CX_STATUS_INVALID_PARAMETER; }
+	cx_status_t getBufferInfo(CX_BUFFER_HANDLE, int param, cx_variant_t* val) override
+	{
+		if (param != CX_BUFFER_INFO_TIMESTAMP)
+			return CX_STATUS_INVALID_PARAMETER;
+		*static_cast<cx::Variant*>(val) = (uint64_t)m_ticks;
+		return CX_STATUS_OK;
+	}
+	cx_status_t queueBuffer(CX_BUFFER_HANDLE) override { return CX_STATUS_OK; }
+
+	void next() { m_ticks += 1000000; }
+
+private:
+	uint64_t m_ticks;
+};
+
+class StatsDevice : public cx::Device
+{
+public:
+	using cx::Device::recordBuffer;
+	using cx::Device::recordAllocation;
+};
+
+// one thread delivers and queues back buffers, the other toggles and reads the statistics
+static void testEnableWhileDelivering()
+{
+	StatsDevice dev;
+	check(dev.stats() != nullptr && !dev.statsEnabled(), "statistics exist before enableStats");
+	dev.recordAllocation(1);
+
+	TimestampSource source;
+	std::atomic<bool> running(true);
+	std::thread delivery([&]() {
+		for (int i = 0; i < 20000; i++)
+		{
+			source.next();
+			cx::DeviceBuffer buffer((CX_BUFFER_HANDLE)(uintptr_t)1, &source);
+			dev.recordBuffer(buffer);
+			buffer.queueBuffer();
+		}
+		running = false;
+	});
+	uint64_t reads = 0;
+	while (running)
+	{
+		dev.enableStats((reads & 1) == 0);
+		cx::AcquisitionStats::Snapshot s = dev.stats()->snapshot();
+		check(s.buffersHeld >= 0 && s.buffersHeld <= 1, "held buffers " + std::to_string(s.buffersHeld));
+		reads++;
+	}
+	delivery.join();
+
+	cx::AcquisitionStats::Snapshot s = dev.stats()->snapshot();
+	check(s.buffersHeld == 0 && s.buffersAllocated == 1, "gauges after delivery");
+	check(s.delivered == s.requeued, "delivered " + std::to_string(s.delivered) + " requeued " + std::to_string(s.requeued));
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		testBuckets();
+		testPercentiles();
+		testFrameIds();
+		testEnableWhileDelivering();
+		std::cout << (g_failed ? "FAILED" : "ok") << std::endl;
+		if (g_failed)
+			return -1;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "exception caught, msg: " << err.what() << endl;
+		exit(-3);
+	}
+	return 0;
+}
@@ -0,0 +1,315 @@
+/** C++ test of releasing a device in its own buffer callback.
+\example cx_cam_delivery_release_test.cpp
+
+This example releases the last reference to a device inside the callback of cx::Device::onBuffer, so the device is destroyed in a delivery thread.
+The destructor can't join that thread: it queues the buffer of the callback back while the device still exists, invalidates it and detaches the thread,
+which then ends without touching the device.
+The test runs with one and two delivery threads for:
+- a cx::ReplayDevice playing a recording written by the test,
+- a Device subclass taking its buffers from a buffer source that outlives the device, the source counts the buffers queued back and any queueBuffer after the device was destroyed,
+- a camera (plain cx::Device) if a uri is given.
+
+Run it with AddressSanitizer to detect accesses to the destroyed device. The example returns -1 if a check fails.
+
+Usage: cx_cam_delivery_release_test [uri]
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+using namespace std;
+
+#include "cx_cam_common.h"
+#include "AT/cx/Recorder.h"
+#include "AT/cx/ReplayDevice.h"
+using namespace AT;
+
+static const unsigned WIDTH = 64;
+static const unsigned HEIGHT = 8;
+static const int RELEASE_AT = 5;		// the callback of this buffer releases the device
+
+/** Buffer source with a fixed number of Mono8 buffers.
+	Counts the buffers handed out and queued back, a queueBuffer after the device was destroyed is counted as late.
+*/
+class TestSource : public cx::BufferSource
+{
+public:
+	explicit TestSource(int numBuffers) : m_data(numBuffers, std::vector<uint8_t>(WIDTH * HEIGHT)), m_taken(numBuffers, false), m_numTaken(0), m_invalidQueues(0), m_lateQueues(0), m_deviceAlive(true) {}
+
+	//! Hand out a free buffer, the pixels hold the running number of the buffer.
+	bool take(cx::DeviceBuffer& buffer)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < m_taken.size(); i++)
+		{
+			if (m_taken[i])
+				continue;
+			m_taken[i] = true;
+			memset(m_data[i].data(), (int)(m_numTaken & 0xff), m_data[i].size());
+			m_numTaken++;
+			buffer = cx::DeviceBuffer((CX_BUFFER_HANDLE)(uintptr_t)(i + 1), this);
+			return true;
+		}
+		return false;
+	}
+
+	void setDeviceAlive(bool alive)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_deviceAlive = alive;
+	}
+
+	size_t numOutstanding() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		size_t n = 0;
+		for (size_t i = 0; i < m_taken.size(); i++)
+			n += m_taken[i] ? 1 : 0;
+		return n;
+	}
+	int invalidQueues() const { std::lock_guard<std::mutex> lock(m_mutex); return m_invalidQueues; }
+	int lateQueues() const { std::lock_guard<std::mutex> lock(m_mutex); return m_lateQueues; }
+
+	cx_status_t getBufferImage(CX_BUFFER_HANDLE hBuffer, int, cx_img_t* img) override
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		int idx = takenIndex(hBuffer);
+		if (idx < 0 || img == nullptr)
+			return CX_STATUS_INVALID_HANDLE;
+		img->pixelFormat = CX_PF_MONO_8;
+		img->width = WIDTH;
+		img->height = HEIGHT;
+		img->flag = 0;
+		img->linePitch = WIDTH;
+		img->planePitch = 0;
+		img->dataSz = m_data[idx].size();
+		img->data = m_data[idx].data();
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t getBufferChunk(CX_BUFFER_HANDLE, int, cx_chunk_t*) override { return CX_STATUS_INVALID_PARAMETER; }
+	cx_status_t getBufferPartInfo(CX_BUFFER_HANDLE, int, int, cx_variant_t*) override { return CX_STATUS_INVALID_PARAMETER; }
+
+	cx_status_t getBufferInfo(CX_BUFFER_HANDLE hBuffer, int param, cx_variant_t* val) override
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (takenIndex(hBuffer) < 0 || val == nullptr)
+			return CX_STATUS_INVALID_HANDLE;
+		if (param != CX_BUFFER_INFO_TIMESTAMP)
+			return CX_STATUS_INVALID_PARAMETER;
+		*static_cast<cx::Variant*>(val) = (uint64_t)m_numTaken * 1000000;
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t queueBuffer(CX_BUFFER_HANDLE hBuffer) override
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_deviceAlive)
+			m_lateQueues++;
+		int idx = takenIndex(hBuffer);
+		if (idx < 0)
+		{
+			m_invalidQueues++;
+			return CX_STATUS_INVALID_HANDLE;
+		}
+		m_taken[idx] = false;
+		return CX_STATUS_OK;
+	}
+
+private:
+	// call with m_mutex locked
+	int takenIndex(CX_BUFFER_HANDLE hBuffer) const
+	{
+		intptr_t idx = (intptr_t)(uintptr_t)hBuffer - 1;
+		return (idx >= 0 && idx < (intptr_t)m_taken.size() && m_taken[idx]) ? (int)idx : -1;
+	}
+
+	mutable std::mutex m_mutex;
+	std::vector<std::vector<uint8_t>> m_data;
+	std::vector<bool> m_taken;
+	uint64_t m_numTaken;
+	int m_invalidQueues;
+	int m_lateQueues;
+	bool m_deviceAlive;
+};
+
+/** Device without camera, delivers the buffers of a TestSource.
+	Like every subclass overriding tryWaitForBuffer it stops the delivery in its own destructor.
+*/
+class SourceDevice : public cx::Device
+{
+public:
+	explicit SourceDevice(TestSource& source) : m_source(source) {}
+
+	~SourceDevice()
+	{
+		releaseDelivery();
+		m_source.setDeviceAlive(false);
+	}
+
+	cx_status_t tryWaitForBuffer(cx::DeviceBuffer& buffer, unsigned int timeout) override
+	{
+		buffer = cx::DeviceBuffer();
+		if (!m_source.take(buffer))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeout, 1u)));
+			return CX_STATUS_TIMEOUT;
+		}
+		recordBuffer(buffer);
+		return CX_STATUS_OK;
+	}
+
+private:
+	TestSource& m_source;
+};
+
+// state shared with the callback, outlives the device
+struct ReleaseState
+{
+	ReleaseState() : count(0), released(false), returned(false) {}
+
+	std::mutex mutex;
+	cx::DevicePtr keep;
+	std::atomic<int> count;
+	std::atomic<bool> released;
+	std::atomic<bool> returned;
+};
+
+/** Hands the only reference to the device to the callback, which releases it in the callback of buffer RELEASE_AT.
+	@return true if the device was destroyed in the callback and the callback returned.
+*/
+static bool releaseInCallback(cx::DevicePtr dev, unsigned numThreads, ReleaseState& state)
+{
+	std::weak_ptr<cx::Device> alive = dev;
+	state.keep = dev;
+	dev->onBuffer([&state](cx::DeviceBuffer& buffer) {
+		if (++state.count != RELEASE_AT)
+			return;
+		if (buffer.getImageView().isEmpty())
+			return;
+		cx::DevicePtr last;
+		{
+			std::lock_guard<std::mutex> lock(state.mutex);
+			last.swap(state.keep);
+		}
+		last.reset();		// ~Device runs in this delivery thread
+		state.released = true;
+		state.returned = true;
+	}, numThreads, 20);
+	dev.reset();
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (!state.returned && std::chrono::steady_clock::now() < deadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	// let the detached thread run to its end
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	if (!state.returned)
+	{
+		// not released, e.g. no buffers from the camera: stop and release the device here
+		cx::DevicePtr last;
+		{
+			std::lock_guard<std::mutex> lock(state.mutex);
+			last.swap(state.keep);
+		}
+		if (last)
+			last->stopDelivery();
+		return false;
+	}
+	return state.released && alive.expired();
+}
+
+static void writeRecording(const std::string& fileName, int numFrames)
+{
+	TestSource source(1);
+	cx::Recorder::Options options;
+	options.blockSize = 1 << 16;
+	options.numBlocks = 4;
+	options.blockOnFull = true;
+	cx::Recorder rec(fileName, cx::ParamMap(), options);
+	for (int i = 0; i < numFrames; i++)
+	{
+		cx::DeviceBuffer buffer;
+		source.take(buffer);
+		rec.record(buffer);
+		buffer.queueBuffer();
+	}
+	rec.close();
+}
+
+static bool report(const std::string& name, bool ok)
+{
+	std::cout << name << ": " << (ok ? "ok" : "FAILED") << std::endl;
+	return ok;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		bool ok = true;
+		const std::string recFile = "cx_cam_delivery_release_test.cxrec";
+		writeRecording(recFile, 16);
+
+		for (unsigned numThreads = 1; numThreads <= 2; numThreads++)
+		{
+			std::string suffix = " (" + std::to_string(numThreads) + " threads)";
+
+			// 1. replay device
+			{
+				cx::DevicePtr dev = cx::DeviceFactory::openDevice("replay://" + recFile + "?rate=max&loop=1");
+				dev->allocAndQueueBuffers(4);
+				dev->startAcquisition();
+				ReleaseState state;
+				ok = report("ReplayDevice" + suffix, releaseInCallback(std::move(dev), numThreads, state)) && ok;
+			}
+
+			// 2. device with external buffer source: the buffer of the callback is queued back before the device is gone
+			{
+				TestSource source(4);
+				ReleaseState state;
+				bool released = releaseInCallback(std::make_shared<SourceDevice>(source), numThreads, state);
+				bool clean = source.numOutstanding() == 0 && source.lateQueues() == 0 && source.invalidQueues() == 0;
+				if (!clean)
+					std::cerr << "  outstanding " << source.numOutstanding() << ", late " << source.lateQueues() << ", invalid " << source.invalidQueues() << std::endl;
+				ok = report("Device subclass" + suffix, released && clean) && ok;
+			}
+
+			// 3. camera
+			if (argc > 1)
+			{
+				cx::DevicePtr dev = cx::DeviceFactory::openDevice(argv[1]);
+				dev->allocAndQueueBuffers(4);
+				dev->startAcquisition();
+				ReleaseState state;
+				ok = report(std::string("camera ") + argv[1] + suffix, releaseInCallback(std::move(dev), numThreads, state)) && ok;
+			}
+		}
+		remove(recFile.c_str());
+		if (!ok)
+			return -1;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "exception caught, msg: " << err.what() << endl;
+		exit(-3);
+	}
+	return 0;
+}
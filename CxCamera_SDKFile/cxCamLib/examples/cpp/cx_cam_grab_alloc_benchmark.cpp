@@ -0,0 +1,185 @@
+/** C++ benchmark of the heap allocations and the timeout cost of the grab path.
+\example cx_cam_grab_alloc_benchmark.cpp
+
+This example counts the heap allocations per frame of the two grab paths of cx::Device:
+- Device::waitForBuffer and DeviceBuffer::getImage, which allocate an Image per frame and throw on timeout.
+- Device::tryWaitForBuffer, DeviceBuffer::getImageView and DeviceBuffer::getChunkView, which reuse the caller owned buffer object and return views by value.
+
+The allocations of the grabbing thread are counted by replacing the global operator new and delete, threads of the transport layer are not counted. The allocation free path must not allocate after the first frame,
+the example returns -1 otherwise. Finally the cost of an idle timeout is compared: all buffers are held back so that the wait functions time out,
+the throwing path pays for the exception on every timeout.
+
+Usage: cx_cam_grab_alloc_benchmark [uri] [numFrames]
+The uri can also be a recording, e.g. "replay:///data/scan.cxrec?rate=max&loop=1".
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <new>
+using namespace std;
+
+#include "cx_cam_common.h"
+using namespace AT;
+
+// counting allocator hook, counts the allocations of the thread calling the grab functions
+static std::atomic<uint64_t> g_numAllocs(0);
+static thread_local bool t_countAllocs = false;
+
+static void* countedAlloc(size_t sz) noexcept
+{
+	if (t_countAllocs)
+		g_numAllocs++;
+	return malloc(sz ? sz : 1);
+}
+
+void* operator new(size_t sz)
+{
+	void* p = countedAlloc(sz);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+void* operator new[](size_t sz)
+{
+	void* p = countedAlloc(sz);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+void* operator new(size_t sz, const std::nothrow_t&) noexcept { return countedAlloc(sz); }
+void* operator new[](size_t sz, const std::nothrow_t&) noexcept { return countedAlloc(sz); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+static double msSince(std::chrono::steady_clock::time_point t0)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// 1. discover and connect a device.
+		std::string uri;
+		if (argc > 1)
+			uri = argv[1];
+		else
+			uri = cx::discoverAndChooseDevice(true)->deviceURI;
+		int numFrames = (argc > 2) ? atoi(argv[2]) : 1000;
+		if (numFrames < 1)
+			numFrames = 1;
+
+		auto cam = cx::DeviceFactory::openDevice(uri);
+		std::cout << "Open Device: " << uri.c_str() << endl;
+
+		t_countAllocs = true;
+
+		const int numBuffers = 3;
+		cam->allocAndQueueBuffers(numBuffers);
+		cam->startAcquisition();
+
+		// 2. legacy path: DeviceBuffer by value, Image allocated per frame, exception on error
+		uint64_t sum = 0;
+		uint64_t allocs0 = g_numAllocs;
+		auto t0 = std::chrono::steady_clock::now();
+		for (int i = 0; i < numFrames; i++)
+		{
+			cx::DeviceBuffer buffer = cam->waitForBuffer(5000);
+			cx::ImagePtr img = buffer.getImage();
+			sum += img->width();
+			buffer.queueBuffer();
+		}
+		double legacyMs = msSince(t0);
+		uint64_t legacyAllocs = g_numAllocs - allocs0;
+
+		// 3. allocation free path: the buffer object is reused, views are returned by value
+		cx::DeviceBuffer buffer;
+		cx::checkOk("cx_waitForBuffer", cam->tryWaitForBuffer(buffer, 5000));		// first frame may allocate, e.g. for lazy initialization
+		buffer.queueBuffer();
+		allocs0 = g_numAllocs;
+		t0 = std::chrono::steady_clock::now();
+		for (int i = 0; i < numFrames; i++)
+		{
+			cx::checkOk("cx_waitForBuffer", cam->tryWaitForBuffer(buffer, 5000));
+			cx::ImageView img = buffer.getImageView(0);
+			cx::Chunk chunk = buffer.getChunkView(0);
+			sum += img.width() + chunk.length;
+			buffer.queueBuffer();
+		}
+		double viewMs = msSince(t0);
+		uint64_t viewAllocs = g_numAllocs - allocs0;
+
+		// 4. idle timeouts: hold back all buffers, so that every wait times out
+		std::vector<cx::DeviceBuffer> held(numBuffers);
+		for (int i = 0; i < numBuffers; i++)
+			cx::checkOk("cx_waitForBuffer", cam->tryWaitForBuffer(held[i], 5000));
+		const int numTimeouts = 100;
+		int numThrown = 0;
+		t0 = std::chrono::steady_clock::now();
+		for (int i = 0; i < numTimeouts; i++)
+		{
+			try
+			{
+				cx::DeviceBuffer b = cam->waitForBuffer(1);
+				b.queueBuffer();
+			}
+			catch (const cx::RuntimeError&)
+			{
+				numThrown++;
+			}
+		}
+		double throwMs = msSince(t0);
+		int numStatus = 0;
+		t0 = std::chrono::steady_clock::now();
+		for (int i = 0; i < numTimeouts; i++)
+		{
+			if (cam->tryWaitForBuffer(buffer, 1) != CX_STATUS_OK)
+				numStatus++;
+			else
+				buffer.queueBuffer();
+		}
+		double statusMs = msSince(t0);
+		for (int i = 0; i < numBuffers; i++)
+			held[i].queueBuffer();
+
+		cam->stopAcquisition();
+		cam->freeBuffers();
+		cam->close();
+
+		std::cout << "frames: " << numFrames << " (checksum " << sum << ")" << std::endl;
+		std::cout << "waitForBuffer/getImage:          " << double(legacyAllocs) / numFrames << " allocations/frame, " << 1000.0 * legacyMs / numFrames << " us/frame" << std::endl;
+		std::cout << "tryWaitForBuffer/getImageView:   " << double(viewAllocs) / numFrames << " allocations/frame, " << 1000.0 * viewMs / numFrames << " us/frame" << std::endl;
+		std::cout << "timeout with exception:          " << numThrown << " timeouts, " << 1000.0 * throwMs / numTimeouts << " us/call" << std::endl;
+		std::cout << "timeout with status:             " << numStatus << " timeouts, " << 1000.0 * statusMs / numTimeouts << " us/call" << std::endl;
+		if (viewAllocs != 0)
+		{
+			std::cerr << "FAILED: allocation free grab path allocated " << viewAllocs << " times" << std::endl;
+			return -1;
+		}
+	}
+	catch (const cx::RuntimeError& err)
+	{
+		std::cerr << "cx runtime exception: " << err.what() << endl;
+		exit(-3);
+	}
+	return 0;
+}
@@ -0,0 +1,463 @@
+/** C++ simulation of a synchronized multi-camera acquisition with cx::DeviceGroup.
+\example cx_cam_group_simulation.cpp
+
+This example runs a cx::DeviceGroup of four simulated heads, no camera is needed. The simulated devices are subclasses of cx::Device and cx::BufferSource
+that deliver buffers with a camera info chunk (frame id, timestamp) from a producer thread:
+- Every buffer is delivered with a random delay of up to the jitter, the heads deliver the same frame at different times but every head in order.
+- Heads 1-3 lose frames with the given drop rate, the group detects the missing frame as soon as the head delivers a newer buffer.
+- Head 3 additionally stalls for a longer period without delivering anything, the tuples of that period are completed after the match timeout.
+- A frame is also lost if the application didn't queue a buffer in time, like on a camera.
+
+The group is run twice, aligned by the frame id (starting shortly before the 32 bit wrap-around) and by the timestamp with a tolerance covering the clock synchronization error.
+Each tuple is verified against the frames the heads actually delivered: the buffers of a tuple must belong to the same frame, every frame must be delivered exactly once and in order,
+and a head must be reported missing exactly when it lost the frame. The example returns -1 if a check fails.
+
+\note The match timeout must cover the delivery jitter plus the scheduling delay of the grabber threads, otherwise a late buffer is delivered as a separate tuple after its frame was completed without it.
+
+Usage: cx_cam_group_simulation [numFrames] [dropRate] [jitterMs] [seed]
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+using namespace std;
+
+#include "cx_cam_common.h"
+#include "AT/cx/ChunkView.h"
+#include "AT/cx/DeviceGroup.h"
+using namespace AT;
+
+static const uint32_t FRAME_ID_START = 0xFFFFFF00u;		// frame ids wrap around after 256 frames
+static const int64_t PERIOD_US = 2000;						// frame period of all heads
+static const int64_t CLOCK_START_NS = 1000000000;			// common clock at frame 0
+
+/** Simulated camera head, delivers frames with a camera info chunk and no image.
+	Frame f is delivered after f * period plus a random delay of up to the jitter. Dropped frames and frames without a free buffer are lost.
+*/
+class SimDevice : public cx::Device, public cx::BufferSource
+{
+public:
+	struct Config
+	{
+		Config() : numFrames(500), jitterUs(0), dropRate(0), stallFrom(-1), stallFrames(0), syncErrorNs(0), seed(0) {}
+
+		int numFrames;			// frames delivered per acquisition
+		int64_t jitterUs;		// maximum delivery delay
+		double dropRate;		// probability of a lost frame
+		int stallFrom;			// first frame of the stall, -1 for none
+		int stallFrames;		// number of frames lost in the stall
+		int64_t syncErrorNs;	// maximum deviation of the timestamp from the common clock
+		unsigned seed;
+	};
+
+	explicit SimDevice(const Config& cfg) : m_cfg(cfg), m_acquiring(false), m_stop(false), m_overruns(0) {}
+
+	~SimDevice()
+	{
+		releaseDelivery();		// delivery threads call tryWaitForBuffer of this object
+		stopProducer();
+	}
+
+	bool isOpen() const override { return true; }
+	void close() override { stopProducer(); }
+
+	void allocAndQueueBuffers(int numBuffers = 3) override
+	{
+		if (m_acquiring)
+			cx::checkOk("cx_allocAndQueueBuffers", CX_STATUS_DEVICE_BUSY);
+		if (numBuffers <= 0)
+			cx::checkOk("cx_allocAndQueueBuffers", CX_STATUS_INVALID_PARAMETER);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_slots.assign(numBuffers, Slot());
+			m_free.clear();
+			m_ready.clear();
+			for (int i = 0; i < numBuffers; i++)
+				m_free.push_back(i);
+		}
+		recordAllocation(numBuffers);
+	}
+
+	void freeBuffers() override
+	{
+		if (m_acquiring)
+			cx::checkOk("cx_freeBuffers", CX_STATUS_DEVICE_BUSY);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_slots.clear();
+			m_free.clear();
+			m_ready.clear();
+		}
+		recordAllocation(0);
+	}
+
+	cx::DeviceBuffer waitForBuffer(unsigned int timeout, bool noThrow = false) override
+	{
+		cx::DeviceBuffer buffer;
+		cx_status_t status = tryWaitForBuffer(buffer, timeout);
+		if (noThrow == false)
+			cx::checkOk("cx_waitForBuffer", status);
+		return buffer;
+	}
+
+	cx_status_t tryWaitForBuffer(cx::DeviceBuffer& buffer, unsigned int timeout) override
+	{
+		buffer = cx::DeviceBuffer();
+		int idx;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (!m_cvReady.wait_for(lock, std::chrono::milliseconds(timeout), [this] { return !m_ready.empty(); }))
+				return CX_STATUS_TIMEOUT;
+			idx = m_ready.front();
+			m_ready.pop_front();
+			m_slots[idx].delivered = true;
+		}
+		buffer = cx::DeviceBuffer(toHandle(idx), this);
+		recordBuffer(buffer);
+		return CX_STATUS_OK;
+	}
+
+	void startAcquisition() override
+	{
+		if (m_slots.empty())
+			cx::checkOk("cx_startAcquisition", CX_STATUS_FAILED);
+		if (m_acquiring)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_lost.assign(m_cfg.numFrames, 1);
+			m_overruns = 0;
+		}
+		m_stop = false;
+		m_acquiring = true;
+		m_producer = std::thread(&SimDevice::producerLoop, this);
+	}
+
+	void stopAcquisition() override
+	{
+		stopProducer();
+	}
+
+	// BufferSource interface
+	cx_status_t getBufferImage(CX_BUFFER_HANDLE, int, cx_img_t*) override
+	{
+		return CX_STATUS_NO_DATA;
+	}
+
+	cx_status_t getBufferChunk(CX_BUFFER_HANDLE hBuffer, int chunkIdx, cx_chunk_t* chunk) override
+	{
+		const Slot* slot = deliveredSlot(hBuffer);
+		if (slot == nullptr || chunk == nullptr)
+			return CX_STATUS_INVALID_HANDLE;
+		if (chunkIdx != 0)
+			return CX_STATUS_INVALID_PARAMETER;
+		chunk->descriptor = CX_CHUNK_CAMERA_INFO_ID;
+		chunk->length = sizeof(cx_chunk_camera_info_t);
+		chunk->data = const_cast<cx_chunk_camera_info_t*>(&slot->info);
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t getBufferInfo(CX_BUFFER_HANDLE hBuffer, int param, cx_variant_t* val) override
+	{
+		const Slot* slot = deliveredSlot(hBuffer);
+		if (slot == nullptr || val == nullptr)
+			return CX_STATUS_INVALID_HANDLE;
+		cx::Variant& v = *static_cast<cx::Variant*>(val);
+		switch (param)
+		{
+		case CX_BUFFER_INFO_TIMESTAMP: v = slot->timestamp; break;
+		case CX_BUFFER_INFO_NUM_CHUNK: v = (uint64_t)1; break;
+		case CX_BUFFER_INFO_IS_INCOMPLETE: v = false; break;
+		default: return CX_STATUS_INVALID_PARAMETER;
+		}
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t getBufferPartInfo(CX_BUFFER_HANDLE, int, int, cx_variant_t*) override
+	{
+		return CX_STATUS_NOT_IMPLEMENTED;
+	}
+
+	cx_status_t queueBuffer(CX_BUFFER_HANDLE hBuffer) override
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		int idx = fromHandle(hBuffer);
+		if (idx < 0 || !m_slots[idx].delivered)
+			return CX_STATUS_INVALID_HANDLE;
+		m_slots[idx].delivered = false;
+		m_free.push_back(idx);
+		return CX_STATUS_OK;
+	}
+
+	//! True if frame f of the last acquisition was not delivered, valid after stopAcquisition.
+	bool lost(int f) const { return m_lost[f] != 0; }
+	int overruns() const { return m_overruns; }
+	int numLost() const
+	{
+		int n = 0;
+		for (size_t f = 0; f < m_lost.size(); f++)
+			n += m_lost[f];
+		return n;
+	}
+
+private:
+	struct Slot
+	{
+		Slot() : timestamp(0), delivered(false) { memset(&info, 0, sizeof(info)); }
+		cx_chunk_camera_info_t info;
+		uint64_t timestamp;
+		bool delivered;
+	};
+
+	static CX_BUFFER_HANDLE toHandle(int idx) { return (CX_BUFFER_HANDLE)(uintptr_t)(idx + 1); }
+
+	// call with m_mutex locked
+	int fromHandle(CX_BUFFER_HANDLE hBuffer) const
+	{
+		intptr_t idx = (intptr_t)(uintptr_t)hBuffer - 1;
+		return (idx >= 0 && idx < (intptr_t)m_slots.size()) ? (int)idx : -1;
+	}
+
+	// a delivered slot is owned by the application, no lock needed for reading it
+	const Slot* deliveredSlot(CX_BUFFER_HANDLE hBuffer)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		int idx = fromHandle(hBuffer);
+		if (idx < 0 || !m_slots[idx].delivered)
+			return nullptr;
+		return &m_slots[idx];
+	}
+
+	void producerLoop()
+	{
+		std::mt19937 rng(m_cfg.seed);
+		std::uniform_real_distribution<double> uniform(0.0, 1.0);
+		auto start = std::chrono::steady_clock::now();
+		auto last = start;
+		for (int f = 0; f < m_cfg.numFrames; f++)
+		{
+			// draw every random value for every frame, so the frames of a head don't depend on the drops
+			double delay = uniform(rng);
+			double drop = uniform(rng);
+			double syncError = 2.0 * uniform(rng) - 1.0;
+
+			// a camera delivers in order, a late frame delays the following frames
+			auto due = start + std::chrono::microseconds(f * PERIOD_US + (int64_t)(delay * m_cfg.jitterUs));
+			if (due < last)
+				due = last;
+			last = due;
+			bool stalled = f >= m_cfg.stallFrom && f < m_cfg.stallFrom + m_cfg.stallFrames;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				if (m_cvStop.wait_until(lock, due, [this] { return m_stop; }))
+					return;
+				if (stalled || drop < m_cfg.dropRate)
+					continue;
+				if (m_free.empty())
+				{
+					m_overruns++;
+					continue;
+				}
+				int idx = m_free.front();
+				m_free.pop_front();
+				Slot& slot = m_slots[idx];
+				slot.timestamp = (uint64_t)(CLOCK_START_NS + f * PERIOD_US * 1000 + (int64_t)(syncError * m_cfg.syncErrorNs));
+				slot.info.timeStamp64L = htocx32((uint32_t)slot.timestamp);
+				slot.info.timeStamp64H = htocx32((uint32_t)(slot.timestamp >> 32));
+				slot.info.frameId = htocx32(FRAME_ID_START + (uint32_t)f);
+				m_lost[f] = 0;
+				m_ready.push_back(idx);
+			}
+			m_cvReady.notify_one();
+		}
+	}
+
+	void stopProducer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_cvStop.notify_all();
+		if (m_producer.joinable())
+			m_producer.join();
+		m_acquiring = false;
+	}
+
+	Config m_cfg;
+	std::thread m_producer;
+	bool m_acquiring;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cvReady;
+	std::condition_variable m_cvStop;
+	bool m_stop;
+	std::vector<Slot> m_slots;
+	std::deque<int> m_free;
+	std::deque<int> m_ready;
+	std::vector<char> m_lost;
+	int m_overruns;
+};
+
+// frame and present heads of a delivered tuple
+struct TupleRecord
+{
+	int frame;
+	std::vector<bool> present;
+};
+
+static int runGroup(cx::DeviceGroup::align_mode mode, int numFrames, double dropRate, int jitterMs, unsigned seed)
+{
+	const size_t numHeads = 4;
+	std::vector<std::shared_ptr<SimDevice>> heads;
+	for (size_t i = 0; i < numHeads; i++)
+	{
+		SimDevice::Config cfg;
+		cfg.numFrames = numFrames;
+		cfg.jitterUs = jitterMs * 1000;
+		cfg.dropRate = (i == 0) ? 0.0 : dropRate;		// head 0 delivers every frame, so every frame has a tuple
+		cfg.syncErrorNs = PERIOD_US * 1000 / 8;
+		cfg.seed = seed + (unsigned)i;
+		if (i == 3)
+		{
+			cfg.stallFrom = numFrames / 2;
+			cfg.stallFrames = 100;		// longer than the match timeout
+		}
+		heads.push_back(std::make_shared<SimDevice>(cfg));
+	}
+
+	auto group = cx::DeviceGroup::createShared();
+	for (size_t i = 0; i < numHeads; i++)
+		group->addDevice(heads[i]);
+	if (mode == cx::DeviceGroup::ALIGN_TIMESTAMP)
+		group->setAlignment(mode, PERIOD_US * 1000 / 2);		// tolerance in ns, covers the sync error of two heads
+	else
+		group->setAlignment(mode);
+	group->setMatchTimeout(jitterMs + 50);
+	group->setGrabTimeout(20);
+	group->start(64);
+
+	std::vector<TupleRecord> records;
+	int mismatched = 0;
+	auto t0 = std::chrono::steady_clock::now();
+	auto tLast = t0;
+	cx::DeviceGroup::Tuple tuple;
+	while (group->tryWaitForTuple(tuple, 500) == CX_STATUS_OK)
+	{
+		TupleRecord rec;
+		rec.frame = -1;
+		rec.present.assign(numHeads, false);
+		for (size_t i = 0; i < numHeads; i++)
+		{
+			if (!tuple.has(i))
+				continue;
+			rec.present[i] = true;
+			cx::ChunkView<cx_chunk_camera_info_t> info(tuple.buffers[i].getChunkView(0));
+			int frame = (int)(uint32_t)(info.frameId(0) - FRAME_ID_START);
+			if (rec.frame < 0)
+				rec.frame = frame;
+			else if (frame != rec.frame)
+				mismatched++;
+		}
+		records.push_back(rec);
+		group->queueTuple(tuple);
+		tLast = std::chrono::steady_clock::now();
+	}
+	double ms = std::chrono::duration<double, std::milli>(tLast - t0).count();
+	group->stop();
+
+	// verify the tuples against the frames delivered by the heads
+	int expected = 0;
+	for (int f = 0; f < numFrames; f++)
+	{
+		for (size_t i = 0; i < numHeads; i++)
+		{
+			if (!heads[i]->lost(f))
+			{
+				expected++;
+				break;
+			}
+		}
+	}
+	int outOfOrder = 0, wrongPartner = 0, lastFrame = -1;
+	std::vector<uint64_t> missing(numHeads, 0);
+	for (size_t t = 0; t < records.size(); t++)
+	{
+		const TupleRecord& rec = records[t];
+		if (rec.frame <= lastFrame)
+			outOfOrder++;
+		lastFrame = rec.frame;
+		for (size_t i = 0; i < numHeads; i++)
+		{
+			if (!rec.present[i])
+				missing[i]++;
+			if (rec.present[i] == heads[i]->lost(rec.frame))
+				wrongPartner++;
+		}
+	}
+
+	std::cout << ((mode == cx::DeviceGroup::ALIGN_TIMESTAMP) ? "timestamp alignment" : "frame id alignment") << ": "
+		<< records.size() << " tuples (" << group->numComplete() << " complete, " << group->numIncomplete() << " incomplete) in " << ms << " ms" << std::endl;
+	bool ok = mismatched == 0 && outOfOrder == 0 && wrongPartner == 0 && (int)records.size() == expected;
+	for (size_t i = 0; i < numHeads; i++)
+	{
+		cx::DeviceGroup::DeviceStats stats = group->getDeviceStats(i);
+		std::cout << "  head " << i << ": " << stats.grabbed << " grabbed, " << heads[i]->numLost() << " lost (" << heads[i]->overruns() << " without buffer), "
+			<< stats.missing << " missing" << std::endl;
+		ok = ok && stats.missing == missing[i] && stats.unkeyed == 0;
+	}
+	if (!ok)
+	{
+		std::cerr << "FAILED: " << mismatched << " mixed tuples, " << outOfOrder << " tuples out of order, " << wrongPartner << " wrong missing reports, "
+			<< records.size() << " tuples of " << expected << " frames" << std::endl;
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		int numFrames = (argc > 1) ? atoi(argv[1]) : 1000;
+		double dropRate = (argc > 2) ? atof(argv[2]) : 0.02;
+		int jitterMs = (argc > 3) ? atoi(argv[3]) : 5;
+		unsigned seed = (argc > 4) ? (unsigned)atoi(argv[4]) : 1;
+		if (numFrames < 1)
+			numFrames = 1;
+		if (jitterMs < 0)
+			jitterMs = 0;
+
+		std::cout << numFrames << " frames, drop rate " << dropRate << ", jitter " << jitterMs << " ms, seed " << seed << std::endl;
+		if (runGroup(cx::DeviceGroup::ALIGN_FRAME_ID, numFrames, dropRate, jitterMs, seed) != 0)
+			return -1;
+		if (runGroup(cx::DeviceGroup::ALIGN_TIMESTAMP, numFrames, dropRate, jitterMs, seed) != 0)
+			return -1;
+	}
+	catch (const cx::RuntimeError& err)
+	{
+		std::cerr << "cx runtime exception: " << err.what() << endl;
+		exit(-3);
+	}
+	return 0;
+}
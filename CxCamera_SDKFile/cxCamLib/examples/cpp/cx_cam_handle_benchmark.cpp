@@ -0,0 +1,249 @@
+/** C++ benchmark of the handle lookup of cx::HandleFactory under contention.
+\example cx_cam_handle_benchmark.cpp
+
+Every call of the C API resolves its handle with HandleFactory::getObj, e.g. cx_getBufferImage for each queued buffer.
+This example creates numHandles handles and lets 1, 2, 4, ... maxThreads threads resolve random handles concurrently, once with the previous
+implementation (std::list searched under one mutex, copied below for comparison) and once with the slot map of AT/CX/HandleFactory.h.
+It reports the aggregated lookups per second for each thread count. A second run adds a thread which creates and deletes handles while the
+other threads resolve, run it with ThreadSanitizer to check the lock-free lookup.
+
+Before the benchmark the semantics are checked: stale handles of deleted and reused slots return NULL, deleteBack releases the oldest handle first,
+a second createHandle for the same object returns the same handle. The example returns -1 if a check fails.
+
+Usage: cx_cam_handle_benchmark [numHandles] [maxThreads] [lookupsPerThread]
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <algorithm>
+using namespace std;
+
+#include "cx_cam_common.h"
+#include "AT/CX/HandleFactory.h"
+using namespace AT;
+
+static int g_failed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		std::cerr << "FAILED: " << what << std::endl;
+		g_failed++;
+	}
+}
+
+struct Item
+{
+	unsigned id;
+};
+
+/** Previous HandleFactory: the handle is the object pointer, all functions search a std::list under one mutex.
+*/
+template<typename T, typename H = void*>
+class ListHandleFactory
+{
+public:
+	H createHandle(T* obj)
+	{
+		H h = obj;
+		std::lock_guard<std::mutex> lck(m_mtx);
+		if (std::find(m_handles.begin(), m_handles.end(), h) == m_handles.end())
+			m_handles.push_front(h);
+		return h;
+	}
+
+	T* deleteHandle(H h)
+	{
+		std::lock_guard<std::mutex> lck(m_mtx);
+		typename std::list<H>::iterator it = std::find(m_handles.begin(), m_handles.end(), h);
+		if (it == m_handles.end())
+			return NULL;
+		T* obj = reinterpret_cast<T*>(*it);
+		m_handles.erase(it);
+		return obj;
+	}
+
+	T* getObj(H h)
+	{
+		std::lock_guard<std::mutex> lck(m_mtx);
+		typename std::list<H>::iterator it = std::find(m_handles.begin(), m_handles.end(), h);
+		return (it != m_handles.end()) ? reinterpret_cast<T*>(*it) : NULL;
+	}
+
+private:
+	std::mutex m_mtx;
+	std::list<H> m_handles;
+};
+
+static void testSemantics()
+{
+	cx::HandleFactory<Item> f;
+	Item a = { 1 }, b = { 2 }, c = { 3 };
+	check(f.isEmpty(), "empty factory");
+	check(f.createHandle(NULL) == (void*)CX_INVALID_HANDLE && f.getObj((void*)CX_INVALID_HANDLE) == NULL, "NULL object and invalid handle");
+
+	void* ha = f.createHandle(&a);
+	void* hb = f.createHandle(&b);
+	check(ha != (void*)CX_INVALID_HANDLE && hb != (void*)CX_INVALID_HANDLE && ha != hb, "distinct handles");
+	check(f.createHandle(&a) == ha, "second createHandle returns the same handle");
+	check(f.getObj(ha) == &a && f.getObj(hb) == &b && !f.isEmpty(), "getObj");
+
+	// delete a, its slot is reused for c with a new generation
+	check(f.deleteHandle(ha) == &a && f.getObj(ha) == NULL, "deleted handle");
+	check(f.deleteHandle(ha) == NULL, "second delete of a handle");
+	void* hc = f.createHandle(&c);
+	check(hc != ha && f.getObj(hc) == &c && f.getObj(ha) == NULL, "stale handle of a reused slot");
+	check(f.getObj((void*)(uintptr_t)0x12345) == NULL && f.deleteHandle((void*)(uintptr_t)0x12345) == NULL, "forged handle");
+
+	// oldest first: b was created before c
+	check(f.deleteBack() == &b && f.deleteBack() == &c && f.deleteBack() == NULL && f.isEmpty(), "deleteBack order");
+	check(f.getObj(hb) == NULL && f.getObj(hc) == NULL, "handles after deleteBack");
+
+	// many handles, release in random order, all stale handles stay invalid
+	std::vector<Item> items(5000);
+	std::vector<void*> handles;
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		items[i].id = (unsigned)i;
+		handles.push_back(f.createHandle(&items[i]));
+	}
+	bool ok = true;
+	for (size_t i = 0; i < items.size(); i += 3)
+		ok = ok && f.deleteHandle(handles[i]) == &items[i];
+	for (size_t i = 0; i < items.size(); i++)
+		ok = ok && f.getObj(handles[i]) == ((i % 3 == 0) ? NULL : &items[i]);
+	check(ok, "5000 handles, every third deleted");
+	while (f.deleteBack())
+		;
+	check(f.isEmpty(), "empty after deleteBack loop");
+}
+
+// each thread resolves lookups random handles, returns the aggregated lookups per second
+template<class Factory>
+static double runLookups(Factory& f, const std::vector<void*>& handles, const std::vector<Item>& items, unsigned numThreads, size_t lookups, bool churn)
+{
+	std::atomic<bool> go(false), running(true);
+	std::atomic<unsigned> errors(0);
+	std::vector<std::thread> threads;
+	for (unsigned t = 0; t < numThreads; t++)
+	{
+		threads.emplace_back([&, t]() {
+			uint32_t rnd = 2463534242u + t * 7919u;
+			unsigned err = 0;
+			while (!go)
+				std::this_thread::yield();
+			for (size_t i = 0; i < lookups; i++)
+			{
+				rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;
+				size_t k = rnd % handles.size();
+				Item* obj = f.getObj(handles[k]);
+				if (obj != &items[k])
+					err++;
+			}
+			errors += err;
+		});
+	}
+	// creates and deletes a handle of an extra object all the time, as opening and closing of a device or buffer does
+	std::thread churner;
+	if (churn)
+	{
+		churner = std::thread([&]() {
+			Item extra = { 0 };
+			while (!go)
+				std::this_thread::yield();
+			while (running)
+			{
+				void* h = f.createHandle(&extra);
+				if (f.getObj(h) != &extra || f.deleteHandle(h) != &extra || f.getObj(h) != NULL)
+					errors++;
+			}
+		});
+	}
+
+	auto t0 = std::chrono::steady_clock::now();
+	go = true;
+	for (auto& th : threads)
+		th.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	running = false;
+	if (churner.joinable())
+		churner.join();
+	check(errors == 0, "lookups returned wrong objects: " + std::to_string(errors));
+	return double(lookups) * double(numThreads) / seconds;
+}
+
+template<class Factory>
+static double benchmark(unsigned numThreads, size_t numHandles, size_t lookups, bool churn)
+{
+	Factory f;
+	std::vector<Item> items(numHandles);
+	std::vector<void*> handles(numHandles);
+	for (size_t i = 0; i < numHandles; i++)
+	{
+		items[i].id = (unsigned)i;
+		handles[i] = f.createHandle(&items[i]);
+	}
+	double rate = runLookups(f, handles, items, numThreads, lookups, churn);
+	for (size_t i = 0; i < numHandles; i++)
+		f.deleteHandle(handles[i]);
+	return rate;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		size_t numHandles = (argc > 1) ? (size_t)atoi(argv[1]) : 500;
+		unsigned maxThreads = (argc > 2) ? (unsigned)atoi(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+		size_t lookups = (argc > 3) ? (size_t)atoi(argv[3]) : 200000;
+		if (numHandles == 0 || maxThreads == 0 || lookups == 0)
+		{
+			std::cerr << "Usage: cx_cam_handle_benchmark [numHandles] [maxThreads] [lookupsPerThread]" << std::endl;
+			return -1;
+		}
+
+		testSemantics();
+
+		std::cout << numHandles << " handles, " << lookups << " lookups per thread" << std::endl;
+		for (int churn = 0; churn < 2; churn++)
+		{
+			std::cout << (churn ? "with a thread creating and deleting handles:" : "lookups only:") << std::endl;
+			std::cout << "threads\tlist+mutex [M/s]\tslot map [M/s]\tspeedup" << std::endl;
+			for (unsigned n = 1; n <= maxThreads; n = (n * 2 > maxThreads && n < maxThreads) ? maxThreads : n * 2)
+			{
+				double listRate = benchmark<ListHandleFactory<Item> >(n, numHandles, lookups, churn != 0);
+				double slotRate = benchmark<cx::HandleFactory<Item> >(n, numHandles, lookups, churn != 0);
+				std::cout << n << "\t" << listRate / 1e6 << "\t\t\t" << slotRate / 1e6 << "\t\t" << slotRate / listRate << std::endl;
+			}
+		}
+		std::cout << (g_failed ? "FAILED" : "ok") << std::endl;
+		if (g_failed)
+			return -1;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "exception caught, msg: " << err.what() << endl;
+		exit(-3);
+	}
+	return 0;
+}
@@ -0,0 +1,257 @@
+/** C++ test of the packed pixel decoder of the wrapper.
+\example cx_cam_packed_decode_test.cpp
+
+This example checks cx::unpackRow and cx::Image::decodePacked (AT/cx/PackedDecode.h) without camera:
+- known Mono10p and Mono12p byte sequences (PFNC packing) against their pixel values, for every kernel supported by the CPU,
+- random rows of widths 1 to 64 with and without readable padding, every SIMD kernel (SSSE3, AVX2, NEON) against the scalar kernel and a bit by bit
+  reference decoder. The rows end at the end of their heap block, run it with AddressSanitizer to detect reads beyond the row,
+- Image::decodePacked against the library function cx_image_decode_mono12p (Image::decodeMono12p) for Mono12p and Coord3D_C12p images,
+  also with a thread pool and into a caller provided Coord3D_C16 image with row padding.
+
+Kernels not supported by the CPU or not compiled in are reported as skipped. The example returns -1 if a check fails.
+
+Usage: cx_cam_packed_decode_test
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <random>
+using namespace std;
+
+#include "cx_cam_common.h"
+#include "AT/cx/PackedDecode.h"
+#include "AT/cx/ThreadPool.h"
+using namespace AT;
+
+static int g_failed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		std::cerr << "FAILED: " << what << std::endl;
+		g_failed++;
+	}
+}
+
+static const char* kernelName(cx::packed_kernel k)
+{
+	switch (k)
+	{
+	case cx::PACKED_KERNEL_SCALAR:	return "scalar";
+	case cx::PACKED_KERNEL_SSSE3:	return "SSSE3";
+	case cx::PACKED_KERNEL_AVX2:	return "AVX2";
+	case cx::PACKED_KERNEL_NEON:	return "NEON";
+	default:						return "unknown";
+	}
+}
+
+// reference decoder, reads pixel x bit by bit from the little endian bit stream
+static uint16_t referencePixel(const uint8_t* src, unsigned bits, unsigned x)
+{
+	uint16_t v = 0;
+	for (unsigned b = 0; b < bits; b++)
+	{
+		size_t bit = size_t(x) * bits + b;
+		if (src[bit / 8] & (1 << (bit % 8)))
+			v |= uint16_t(1 << b);
+	}
+	return v;
+}
+
+static std::vector<cx::packed_kernel> supportedKernels()
+{
+	std::vector<cx::packed_kernel> kernels;
+	const cx::packed_kernel all[] = { cx::PACKED_KERNEL_SCALAR, cx::PACKED_KERNEL_SSSE3, cx::PACKED_KERNEL_AVX2, cx::PACKED_KERNEL_NEON };
+	for (cx::packed_kernel k : all)
+	{
+		if (cx::packedKernelSupported(k))
+			kernels.push_back(k);
+		else
+			std::cout << "kernel " << kernelName(k) << " not supported, skipped" << std::endl;
+	}
+	return kernels;
+}
+
+// decodes a row which ends at the end of its heap block, checks that no pixel beyond w is written
+static std::vector<uint16_t> unpack(unsigned bits, const std::vector<uint8_t>& row, unsigned w, cx::packed_kernel k, bool& overrun)
+{
+	std::vector<uint8_t> src(row);
+	std::vector<uint16_t> dst(w + 1, 0xBEEF);
+	cx::unpackRow(bits, src.data(), src.size(), dst.data(), w, k);
+	overrun = dst[w] != 0xBEEF;
+	dst.resize(w);
+	return dst;
+}
+
+static void testGolden(const std::vector<cx::packed_kernel>& kernels)
+{
+	const std::vector<uint8_t> packed10 = { 0xFF, 0x07, 0x50, 0x95, 0xAA, 0x00, 0x00, 0x38, 0x52, 0xF1 };
+	const std::vector<uint16_t> pixels10 = { 0x3FF, 0x001, 0x155, 0x2AA, 0x000, 0x200, 0x123, 0x3C5 };
+	const std::vector<uint8_t> packed12 = { 0xBC, 0x3A, 0x12, 0xFF, 0x0F, 0x00, 0x00, 0xF8, 0x7F };
+	const std::vector<uint16_t> pixels12 = { 0xABC, 0x123, 0xFFF, 0x000, 0x800, 0x7FF };
+	for (cx::packed_kernel k : kernels)
+	{
+		bool overrun = false;
+		check(unpack(10, packed10, 8, k, overrun) == pixels10 && !overrun, std::string("golden Mono10p, ") + kernelName(k));
+		check(unpack(12, packed12, 6, k, overrun) == pixels12 && !overrun, std::string("golden Mono12p, ") + kernelName(k));
+	}
+	for (unsigned x = 0; x < 8; x++)
+		check(referencePixel(packed10.data(), 10, x) == pixels10[x], "reference decoder Mono10p");
+	for (unsigned x = 0; x < 6; x++)
+		check(referencePixel(packed12.data(), 12, x) == pixels12[x], "reference decoder Mono12p");
+
+	bool thrown = false;
+	try
+	{
+		uint16_t dst[8];
+		cx::unpackRow(12, packed12.data(), 11, dst, 8);
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+	check(thrown, "source row too short");
+}
+
+static void testRandomRows(const std::vector<cx::packed_kernel>& kernels)
+{
+	std::mt19937 rng(1234);
+	const unsigned bitsList[] = { 10, 12 };
+	for (unsigned bits : bitsList)
+	{
+		for (unsigned w = 1; w <= 64; w++)
+		{
+			size_t rowBytes = (size_t(w) * bits + 7) / 8;
+			for (int trial = 0; trial < 8; trial++)
+			{
+				// exact row, padding of a few bytes and padding which lets the SIMD kernels decode the whole row
+				size_t padding = (trial == 0) ? 0 : (trial == 1) ? 32 : rng() % 16;
+				std::vector<uint8_t> row(rowBytes + padding);
+				for (uint8_t& b : row)
+					b = uint8_t(rng());
+
+				std::vector<uint16_t> expected(w);
+				for (unsigned x = 0; x < w; x++)
+					expected[x] = referencePixel(row.data(), bits, x);
+				bool overrun = false;
+				std::vector<uint16_t> scalar = unpack(bits, row, w, cx::PACKED_KERNEL_SCALAR, overrun);
+				check(scalar == expected && !overrun, "scalar, " + std::to_string(bits) + " bit, width " + std::to_string(w));
+				for (cx::packed_kernel k : kernels)
+				{
+					std::vector<uint16_t> simd = unpack(bits, row, w, k, overrun);
+					check(simd == scalar && !overrun, std::string(kernelName(k)) + " vs scalar, " + std::to_string(bits) + " bit, width " + std::to_string(w)
+						+ ", padding " + std::to_string(padding));
+				}
+			}
+		}
+	}
+}
+
+static bool sameImage(const cx::Image& a, const cx::Image& b)
+{
+	if (a.width() != b.width() || a.height() != b.height())
+		return false;
+	for (unsigned y = 0; y < a.height(); y++)
+		if (memcmp(((cx::Image&)a).row<uint16_t>(y), ((cx::Image&)b).row<uint16_t>(y), size_t(a.width()) * 2) != 0)
+			return false;
+	return true;
+}
+
+static void testImages()
+{
+	std::mt19937 rng(42);
+	cx::ThreadPool pool(4);
+	const cx_pixel_format formats[] = { CX_PF_MONO_12p, CX_PF_COORD3D_C12p };
+	const unsigned heights[] = { 1, 3, 130 };
+	for (cx_pixel_format pf : formats)
+	{
+		for (unsigned w = 1; w <= 64; w++)
+		{
+			for (unsigned h : heights)
+			{
+				const std::string name = "image " + std::to_string(w) + "x" + std::to_string(h) + " pf " + std::to_string(pf);
+				size_t pitch = (size_t(w) * 12 + 7) / 8;
+				std::vector<uint8_t> data(pitch * h);
+				for (uint8_t& b : data)
+					b = uint8_t(rng());
+				cx::Image src(h, w, pf, data.data(), data.size(), pitch);
+
+				cx::Image golden;
+				cx::Image::decodeMono12p(src, golden);
+				cx::Image out;
+				cx::Image::decodePacked(src, out);
+				check(out.pixelFormat() == cx::unpackedFormat(pf) && sameImage(golden, out), name + ": decodePacked vs cx_image_decode_mono12p");
+
+				cx::Image parallel;
+				cx::Image::decodePacked(src, parallel, &pool);
+				check(sameImage(golden, parallel), name + ": decodePacked with thread pool");
+
+				// caller provided Coord3D_C16 image with row padding, the padding must stay untouched
+				size_t dstPitch = size_t(w) * 2 + 16;
+				std::vector<uint8_t> dstData(dstPitch * h, 0xA5);
+				cx::Image provided(h, w, CX_PF_COORD3D_C16, dstData.data(), dstData.size(), dstPitch);
+				cx::Image::decodePacked(src, provided);
+				bool paddingKept = true;
+				for (unsigned y = 0; y < h; y++)
+					for (size_t i = size_t(w) * 2; i < dstPitch; i++)
+						paddingKept = paddingKept && dstData[y * dstPitch + i] == 0xA5;
+				check(provided.data() == dstData.data() && sameImage(golden, provided) && paddingKept, name + ": decodePacked into caller provided image");
+			}
+		}
+	}
+
+	// Mono10p has no library decoder, compare with the reference decoder
+	for (unsigned w = 1; w <= 64; w++)
+	{
+		const unsigned h = 5;
+		size_t pitch = (size_t(w) * 10 + 7) / 8 + 3;
+		std::vector<uint8_t> data(pitch * h);
+		for (uint8_t& b : data)
+			b = uint8_t(rng());
+		cx::Image src(h, w, CX_PF_MONO_10p, data.data(), data.size() - 3, pitch);
+		cx::Image out;
+		cx::Image::decodePacked(src, out, &pool);
+		bool ok = out.pixelFormat() == CX_PF_MONO_16;
+		for (unsigned y = 0; y < h && ok; y++)
+			for (unsigned x = 0; x < w; x++)
+				ok = ok && out.row<uint16_t>(y)[x] == referencePixel(data.data() + y * pitch, 10, x);
+		check(ok, "Mono10p image, width " + std::to_string(w));
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		std::vector<cx::packed_kernel> kernels = supportedKernels();
+		std::cout << "default kernel: " << kernelName(cx::detectPackedKernel()) << std::endl;
+		testGolden(kernels);
+		testRandomRows(kernels);
+		testImages();
+		std::cout << (g_failed ? "FAILED" : "ok") << std::endl;
+		if (g_failed)
+			return -1;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "exception caught, msg: " << err.what() << endl;
+		exit(-3);
+	}
+	return 0;
+}
@@ -30,6 +30,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <stdio.h>
 #include <string>
 #include <iostream>
+#include <chrono>
 using namespace std;
 
 #ifdef USE_OPENCV
@@ -103,6 +104,9 @@ int main(int argc, char* argv[])
 		val = true;
 		cam->setParam("DataStream::PassCorruptFrames", val);
 
+		// collect the acquisition statistics, the counters of the DataStream nodemap are read by pollStreamStats
+		cx::AcquisitionStats& stats = cam->enableStats();
+
 		// 2. Allocate and queue internal acquisition buffers
 		cam->allocAndQueueBuffers(3);
 
@@ -113,19 +117,22 @@ int main(int argc, char* argv[])
 
 		// 4. Acquisition loop
 
-		size_t buffersDelivered = 0, buffersCorrupt = 0;
+		auto lastReport = std::chrono::steady_clock::now();
 		while (1)
 		{
 			// 4. Grab acquisition buffer, wait for valid buffer with optional timeout. Timeout is given in ms.
 			cx::DeviceBuffer buffer = cam->waitForBuffer(5000);
-			
-			cam->getParam("DataStream::NumBuffersDelivered", val);
-			buffersDelivered = (size_t)val;
-
-			cam->getParam("DataStream::NumBuffersCorrupt", val);
-			buffersCorrupt = (size_t)val;
 
-			std::cout << "NumBuffersDelivered: " << buffersDelivered << ", NumBuffersCorrupt: " << buffersCorrupt << std::endl;
+			// reading GenApi nodes per frame costs more than the acquisition itself, the statistics are updated per buffer and reported once per second.
+			auto now = std::chrono::steady_clock::now();
+			if (now - lastReport >= std::chrono::seconds(1))
+			{
+				lastReport = now;
+				cam->pollStreamStats();
+				cx::AcquisitionStats::Snapshot s = stats.snapshot();
+				std::cout << "Delivered: " << s.delivered << ", Corrupt: " << s.corrupt << ", Incomplete: " << s.incomplete << ", Missing: " << s.missingFrames
+					<< ", Latency p99: " << s.latency.percentile(99) / 1000 << " us" << std::endl;
+			}
 
 			// 5. get image data from buffer and do some processing on the image data (or get a copy for later use)
 			// \note img holds a reference to the image data in the DeviceBuffer, if you need the image data after cx_queueBuffer you need to clone the image!
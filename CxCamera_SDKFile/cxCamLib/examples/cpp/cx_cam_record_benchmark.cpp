@@ -0,0 +1,163 @@
+/** C++ benchmark of the write throughput of cx::Recorder.
+\example cx_cam_record_benchmark.cpp
+
+This example records synthetic buffers as fast as the recorder accepts them and reports the sustained write rate in GB/s, the target for
+recording high speed 3D cameras is more than 1 GB/s. The recorder waits for free blocks (Options::blockOnFull), so no buffer is dropped and the time
+until close() returns includes writing all data. The cost of record() on the grab thread is reported separately, it is the copy into the write blocks.
+
+Without "direct" the file is written through the page cache and the rate includes the cache, use a total size larger than the memory of the system
+or "direct" (O_DIRECT on Linux) to measure the disk. Finally the recording is opened with cx::RecordingReader to check that all buffers were written.
+The example returns -1 if a write failed or the recording is incomplete.
+
+Usage: cx_cam_record_benchmark [file] [bufferMB] [totalMB] [direct]
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+using namespace std;
+
+#include "cx_cam_common.h"
+#include "AT/cx/Recorder.h"
+using namespace AT;
+
+/** Buffer source with one Mono16 image of the given size, the first row holds the frame number.
+*/
+class BenchmarkSource : public cx::BufferSource
+{
+public:
+	explicit BenchmarkSource(size_t size) : m_width(4096), m_frame(0)
+	{
+		m_height = (unsigned)std::max<size_t>(1, size / (m_width * 2));
+		m_data.resize(size_t(m_width) * 2 * m_height);
+		for (size_t i = 0; i < m_data.size(); i++)
+			m_data[i] = (uint8_t)(i * 31);
+	}
+
+	cx::DeviceBuffer next(uint64_t frame)
+	{
+		m_frame = frame;
+		memcpy(m_data.data(), &frame, sizeof(frame));
+		return cx::DeviceBuffer((CX_BUFFER_HANDLE)(uintptr_t)1, this);
+	}
+
+	size_t size() const { return m_data.size(); }
+
+	cx_status_t getBufferImage(CX_BUFFER_HANDLE, int, cx_img_t* img) override
+	{
+		img->pixelFormat = CX_PF_MONO_16;
+		img->width = m_width;
+		img->height = m_height;
+		img->flag = 0;
+		img->linePitch = size_t(m_width) * 2;
+		img->planePitch = 0;
+		img->dataSz = m_data.size();
+		img->data = m_data.data();
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t getBufferInfo(CX_BUFFER_HANDLE, int param, cx_variant_t* val) override
+	{
+		if (param != CX_BUFFER_INFO_TIMESTAMP)
+			return CX_STATUS_INVALID_PARAMETER;
+		*static_cast<cx::Variant*>(val) = (uint64_t)(m_frame * 1000);
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t getBufferChunk(CX_BUFFER_HANDLE, int, cx_chunk_t*) override { return CX_STATUS_INVALID_PARAMETER; }
+	cx_status_t getBufferPartInfo(CX_BUFFER_HANDLE, int, int, cx_variant_t*) override { return CX_STATUS_INVALID_PARAMETER; }
+	cx_status_t queueBuffer(CX_BUFFER_HANDLE) override { return CX_STATUS_OK; }
+
+private:
+	unsigned m_width;
+	unsigned m_height;
+	std::vector<uint8_t> m_data;
+	uint64_t m_frame;
+};
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		std::string fileName = (argc > 1) ? argv[1] : "cx_cam_record_benchmark.cxrec";
+		size_t bufferMB = (argc > 2) ? (size_t)atoi(argv[2]) : 8;
+		size_t totalMB = (argc > 3) ? (size_t)atoi(argv[3]) : 4096;
+		bool direct = (argc > 4) && std::string(argv[4]) == "direct";
+		if (bufferMB == 0 || totalMB < bufferMB)
+		{
+			std::cerr << "Usage: cx_cam_record_benchmark [file] [bufferMB] [totalMB] [direct]" << std::endl;
+			return -1;
+		}
+
+		BenchmarkSource source(bufferMB << 20);
+		const uint64_t numFrames = totalMB / bufferMB;
+		cx::Recorder::Options options;
+		options.directIO = direct;
+		options.blockOnFull = true;
+		std::cout << "recording " << numFrames << " buffers of " << source.size() / 1e6 << " MB to " << fileName << (direct ? " (O_DIRECT)" : "")
+			<< ", " << options.numBlocks << " blocks of " << (options.blockSize >> 20) << " MB" << std::endl;
+
+		cx::Recorder rec(fileName, cx::ParamMap(), options);
+		double recordMs = 0.0, maxRecordMs = 0.0;
+		auto t0 = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < numFrames; i++)
+		{
+			cx::DeviceBuffer buffer = source.next(i);
+			auto r0 = std::chrono::steady_clock::now();
+			rec.record(buffer);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - r0).count();
+			recordMs += ms;
+			maxRecordMs = std::max(maxRecordMs, ms);
+		}
+		rec.close();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		double gbps = double(rec.bytesWritten()) / seconds / 1e9;
+
+		std::cout << "written: " << rec.bytesWritten() / 1e9 << " GB in " << seconds << " s, " << gbps << " GB/s (target 1 GB/s: " << (gbps >= 1.0 ? "reached" : "not reached") << ")" << std::endl;
+		std::cout << "record(): " << recordMs / double(numFrames) << " ms/buffer average (including waits for free blocks), " << maxRecordMs << " ms max" << std::endl;
+		std::cout << "recorded: " << rec.numRecorded() << ", dropped: " << rec.numDropped() << std::endl;
+
+		bool ok = !rec.hasError() && rec.numRecorded() == numFrames;
+		{
+			cx::RecordingReader reader(fileName);
+			ok = ok && reader.numFrames() == numFrames;
+			if (reader.numFrames() > 0)
+			{
+				cx::RecordedFrame frame;
+				reader.readFrame(reader.numFrames() - 1, frame);
+				uint64_t last = 0;
+				if (!frame.parts.empty() && frame.parts[0].info.dataSize >= sizeof(last))
+					memcpy(&last, frame.parts[0].data, sizeof(last));
+				ok = ok && last == numFrames - 1;
+			}
+		}
+		remove(fileName.c_str());
+		if (!ok)
+		{
+			std::cerr << "recording incomplete" << std::endl;
+			return -1;
+		}
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "exception caught, msg: " << err.what() << endl;
+		exit(-3);
+	}
+	return 0;
+}
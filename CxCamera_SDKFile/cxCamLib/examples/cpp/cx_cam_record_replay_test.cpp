@@ -0,0 +1,449 @@
+/** C++ test of recording buffers with cx::Recorder and playing them back with cx::ReplayDevice.
+\example cx_cam_record_replay_test.cpp
+
+This example records synthetic buffers without camera and compares the replayed buffers with the originals:
+- multipart buffers with part infos, chunks, timestamps, incomplete flags and device parameters, with records larger than the write blocks,
+- records that don't fit into the free blocks, they are dropped also if the recorder waits for free blocks,
+- planar images (Coord3D_ABC16_Planar with padding between the planes), the plane pitch must be restored on replay,
+- recordings of format version 1, which have no plane pitch in the part header, must still be readable.
+
+The example returns -1 if a check fails.
+
+Usage: cx_cam_record_replay_test
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <iostream>
+using namespace std;
+
+#include "cx_cam_common.h"
+#include "AT/cx/Recorder.h"
+#include "AT/cx/ReplayDevice.h"
+using namespace AT;
+
+static int g_failed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		std::cerr << "FAILED: " << what << std::endl;
+		g_failed++;
+	}
+}
+
+/** Buffer source with one synthetic buffer, the bytes of the image depend on the frame number.
+*/
+class SyntheticSource : public cx::BufferSource
+{
+public:
+	SyntheticSource(unsigned pixelFormat, unsigned width, unsigned height, size_t linePitch, size_t planePitch, size_t dataSize)
+		: m_pixelFormat(pixelFormat), m_width(width), m_height(height), m_linePitch(linePitch), m_planePitch(planePitch), m_data(dataSize), m_frame(0)
+	{
+	}
+
+	//! Fill the buffer for frame and return it.
+	cx::DeviceBuffer next(uint64_t frame)
+	{
+		m_frame = frame;
+		fill(m_data, frame);
+		return cx::DeviceBuffer((CX_BUFFER_HANDLE)(uintptr_t)1, this);
+	}
+
+	static void fill(std::vector<uint8_t>& data, uint64_t frame)
+	{
+		for (size_t i = 0; i < data.size(); i++)
+			data[i] = (uint8_t)(i * 7 + frame * 13);
+	}
+
+	cx_status_t getBufferImage(CX_BUFFER_HANDLE, int, cx_img_t* img) override
+	{
+		img->pixelFormat = m_pixelFormat;
+		img->width = m_width;
+		img->height = m_height;
+		img->flag = 0;
+		img->linePitch = m_linePitch;
+		img->planePitch = m_planePitch;
+		img->dataSz = m_data.size();
+		img->data = m_data.data();
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t getBufferInfo(CX_BUFFER_HANDLE, int param, cx_variant_t* val) override
+	{
+		if (param != CX_BUFFER_INFO_TIMESTAMP)
+			return CX_STATUS_INVALID_PARAMETER;
+		*static_cast<cx::Variant*>(val) = (uint64_t)(1000 + m_frame * 20);
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t getBufferChunk(CX_BUFFER_HANDLE, int, cx_chunk_t*) override { return CX_STATUS_INVALID_PARAMETER; }
+	cx_status_t getBufferPartInfo(CX_BUFFER_HANDLE, int, int, cx_variant_t*) override { return CX_STATUS_INVALID_PARAMETER; }
+	cx_status_t queueBuffer(CX_BUFFER_HANDLE) override { return CX_STATUS_OK; }
+
+private:
+	unsigned m_pixelFormat;
+	unsigned m_width;
+	unsigned m_height;
+	size_t m_linePitch;
+	size_t m_planePitch;
+	std::vector<uint8_t> m_data;
+	uint64_t m_frame;
+};
+
+/** Buffer source with a multipart buffer (range and reflectance of a 3D camera) and a chunk.
+	Part data, chunk, timestamp and incomplete flag depend on the frame number.
+*/
+class MultipartSource : public cx::BufferSource
+{
+public:
+	enum { WIDTH = 256, HEIGHT = 16, CHUNK_SIZE = 40, CHUNK_ID = 0x40000001 };
+
+	MultipartSource() : m_frame(0)
+	{
+		m_parts.resize(2);
+		m_parts[0].pixelFormat = CX_PF_MONO_16;
+		m_parts[0].purposeId = CX_BUFFER_PART_PURPOSE_ID_RANGE;
+		m_parts[0].regionId = 1;
+		m_parts[0].data.resize(WIDTH * HEIGHT * 2);
+		m_parts[1].pixelFormat = CX_PF_MONO_8;
+		m_parts[1].purposeId = CX_BUFFER_PART_PURPOSE_ID_REFLECTANCE;
+		m_parts[1].regionId = 2;
+		m_parts[1].data.resize(WIDTH * HEIGHT);
+		m_chunk.resize(CHUNK_SIZE);
+	}
+
+	cx::DeviceBuffer next(uint64_t frame)
+	{
+		m_frame = frame;
+		for (size_t i = 0; i < m_parts.size(); i++)
+			SyntheticSource::fill(m_parts[i].data, frame * 2 + i);
+		SyntheticSource::fill(m_chunk, frame + 100);
+		return cx::DeviceBuffer((CX_BUFFER_HANDLE)(uintptr_t)1, this);
+	}
+
+	static uint64_t timestamp(uint64_t frame) { return 5000000 + frame * 1000; }
+	static bool incomplete(uint64_t frame) { return frame % 5 == 4; }
+	static unsigned deliveredHeight(uint64_t frame) { return incomplete(frame) ? HEIGHT / 2 : HEIGHT; }
+
+	cx_status_t getBufferImage(CX_BUFFER_HANDLE, int partIdx, cx_img_t* img) override
+	{
+		if (partIdx < 0 || partIdx >= (int)m_parts.size())
+			return CX_STATUS_INVALID_PARAMETER;
+		const Part& p = m_parts[partIdx];
+		img->pixelFormat = p.pixelFormat;
+		img->width = WIDTH;
+		img->height = HEIGHT;
+		img->flag = 0;
+		img->linePitch = p.data.size() / HEIGHT;
+		img->planePitch = 0;
+		img->dataSz = p.data.size();
+		img->data = const_cast<uint8_t*>(p.data.data());
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t getBufferChunk(CX_BUFFER_HANDLE, int chunkIdx, cx_chunk_t* chunk) override
+	{
+		if (chunkIdx != 0)
+			return CX_STATUS_INVALID_PARAMETER;
+		chunk->descriptor = CHUNK_ID;
+		chunk->length = m_chunk.size();
+		chunk->data = m_chunk.data();
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t getBufferInfo(CX_BUFFER_HANDLE, int param, cx_variant_t* val) override
+	{
+		cx::Variant& v = *static_cast<cx::Variant*>(val);
+		switch (param)
+		{
+		case CX_BUFFER_INFO_TIMESTAMP: v = timestamp(m_frame); break;
+		case CX_BUFFER_INFO_IS_INCOMPLETE: v = incomplete(m_frame); break;
+		case CX_BUFFER_INFO_IS_MULTIPART: v = true; break;
+		case CX_BUFFER_INFO_NUM_PARTS: v = (uint64_t)m_parts.size(); break;
+		case CX_BUFFER_INFO_NUM_CHUNK: v = (uint64_t)1; break;
+		default: return CX_STATUS_INVALID_PARAMETER;
+		}
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t getBufferPartInfo(CX_BUFFER_HANDLE, int partIdx, int param, cx_variant_t* val) override
+	{
+		if (partIdx < 0 || partIdx >= (int)m_parts.size())
+			return CX_STATUS_INVALID_PARAMETER;
+		cx::Variant& v = *static_cast<cx::Variant*>(val);
+		switch (param)
+		{
+		case CX_BUFFER_PART_INFO_DATA_PURPOSE_ID: v = (uint64_t)m_parts[partIdx].purposeId; break;
+		case CX_BUFFER_PART_INFO_REGION_ID: v = (uint64_t)m_parts[partIdx].regionId; break;
+		case CX_BUFFER_PART_INFO_SOURCE_ID: v = (uint64_t)0; break;
+		case CX_BUFFER_PART_INFO_YOFFSET: v = (uint64_t)(10 * partIdx); break;
+		case CX_BUFFER_PART_INFO_DELIVERED_HEIGHT: v = (uint64_t)deliveredHeight(m_frame); break;
+		default: return CX_STATUS_INVALID_PARAMETER;
+		}
+		return CX_STATUS_OK;
+	}
+
+	cx_status_t queueBuffer(CX_BUFFER_HANDLE) override { return CX_STATUS_OK; }
+
+private:
+	struct Part
+	{
+		unsigned pixelFormat;
+		unsigned purposeId;
+		unsigned regionId;
+		std::vector<uint8_t> data;
+	};
+
+	std::vector<Part> m_parts;
+	std::vector<uint8_t> m_chunk;
+	uint64_t m_frame;
+};
+
+static cx::Recorder::Options smallBlocks()
+{
+	cx::Recorder::Options options;
+	options.blockSize = 1 << 16;
+	options.numBlocks = 4;
+	options.blockOnFull = true;
+	return options;
+}
+
+// compare a replayed buffer with the buffer recorded as frame
+static void checkReplayed(cx::DeviceBuffer& buffer, uint64_t frame)
+{
+	const std::string name = "frame " + std::to_string(frame);
+	cx::Variant val;
+	check(buffer.tryGetInfo(CX_BUFFER_INFO_TIMESTAMP, val) == CX_STATUS_OK && (uint64_t)(int64_t)val == MultipartSource::timestamp(frame), name + " timestamp");
+	check(buffer.tryGetInfo(CX_BUFFER_INFO_IS_INCOMPLETE, val) == CX_STATUS_OK && ((int64_t)val != 0) == MultipartSource::incomplete(frame), name + " incomplete flag");
+	check(buffer.tryGetInfo(CX_BUFFER_INFO_IS_MULTIPART, val) == CX_STATUS_OK && (int64_t)val != 0, name + " multipart flag");
+	check(buffer.tryGetInfo(CX_BUFFER_INFO_NUM_PARTS, val) == CX_STATUS_OK && (int64_t)val == 2, name + " number of parts");
+
+	MultipartSource expected;
+	cx::DeviceBuffer orig = expected.next(frame);
+	for (int i = 0; i < 2; i++)
+	{
+		const std::string part = name + " part " + std::to_string(i);
+		const int infos[] = { CX_BUFFER_PART_INFO_DATA_PURPOSE_ID, CX_BUFFER_PART_INFO_REGION_ID, CX_BUFFER_PART_INFO_YOFFSET, CX_BUFFER_PART_INFO_DELIVERED_HEIGHT };
+		for (int info : infos)
+		{
+			cx::Variant a, b;
+			check(buffer.tryGetPartInfo(i, (cx_buffer_part_info)info, a) == CX_STATUS_OK && orig.tryGetPartInfo(i, (cx_buffer_part_info)info, b) == CX_STATUS_OK
+				&& (int64_t)a == (int64_t)b, part + " info " + std::to_string(info));
+		}
+		cx::ImageView img = buffer.getImageView(i);
+		cx::ImageView ref = orig.getImageView(i);
+		// the replayed image has the delivered height, the data is complete
+		check(img.pixelFormat() == ref.pixelFormat() && img.width() == ref.width() && img.height() == MultipartSource::deliveredHeight(frame)
+			&& img.linePitch() == ref.linePitch(), part + " layout");
+		check(img.dataSz() == ref.dataSz() && memcmp(img.data(), ref.data(), ref.dataSz()) == 0, part + " data");
+	}
+	cx::Chunk chunk = buffer.getChunkView(0);
+	cx::Chunk refChunk = orig.getChunkView(0);
+	check(chunk.descriptor == MultipartSource::CHUNK_ID && chunk.length == refChunk.length && memcmp(chunk.data, refChunk.data, refChunk.length) == 0, name + " chunk");
+}
+
+// multipart buffers recorded with 4 KB blocks, every record spans several blocks
+static void testRoundTrip(const std::string& fileName)
+{
+	const int numFrames = 50;
+	cx::ParamMap params;
+	params["Width"] = (int64_t)MultipartSource::WIDTH;
+	params["DeviceModelName"] = "replay test";
+	params["Scan3dExtractionSelector#2"] = "Extraction0";
+	{
+		cx::Recorder::Options options = smallBlocks();
+		options.blockSize = 4096;
+		options.numBlocks = 8;
+		MultipartSource source;
+		cx::Recorder rec(fileName, params, options);
+		for (int i = 0; i < numFrames; i++)
+		{
+			cx::DeviceBuffer buffer = source.next(i);
+			check(rec.record(buffer), "record frame " + std::to_string(i));
+		}
+		rec.close();
+		check(rec.numRecorded() == numFrames && rec.numDropped() == 0 && !rec.hasError(), "recorder counters");
+	}
+
+	cx::RecordingReader reader(fileName);
+	check(reader.numFrames() == numFrames && reader.params().size() == params.size(), "recording has " + std::to_string(reader.numFrames()) + " frames");
+	check(reader.findFrame(MultipartSource::timestamp(17)) == 17 && reader.findFrame(MultipartSource::timestamp(17) + 1) == 18, "findFrame by timestamp");
+
+	cx::DevicePtr dev = cx::DeviceFactory::openDevice("replay://" + fileName + "?rate=max");
+	cx::Variant val;
+	dev->getParam("Width", val);
+	check((int64_t)val == MultipartSource::WIDTH, "parameter Width");
+	dev->getParam("DeviceModelName", val);
+	check(std::string(val) == "replay test", "parameter DeviceModelName");
+	dev->getParamInfo(CX_PARAM_INFO_RANGE, "Scan3dExtractionSelector", val);
+	check(std::string(val) == "Extraction0", "parameter info of Scan3dExtractionSelector");
+
+	dev->allocAndQueueBuffers(4);
+	dev->startAcquisition();
+	int n = 0;
+	cx::DeviceBuffer buffer;
+	while (n < numFrames && dev->tryWaitForBuffer(buffer, 1000) == CX_STATUS_OK)
+	{
+		checkReplayed(buffer, n++);
+		buffer.queueBuffer();
+	}
+	check(n == numFrames, "replayed " + std::to_string(n) + " of " + std::to_string(numFrames) + " frames");
+	// without loop the replay ends after the last frame
+	check(dev->tryWaitForBuffer(buffer, 200) != CX_STATUS_OK, "no buffer after the end of the recording");
+	dev->stopAcquisition();
+}
+
+/** Records that need all blocks while a partially filled block is held can't be reserved, with blockOnFull they must be dropped instead of waiting forever.
+	A record of the multipart source needs 3 or 4 blocks of 4 KB.
+*/
+static void testOversizedRecords(const std::string& fileName)
+{
+	const int numFrames = 20;
+	cx::Recorder::Options options = smallBlocks();
+	options.blockSize = 4096;
+	options.numBlocks = 4;
+	MultipartSource source;
+	cx::Recorder rec(fileName, cx::ParamMap(), options);
+	int recorded = 0;
+	for (int i = 0; i < numFrames; i++)
+	{
+		cx::DeviceBuffer buffer = source.next(i);
+		recorded += rec.record(buffer) ? 1 : 0;
+	}
+	rec.close();
+	check(rec.numRecorded() == (uint64_t)recorded && rec.numRecorded() + rec.numDropped() == numFrames && rec.numDropped() > 0 && !rec.hasError(),
+		"oversized records: " + std::to_string(rec.numRecorded()) + " recorded, " + std::to_string(rec.numDropped()) + " dropped");
+	cx::RecordingReader reader(fileName);
+	check(reader.numFrames() == rec.numRecorded(), "oversized records: recording has " + std::to_string(reader.numFrames()) + " frames");
+}
+
+// planar image with 128 bytes padding after each plane
+static void testPlanar(const std::string& fileName)
+{
+	const unsigned width = 32, height = 4;
+	const size_t linePitch = width * 2, planePitch = linePitch * height + 128;
+	const int numFrames = 8;
+	SyntheticSource source(CX_PF_COORD3D_ABC16_PLANAR, width, height, linePitch, planePitch, 3 * planePitch);
+	{
+		cx::Recorder rec(fileName, cx::ParamMap(), smallBlocks());
+		for (int i = 0; i < numFrames; i++)
+		{
+			cx::DeviceBuffer buffer = source.next(i);
+			check(rec.record(buffer), "record planar frame " + std::to_string(i));
+		}
+		rec.close();
+	}
+
+	cx::RecordingReader reader(fileName);
+	check(reader.version() == cx::REC_VERSION && reader.numFrames() == numFrames, "planar recording has " + std::to_string(reader.numFrames()) + " frames");
+	cx::RecordedFrame frame;
+	reader.readFrame(0, frame);
+	check(frame.parts.size() == 1 && frame.parts[0].info.planePitch == planePitch, "plane pitch in the part header");
+
+	cx::DevicePtr dev = cx::DeviceFactory::openDevice("replay://" + fileName + "?rate=max");
+	dev->allocAndQueueBuffers(2);
+	dev->startAcquisition();
+	std::vector<uint8_t> expected(3 * planePitch);
+	for (int i = 0; i < numFrames; i++)
+	{
+		cx::DeviceBuffer buffer;
+		if (dev->tryWaitForBuffer(buffer, 1000) != CX_STATUS_OK)
+		{
+			check(false, "replay of planar frame " + std::to_string(i));
+			break;
+		}
+		cx::ImageView img = buffer.getImageView();
+		SyntheticSource::fill(expected, i);
+		check(img.pixelFormat() == CX_PF_COORD3D_ABC16_PLANAR && img.planePitch() == planePitch && img.linePitch() == linePitch,
+			"planar layout of frame " + std::to_string(i) + ": plane pitch " + std::to_string(img.planePitch()));
+		check(img.dataSz() == expected.size() && memcmp(img.data(), expected.data(), expected.size()) == 0, "planar data of frame " + std::to_string(i));
+		buffer.queueBuffer();
+	}
+	dev->stopAcquisition();
+}
+
+// version 1 recording without index: part headers without plane pitch
+static void testVersion1(const std::string& fileName)
+{
+	const unsigned width = 16, height = 2;
+	std::vector<uint8_t> data(width * height);
+	SyntheticSource::fill(data, 3);
+
+	FILE* f = fopen(fileName.c_str(), "wb");
+	if (f == nullptr)
+	{
+		check(false, "create " + fileName);
+		return;
+	}
+	cx::RecFileHeader fh;
+	memset(&fh, 0, sizeof(fh));
+	memcpy(fh.magic, "CXREC", 5);
+	fh.version = 1;
+	fh.dataOffset = sizeof(fh);
+	cx::RecFrameHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = cx::REC_FRAME_MAGIC;
+	hdr.recordSize = sizeof(hdr) + cx::REC_V1_PART_HEADER_SIZE + data.size();
+	hdr.timestamp = 77;
+	hdr.numParts = 1;
+	cx::RecPartHeader part;
+	memset(&part, 0, sizeof(part));
+	part.pixelFormat = CX_PF_MONO_8;
+	part.width = width;
+	part.height = height;
+	part.deliveredHeight = height;
+	part.linePitch = width;
+	part.dataSize = data.size();
+	fwrite(&fh, sizeof(fh), 1, f);
+	fwrite(&hdr, sizeof(hdr), 1, f);
+	fwrite(&part, cx::REC_V1_PART_HEADER_SIZE, 1, f);
+	fwrite(data.data(), data.size(), 1, f);
+	fclose(f);
+
+	cx::RecordingReader reader(fileName);
+	check(reader.version() == 1 && reader.numFrames() == 1, "version 1 recording");
+	if (reader.numFrames() != 1)
+		return;
+	cx::RecordedFrame frame;
+	reader.readFrame(0, frame);
+	check(frame.parts.size() == 1 && frame.parts[0].info.planePitch == 0 && frame.parts[0].info.width == width && frame.parts[0].info.dataSize == data.size()
+		&& memcmp(frame.parts[0].data, data.data(), data.size()) == 0, "version 1 part");
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		const std::string fileName = "cx_cam_record_replay_test.cxrec";
+		testRoundTrip(fileName);
+		testOversizedRecords(fileName);
+		testPlanar(fileName);
+		testVersion1(fileName);
+		remove(fileName.c_str());
+		std::cout << (g_failed ? "FAILED" : "ok") << std::endl;
+		if (g_failed)
+			return -1;
+	}
+	catch (const std::exception& err)
+	{
+		std::cerr << "exception caught, msg: " << err.what() << endl;
+		exit(-3);
+	}
+	return 0;
+}
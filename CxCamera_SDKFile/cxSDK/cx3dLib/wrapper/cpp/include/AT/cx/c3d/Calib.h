@@ -21,6 +21,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #ifndef CX_C3D_CALIB_H_INCLUDED
 #define CX_C3D_CALIB_H_INCLUDED
 
+#include <cmath>
+#include <algorithm>
 #include "cx_3d_metric.h"
 #include "cx_3d_calib.h"
 #include "cx_3d_calib_int.h"
@@ -248,6 +250,70 @@ namespace AT {
 					cx::checkOk(cx_3d_calibrateIntrinsicFromPoints(getHandle(), (const cx_point3r_t*)ip.data(), (const cx_point3r_t*)tp.data(), (unsigned int)ip.size(), calib_flags));
 				}
 
+				/** Create an independent copy of the calibration, e.g. for use in parallel threads.
+					The calibration is copied through the XML format, runtime parameters like sensor ROI, SY and the metric parameters are copied explicitly.
+					The LUT cache of the copy is not built, see CX_3D_PARAM_METRIC_CACHE_MODE.
+				*/
+				Calib::Ptr clone()
+				{
+					Calib::Ptr c = std::make_shared<Calib>();
+					c->loadFromBuffer(saveToBuffer("clone", CX_3D_CALIB_FORMAT_XML), "clone");
+
+					static const cx_3d_calib_param_t params[] = { CX_3D_PARAM_RANGE_SCALE, CX_3D_PARAM_S_ROI, CX_3D_PARAM_S_RR_H, CX_3D_PARAM_S_RR_V, CX_3D_PARAM_RANGE_OFFSET,
+						CX_3D_PARAM_SY, CX_3D_PARAM_SXY, CX_3D_PARAM_SZY, CX_3D_PARAM_R, CX_3D_PARAM_T, CX_3D_PARAM_METRIC_O, CX_3D_PARAM_METRIC_S, CX_3D_PARAM_METRIC_IDV };
+					cx::Variant val;
+					for (size_t i = 0; i < sizeof(params) / sizeof(params[0]); i++)
+					{
+						// parameters not available in this calibration model are skipped
+						if (cx_3d_calib_get(m_hCalib, params[i], val) == CX_STATUS_OK)
+							cx_3d_calib_set(c->m_hCalib, params[i], val);
+					}
+					// reading the cache parameters returns the division values followed by the LUT sizes
+					std::vector<int64_t> div;
+					if (cx_3d_calib_get(m_hCalib, CX_3D_PARAM_METRIC_CACHE_PARAMS, val) == CX_STATUS_OK && val.get(div) == CX_STATUS_OK && div.size() >= 2)
+					{
+						div.resize(2);
+						val = div;
+						cx_3d_calib_set(c->m_hCalib, CX_3D_PARAM_METRIC_CACHE_PARAMS, val);
+					}
+					return c;
+				}
+
+				/** Get the extent of a profile in world y.
+					The world y coordinate of a point is affine in the profile coordinate (encoder y), the function samples the corners of the calibrated region (CX_3D_PARAM_ROC)
+					at profile coordinate 0 and 1.
+					@param[out] dyDp	change of world y per profile coordinate.
+					@param[out] yMin0	minimum world y of the profile with coordinate 0.
+					@param[out] yMax0	maximum world y of the profile with coordinate 0.
+					@return false if the region of calibration is not available or the profiles don't move in world y.
+				*/
+				bool getProfileExtent(double& dyDp, double& yMin0, double& yMax0) const
+				{
+					std::vector<double> roc;
+					cx::Variant val;
+					if (cx_3d_calib_get(m_hCalib, CX_3D_PARAM_ROC, val) != CX_STATUS_OK || val.get(roc) != CX_STATUS_OK || roc.size() < 4)
+						return false;
+					cx_point3r_t pi[8], po[8];
+					for (int i = 0; i < 8; i++)
+					{
+						pi[i].a = roc[0] + ((i & 1) ? roc[2] : 0.0);
+						pi[i].c = roc[1] + ((i & 2) ? roc[3] : 0.0);
+						pi[i].b = (i & 4) ? 1.0 : 0.0;
+					}
+					if (cx_3d_sensor2world(m_hCalib, pi, po, 8) != CX_STATUS_OK)
+						return false;
+					dyDp = 0.0;
+					yMin0 = po[0].b;
+					yMax0 = po[0].b;
+					for (int i = 0; i < 4; i++)
+					{
+						dyDp += (po[i + 4].b - po[i].b) / 4.0;
+						yMin0 = std::min(yMin0, po[i].b);
+						yMax0 = std::max(yMax0, po[i].b);
+					}
+					return std::fabs(dyDp) > 1e-9;
+				}
+
 				CX_CALIB_HANDLE getHandle() const { return m_hCalib; }
 				operator CX_CALIB_HANDLE() const { return m_hCalib; }
 				operator CX_CALIB_HANDLE&() { return m_hCalib; }
@@ -0,0 +1,107 @@
+/**
+@file : Chunk.h
+@package : cx_3d library
+@brief C++ chunk data helper for the chunk aware metric functions
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef CX_C3D_CHUNK_H_INCLUDED
+#define CX_C3D_CHUNK_H_INCLUDED
+
+#include <vector>
+#include "AT/cx/base.h"
+#include "AT/cx/ChunkView.h"
+
+namespace AT {
+	namespace cx {
+		namespace c3d {
+			//! @addtogroup cx_wrapper_cpp
+			//! @{
+
+			/** Chunk holds the per-profile chunk values in the form needed by the chunk aware metric functions
+				cx_3d_rangeWithChunk2calibratedABC and cx_3d_rangeWithChunk2rectifiedC.
+				The values are extracted in one pass from a chunk with one record per profile (CX_CHUNK_CAMERA_INFO, CX_CHUNK_C6_LINE_INFO, CX_CHUNK_IRSX_IMAGE_INFO).
+				The arrays are reused, after the first frame update() does not allocate.
+
+				\code{.cpp}
+					cx::c3d::Chunk chunkData(buffer.getChunkView());
+					cx::c3d::calculateZMap(calib, rangeImg, chunkData.getXs(), chunkData.getYs(), chunkData.getPosCounter(), zMap, CX_3D_METRIC_MARK_Z_INVALID_DATA | CX_3D_METRIC_INTERP_IDW);
+				\endcode
+			*/
+			class Chunk
+			{
+			public:
+				typedef std::shared_ptr<Chunk> Ptr;
+
+				Chunk() {}
+				explicit Chunk(const cx_chunk_t& chunk) { update(chunk); }
+
+				/** Extract values from chunk, the chunk type is detected from the chunk id.
+					@return number of profiles, 0 if the chunk type is not supported.
+				*/
+				size_t update(const cx_chunk_t& chunk)
+				{
+					switch (chunk.descriptor)
+					{
+					case CX_CHUNK_CAMERA_INFO_ID: return update(ChunkView<cx_chunk_camera_info_t>(chunk));
+					case CX_CHUNK_C6_LINE_INFO_ID: return update(ChunkView<cx_chunk_c6_line_info_t>(chunk));
+					case CX_CHUNK_IRSX_IMAGE_INFO_ID: return update(ChunkView<cx_chunk_irsx_image_info_t>(chunk));
+					default:
+						clear();
+						return 0;
+					}
+				}
+
+				//! @overload
+				template<typename T> size_t update(const ChunkView<T>& view)
+				{
+					m_xs.resize(view.size());
+					m_ys.resize(view.size());
+					m_posCounter.resize(view.size());
+					m_timestamp.resize(view.size());
+					return extractProfileInfo(view, m_xs.data(), m_ys.data(), m_posCounter.data(), m_timestamp.data(), view.size());
+				}
+
+				void clear()
+				{
+					m_xs.clear();
+					m_ys.clear();
+					m_posCounter.clear();
+					m_timestamp.clear();
+				}
+
+				size_t size() const { return m_posCounter.size(); }					//!< number of profiles
+				const uint16_t* getXs() const { return m_xs.empty() ? nullptr : m_xs.data(); }				//!< AOI x-start per profile
+				const uint16_t* getYs() const { return m_ys.empty() ? nullptr : m_ys.data(); }				//!< AOI y-start per profile
+				const int32_t* getPosCounter() const { return m_posCounter.empty() ? nullptr : m_posCounter.data(); }	//!< encoder value per profile
+				const uint64_t* getTimestamp() const { return m_timestamp.empty() ? nullptr : m_timestamp.data(); }	//!< timestamp per profile
+
+				static Chunk::Ptr createShared() { return std::make_shared<Chunk>(); }
+
+			private:
+				std::vector<uint16_t> m_xs;
+				std::vector<uint16_t> m_ys;
+				std::vector<int32_t> m_posCounter;
+				std::vector<uint64_t> m_timestamp;
+			};
+
+			typedef Chunk::Ptr ChunkPtr;
+
+			//! @} cx_wrapper_cpp
+		}	// namespace c3d
+	}	// namespace cx
+}	// namespace AT
+#endif	// CX_C3D_CHUNK_H_INCLUDED
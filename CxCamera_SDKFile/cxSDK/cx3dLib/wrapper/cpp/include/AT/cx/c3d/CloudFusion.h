@@ -0,0 +1,472 @@
+/**
+@file : CloudFusion.h
+@package : cx_3d library
+@brief C++ fusion of the range images of several sensor heads into a common world frame
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef CX_C3D_CLOUDFUSION_H_INCLUDED
+#define CX_C3D_CLOUDFUSION_H_INCLUDED
+
+#include <stdint.h>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <cmath>
+#include <stdexcept>
+#include "cx_3d_metric.h"
+#include "AT/cx/base.h"
+#include "AT/cx/ThreadPool.h"
+#include "AT/cx/c3d/Calib.h"
+#include "AT/cx/c3d/PointCloud.h"
+#include "AT/cx/c3d/ZMap.h"
+
+namespace AT {
+	namespace cx {
+		namespace c3d {
+			//! @addtogroup cx_wrapper_cpp
+			//! @{
+
+			//! How the z values of several points falling into the same Z-Map cell are combined.
+			enum fusion_z_policy {
+				FUSION_Z_MAX = 0,		//!< highest z
+				FUSION_Z_MIN = 1,		//!< lowest z
+				FUSION_Z_MEAN = 2,		//!< mean of all z
+			};
+
+			//! Calibration and range image of one sensor head.
+			typedef std::pair<const Calib*, const cx::Image*> FusionHead;
+
+			/** CloudFusion combines the range images of several sensor heads into one Z-Map or one point cloud in world coordinates.
+				Every head is transformed by cx_3d_range2calibratedABC with its own calibration, this applies the extrinsic CX_3D_PARAM_R and CX_3D_PARAM_T,
+				so all heads must be calibrated into the same world coordinate system. The metric scale, offset and invalid data value of each calibration are taken into account,
+				the calibrations are not modified.
+
+				The heads are transformed in parallel, afterwards the points of all heads are rasterized in one pass into a shared accumulator.
+				Cells hit by several points are combined with atomic compare-and-swap (max, min) or atomic sums (mean), no locks are taken.
+				A final pass writes the accumulator into the Z-Map, cells without points get the invalid data value of the Z-Map.
+
+				If the Z-Map is empty its geometry is computed from the bounding box of all heads. The cell size is taken from ZMap::scale (x, y),
+				a cell size <= 0 is derived from the point spacing of the heads. The geometry is kept for the following calls, so all Z-Maps of a sequence are aligned.
+
+				\code{.cpp}
+					cx::c3d::CloudFusion fusion(cx::c3d::FUSION_Z_MAX, &pool);
+					cx::c3d::ZMap zmap;
+					zmap.scale = cx::Point3f(0.1f, 0.1f, 1.0f);		// cell size in mm
+					std::vector<cx::c3d::FusionHead> heads = { { &calib0, &range0 }, { &calib1, &range1 }, { &calib2, &range2 }, { &calib3, &range3 } };
+					fusion.fuse(heads, zmap);
+				\endcode
+
+				\note Points are assigned to the nearest cell without interpolation, choose a cell size not smaller than the point spacing to avoid holes.
+				The calibrations of the heads must be different objects, a calibration can't be used by two threads at the same time.
+			*/
+			class CloudFusion
+			{
+			public:
+				typedef std::shared_ptr<CloudFusion> Ptr;
+
+				CloudFusion(fusion_z_policy policy = FUSION_Z_MAX, ThreadPool* pool = nullptr) : m_policy(policy), m_pool(pool), m_accSize(0) {}
+
+				static CloudFusion::Ptr createShared(fusion_z_policy policy = FUSION_Z_MAX, ThreadPool* pool = nullptr)
+				{
+					return std::make_shared<CloudFusion>(policy, pool);
+				}
+
+				void setPolicy(fusion_z_policy policy) { m_policy = policy; }
+				fusion_z_policy policy() const { return m_policy; }
+
+				//! Use the given thread pool, nullptr runs single threaded.
+				void setThreadPool(ThreadPool* pool) { m_pool = pool; }
+
+				/** Fuse the heads into a Z-Map.
+					@param heads	calibration and range image of every head.
+					@param out		output Z-Map of type CX_PF_COORD3D_C32f or CX_PF_COORD3D_C16. An empty Z-Map is created as CX_PF_COORD3D_C32f with the geometry of the heads.
+					@return number of valid cells.
+				*/
+				size_t fuse(const std::vector<FusionHead>& heads, ZMap& out)
+				{
+					calculateHeads(heads, out.img.isEmpty());
+					if (out.img.isEmpty())
+						createGeometry(out);
+					cx_pixel_format pf = out.img.pixelFormat();
+					if (pf != CX_PF_COORD3D_C32f && pf != CX_PF_COORD3D_C16)
+						throw std::runtime_error("CloudFusion: unsupported Z-Map pixel format");
+
+					unsigned w = out.img.width();
+					unsigned h = out.img.height();
+					resetAccumulator(size_t(w) * h);
+
+					// rasterize the rows of all heads, rows of different heads may run in parallel
+					const float sx = out.scale.x, sy = out.scale.y, ox = out.offset.x, oy = out.offset.y;
+					const fusion_z_policy policy = m_policy;
+					std::atomic<float>* acc = m_acc.get();
+					std::atomic<uint32_t>* cnt = m_cnt.get();
+					forEachRow([&](size_t head, unsigned r) {
+						const HeadCloud& hc = m_heads[head];
+						const float* p = hc.points.row<float>(r);
+						for (unsigned c = 0; c < hc.points.width(); c++, p += 3)
+						{
+							float x, y, z;
+							if (!hc.toWorld(p, x, y, z))
+								continue;
+							float fc = std::floor((x - ox) / sx + 0.5f);
+							float fr = std::floor((y - oy) / sy + 0.5f);
+							if (!(fc >= 0.0f && fr >= 0.0f && fc < float(w) && fr < float(h)))
+								continue;
+							size_t i = size_t(fr) * w + size_t(fc);
+							accumulate(policy, acc[i], cnt ? &cnt[i] : nullptr, z);
+						}
+					});
+
+					// write the Z-Map
+					const float sz = out.scale.z, oz = out.offset.z;
+					const float ivd = out.ivd;
+					std::atomic<size_t> numValid(0);
+					run(h, [&](size_t r0, size_t r1) {
+						size_t valid = 0;
+						for (size_t r = r0; r < r1; r++)
+						{
+							for (unsigned c = 0; c < w; c++)
+							{
+								size_t i = r * w + c;
+								float z = acc[i].load(std::memory_order_relaxed);
+								bool isValid;
+								if (policy == FUSION_Z_MEAN)
+								{
+									uint32_t n = cnt[i].load(std::memory_order_relaxed);
+									isValid = n > 0;
+									z = isValid ? z / float(n) : 0.0f;
+								}
+								else
+									isValid = !std::isinf(z);
+								valid += isValid ? 1 : 0;
+								float v = (z - oz) / sz;
+								if (pf == CX_PF_COORD3D_C32f)
+									out.img.row<float>(unsigned(r))[c] = isValid ? v : ivd;
+								else
+									out.img.row<uint16_t>(unsigned(r))[c] = isValid ? uint16_t(std::min(std::max(v + 0.5f, 0.0f), 65535.0f)) : (std::isnan(ivd) ? uint16_t(0) : uint16_t(ivd));
+							}
+						}
+						numValid += valid;
+					});
+					return numValid;
+				}
+
+				/** Concatenate the heads into one point cloud in world coordinates.
+					The points of head i are stored in the rows following the rows of head i-1, heads with a smaller width are padded with NaN points.
+					Invalid points get NaN in z, pc.scale and pc.offset are set to identity.
+					@return number of valid points.
+				*/
+				size_t fuse(const std::vector<FusionHead>& heads, PointCloud& out)
+				{
+					unsigned rows = 0, width = 0;
+					for (size_t i = 0; i < heads.size(); i++)
+					{
+						checkHead(heads[i]);
+						rows += heads[i].second->height();
+						width = std::max(width, heads[i].second->width());
+					}
+					if (out.points.height() != rows || out.points.width() != width || out.points.pixelFormat() != CX_PF_COORD3D_ABC32f)
+						out.points.create(rows, width, CX_PF_COORD3D_ABC32f);
+					out.scale = cx::Point3f(1.0f, 1.0f, 1.0f);
+					out.offset = cx::Point3f(0.0f, 0.0f, 0.0f);
+
+					// every head is transformed directly into its rows of the output
+					std::vector<cx::Image> views(heads.size());
+					unsigned row0 = 0;
+					for (size_t i = 0; i < heads.size(); i++)
+					{
+						unsigned h = heads[i].second->height();
+						if (h > 0)
+							views[i].create(h, heads[i].second->width(), CX_PF_COORD3D_ABC32f, out.points.row<uint8_t>(row0), size_t(h) * out.points.linePitch(), out.points.linePitch(), 0);
+						row0 += h;
+					}
+					calculateHeads(heads, false, &views);
+
+					const float nan = std::numeric_limits<float>::quiet_NaN();
+					std::atomic<size_t> numValid(0);
+					forEachRow([&](size_t head, unsigned r) {
+						const HeadCloud& hc = m_heads[head];
+						float* p = const_cast<float*>(hc.points.row<float>(r));
+						unsigned w = hc.points.width();
+						size_t valid = 0;
+						for (unsigned c = 0; c < w; c++, p += 3)
+						{
+							if (hc.toWorld(p, p[0], p[1], p[2]))
+								valid++;
+							else
+								p[2] = nan;
+						}
+						for (unsigned c = w; c < width; c++, p += 3)
+							p[0] = p[1] = p[2] = nan;
+						numValid += valid;
+					});
+					return numValid;
+				}
+
+			private:
+				CloudFusion(const CloudFusion&);
+				CloudFusion& operator=(const CloudFusion&);
+
+				struct HeadCloud
+				{
+					cx::Image points;			// ABC32f result of the library, owned or a view into the output of the last fuse into a point cloud
+					cx::Point3f scale;			// CX_3D_PARAM_METRIC_S of the calibration
+					cx::Point3f offset;			// CX_3D_PARAM_METRIC_O of the calibration
+					float idv;					// CX_3D_PARAM_METRIC_IDV of the calibration
+					float min[3], max[3];		// bounding box in world coordinates, only computed for new geometries
+					unsigned numRows, numCols;
+
+					// returns false for invalid points
+					bool toWorld(const float* p, float& x, float& y, float& z) const
+					{
+						if (std::isnan(p[2]) || p[2] == idv)
+							return false;
+						x = p[0] * scale.x + offset.x;
+						y = p[1] * scale.y + offset.y;
+						z = p[2] * scale.z + offset.z;
+						return true;
+					}
+				};
+
+				void checkHead(const FusionHead& head) const
+				{
+					if (!head.first || !head.second || !head.first->isValid())
+						throw std::runtime_error("CloudFusion: invalid head");
+				}
+
+				void run(size_t count, const std::function<void(size_t, size_t)>& band)
+				{
+					if (m_pool && m_pool->numThreads() > 1)
+						m_pool->parallelForRange(count, 16, band);
+					else if (count > 0)
+						band(0, count);
+				}
+
+				// calls func(head, row) for the rows of all heads
+				void forEachRow(const std::function<void(size_t, unsigned)>& func)
+				{
+					std::vector<size_t> start(m_heads.size() + 1, 0);
+					for (size_t i = 0; i < m_heads.size(); i++)
+						start[i + 1] = start[i] + m_heads[i].points.height();
+					run(start.back(), [&](size_t r0, size_t r1) {
+						size_t head = std::upper_bound(start.begin(), start.end(), r0) - start.begin() - 1;
+						for (size_t r = r0; r < r1; r++)
+						{
+							while (r >= start[head + 1])
+								head++;
+							func(head, unsigned(r - start[head]));
+						}
+					});
+				}
+
+				// transforms every head with its calibration, in parallel if the calibrations are different objects
+				void calculateHeads(const std::vector<FusionHead>& heads, bool bounds, std::vector<cx::Image>* views = nullptr)
+				{
+					if (heads.empty())
+						throw std::runtime_error("CloudFusion: no heads");
+					bool distinct = true;
+					for (size_t i = 0; i < heads.size(); i++)
+					{
+						checkHead(heads[i]);
+						for (size_t k = 0; k < i; k++)
+							distinct = distinct && heads[k].first != heads[i].first;
+					}
+					m_heads.resize(heads.size());
+
+					auto task = [&](size_t i) {
+						HeadCloud& hc = m_heads[i];
+						const Calib& calib = *heads[i].first;
+						const cx::Image& range = *heads[i].second;
+						hc.scale = cx::Point3f(1.0f, 1.0f, 1.0f);
+						hc.offset = cx::Point3f(0.0f, 0.0f, 0.0f);
+						hc.idv = std::numeric_limits<float>::quiet_NaN();
+						cx::Variant val;
+						std::vector<double> v;
+						if (cx_3d_calib_get(calib.getHandle(), CX_3D_PARAM_METRIC_S, val) == CX_STATUS_OK && val.get(v) == CX_STATUS_OK && v.size() >= 3)
+							hc.scale = cx::Point3f(float(v[0]), float(v[1]), float(v[2]));
+						if (cx_3d_calib_get(calib.getHandle(), CX_3D_PARAM_METRIC_O, val) == CX_STATUS_OK && val.get(v) == CX_STATUS_OK && v.size() >= 3)
+							hc.offset = cx::Point3f(float(v[0]), float(v[1]), float(v[2]));
+						if (cx_3d_calib_get(calib.getHandle(), CX_3D_PARAM_METRIC_IDV, val) == CX_STATUS_OK)
+							hc.idv = float(double(val));
+
+						// a copy of the view would leak an owned buffer of the head, the move hands it to the views which release it.
+						// A view left by the previous call refers to another output and is replaced by an owned image.
+						if (views)
+							hc.points = std::move((*views)[i]);
+						else if (!hc.points.isOwner() || hc.points.height() != range.height() || hc.points.width() != range.width() || hc.points.pixelFormat() != CX_PF_COORD3D_ABC32f)
+							hc.points.create(range.height(), range.width(), CX_PF_COORD3D_ABC32f);
+						if (range.height() > 0)
+							cx::checkOk("cx_3d_range2calibratedABC", cx_3d_range2calibratedABC(calib.getHandle(), range, hc.points, CX_3D_METRIC_MARK_Z_INVALID_DATA));
+						hc.numRows = range.height();
+						hc.numCols = range.width();
+						if (bounds)
+							computeBounds(hc);
+					};
+					if (distinct && m_pool && m_pool->numThreads() > 1 && heads.size() > 1)
+						m_pool->parallelFor(heads.size(), task);
+					else
+					{
+						for (size_t i = 0; i < heads.size(); i++)
+							task(i);
+					}
+				}
+
+				static void computeBounds(HeadCloud& hc)
+				{
+					for (int k = 0; k < 3; k++)
+					{
+						hc.min[k] = std::numeric_limits<float>::max();
+						hc.max[k] = -std::numeric_limits<float>::max();
+					}
+					for (unsigned r = 0; r < hc.points.height(); r++)
+					{
+						const float* p = hc.points.row<float>(r);
+						for (unsigned c = 0; c < hc.points.width(); c++, p += 3)
+						{
+							float w[3];
+							if (!hc.toWorld(p, w[0], w[1], w[2]))
+								continue;
+							for (int k = 0; k < 3; k++)
+							{
+								hc.min[k] = std::min(hc.min[k], w[k]);
+								hc.max[k] = std::max(hc.max[k], w[k]);
+							}
+						}
+					}
+				}
+
+				// geometry covering all heads, cell size from out.scale or the point spacing
+				void createGeometry(ZMap& out)
+				{
+					float mn[2] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+					float mx[2] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+					float spacing[2] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+					for (size_t i = 0; i < m_heads.size(); i++)
+					{
+						const HeadCloud& hc = m_heads[i];
+						if (hc.min[0] > hc.max[0])
+							continue;
+						for (int k = 0; k < 2; k++)
+						{
+							mn[k] = std::min(mn[k], hc.min[k]);
+							mx[k] = std::max(mx[k], hc.max[k]);
+						}
+						if (hc.numCols > 1)
+							spacing[0] = std::min(spacing[0], (hc.max[0] - hc.min[0]) / float(hc.numCols - 1));
+						if (hc.numRows > 1)
+							spacing[1] = std::min(spacing[1], (hc.max[1] - hc.min[1]) / float(hc.numRows - 1));
+					}
+					if (mn[0] > mx[0])
+						throw std::runtime_error("CloudFusion: no valid points for computing the Z-Map geometry");
+
+					float cell[2] = { out.scale.x, out.scale.y };
+					for (int k = 0; k < 2; k++)
+					{
+						if (!(cell[k] > 0.0f))
+							cell[k] = (spacing[k] > 0.0f && spacing[k] < std::numeric_limits<float>::max()) ? spacing[k] : 1.0f;
+					}
+					double w = std::floor((mx[0] - mn[0]) / cell[0]) + 1.0;
+					double h = std::floor((mx[1] - mn[1]) / cell[1]) + 1.0;
+					if (w * h > double(1 << 28))
+						throw std::runtime_error("CloudFusion: Z-Map too large, increase the cell size");
+					out.create(unsigned(h), unsigned(w), CX_PF_COORD3D_C32f, cx::Point3f(cell[0], cell[1], 1.0f), cx::Point3f(mn[0], mn[1], 0.0f));
+				}
+
+				void resetAccumulator(size_t n)
+				{
+					bool mean = (m_policy == FUSION_Z_MEAN);
+					if (n != m_accSize)
+					{
+						m_acc.reset(new std::atomic<float>[n]);
+						m_cnt.reset();
+						m_accSize = n;
+					}
+					if (mean && !m_cnt)
+						m_cnt.reset(new std::atomic<uint32_t>[n]);
+					float init = (m_policy == FUSION_Z_MAX) ? -std::numeric_limits<float>::infinity() : (m_policy == FUSION_Z_MIN) ? std::numeric_limits<float>::infinity() : 0.0f;
+					std::atomic<float>* acc = m_acc.get();
+					std::atomic<uint32_t>* cnt = mean ? m_cnt.get() : nullptr;
+					run(n, [&](size_t i0, size_t i1) {
+						for (size_t i = i0; i < i1; i++)
+						{
+							acc[i].store(init, std::memory_order_relaxed);
+							if (cnt)
+								cnt[i].store(0, std::memory_order_relaxed);
+						}
+					});
+				}
+
+				static void accumulate(fusion_z_policy policy, std::atomic<float>& acc, std::atomic<uint32_t>* cnt, float z)
+				{
+					float cur = acc.load(std::memory_order_relaxed);
+					if (policy == FUSION_Z_MAX)
+					{
+						while (z > cur && !acc.compare_exchange_weak(cur, z, std::memory_order_relaxed))
+							;
+					}
+					else if (policy == FUSION_Z_MIN)
+					{
+						while (z < cur && !acc.compare_exchange_weak(cur, z, std::memory_order_relaxed))
+							;
+					}
+					else
+					{
+						while (!acc.compare_exchange_weak(cur, cur + z, std::memory_order_relaxed))
+							;
+						cnt->fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+
+				fusion_z_policy m_policy;
+				ThreadPool* m_pool;
+				std::vector<HeadCloud> m_heads;
+				std::unique_ptr<std::atomic<float>[]> m_acc;
+				std::unique_ptr<std::atomic<uint32_t>[]> m_cnt;
+				size_t m_accSize;
+			};
+
+			typedef CloudFusion::Ptr CloudFusionPtr;
+
+			/** Fuse the range images of several heads into a Z-Map, see \ref CloudFusion.
+				Use a CloudFusion object for repeated calls, it keeps the buffers of the heads and the accumulator.
+				@return number of valid cells.
+			*/
+			inline size_t fuseCalibratedClouds(const std::vector<FusionHead>& heads, ZMap& out, fusion_z_policy policy = FUSION_Z_MAX, ThreadPool* pool = nullptr)
+			{
+				CloudFusion fusion(policy, pool);
+				return fusion.fuse(heads, out);
+			}
+
+			/** Concatenate the range images of several heads into a point cloud in world coordinates, see \ref CloudFusion.
+				@return number of valid points.
+			*/
+			inline size_t fuseCalibratedClouds(const std::vector<FusionHead>& heads, PointCloud& out, ThreadPool* pool = nullptr)
+			{
+				CloudFusion fusion(FUSION_Z_MAX, pool);
+				return fusion.fuse(heads, out);
+			}
+
+			//! @} cx_wrapper_cpp
+		}
+	}
+}
+
+#endif // CX_C3D_CLOUDFUSION_H_INCLUDED
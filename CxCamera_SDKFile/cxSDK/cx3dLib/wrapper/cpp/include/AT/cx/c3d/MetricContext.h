@@ -0,0 +1,516 @@
+/**
+@file : MetricContext.h
+@package : cx_3d library
+@brief C++ persistent context for metric range image transformation
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef CX_C3D_METRICCONTEXT_H_INCLUDED
+#define CX_C3D_METRICCONTEXT_H_INCLUDED
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include "cx_3d_metric.h"
+#include "AT/cx/base.h"
+#include "AT/cx/ThreadPool.h"
+#include "AT/cx/c3d/Calib.h"
+#include "AT/cx/c3d/MetricLut.h"
+#include "AT/cx/c3d/PointCloud.h"
+#include "AT/cx/c3d/ZMap.h"
+
+namespace AT {
+	namespace cx {
+		namespace c3d {
+			//! @addtogroup cx_wrapper_cpp
+			//! @{
+
+			/** MetricContext binds a calibration to a fixed output geometry (METRIC_O, METRIC_S, METRIC_IDV) and preallocated outputs.
+				The calibration parameters and the bilinear LUT cache (\ref CX_3D_PARAM_METRIC_CACHE_MODE) are set up once in prepare(),
+				per frame only the transformation itself is executed. Output images are only reallocated if the size of the range image changes.
+
+				\code{.cpp}
+					cx::c3d::CalibPtr calib = cx::c3d::Calib::createShared();
+					calib->load("calib.xml");
+					cx::c3d::MetricContext ctx(calib, cx::Point3f(1.0f, 1.0f, 1.0f), cx::Point3f(0.0f, 0.0f, 0.0f), NAN);
+					std::cout << "LUT build time: " << ctx.prepare() << " ms" << std::endl;
+					while (grabbing)
+					{
+						// ...
+						cx::c3d::PointCloud& pc = ctx.calculatePointCloud(rangeImg);
+						// use pc ...
+					}
+				\endcode
+
+				With setNumThreads(n) the transformations are executed in parallel. Point clouds are split into horizontal bands of profiles,
+				every band is transformed by its own copy of the calibration into a disjoint slice of the output. Z-Maps are split into tiles of output rows,
+				every tile is computed from the profiles that project into the tile plus a halo of rows, so IDW interpolation and hole filling see the same neighborhood as in the single threaded case.
+
+				With setHostLut(true) point clouds are calculated by the vectorized MetricLut. The first frame is calculated by the library as well and compared with the table result,
+				if the difference exceeds the tolerance the context stays with the library functions.
+
+				\note The context assumes that the calibration is not modified by other code while in use, the cache is not rebuilt automatically.
+				After changing calibration parameters (e.g. CX_3D_PARAM_SY or the sensor ROI) call invalidate() or prepare().
+				Don't share one calibration between contexts with different geometry, use a separate Calib object per context.
+			*/
+			class MetricContext
+			{
+			public:
+				typedef std::shared_ptr<MetricContext> Ptr;
+
+				/** Create context.
+					@param calib	calibration used for the transformations.
+					@param scale	scale of the output, see CX_3D_PARAM_METRIC_S.
+					@param offset	offset of the output, see CX_3D_PARAM_METRIC_O.
+					@param idv		invalid data value, see CX_3D_PARAM_METRIC_IDV.
+				*/
+				MetricContext(const CalibPtr& calib, const cx::Point3f& scale = cx::Point3f(1.0f, 1.0f, 1.0f), const cx::Point3f& offset = cx::Point3f(0.0f, 0.0f, 0.0f), float idv = NAN)
+					: m_calib(calib), m_scale(scale), m_offset(offset), m_idv(idv), m_prepared(false), m_prepareTime(0.0), m_haloRows(4), m_tilesValid(false), m_dyDp(0.0), m_yMin0(0.0), m_yMax0(0.0), m_useLut(false), m_lutTolerance(1.0f), m_lutState(LUT_NONE), m_lutError(0.0f)
+				{
+					if (!m_calib || !m_calib->isValid())
+						throw std::runtime_error("MetricContext: invalid calibration");
+					m_pc.scale = scale;
+					m_pc.offset = offset;
+				}
+
+				static MetricContext::Ptr createShared(const CalibPtr& calib, const cx::Point3f& scale = cx::Point3f(1.0f, 1.0f, 1.0f), const cx::Point3f& offset = cx::Point3f(0.0f, 0.0f, 0.0f), float idv = NAN)
+				{
+					return std::make_shared<MetricContext>(calib, scale, offset, idv);
+				}
+
+				/** Change the output geometry, the context must be prepared again.
+				*/
+				void setGeometry(const cx::Point3f& scale, const cx::Point3f& offset, float idv = NAN)
+				{
+					m_scale = scale;
+					m_offset = offset;
+					m_idv = idv;
+					m_pc.scale = scale;
+					m_pc.offset = offset;
+					m_zMap.scale = scale;
+					m_zMap.offset = offset;
+					invalidate();
+				}
+
+				/** Set METRIC_O, METRIC_S and METRIC_IDV in the calibration and build the LUT cache.
+					Call this at startup in order to move the cost of the cache build out of the first frame.
+					@return time needed for building the cache in ms.
+				*/
+				double prepare()
+				{
+					m_calib->setParam(CX_3D_PARAM_METRIC_O, m_offset);
+					m_calib->setParam(CX_3D_PARAM_METRIC_S, m_scale);
+					m_calib->setParam(CX_3D_PARAM_METRIC_IDV, m_idv);
+
+					std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+					m_calib->setParam(CX_3D_PARAM_METRIC_CACHE_MODE, int(1));	// argument > 0 triggers the cache update
+					prepareBands();
+					prepareTiles();
+					m_lutState = LUT_NONE;		// the table is built with the first frame, when the range image width is known
+					m_prepareTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+					m_prepared = true;
+					return m_prepareTime;
+				}
+
+				/** Enable multi-threaded execution of the transformations, the context must be prepared again.
+					@param numThreads	number of threads, 0 uses all hardware threads, 1 disables multi-threading.
+					@param haloRows		number of additional Z-Map rows computed at the border of each tile, should cover the neighborhood used by CX_3D_METRIC_INTERP_IDW and CX_3D_METRIC_FILL_HOLES.
+				*/
+				void setNumThreads(unsigned numThreads, unsigned haloRows = 4)
+				{
+					setThreadPool((numThreads == 1) ? ThreadPool::Ptr() : ThreadPool::createShared(numThreads), haloRows);
+				}
+
+				/** Use the given thread pool for multi-threaded execution, an empty pointer disables multi-threading. The context must be prepared again.
+				*/
+				void setThreadPool(const ThreadPool::Ptr& pool, unsigned haloRows = 4)
+				{
+					m_pool = pool;
+					m_haloRows = haloRows;
+					invalidate();
+				}
+
+				unsigned numThreads() const { return m_pool ? m_pool->numThreads() : 1; }
+
+				/** Calculate point clouds with the vectorized lookup table of MetricLut instead of the library.
+					@param enable		enable or disable the table.
+					@param tolerance	maximum accepted difference to the library result of the first frame in output units (see CX_3D_PARAM_METRIC_S).
+				*/
+				void setHostLut(bool enable, float tolerance = 1.0f)
+				{
+					m_useLut = enable;
+					m_lutTolerance = tolerance;
+					invalidate();
+				}
+
+				bool hostLutActive() const { return m_lutState == LUT_VALIDATED; }		//!< true if the table passed the comparison with the library
+				float hostLutError() const { return m_lutError; }						//!< difference of table and library result of the validation frame in output units
+
+				/** Mark the context as not prepared, the next transformation calls prepare() first.
+				*/
+				void invalidate() { m_prepared = false; }
+
+				bool isPrepared() const { return m_prepared; }
+
+				double prepareTime() const { return m_prepareTime; }		//!< time of the last cache build in ms
+
+				/** Preallocate Z-Map output with given size and pixel format, scale and offset are taken from the context.
+				*/
+				void createZMap(unsigned int h, unsigned int w, cx_pixel_format pf = CX_PF_COORD3D_C32f)
+				{
+					m_zMap.create(h, w, pf, m_scale, m_offset);
+					invalidate();
+				}
+
+				/** Calculate point cloud from range image into the context owned point cloud.
+					@param rangeMap	the sensor range image.
+					@param flags	see \ref cx_3d_metric_flags.
+					@param pf		pixel format of the point cloud.
+					@return reference to the context owned point cloud, valid until the next call.
+				*/
+				PointCloud& calculatePointCloud(const cx::Image& rangeMap, int flags = CX_3D_METRIC_MARK_Z_INVALID_DATA, cx_pixel_format pf = CX_PF_COORD3D_ABC32f)
+				{
+					calculatePointCloud(rangeMap, m_pc, flags, pf);
+					return m_pc;
+				}
+
+				/** @overload
+					Calculate point cloud using chunk data, see \ref cx_3d_rangeWithChunk2calibratedABC.
+				*/
+				PointCloud& calculatePointCloud(const cx::Image& rangeMap, const uint16_t* xs, const uint16_t* ys, const int32_t* encoderValue, int flags = CX_3D_METRIC_MARK_Z_INVALID_DATA, cx_pixel_format pf = CX_PF_COORD3D_ABC32f)
+				{
+					calculatePointCloud(rangeMap, xs, ys, encoderValue, m_pc, flags, pf);
+					return m_pc;
+				}
+
+				/** Calculate point cloud from range image into a caller owned point cloud.
+					The points are only reallocated if size or pixel format don't match, scale and offset of pc are set to the context geometry.
+				*/
+				void calculatePointCloud(const cx::Image& rangeMap, PointCloud& pc, int flags = CX_3D_METRIC_MARK_Z_INVALID_DATA, cx_pixel_format pf = CX_PF_COORD3D_ABC32f)
+				{
+					preparePointCloud(rangeMap, pc, pf);
+					if (lutReady(rangeMap, pf, flags))
+						calculateLut(rangeMap, nullptr, pc, flags);
+					else
+					{
+						if (!m_bandCalibs.empty() && rangeMap.height() >= m_bandCalibs.size())
+							calculateBands(rangeMap, nullptr, nullptr, nullptr, pc, flags);
+						else
+							cx::checkOk("cx_3d_range2calibratedABC", cx_3d_range2calibratedABC(*m_calib, rangeMap, pc.points, flags));
+						validateLut(rangeMap, nullptr, pc, flags);
+					}
+				}
+
+				/** @overload
+				*/
+				void calculatePointCloud(const cx::Image& rangeMap, const uint16_t* xs, const uint16_t* ys, const int32_t* encoderValue, PointCloud& pc, int flags = CX_3D_METRIC_MARK_Z_INVALID_DATA, cx_pixel_format pf = CX_PF_COORD3D_ABC32f)
+				{
+					preparePointCloud(rangeMap, pc, pf);
+					if (lutReady(rangeMap, pf, flags))
+						calculateLut(rangeMap, encoderValue, pc, flags);
+					else
+					{
+						if (!m_bandCalibs.empty() && rangeMap.height() >= m_bandCalibs.size())
+							calculateBands(rangeMap, xs, ys, encoderValue, pc, flags);
+						else
+							cx::checkOk("cx_3d_rangeWithChunk2calibratedABC", cx_3d_rangeWithChunk2calibratedABC(*m_calib, rangeMap, xs, ys, encoderValue, pc.points, flags));
+						validateLut(rangeMap, encoderValue, pc, flags);
+					}
+				}
+
+				/** Calculate Z-Map from range image into the context owned Z-Map, the Z-Map must be created with createZMap before.
+					@param rangeMap	the sensor range image.
+					@param flags	use CX_3D_METRIC_NEAREST_POINT | CX_3D_METRIC_FILL_HOLES or CX_3D_METRIC_INTERP_IDW, optional you can also add CX_3D_METRIC_MARK_Z_INVALID_DATA
+					@return reference to the context owned Z-Map, valid until the next call.
+				*/
+				ZMap& calculateZMap(const cx::Image& rangeMap, int flags = CX_3D_METRIC_MARK_Z_INVALID_DATA | CX_3D_METRIC_INTERP_IDW)
+				{
+					prepareZMap();
+					if (m_tilesValid)
+						calculateTiles(rangeMap, nullptr, nullptr, nullptr, flags);
+					else
+						cx::checkOk("cx_3d_range2rectifiedC", cx_3d_range2rectifiedC(*m_calib, rangeMap, m_zMap.img, flags));
+					return m_zMap;
+				}
+
+				/** @overload
+					Calculate Z-Map using chunk data, see \ref cx_3d_rangeWithChunk2rectifiedC.
+				*/
+				ZMap& calculateZMap(const cx::Image& rangeMap, const uint16_t* xs, const uint16_t* ys, const int32_t* encoderValue, int flags = CX_3D_METRIC_MARK_Z_INVALID_DATA | CX_3D_METRIC_INTERP_IDW)
+				{
+					prepareZMap();
+					if (m_tilesValid)
+						calculateTiles(rangeMap, xs, ys, encoderValue, flags);
+					else
+						cx::checkOk("cx_3d_rangeWithChunk2rectifiedC", cx_3d_rangeWithChunk2rectifiedC(*m_calib, rangeMap, xs, ys, encoderValue, m_zMap.img, flags));
+					return m_zMap;
+				}
+
+				PointCloud& pointCloud() { return m_pc; }					//!< context owned point cloud
+				ZMap& zMap() { return m_zMap; }								//!< context owned Z-Map
+				const CalibPtr& calib() const { return m_calib; }
+				const cx::Point3f& scale() const { return m_scale; }
+				const cx::Point3f& offset() const { return m_offset; }
+				float idv() const { return m_idv; }
+
+			private:
+				MetricContext(const MetricContext&);
+				MetricContext& operator=(const MetricContext&);
+
+				void preparePointCloud(const cx::Image& rangeMap, PointCloud& pc, cx_pixel_format pf)
+				{
+					if (!m_prepared)
+						prepare();
+					if (pc.points.height() != rangeMap.height() || pc.points.width() != rangeMap.width() || pc.points.pixelFormat() != pf)
+						pc.points.create(rangeMap.height(), rangeMap.width(), pf);
+					pc.scale = m_scale;
+					pc.offset = m_offset;
+				}
+
+				void prepareZMap()
+				{
+					if (m_zMap.img.isEmpty())
+						throw std::runtime_error("MetricContext: Z-Map not created, call createZMap first");
+					if (!m_prepared)
+						prepare();
+				}
+
+				// calibration copy with the given geometry and built cache
+				CalibPtr cloneCalib(const cx::Point3f& offset)
+				{
+					CalibPtr c = m_calib->clone();
+					c->setParam(CX_3D_PARAM_METRIC_O, offset);
+					c->setParam(CX_3D_PARAM_METRIC_S, m_scale);
+					c->setParam(CX_3D_PARAM_METRIC_IDV, m_idv);
+					c->setParam(CX_3D_PARAM_METRIC_CACHE_MODE, int(1));
+					return c;
+				}
+
+				void prepareBands()
+				{
+					m_bandCalibs.clear();
+					if (!m_pool || m_pool->numThreads() < 2)
+						return;
+					m_bandCalibs.resize(m_pool->numThreads());
+					m_pool->parallelFor(m_bandCalibs.size(), [&](size_t i) {
+						m_bandCalibs[i] = cloneCalib(m_offset);
+					});
+				}
+
+				// tiles need a model which profiles project into which Z-Map rows, see Calib::getProfileExtent
+				void prepareTiles()
+				{
+					m_tiles.clear();
+					m_tilesValid = false;
+					if (!m_pool || m_pool->numThreads() < 2 || m_zMap.img.height() < 2 * m_pool->numThreads())
+						return;
+
+					if (!m_calib->getProfileExtent(m_dyDp, m_yMin0, m_yMax0))
+						return;
+
+					unsigned numTiles = m_pool->numThreads();
+					unsigned h = m_zMap.img.height();
+					m_tiles.resize(numTiles);
+					m_pool->parallelFor(numTiles, [&](size_t i) {
+						ZMapTile& t = m_tiles[i];
+						t.row0 = unsigned(h * i / numTiles);
+						t.row1 = unsigned(h * (i + 1) / numTiles);
+						t.haloRow0 = (t.row0 > m_haloRows) ? t.row0 - m_haloRows : 0;
+						t.haloRow1 = std::min(h, t.row1 + m_haloRows);
+						t.buffer.create(t.haloRow1 - t.haloRow0, m_zMap.img.width(), m_zMap.img.pixelFormat());
+						t.calib = cloneCalib(cx::Point3f(m_offset.x, m_offset.y + float(t.haloRow0) * m_scale.y, m_offset.z));
+					});
+					m_tilesValid = true;
+				}
+
+				// sensor y coordinate of each profile, the chunk y if given, otherwise the profile index
+				const int32_t* profileY(unsigned numRows, const int32_t* encoderValue, int flags)
+				{
+					if (encoderValue && (flags & CX_3D_METRIC_USE_CHUNK_Y))
+						return encoderValue;
+					if (m_rowIdx.size() < numRows)
+					{
+						size_t n = m_rowIdx.size();
+						m_rowIdx.resize(numRows);
+						for (size_t i = n; i < numRows; i++)
+							m_rowIdx[i] = int32_t(i);
+					}
+					return m_rowIdx.data();
+				}
+
+				void calculateBands(const cx::Image& rangeMap, const uint16_t* xs, const uint16_t* ys, const int32_t* encoderValue, PointCloud& pc, int flags)
+				{
+					// the bands get the absolute y of every profile, otherwise each band would start at y=0
+					const int32_t* py = profileY(rangeMap.height(), encoderValue, flags);
+					int bandFlags = flags | CX_3D_METRIC_USE_CHUNK_Y;
+					size_t numBands = m_bandCalibs.size();
+					m_pool->parallelFor(numBands, [&](size_t b) {
+						unsigned r0 = unsigned(rangeMap.height() * b / numBands);
+						unsigned r1 = unsigned(rangeMap.height() * (b + 1) / numBands);
+						cx::Image src = rangeMap.rowRange(r0, r1);
+						cx::Image dst = pc.points.rowRange(r0, r1);
+						cx::checkOk("cx_3d_rangeWithChunk2calibratedABC", cx_3d_rangeWithChunk2calibratedABC(*m_bandCalibs[b], src, xs ? xs + r0 : nullptr, ys ? ys + r0 : nullptr, py + r0, dst, bandFlags));
+					});
+				}
+
+				void calculateTiles(const cx::Image& rangeMap, const uint16_t* xs, const uint16_t* ys, const int32_t* encoderValue, int flags)
+				{
+					const int32_t* py = profileY(rangeMap.height(), encoderValue, flags);
+					int tileFlags = flags | CX_3D_METRIC_USE_CHUNK_Y;
+					unsigned numRows = rangeMap.height();
+					m_pool->parallelFor(m_tiles.size(), [&](size_t i) {
+						ZMapTile& t = m_tiles[i];
+
+						// world y range of the tile including halo, and the range of sensor y that can project into it
+						double ya = m_offset.y + double(t.haloRow0) * m_scale.y;
+						double yb = m_offset.y + double(t.haloRow1) * m_scale.y;
+						if (ya > yb)
+							std::swap(ya, yb);
+						double p0 = (m_dyDp > 0) ? (ya - m_yMax0) / m_dyDp : (yb - m_yMin0) / m_dyDp;
+						double p1 = (m_dyDp > 0) ? (yb - m_yMin0) / m_dyDp : (ya - m_yMax0) / m_dyDp;
+						p0 -= 2.0;		// neighbor profiles used for interpolation
+						p1 += 2.0;
+
+						unsigned first = numRows, last = 0;
+						for (unsigned r = 0; r < numRows; r++)
+						{
+							if (py[r] >= p0 && py[r] <= p1)
+							{
+								first = std::min(first, r);
+								last = r;
+							}
+						}
+
+						if (first > last)
+						{
+							fillInvalid(t.buffer, flags);
+						}
+						else
+						{
+							cx::Image src = rangeMap.rowRange(first, last + 1);
+							cx::checkOk("cx_3d_rangeWithChunk2rectifiedC", cx_3d_rangeWithChunk2rectifiedC(*t.calib, src, xs ? xs + first : nullptr, ys ? ys + first : nullptr, py + first, t.buffer, tileFlags));
+						}
+
+						// copy the tile without halo into the Z-Map
+						size_t rowBytes = std::min(t.buffer.linePitch(), m_zMap.img.linePitch());
+						for (unsigned r = t.row0; r < t.row1; r++)
+							memcpy(m_zMap.img.row<uint8_t>(r), t.buffer.row<uint8_t>(r - t.haloRow0), rowBytes);
+					});
+				}
+
+				bool lutReady(const cx::Image& rangeMap, cx_pixel_format pf, int flags) const
+				{
+					return m_useLut && m_lutState == LUT_VALIDATED && m_lut.supports(rangeMap, pf, flags);
+				}
+
+				// build the table with the first frame and compare it with the library result in pc
+				void validateLut(const cx::Image& rangeMap, const int32_t* encoderValue, const PointCloud& pc, int flags)
+				{
+					if (!m_useLut || m_lutState == LUT_FAILED || m_lutState == LUT_VALIDATED)
+						return;
+					if (m_lutState == LUT_NONE || m_lut.width() != rangeMap.width())
+					{
+						m_lutState = m_lut.build(*m_calib, rangeMap.width(), m_scale, m_offset, m_idv) ? LUT_BUILT : LUT_FAILED;
+						m_lutScratch.assign((m_pool && m_pool->numThreads() > 1) ? m_pool->numThreads() : 0, std::vector<float>(m_lut.scratchSize()));
+					}
+					if (m_lutState != LUT_BUILT || !m_lut.supports(rangeMap, pc.points.pixelFormat(), flags))
+						return;
+					PointCloud ref;
+					ref.points.create(pc.points.height(), pc.points.width(), pc.points.pixelFormat());
+					calculateLut(rangeMap, encoderValue, ref, flags);
+					m_lutError = MetricLut::maxDifference(pc.points, ref.points);
+					m_lutState = (m_lutError <= m_lutTolerance) ? LUT_VALIDATED : LUT_FAILED;
+				}
+
+				void calculateLut(const cx::Image& rangeMap, const int32_t* encoderValue, PointCloud& pc, int flags)
+				{
+					if (!m_pool || m_pool->numThreads() < 2 || m_lutScratch.empty())
+					{
+						m_lut.transform(rangeMap, encoderValue, pc.points, flags);
+						return;
+					}
+					// one band per scratch buffer, the table itself is shared read-only
+					size_t numBands = m_lutScratch.size();
+					m_pool->parallelFor(numBands, [&](size_t b) {
+						unsigned r0 = unsigned(rangeMap.height() * b / numBands);
+						unsigned r1 = unsigned(rangeMap.height() * (b + 1) / numBands);
+						if (r0 == r1)
+							return;
+						cx::Image dst = pc.points.rowRange(r0, r1);
+						m_lut.transform(rangeMap.rowRange(r0, r1), encoderValue ? encoderValue + r0 : nullptr, dst, flags, int32_t(r0), m_lutScratch[b].data());
+					});
+				}
+
+				void fillInvalid(cx::Image& img, int flags)
+				{
+					bool mark = (flags & CX_3D_METRIC_MARK_Z_INVALID_DATA) != 0;
+					for (unsigned r = 0; r < img.height(); r++)
+					{
+						if (img.pixelFormat() == CX_PF_COORD3D_C32f)
+							std::fill(img.row<float>(r), img.row<float>(r) + img.width(), mark ? m_idv : 0.0f);
+						else if (img.pixelFormat() == CX_PF_COORD3D_C16)
+							std::fill(img.row<uint16_t>(r), img.row<uint16_t>(r) + img.width(), (mark && !std::isnan(m_idv)) ? uint16_t(m_idv + 0.5f) : uint16_t(0));
+						else
+							memset(img.row<uint8_t>(r), 0, img.linePitch());
+					}
+				}
+
+				struct ZMapTile
+				{
+					unsigned row0, row1;			// rows of the Z-Map computed by the tile
+					unsigned haloRow0, haloRow1;	// rows including halo
+					CalibPtr calib;					// calibration copy with METRIC_O shifted to haloRow0
+					cx::Image buffer;				// tile result including halo
+				};
+
+				CalibPtr m_calib;
+				cx::Point3f m_scale;
+				cx::Point3f m_offset;
+				float m_idv;
+				bool m_prepared;
+				double m_prepareTime;
+				PointCloud m_pc;
+				ZMap m_zMap;
+
+				ThreadPool::Ptr m_pool;
+				unsigned m_haloRows;
+				std::vector<CalibPtr> m_bandCalibs;
+				std::vector<ZMapTile> m_tiles;
+				bool m_tilesValid;
+				double m_dyDp;					// world y per sensor y
+				double m_yMin0, m_yMax0;		// world y range over the calibrated region at sensor y=0
+				std::vector<int32_t> m_rowIdx;
+
+				enum { LUT_NONE, LUT_BUILT, LUT_VALIDATED, LUT_FAILED };
+				bool m_useLut;
+				float m_lutTolerance;
+				int m_lutState;
+				float m_lutError;
+				MetricLut m_lut;
+				std::vector<std::vector<float> > m_lutScratch;	// scratch buffer of MetricLut per band
+			};
+
+			typedef MetricContext::Ptr MetricContextPtr;
+
+			//! @} cx_wrapper_cpp
+		}
+	}
+}
+
+#endif // CX_C3D_METRICCONTEXT_H_INCLUDED
@@ -0,0 +1,527 @@
+/**
+@file : MetricLut.h
+@package : cx_3d library
+@brief C++ bilinear lookup table for vectorized range to point cloud transformation
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef CX_C3D_METRICLUT_H_INCLUDED
+#define CX_C3D_METRICLUT_H_INCLUDED
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <stdint.h>
+#include "cx_3d_metric.h"
+#include "AT/cx/base.h"
+#include "AT/cx/Image.h"
+#include "AT/cx/c3d/Calib.h"
+
+// AVX2 kernel is compiled with function target attributes, no global compiler flags are needed
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define CX_C3D_LUT_AVX2
+	#define CX_C3D_LUT_TARGET_AVX2 __attribute__((target("avx2,fma")))
+	#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+	#define CX_C3D_LUT_AVX2
+	#define CX_C3D_LUT_TARGET_AVX2
+	#include <intrin.h>
+	#include <immintrin.h>
+#endif
+#if defined(__aarch64__) || defined(_M_ARM64)
+	#define CX_C3D_LUT_NEON
+	#include <arm_neon.h>
+#endif
+
+namespace AT {
+	namespace cx {
+		namespace c3d {
+			//! @addtogroup cx_wrapper_cpp
+			//! @{
+
+			//! Implementations of the lookup kernel
+			enum lut_kernel
+			{
+				LUT_KERNEL_SCALAR = 0,	//!< portable C++ implementation
+				LUT_KERNEL_AVX2 = 1,	//!< x86-64 with AVX2 and FMA, 8 pixel per iteration
+				LUT_KERNEL_NEON = 2		//!< ARM64 NEON, 4 pixel per iteration
+			};
+
+			/** MetricLut transforms range images to point clouds with a bilinear lookup table evaluated in the wrapper.
+				The table is built like the internal cache of the library (\ref CX_3D_PARAM_METRIC_CACHE_MODE): world coordinates are sampled with cx_3d_sensor2world
+				on a grid of image x and range values with the division from \ref CX_3D_PARAM_METRIC_CACHE_PARAMS. The profile coordinate (encoder y) enters the
+				transformation as a constant offset vector per profile, so one table serves all profiles. Scale and offset of the output are folded into the table.
+
+				Per pixel the kernel gathers the four grid nodes around (x, range) and interpolates twice, the AVX2 kernel processes 8 pixels per iteration.
+				The kernel is selected at runtime from the CPU features, see detectKernel().
+
+				\code{.cpp}
+					cx::c3d::MetricLut lut;
+					if (lut.build(calib, rangeImg.width(), cx::Point3f(1.0f, 1.0f, 1.0f), cx::Point3f(0.0f, 0.0f, 0.0f), NAN))
+						lut.transform(rangeImg, nullptr, pc.points, CX_3D_METRIC_MARK_Z_INVALID_DATA);
+				\endcode
+
+				\note Tolerance: all kernels evaluate the same interpolation formula, results of the SIMD kernels differ from the scalar kernel only by the rounding of fused multiply-add.
+				For 32-bit float output that is below 1e-6 relative to the coordinate value or to the largest absolute value of the four grid nodes around the pixel, whichever is larger,
+				near a zero crossing of a coordinate the nodes dominate. For 16-bit output the difference is at most 1 at rounding boundaries. The example cx_3d_metric_lut_test checks this with random calibrations.
+				Compared to the library the difference is in the range of the interpolation error of the library's own cache with the same division,
+				use maxDifference() on a reference frame to verify a calibration, MetricContext::setHostLut does this automatically.
+				\note Supported input are 16-bit range images (Mono16, Coord3D_C16), range value 0 is treated as invalid. Supported outputs are
+				CX_PF_COORD3D_ABC32f, CX_PF_COORD3D_ABC16, CX_PF_COORD3D_C32f and CX_PF_COORD3D_C16. Calibrations that are not affine in the profile coordinate are rejected by build().
+			*/
+			class MetricLut
+			{
+			public:
+				typedef std::shared_ptr<MetricLut> Ptr;
+
+				MetricLut() : m_valid(false), m_width(0), m_nx(0), m_nz(0), m_shiftX(4), m_shiftZ(5), m_idv(NAN), m_kernel(detectKernel())
+				{
+					m_dy[0] = m_dy[1] = m_dy[2] = 0.0;
+				}
+
+				static MetricLut::Ptr createShared() { return std::make_shared<MetricLut>(); }
+
+				/** Build the table for the given calibration and output geometry.
+					@param calib	calibration, METRIC_O/S/IDV of the calibration are not used.
+					@param width	width of the range images.
+					@param scale	scale of the output, see CX_3D_PARAM_METRIC_S.
+					@param offset	offset of the output, see CX_3D_PARAM_METRIC_O.
+					@param idv		invalid data value, see CX_3D_PARAM_METRIC_IDV.
+					@return false if the calibration can't be represented by the table, in that case use the library functions.
+				*/
+				bool build(const Calib& calib, unsigned width, const cx::Point3f& scale, const cx::Point3f& offset, float idv)
+				{
+					m_valid = false;
+					if (width == 0 || scale.x == 0.0f || scale.y == 0.0f || scale.z == 0.0f)
+						return false;
+
+					// division values as power of 2, the library default is [4, 5]
+					m_shiftX = 4;
+					m_shiftZ = 5;
+					cx::Variant val;
+					std::vector<int64_t> cacheParams;
+					if (cx_3d_calib_get(calib, CX_3D_PARAM_METRIC_CACHE_PARAMS, val) == CX_STATUS_OK && val.get(cacheParams) == CX_STATUS_OK && cacheParams.size() >= 2
+						&& cacheParams[0] >= 0 && cacheParams[0] < 16 && cacheParams[1] >= 0 && cacheParams[1] < 16)
+					{
+						m_shiftX = unsigned(cacheParams[0]);
+						m_shiftZ = unsigned(cacheParams[1]);
+					}
+
+					// the profile coordinate must add a constant vector, check at the corners and the center of the image x/range plane
+					cx_point3r_t pi[18], po[18];
+					for (int i = 0; i < 9; i++)
+					{
+						pi[2 * i].a = pi[2 * i + 1].a = double(width - 1) * (i % 3) / 2.0;
+						pi[2 * i].c = pi[2 * i + 1].c = 65535.0 * (i / 3) / 2.0;
+						pi[2 * i].b = 0.0;
+						pi[2 * i + 1].b = 1.0;
+					}
+					if (cx_3d_sensor2world(calib, pi, po, 18) != CX_STATUS_OK)
+						return false;
+					double d[3] = { po[1].a - po[0].a, po[1].b - po[0].b, po[1].c - po[0].c };
+					double dNorm = std::max(1.0, std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+					for (int i = 1; i < 9; i++)
+					{
+						double e = std::fabs(po[2 * i + 1].a - po[2 * i].a - d[0]) + std::fabs(po[2 * i + 1].b - po[2 * i].b - d[1]) + std::fabs(po[2 * i + 1].c - po[2 * i].c - d[2]);
+						if (!(e <= 1e-6 * dNorm))
+							return false;
+					}
+
+					// grid nodes at y=0
+					m_nx = ((width - 1) >> m_shiftX) + 2;
+					m_nz = (0xFFFFu >> m_shiftZ) + 2;
+					std::vector<cx_point3r_t> nodeIn(size_t(m_nx) * m_nz), nodeOut(size_t(m_nx) * m_nz);
+					for (unsigned iz = 0; iz < m_nz; iz++)
+					{
+						for (unsigned ix = 0; ix < m_nx; ix++)
+						{
+							cx_point3r_t& p = nodeIn[size_t(iz) * m_nx + ix];
+							p.a = double(ix << m_shiftX);
+							p.b = 0.0;
+							p.c = double(iz << m_shiftZ);
+						}
+					}
+					if (cx_3d_sensor2world(calib, nodeIn.data(), nodeOut.data(), unsigned(nodeIn.size())) != CX_STATUS_OK)
+						return false;
+
+					// scale and offset are folded into the table, the kernel output is in units of the output image
+					const double o[3] = { offset.x, offset.y, offset.z };
+					const double s[3] = { scale.x, scale.y, scale.z };
+					for (int c = 0; c < 3; c++)
+					{
+						m_lut[c].resize(nodeOut.size());
+						m_dy[c] = d[c] / s[c];
+					}
+					for (size_t n = 0; n < nodeOut.size(); n++)
+					{
+						m_lut[0][n] = float((nodeOut[n].a - o[0]) / s[0]);
+						m_lut[1][n] = float((nodeOut[n].b - o[1]) / s[1]);
+						m_lut[2][n] = float((nodeOut[n].c - o[2]) / s[2]);
+					}
+
+					m_colIdx.resize(width);
+					m_colW.resize(width);
+					for (unsigned x = 0; x < width; x++)
+					{
+						unsigned ix = std::min(x >> m_shiftX, m_nx - 2);
+						m_colIdx[x] = int32_t(ix);
+						m_colW[x] = float(x - (ix << m_shiftX)) / float(1u << m_shiftX);
+					}
+					m_scratch.resize(size_t(3) * width);
+					m_width = width;
+					m_idv = idv;
+					m_valid = true;
+					return true;
+				}
+
+				bool isValid() const { return m_valid; }
+				unsigned width() const { return m_width; }			//!< width of range images the table was built for
+				unsigned divisionX() const { return 1u << m_shiftX; }
+				unsigned divisionZ() const { return 1u << m_shiftZ; }
+				size_t scratchSize() const { return size_t(3) * m_width; }	//!< number of floats needed as scratch buffer by transform()
+
+				lut_kernel kernel() const { return m_kernel; }
+
+				/** Select kernel, e.g. for comparing SIMD results with the scalar implementation.
+					Throws if the kernel is not supported by the CPU.
+				*/
+				void setKernel(lut_kernel k)
+				{
+					if (!kernelSupported(k))
+						throw std::runtime_error("MetricLut: kernel not supported on this CPU");
+					m_kernel = k;
+				}
+
+				static bool kernelSupported(lut_kernel k)
+				{
+					if (k == LUT_KERNEL_SCALAR)
+						return true;
+#if defined(CX_C3D_LUT_AVX2)
+					if (k == LUT_KERNEL_AVX2)
+						return cpuHasAvx2();
+#endif
+#if defined(CX_C3D_LUT_NEON)
+					if (k == LUT_KERNEL_NEON)
+						return true;
+#endif
+					return false;
+				}
+
+				//! Returns the fastest kernel supported by the CPU.
+				static lut_kernel detectKernel()
+				{
+					if (kernelSupported(LUT_KERNEL_AVX2))
+						return LUT_KERNEL_AVX2;
+					if (kernelSupported(LUT_KERNEL_NEON))
+						return LUT_KERNEL_NEON;
+					return LUT_KERNEL_SCALAR;
+				}
+
+				//! Returns true if transform() supports the combination of input, output pixel format and flags.
+				bool supports(const cx::Image& rangeMap, cx_pixel_format pf, int flags) const
+				{
+					if (!m_valid || rangeMap.width() != m_width)
+						return false;
+					if (rangeMap.pixelFormat() != CX_PF_MONO_16 && rangeMap.pixelFormat() != CX_PF_COORD3D_C16)
+						return false;
+					if (flags & (CX_3D_METRIC_USE_CHUNK_X0 | CX_3D_METRIC_USE_CHUNK_Z0))
+						return false;
+					return pf == CX_PF_COORD3D_ABC32f || pf == CX_PF_COORD3D_ABC16 || pf == CX_PF_COORD3D_C32f || pf == CX_PF_COORD3D_C16;
+				}
+
+				/** Transform range image.
+					@param rangeMap		the sensor range image.
+					@param yValues		optional profile coordinate per row, e.g. the encoder value from chunk data. If null the row index plus y0 is used.
+					@param out			output image, must be allocated by the caller with the size of the range image.
+					@param flags		supported flags: CX_3D_METRIC_MARK_Z_INVALID_DATA, CX_3D_METRIC_USE_CHUNK_Y, see \ref cx_3d_metric_flags.
+					@param y0			profile coordinate of the first row if yValues is null, used when transforming a band of rows.
+					\note Uses the scratch buffer of the table, don't call concurrently on the same table, use the overload with a caller owned scratch buffer instead.
+				*/
+				void transform(const cx::Image& rangeMap, const int32_t* yValues, cx::Image& out, int flags, int32_t y0 = 0)
+				{
+					transform(rangeMap, yValues, out, flags, y0, m_scratch.data());
+				}
+
+				/** Transform range image with a caller owned scratch buffer, can be called concurrently, e.g. for bands of rows.
+					@param scratch		buffer of at least scratchSize() floats, one buffer per concurrent call.
+					\sa transform(const cx::Image&, const int32_t*, cx::Image&, int, int32_t)
+				*/
+				void transform(const cx::Image& rangeMap, const int32_t* yValues, cx::Image& out, int flags, int32_t y0, float* scratch) const
+				{
+					if (!supports(rangeMap, out.pixelFormat(), flags))
+						throw std::runtime_error("MetricLut: unsupported image format or flags");
+					if (out.width() != rangeMap.width() || out.height() != rangeMap.height())
+						throw std::runtime_error("MetricLut: output image size does not match range image");
+
+					cx_pixel_format pf = out.pixelFormat();
+					RowParams p;
+					p.width = m_width;
+					p.nx = m_nx;
+					p.shiftZ = m_shiftZ;
+					p.maskZ = (1u << m_shiftZ) - 1;
+					p.invDivZ = 1.0f / float(1u << m_shiftZ);
+					p.colIdx = m_colIdx.data();
+					p.colW = m_colW.data();
+					p.c0 = (pf == CX_PF_COORD3D_C32f || pf == CX_PF_COORD3D_C16) ? 2 : 0;
+					for (int c = 0; c < 3; c++)
+						p.lut[c] = m_lut[c].data();
+
+					bool mark = (flags & CX_3D_METRIC_MARK_Z_INVALID_DATA) != 0;
+					for (unsigned r = 0; r < rangeMap.height(); r++)
+					{
+						double y = (yValues && (flags & CX_3D_METRIC_USE_CHUNK_Y)) ? double(yValues[r]) : double(y0) + double(r);
+						for (int c = 0; c < 3; c++)
+							p.rowAdd[c] = float(y * m_dy[c]);
+						p.range = rangeMap.row<uint16_t>(r);
+						switch (m_kernel)
+						{
+#if defined(CX_C3D_LUT_AVX2)
+						case LUT_KERNEL_AVX2: lookupRowAvx2(p, scratch); break;
+#endif
+#if defined(CX_C3D_LUT_NEON)
+						case LUT_KERNEL_NEON: lookupRowNeon(p, scratch); break;
+#endif
+						default: lookupScalar(p, scratch, 0, p.width); break;
+						}
+						writeRow(p, scratch, out, r, mark);
+					}
+				}
+
+				/** Returns the maximum absolute difference of two images with equal format in output units.
+					Pixels with NaN in any of both images are skipped, e.g. for comparing MetricLut results with the library functions.
+				*/
+				static float maxDifference(const cx::Image& a, const cx::Image& b)
+				{
+					if (a.width() != b.width() || a.height() != b.height() || a.pixelFormat() != b.pixelFormat())
+						throw std::runtime_error("MetricLut: images differ in size or format");
+					unsigned numComp = (a.pixelFormat() == CX_PF_COORD3D_ABC32f || a.pixelFormat() == CX_PF_COORD3D_ABC16) ? 3 : 1;
+					bool is16 = (a.pixelFormat() == CX_PF_COORD3D_ABC16 || a.pixelFormat() == CX_PF_COORD3D_C16);
+					if (!is16 && a.pixelFormat() != CX_PF_COORD3D_ABC32f && a.pixelFormat() != CX_PF_COORD3D_C32f)
+						throw std::runtime_error("MetricLut: unsupported pixel format");
+					float maxDiff = 0.0f;
+					for (unsigned r = 0; r < a.height(); r++)
+					{
+						for (unsigned i = 0; i < a.width() * numComp; i++)
+						{
+							float va = is16 ? float(a.row<uint16_t>(r)[i]) : a.row<float>(r)[i];
+							float vb = is16 ? float(b.row<uint16_t>(r)[i]) : b.row<float>(r)[i];
+							if (std::isnan(va) || std::isnan(vb))
+								continue;
+							maxDiff = std::max(maxDiff, std::fabs(va - vb));
+						}
+					}
+					return maxDiff;
+				}
+
+			private:
+				struct RowParams
+				{
+					const uint16_t* range;
+					unsigned width;
+					unsigned nx;
+					unsigned shiftZ;
+					uint32_t maskZ;
+					float invDivZ;
+					const int32_t* colIdx;
+					const float* colW;
+					const float* lut[3];
+					float rowAdd[3];
+					int c0;					// first component, 2 for C only output
+				};
+
+				// result is stored planar in dst, one row of width values per component
+				static void lookupScalar(const RowParams& p, float* dst, unsigned x0, unsigned x1)
+				{
+					for (unsigned x = x0; x < x1; x++)
+					{
+						uint32_t r = p.range[x];
+						uint32_t n = (r >> p.shiftZ) * p.nx + uint32_t(p.colIdx[x]);
+						float wx = p.colW[x];
+						float wz = float(r & p.maskZ) * p.invDivZ;
+						for (int c = p.c0; c < 3; c++)
+						{
+							const float* l = p.lut[c];
+							float v0 = l[n] + wx * (l[n + 1] - l[n]);
+							float v1 = l[n + p.nx] + wx * (l[n + p.nx + 1] - l[n + p.nx]);
+							dst[size_t(c - p.c0) * p.width + x] = v0 + wz * (v1 - v0) + p.rowAdd[c];
+						}
+					}
+				}
+
+#if defined(CX_C3D_LUT_AVX2)
+				static bool cpuHasAvx2()
+				{
+#if defined(_MSC_VER)
+					int info[4];
+					__cpuid(info, 0);
+					if (info[0] < 7)
+						return false;
+					__cpuid(info, 1);
+					bool fma = (info[2] & (1 << 12)) != 0;
+					bool osxsave = (info[2] & (1 << 27)) != 0;
+					if (!fma || !osxsave || (_xgetbv(0) & 6) != 6)
+						return false;
+					__cpuidex(info, 7, 0);
+					return (info[1] & (1 << 5)) != 0;
+#else
+					__builtin_cpu_init();
+					return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+				}
+
+				CX_C3D_LUT_TARGET_AVX2 static void lookupRowAvx2(const RowParams& p, float* dst)
+				{
+					const __m256i nx = _mm256_set1_epi32(int(p.nx));
+					const __m256i one = _mm256_set1_epi32(1);
+					const __m256i maskZ = _mm256_set1_epi32(int(p.maskZ));
+					const __m128i shiftZ = _mm_cvtsi32_si128(int(p.shiftZ));
+					const __m256 invDivZ = _mm256_set1_ps(p.invDivZ);
+					unsigned x = 0;
+					for (; x + 8 <= p.width; x += 8)
+					{
+						__m256i r = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(p.range + x)));
+						__m256i n00 = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srl_epi32(r, shiftZ), nx), _mm256_loadu_si256((const __m256i*)(p.colIdx + x)));
+						__m256i n01 = _mm256_add_epi32(n00, one);
+						__m256i n10 = _mm256_add_epi32(n00, nx);
+						__m256i n11 = _mm256_add_epi32(n10, one);
+						__m256 wx = _mm256_loadu_ps(p.colW + x);
+						__m256 wz = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(r, maskZ)), invDivZ);
+						for (int c = p.c0; c < 3; c++)
+						{
+							const float* l = p.lut[c];
+							__m256 a = _mm256_i32gather_ps(l, n00, 4);
+							__m256 b = _mm256_i32gather_ps(l, n01, 4);
+							__m256 d = _mm256_i32gather_ps(l, n10, 4);
+							__m256 e = _mm256_i32gather_ps(l, n11, 4);
+							__m256 v0 = _mm256_fmadd_ps(wx, _mm256_sub_ps(b, a), a);
+							__m256 v1 = _mm256_fmadd_ps(wx, _mm256_sub_ps(e, d), d);
+							__m256 v = _mm256_add_ps(_mm256_fmadd_ps(wz, _mm256_sub_ps(v1, v0), v0), _mm256_set1_ps(p.rowAdd[c]));
+							_mm256_storeu_ps(dst + size_t(c - p.c0) * p.width + x, v);
+						}
+					}
+					lookupScalar(p, dst, x, p.width);
+				}
+#endif
+
+#if defined(CX_C3D_LUT_NEON)
+				// NEON has no gather, indices are computed vectorized and the nodes loaded per lane
+				static void lookupRowNeon(const RowParams& p, float* dst)
+				{
+					const uint32x4_t nx = vdupq_n_u32(p.nx);
+					const uint32x4_t maskZ = vdupq_n_u32(p.maskZ);
+					const int32x4_t shiftZ = vdupq_n_s32(-int(p.shiftZ));
+					const float32x4_t invDivZ = vdupq_n_f32(p.invDivZ);
+					unsigned x = 0;
+					for (; x + 4 <= p.width; x += 4)
+					{
+						uint32x4_t r = vmovl_u16(vld1_u16(p.range + x));
+						uint32x4_t nv = vmlaq_u32(vreinterpretq_u32_s32(vld1q_s32(p.colIdx + x)), vshlq_u32(r, shiftZ), nx);
+						uint32_t n[4];
+						vst1q_u32(n, nv);
+						float32x4_t wx = vld1q_f32(p.colW + x);
+						float32x4_t wz = vmulq_f32(vcvtq_f32_u32(vandq_u32(r, maskZ)), invDivZ);
+						for (int c = p.c0; c < 3; c++)
+						{
+							const float* l = p.lut[c];
+							float32x4_t a = vdupq_n_f32(0.0f), b = a, d = a, e = a;
+							a = vld1q_lane_f32(l + n[0], a, 0); b = vld1q_lane_f32(l + n[0] + 1, b, 0); d = vld1q_lane_f32(l + n[0] + p.nx, d, 0); e = vld1q_lane_f32(l + n[0] + p.nx + 1, e, 0);
+							a = vld1q_lane_f32(l + n[1], a, 1); b = vld1q_lane_f32(l + n[1] + 1, b, 1); d = vld1q_lane_f32(l + n[1] + p.nx, d, 1); e = vld1q_lane_f32(l + n[1] + p.nx + 1, e, 1);
+							a = vld1q_lane_f32(l + n[2], a, 2); b = vld1q_lane_f32(l + n[2] + 1, b, 2); d = vld1q_lane_f32(l + n[2] + p.nx, d, 2); e = vld1q_lane_f32(l + n[2] + p.nx + 1, e, 2);
+							a = vld1q_lane_f32(l + n[3], a, 3); b = vld1q_lane_f32(l + n[3] + 1, b, 3); d = vld1q_lane_f32(l + n[3] + p.nx, d, 3); e = vld1q_lane_f32(l + n[3] + p.nx + 1, e, 3);
+							float32x4_t v0 = vfmaq_f32(a, wx, vsubq_f32(b, a));
+							float32x4_t v1 = vfmaq_f32(d, wx, vsubq_f32(e, d));
+							float32x4_t v = vaddq_f32(vfmaq_f32(v0, wz, vsubq_f32(v1, v0)), vdupq_n_f32(p.rowAdd[c]));
+							vst1q_f32(dst + size_t(c - p.c0) * p.width + x, v);
+						}
+					}
+					lookupScalar(p, dst, x, p.width);
+				}
+#endif
+
+				static uint16_t toU16(float v)
+				{
+					// NaN and negative values map to 0
+					return (v > 0.0f) ? ((v < 65535.0f) ? uint16_t(v + 0.5f) : uint16_t(65535)) : uint16_t(0);
+				}
+
+				// interleave/convert the planar kernel result into the output row and mark invalid range values
+				void writeRow(const RowParams& p, const float* src, cx::Image& out, unsigned r, bool mark) const
+				{
+					const float* srcZ = src + size_t(2 - p.c0) * p.width;
+					switch (out.pixelFormat())
+					{
+					case CX_PF_COORD3D_ABC32f:
+					{
+						float* dst = out.row<float>(r);
+						for (unsigned x = 0; x < p.width; x++)
+						{
+							dst[3 * x + 0] = src[x];
+							dst[3 * x + 1] = src[p.width + x];
+							dst[3 * x + 2] = (mark && p.range[x] == 0) ? m_idv : srcZ[x];
+						}
+						break;
+					}
+					case CX_PF_COORD3D_ABC16:
+					{
+						uint16_t* dst = out.row<uint16_t>(r);
+						uint16_t idv = toU16(m_idv);
+						for (unsigned x = 0; x < p.width; x++)
+						{
+							dst[3 * x + 0] = toU16(src[x]);
+							dst[3 * x + 1] = toU16(src[p.width + x]);
+							dst[3 * x + 2] = (mark && p.range[x] == 0) ? idv : toU16(srcZ[x]);
+						}
+						break;
+					}
+					case CX_PF_COORD3D_C32f:
+					{
+						float* dst = out.row<float>(r);
+						for (unsigned x = 0; x < p.width; x++)
+							dst[x] = (mark && p.range[x] == 0) ? m_idv : srcZ[x];
+						break;
+					}
+					default:
+					{
+						uint16_t* dst = out.row<uint16_t>(r);
+						uint16_t idv = toU16(m_idv);
+						for (unsigned x = 0; x < p.width; x++)
+							dst[x] = (mark && p.range[x] == 0) ? idv : toU16(srcZ[x]);
+						break;
+					}
+					}
+				}
+
+				bool m_valid;
+				unsigned m_width;
+				unsigned m_nx, m_nz;				// number of grid nodes in image x and range direction
+				unsigned m_shiftX, m_shiftZ;		// division as power of 2
+				float m_idv;
+				double m_dy[3];						// output change per profile coordinate
+				std::vector<float> m_lut[3];		// grid nodes per component, planar for gather
+				std::vector<int32_t> m_colIdx;		// grid column per image x
+				std::vector<float> m_colW;			// interpolation weight per image x
+				std::vector<float> m_scratch;		// one row of kernel output, sized in build()
+				lut_kernel m_kernel;
+			};
+
+			typedef MetricLut::Ptr MetricLutPtr;
+
+			//! @} cx_wrapper_cpp
+		}	// namespace c3d
+	}	// namespace cx
+}	// namespace AT
+#endif	// CX_C3D_METRICLUT_H_INCLUDED
@@ -0,0 +1,311 @@
+/**
+@file : MultipartRouter.h
+@package : cx_3d library
+@brief C++ dispatch of multipart buffer parts to per-region calibrations
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef CX_C3D_MULTIPARTROUTER_H_INCLUDED
+#define CX_C3D_MULTIPARTROUTER_H_INCLUDED
+
+#include <stdint.h>
+#include <vector>
+#include <map>
+#include <utility>
+#include <memory>
+#include <functional>
+#include <stdexcept>
+#include "cx_cam.h"
+#include "AT/cx/base.h"
+#include "AT/cx/ThreadPool.h"
+#include "AT/cx/Device.h"
+#include "AT/cx/ParamSnapshot.h"
+#include "AT/cx/c3d/Calib.h"
+#include "AT/cx/c3d/MetricContext.h"
+
+namespace AT {
+	namespace cx {
+		namespace c3d {
+			//! @addtogroup cx_wrapper_cpp
+			//! @{
+
+			/** MultipartRouter dispatches the image parts of GeV multipart buffers (GevSCCFGMultiPart) to handlers registered per extraction region.
+				Parts are routed by their key (CX_BUFFER_PART_INFO_REGION_ID, CX_BUFFER_PART_INFO_DATA_PURPOSE_ID), which is read for every part of every buffer,
+				so buffers with a different order or number of parts are routed correctly. CX_BUFFER_PART_INFO_TYPE_ID and the matching routes are cached per key.
+				Call reset() if the device can deliver a part of another type under a known key.
+
+				Routes are keyed by the Scan3dExtractionSelector value. configure() reads Scan3dExtractionSource of every extraction, a part is dispatched to the route
+				whose source region equals the region bits of the part's region id (see setRegionMask). Without configure() the extraction value is used as region directly.
+				Each route gets at most one part per buffer.
+
+				The parts are passed as zero-copy images on the buffer data and the handlers of different routes run concurrently on the thread pool.
+				Routes created with a MetricContext compute the point cloud with their own calibration before the handler is called,
+				so the calibrations and contexts must not be shared between routes.
+
+				\code{.cpp}
+					cx::ParamSnapshot params(*cam);
+					cx::c3d::MultipartRouter router(&pool);
+					router.configure(params);
+					for (int64_t region = 0; region < 2; region++)
+					{
+						auto calib = cx::c3d::Calib::createShared();
+						// load calibration and update with the region settings ...
+						router.addRoute(region, cx::c3d::MetricContext::createShared(calib), [&](const cx::c3d::MultipartRouter::Part& part, const cx::Image& rangeImg, cx::c3d::PointCloud& pc) {
+							// use pc ...
+						});
+					}
+					while (grabbing)
+					{
+						cx::DeviceBuffer buffer = cam->waitForBuffer(1000);
+						router.dispatch(buffer);
+						buffer.queueBuffer();
+					}
+				\endcode
+			*/
+			class MultipartRouter
+			{
+			public:
+				typedef std::shared_ptr<MultipartRouter> Ptr;
+
+				//! Cached info of a buffer part.
+				struct Part
+				{
+					int index;				//!< part index in the buffer
+					int64_t regionId;		//!< CX_BUFFER_PART_INFO_REGION_ID
+					int64_t purposeId;		//!< CX_BUFFER_PART_INFO_DATA_PURPOSE_ID, see \ref cx_buffer_part_purpose
+					int64_t typeId;			//!< CX_BUFFER_PART_INFO_TYPE_ID, see \ref cx_buffer_part_type
+					int route;				//!< index of the route the part is dispatched to, -1 if not routed
+				};
+
+				//! Called with the part and a zero-copy image of the part data, the image is only valid until the buffer is queued.
+				typedef std::function<void(const Part& part, const cx::Image& img)> Handler;
+
+				//! Called with the range image and the point cloud computed by the MetricContext of the route.
+				typedef std::function<void(const Part& part, const cx::Image& img, PointCloud& pc)> PointCloudHandler;
+
+				struct Route
+				{
+					int64_t extraction;				//!< Scan3dExtractionSelector value
+					int64_t region;					//!< source region of the extraction, matched against the region id of the parts
+					int64_t purposeId;				//!< accepted part purpose, -1 accepts all
+					MetricContext::Ptr context;		//!< optional context, holds the calibration of the route
+					Handler handler;
+				};
+
+				/** Create router.
+					@param pool			thread pool for running the handlers, nullptr runs them sequentially.
+					@param regionMask	bits of CX_BUFFER_PART_INFO_REGION_ID holding the sensor region.
+				*/
+				MultipartRouter(ThreadPool* pool = nullptr, int64_t regionMask = 0xf) : m_pool(pool), m_regionMask(regionMask), m_layoutValid(false) {}
+
+				static MultipartRouter::Ptr createShared(ThreadPool* pool = nullptr, int64_t regionMask = 0xf)
+				{
+					return std::make_shared<MultipartRouter>(pool, regionMask);
+				}
+
+				void setThreadPool(ThreadPool* pool) { m_pool = pool; }
+
+				void setRegionMask(int64_t mask)
+				{
+					m_regionMask = mask;
+					reset();
+				}
+
+				/** Read the source region of every Scan3dExtractionSelector value.
+					The snapshot can be shared with cx::updateCalibC6, which requests the same parameters.
+				*/
+				void configure(cx::ParamSnapshot& params)
+				{
+					params.addSelected("Scan3dExtractionSelector", { "Scan3dExtractionSource" }, cx::ParamSnapshot::FETCH_ENUM_INT_VALUE);
+					params.fetch();
+					m_sources.clear();
+					std::vector<int64_t> extractions = params.selectorValues("Scan3dExtractionSelector");
+					for (size_t i = 0; i < extractions.size(); i++)
+					{
+						cx::Variant val;
+						if (params.tryInfo(cx::ParamSnapshot::selectedName("Scan3dExtractionSource", "Scan3dExtractionSelector", extractions[i]), CX_PARAM_INFO_ENUM_INT_VALUE, val))
+							m_sources[extractions[i]] = int64_t(val);
+					}
+					for (size_t i = 0; i < m_routes.size(); i++)
+						m_routes[i].region = sourceRegion(m_routes[i].extraction);
+					reset();
+				}
+
+				/** Add a route for the parts of an extraction.
+					@param extraction	Scan3dExtractionSelector value.
+					@param handler		called for every matching part.
+					@param purposeId	accepted part purpose, see \ref cx_buffer_part_purpose, -1 accepts all.
+					@return index of the route.
+				*/
+				int addRoute(int64_t extraction, const Handler& handler, int64_t purposeId = CX_BUFFER_PART_PURPOSE_ID_RANGE)
+				{
+					Route r;
+					r.extraction = extraction;
+					r.region = sourceRegion(extraction);
+					r.purposeId = purposeId;
+					r.handler = handler;
+					m_routes.push_back(r);
+					reset();
+					return int(m_routes.size() - 1);
+				}
+
+				/** @overload
+					The point cloud of the part is computed by the context, the handler gets the context owned point cloud.
+				*/
+				int addRoute(int64_t extraction, const MetricContext::Ptr& context, const PointCloudHandler& handler, int flags = CX_3D_METRIC_MARK_Z_INVALID_DATA, int64_t purposeId = CX_BUFFER_PART_PURPOSE_ID_RANGE)
+				{
+					if (!context)
+						throw std::runtime_error("MultipartRouter: invalid metric context");
+					MetricContext* ctx = context.get();
+					int idx = addRoute(extraction, [ctx, handler, flags](const Part& part, const cx::Image& img) {
+						PointCloud& pc = ctx->calculatePointCloud(img, flags);
+						if (handler)
+							handler(part, img, pc);
+					}, purposeId);
+					m_routes[idx].context = context;
+					return idx;
+				}
+
+				/** Dispatch the image parts of a buffer to the routes.
+					Every part is routed by its region id and purpose id, the parts may come in any order. Each route gets the first matching part of the buffer.
+					The handlers run concurrently, the function returns when all handlers are finished. The first exception thrown by a handler is rethrown.
+					@return number of dispatched parts.
+				*/
+				size_t dispatch(cx::DeviceBuffer& buffer)
+				{
+					cx::Variant val;
+					buffer.getInfo(CX_BUFFER_INFO_NUM_PARTS, val);
+					readLayout(buffer, int(val));
+
+					for (size_t i = 0; i < m_dispatch.size(); i++)
+						buffer.getImage(m_images[i], m_parts[m_dispatch[i]].index);
+
+					auto task = [&](size_t i) {
+						const Part& part = m_parts[m_dispatch[i]];
+						m_routes[part.route].handler(part, m_images[i]);
+					};
+					if (m_pool && m_pool->numThreads() > 1 && m_dispatch.size() > 1)
+						m_pool->parallelFor(m_dispatch.size(), task);
+					else
+					{
+						for (size_t i = 0; i < m_dispatch.size(); i++)
+							task(i);
+					}
+					return m_dispatch.size();
+				}
+
+				//! Drops the cached part types and routes of all keys, the next buffer reads them again.
+				void reset()
+				{
+					m_layoutValid = false;
+					m_keys.clear();
+				}
+
+				bool hasLayout() const { return m_layoutValid; }
+				const std::vector<Part>& layout() const { return m_parts; }			//!< parts of the last buffer
+				const std::vector<Route>& routes() const { return m_routes; }
+				Route& route(size_t idx) { return m_routes.at(idx); }
+
+			private:
+				MultipartRouter(const MultipartRouter&);
+				MultipartRouter& operator=(const MultipartRouter&);
+
+				int64_t sourceRegion(int64_t extraction) const
+				{
+					auto it = m_sources.find(extraction);
+					return (it != m_sources.end()) ? it->second : extraction;
+				}
+
+				// type and matching routes of the parts with the same region id and purpose id
+				struct PartKey
+				{
+					int64_t typeId;
+					std::vector<int> routes;
+				};
+
+				const PartKey& partKey(cx::DeviceBuffer& buffer, int partIdx, int64_t regionId, int64_t purposeId)
+				{
+					std::pair<int64_t, int64_t> key(regionId, purposeId);
+					auto it = m_keys.find(key);
+					if (it != m_keys.end())
+						return it->second;
+					PartKey pk;
+					cx::Variant val;
+					buffer.getPartInfo(partIdx, CX_BUFFER_PART_INFO_TYPE_ID, val);
+					pk.typeId = int64_t(val);
+					for (size_t r = 0; r < m_routes.size() && pk.typeId == CX_BUFFER_PART_TYPE_ID_IMAGE2D; r++)
+					{
+						const Route& route = m_routes[r];
+						if ((regionId & m_regionMask) == route.region && (route.purposeId < 0 || route.purposeId == purposeId))
+							pk.routes.push_back(int(r));
+					}
+					return m_keys[key] = pk;
+				}
+
+				void readLayout(cx::DeviceBuffer& buffer, int numParts)
+				{
+					m_parts.clear();
+					m_dispatch.clear();
+					m_used.assign(m_routes.size(), 0);
+					cx::Variant val;
+					for (int i = 0; i < numParts; i++)
+					{
+						Part p;
+						p.index = i;
+						buffer.getPartInfo(i, CX_BUFFER_PART_INFO_REGION_ID, val);
+						p.regionId = int64_t(val);
+						buffer.getPartInfo(i, CX_BUFFER_PART_INFO_DATA_PURPOSE_ID, val);
+						p.purposeId = int64_t(val);
+						const PartKey& pk = partKey(buffer, i, p.regionId, p.purposeId);
+						p.typeId = pk.typeId;
+						p.route = -1;
+						for (size_t k = 0; k < pk.routes.size(); k++)
+						{
+							int r = pk.routes[k];
+							if (!m_used[r])
+							{
+								p.route = r;
+								m_used[r] = 1;
+								m_dispatch.push_back(m_parts.size());
+								break;
+							}
+						}
+						m_parts.push_back(p);
+					}
+					m_images.resize(m_dispatch.size());
+					m_layoutValid = true;
+				}
+
+				ThreadPool* m_pool;
+				int64_t m_regionMask;
+				bool m_layoutValid;
+				std::map<int64_t, int64_t> m_sources;		// Scan3dExtractionSelector -> Scan3dExtractionSource
+				std::vector<Route> m_routes;
+				std::map<std::pair<int64_t, int64_t>, PartKey> m_keys;		// (region id, purpose id) -> type and routes
+				std::vector<char> m_used;					// routes which got a part of the current buffer
+				std::vector<Part> m_parts;
+				std::vector<size_t> m_dispatch;				// indices of the routed parts
+				std::vector<cx::Image> m_images;			// views on the routed parts of the current buffer
+			};
+
+			typedef MultipartRouter::Ptr MultipartRouterPtr;
+
+			//! @} cx_wrapper_cpp
+		}
+	}
+}
+
+#endif // CX_C3D_MULTIPARTROUTER_H_INCLUDED
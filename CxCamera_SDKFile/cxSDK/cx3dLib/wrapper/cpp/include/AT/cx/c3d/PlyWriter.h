@@ -0,0 +1,296 @@
+/**
+@file : PlyWriter.h
+@package : cx_3d library
+@brief C++ streaming writer for binary PLY point clouds
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef CX_C3D_PLYWRITER_H_INCLUDED
+#define CX_C3D_PLYWRITER_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "AT/cx/base.h"
+#include "AT/cx/Image.h"
+
+namespace AT {
+	namespace cx {
+		namespace c3d {
+			//! @addtogroup cx_wrapper_cpp
+			//! @{
+
+			inline bool isPlyFileName(const std::string& fileName)
+			{
+				size_t pos = fileName.find_last_of('.');
+				if (pos == std::string::npos)
+					return false;
+				std::string ext = fileName.substr(pos + 1);
+				std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return char(tolower((unsigned char)c)); });
+				return ext == "ply";
+			}
+
+			/** Class PlyWriter writes organized point clouds and range maps as binary little endian PLY file.
+				The vertices are converted row by row directly into a large output buffer, no intermediate vertex array is built.
+				Scale and offset are applied while writing, invalid points are skipped.
+
+				Supported point formats:
+				- CX_PF_COORD3D_ABC8, CX_PF_COORD3D_ABC16, CX_PF_COORD3D_ABC32f in packed and planar layout: vertex = point * scale + offset
+				- CX_PF_COORD3D_C16, CX_PF_COORD3D_C32f (range map or ZMap): vertex = (column, row, value) * scale + offset
+
+				Vertex properties are float x, y, z, optionally float nx, ny, nz from normals of type CX_PF_COORD3D_ABC32f
+				and uchar red, green, blue from colors of type CX_PF_MONO_8.
+				Header and vertex records are the same as written by cx_3d_pointcloud_save (VTK PLY writer) for the valid points
+				in world coordinates, including the comment, obj_info and the empty face element.
+				The writer object keeps its buffers, reuse it for writing a sequence of files.
+
+				\code{.cpp}
+					cx::c3d::PlyWriter writer;
+					size_t n = writer.write("cloud.ply", pc.points, pc.scale, pc.offset, NAN, &pc.normals);
+				\endcode
+			*/
+			class PlyWriter
+			{
+			public:
+				typedef std::shared_ptr<PlyWriter> Ptr;
+
+				/** @param bufferSize	size of the output buffer, the file is written in pieces of this size
+				*/
+				explicit PlyWriter(size_t bufferSize = size_t(4) << 20) : m_bufferSize(std::max<size_t>(bufferSize, 4096))
+				{
+				}
+
+				static bool isPointFormat(cx_pixel_format pf)
+				{
+					return pf == CX_PF_COORD3D_ABC8 || pf == CX_PF_COORD3D_ABC8_PLANAR || pf == CX_PF_COORD3D_ABC16 || pf == CX_PF_COORD3D_ABC16_PLANAR
+						|| pf == CX_PF_COORD3D_ABC32f || pf == CX_PF_COORD3D_ABC32f_PLANAR || pf == CX_PF_COORD3D_C16 || pf == CX_PF_COORD3D_C32f;
+				}
+
+				/** Write a binary PLY file, an existing file is overwritten.
+					@param fileName		file name
+					@param points		points or range map, see supported formats above
+					@param scale		scale applied to the points
+					@param offset		offset applied to the points
+					@param idv			invalid data value of z (in raw point units), NaN is always treated as invalid.
+					@param normals		optional normals of type CX_PF_COORD3D_ABC32f with the size of points
+					@param colors		optional colors of type CX_PF_MONO_8 with the size of points, written as gray RGB
+					@return number of written vertices
+				*/
+				size_t write(const std::string& fileName, const cx::Image& points, const cx::Point3f& scale = cx::Point3f(1.0f, 1.0f, 1.0f), const cx::Point3f& offset = cx::Point3f(0.0f, 0.0f, 0.0f),
+					float idv = NAN, const cx::Image* normals = nullptr, const cx::Image* colors = nullptr)
+				{
+					cx_pixel_format pf = points.pixelFormat();
+					if (!isPointFormat(pf))
+						throw std::runtime_error("PlyWriter: pixelFormat not supported");
+					if (normals && normals->size() == 0)
+						normals = nullptr;
+					if (colors && colors->size() == 0)
+						colors = nullptr;
+					if (normals && (normals->pixelFormat() != CX_PF_COORD3D_ABC32f || normals->width() != points.width() || normals->height() != points.height()))
+						throw std::runtime_error("PlyWriter: normals must be of type CX_PF_COORD3D_ABC32f with the size of points");
+					if (colors && (colors->pixelFormat() != CX_PF_MONO_8 || colors->width() != points.width() || colors->height() != points.height()))
+						throw std::runtime_error("PlyWriter: colors must be of type CX_PF_MONO_8 with the size of points");
+
+					unsigned w = points.width();
+					unsigned h = points.height();
+					size_t count = 0;
+					for (unsigned y = 0; y < h; y++)
+						count += countRow(points, y, idv);
+
+					std::string hdr = "ply\nformat binary_little_endian 1.0\n";
+					hdr += "comment VTK generated PLY File\nobj_info vtkPolyData points and polygons: vtk4.0\n";
+					hdr += "element vertex " + std::to_string((unsigned long long)count) + "\n";
+					hdr += "property float x\nproperty float y\nproperty float z\n";
+					if (normals)
+						hdr += "property float nx\nproperty float ny\nproperty float nz\n";
+					if (colors)
+						hdr += "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+					hdr += "element face 0\nproperty list uchar int vertex_indices\n";
+					hdr += "end_header\n";
+
+					std::unique_ptr<FILE, int(*)(FILE*)> f(fopen(fileName.c_str(), "wb"), fclose);
+					if (!f)
+						throw std::runtime_error("PlyWriter: can not create " + fileName);
+					// stdio buffering is not needed, the data is written in large pieces
+					setvbuf(f.get(), NULL, _IONBF, 0);
+
+					size_t recSize = 3 * sizeof(float) + (normals ? 3 * sizeof(float) : 0) + (colors ? 3 : 0);
+					m_buf.resize(std::max(m_bufferSize, hdr.size() + size_t(w) * recSize));
+					m_xyz.resize(3 * size_t(w));
+					memcpy(m_buf.data(), hdr.data(), hdr.size());
+					size_t used = hdr.size();
+
+					for (unsigned y = 0; y < h; y++)
+					{
+						if (used + size_t(w) * recSize > m_buf.size())
+						{
+							writeBuffer(f.get(), used);
+							used = 0;
+						}
+						float* xs = m_xyz.data();
+						float* ys = xs + w;
+						float* zs = ys + w;
+						loadRow(points, y, idv, scale, offset, xs, ys, zs);
+						const float* nrm = normals ? normals->row<float>(y) : nullptr;
+						const uint8_t* col = colors ? colors->row<uint8_t>(y) : nullptr;
+						uint8_t* dst = m_buf.data() + used;
+						for (unsigned x = 0; x < w; x++)
+						{
+							if (std::isnan(zs[x]))
+								continue;
+							float v[3] = { xs[x], ys[x], zs[x] };
+							memcpy(dst, v, sizeof(v));
+							dst += sizeof(v);
+							if (nrm)
+							{
+								memcpy(dst, nrm + 3 * size_t(x), 3 * sizeof(float));
+								dst += 3 * sizeof(float);
+							}
+							if (col)
+							{
+								dst[0] = dst[1] = dst[2] = col[x];
+								dst += 3;
+							}
+						}
+						used = size_t(dst - m_buf.data());
+					}
+					writeBuffer(f.get(), used);
+					if (fclose(f.release()) != 0)
+						throw std::runtime_error("PlyWriter: write error " + fileName);
+					return count;
+				}
+
+				static PlyWriter::Ptr createShared(size_t bufferSize = size_t(4) << 20)
+				{
+					return std::make_shared<PlyWriter>(bufferSize);
+				}
+
+			private:
+				PlyWriter(const PlyWriter&);
+				PlyWriter& operator=(const PlyWriter&);
+
+				void writeBuffer(FILE* f, size_t n)
+				{
+					if (n && fwrite(m_buf.data(), n, 1, f) != 1)
+						throw std::runtime_error("PlyWriter: write error");
+				}
+
+				static size_t countRow(const cx::Image& points, unsigned y, float idv)
+				{
+					switch (points.pixelFormat())
+					{
+					case CX_PF_COORD3D_ABC8:			return countRow<uint8_t>(points, y, 3, 2, idv);
+					case CX_PF_COORD3D_ABC8_PLANAR:		return countRow<uint8_t>(points, y, 1, 2 * points.planePitch(), idv);
+					case CX_PF_COORD3D_ABC16:			return countRow<uint16_t>(points, y, 3, 2 * sizeof(uint16_t), idv);
+					case CX_PF_COORD3D_ABC16_PLANAR:	return countRow<uint16_t>(points, y, 1, 2 * points.planePitch(), idv);
+					case CX_PF_COORD3D_ABC32f:			return countRow<float>(points, y, 3, 2 * sizeof(float), idv);
+					case CX_PF_COORD3D_ABC32f_PLANAR:	return countRow<float>(points, y, 1, 2 * points.planePitch(), idv);
+					case CX_PF_COORD3D_C16:				return countRow<uint16_t>(points, y, 1, 0, idv);
+					case CX_PF_COORD3D_C32f:			return countRow<float>(points, y, 1, 0, idv);
+					default: throw std::runtime_error("PlyWriter: pixelFormat not supported");
+					}
+				}
+
+				// z values start at byte offset zOffset of the row and have a distance of step elements
+				template<typename T>
+				static size_t countRow(const cx::Image& points, unsigned y, size_t step, size_t zOffset, float idv)
+				{
+					const T* z = (const T*)((const char*)points.data() + size_t(y) * points.linePitch() + zOffset);
+					size_t n = 0;
+					for (unsigned x = 0; x < points.width(); x++)
+					{
+						float v = float(z[x * step]);
+						n += (!std::isnan(v) && v != idv) ? 1 : 0;
+					}
+					return n;
+				}
+
+				// convert row y into planar world coordinates, z of invalid points is set to NaN
+				static void loadRow(const cx::Image& points, unsigned y, float idv, const cx::Point3f& s, const cx::Point3f& o, float* xs, float* ys, float* zs)
+				{
+					switch (points.pixelFormat())
+					{
+					case CX_PF_COORD3D_ABC8:			loadRowAbc<uint8_t>(points, y, 3, 0, idv, s, o, xs, ys, zs); break;
+					case CX_PF_COORD3D_ABC8_PLANAR:		loadRowAbc<uint8_t>(points, y, 1, points.planePitch(), idv, s, o, xs, ys, zs); break;
+					case CX_PF_COORD3D_ABC16:			loadRowAbc<uint16_t>(points, y, 3, 0, idv, s, o, xs, ys, zs); break;
+					case CX_PF_COORD3D_ABC16_PLANAR:	loadRowAbc<uint16_t>(points, y, 1, points.planePitch(), idv, s, o, xs, ys, zs); break;
+					case CX_PF_COORD3D_ABC32f:			loadRowAbc<float>(points, y, 3, 0, idv, s, o, xs, ys, zs); break;
+					case CX_PF_COORD3D_ABC32f_PLANAR:	loadRowAbc<float>(points, y, 1, points.planePitch(), idv, s, o, xs, ys, zs); break;
+					case CX_PF_COORD3D_C16:				loadRowC<uint16_t>(points, y, idv, s, o, xs, ys, zs); break;
+					case CX_PF_COORD3D_C32f:			loadRowC<float>(points, y, idv, s, o, xs, ys, zs); break;
+					default: throw std::runtime_error("PlyWriter: pixelFormat not supported");
+					}
+				}
+
+				template<typename T>
+				static void loadRowAbc(const cx::Image& points, unsigned y, size_t step, size_t planePitch, float idv, const cx::Point3f& s, const cx::Point3f& o, float* xs, float* ys, float* zs)
+				{
+					const char* base = (const char*)points.data() + size_t(y) * points.linePitch();
+					const T* a = (const T*)base;
+					const T* b = planePitch ? (const T*)(base + planePitch) : a + 1;
+					const T* c = planePitch ? (const T*)(base + 2 * planePitch) : a + 2;
+					for (unsigned x = 0; x < points.width(); x++)
+					{
+						float z = float(c[x * step]);
+						bool valid = !std::isnan(z) && z != idv;
+						xs[x] = float(a[x * step]) * s.x + o.x;
+						ys[x] = float(b[x * step]) * s.y + o.y;
+						zs[x] = valid ? z * s.z + o.z : NAN;
+					}
+				}
+
+				template<typename T>
+				static void loadRowC(const cx::Image& points, unsigned y, float idv, const cx::Point3f& s, const cx::Point3f& o, float* xs, float* ys, float* zs)
+				{
+					const T* c = points.row<T>(y);
+					float yw = float(y) * s.y + o.y;
+					for (unsigned x = 0; x < points.width(); x++)
+					{
+						float z = float(c[x]);
+						bool valid = !std::isnan(z) && z != idv;
+						xs[x] = float(x) * s.x + o.x;
+						ys[x] = yw;
+						zs[x] = valid ? z * s.z + o.z : NAN;
+					}
+				}
+
+				size_t m_bufferSize;
+				std::vector<uint8_t> m_buf;		// output buffer, starts with the header
+				std::vector<float> m_xyz;		// planar world coordinates of one row
+			};
+
+			/** Write a binary PLY file, see \ref PlyWriter::write.
+				@return number of written vertices
+			*/
+			inline size_t savePly(const std::string& fileName, const cx::Image& points, const cx::Point3f& scale = cx::Point3f(1.0f, 1.0f, 1.0f), const cx::Point3f& offset = cx::Point3f(0.0f, 0.0f, 0.0f),
+				float idv = NAN, const cx::Image* normals = nullptr, const cx::Image* colors = nullptr)
+			{
+				PlyWriter writer;
+				return writer.write(fileName, points, scale, offset, idv, normals, colors);
+			}
+
+			//! @} cx_wrapper_cpp
+		}
+	}
+}
+
+#endif	// CX_C3D_PLYWRITER_H_INCLUDED
@@ -21,11 +21,25 @@ POSSIBILITY OF SUCH DAMAGE.
 #ifndef CX_C3D_POINTCLOUD_H_INCLUDED
 #define CX_C3D_POINTCLOUD_H_INCLUDED
 
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <mutex>
 #include "cx_3d_metric.h"
 #include "cx_3d_calib.h"
 #include "cx_3d_pointcloud.h"
 #include "AT/cx/base.h"
+#include "AT/cx/ThreadPool.h"
+#include "AT/cx/MappedFile.h"
+#include "AT/cx/ImagePool.h"
 #include "AT/cx/c3d/Calib.h"
+#include "AT/cx/c3d/PlyWriter.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CX_C3D_POINTCLOUD_SSE2
+	#include <emmintrin.h>
+#endif
 
 namespace AT {
 	namespace cx {
@@ -33,6 +47,8 @@ namespace AT {
 			//! @addtogroup cx_wrapper_cpp
 			//! @{
 
+			class PointCloudStoreReader;
+
 			/** Point Cloud class represents an organized point cloud based on cx::Image object. 
 			*/
 			class PointCloud
@@ -62,11 +78,21 @@ namespace AT {
 					normals	Used by PLY and OBJ format only. Supported depths: CV_32F and CV_64F. Supported channels: 3 and 4.
 					binary	Used only for PLY format.
 
+					Binary PLY files are written by \ref PlyWriter if normals are absent or of type CX_PF_COORD3D_ABC32f and colors are absent or of type CX_PF_MONO_8:
+					all point formats are supported, scale and offset are applied and points with z = NaN are skipped.
+
 					\note
-					The current implementation does only support saving point clouds of format CX_PF_COORD3D_ABC32f, it does not support saving of scale and offset.
+					For the other cases the implementation does only support saving point clouds of format CX_PF_COORD3D_ABC32f, it does not support saving of scale and offset.
 				*/
 				void save(const std::string& fileName, bool binary = true)
 				{
+					bool plyNormals = !hasNormals() || normals.pixelFormat() == CX_PF_COORD3D_ABC32f;
+					bool plyColors = !hasColors() || colors.pixelFormat() == CX_PF_MONO_8;
+					if (binary && isPlyFileName(fileName) && plyNormals && plyColors && PlyWriter::isPointFormat(points.pixelFormat()))
+					{
+						savePly(fileName, points, scale, offset, NAN, hasNormals() ? &normals : nullptr, hasColors() ? &colors : nullptr);
+						return;
+					}
 					checkOk(cx_3d_pointcloud_save(fileName.c_str(), points, hasColors() ? (cx_img_t*)colors : nullptr, hasNormals() ? (cx_img_t*)normals : nullptr, binary));
 				}
 
@@ -80,76 +106,116 @@ namespace AT {
 			
 
 				/** Compute normals from points.
-					The calculated Normal vectors are normalized.
-					Function only works for organized point clouds. 
-					
+					The calculated Normal vectors are normalized and oriented towards positive z in world coordinates, scale of the points is considered.
+					Function only works for organized point clouds, supported pixel formats: CX_PF_COORD3D_ABC8, CX_PF_COORD3D_ABC16 and CX_PF_COORD3D_ABC32f in packed and planar layout.
+					The tangents are computed by central differences of the 4 neighbours, if one neighbour is invalid the one-sided difference is used.
+					Normals of invalid points and of points without valid neighbour in x or y direction are set to NaN.
+					@param idv		invalid data value of z (in raw point units) used to mark invalid data points, NaN is always treated as invalid.
+					@param pool		optional thread pool, rows are processed in parallel bands.
+
 					\note 
 					After importing point cloud from eg. ply-files the organization is unordered and the calculation will fail.
 				*/
-				void computeNormals()
+				void computeNormals(float idv = NAN, ThreadPool* pool = nullptr)
 				{
-					normals.create(points.height(), points.width(), CX_PF_COORD3D_ABC32f);
-					assert(points.pixelFormat() == CX_PF_COORD3D_ABC32f);
-					float sdzdx = scale.z / scale.x;
-					float sdzdy = scale.z / scale.y;
-					for (unsigned y = 1; y < points.height(); y++)
-					{
-						for (unsigned x = 1; x < points.width(); x++)
+					if (!isPointFormat(points.pixelFormat()))
+						throw std::runtime_error("pixelFormat not supported");
+					if (!isPooled(normals, points.height(), points.width(), CX_PF_COORD3D_ABC32f))
+						normals.create(points.height(), points.width(), CX_PF_COORD3D_ABC32f);
+
+					unsigned h = points.height();
+					auto band = [&](size_t r0, size_t r1) {
+						// SoA rows in world units with one NaN pixel padding on both sides, 3 rows are kept in a rolling window
+						unsigned w = points.width();
+						size_t stride = size_t(w) + 2;
+						std::vector<float> buf(9 * stride, NAN);
+						float* rows[3] = { buf.data(), buf.data() + 3 * stride, buf.data() + 6 * stride };
+						if (r0 > 0)
+							loadPlanarRow(unsigned(r0 - 1), 0, w, idv, scale, rows[0] + 1, stride);
+						loadPlanarRow(unsigned(r0), 0, w, idv, scale, rows[1] + 1, stride);
+						for (size_t r = r0; r < r1; r++)
 						{
-#if 0
-							cx::Point3f t = points.at<cx::Point3f>(y - 1, x);
-							cx::Point3f l = points.at<cx::Point3f>(y, x - 1);
-							cx::Point3f c = points.at<cx::Point3f>(y, x);
-							cx::Point3f d = (c - t).cross(c - l);
-							normals.at<cx::Point3f>(y, x) = normalize(d);
-#else			
-							cx::Point3f dx = points.at<cx::Point3f>(y, x) - points.at<cx::Point3f>(y, x - 1);
-							float dzdx = dx.z / dx.x * sdzdx;
-							cx::Point3f dy = points.at<cx::Point3f>(y, x) - points.at<cx::Point3f>(y - 1, x);
-							float dzdy = dy.z / dy.y * sdzdy;
-							normals.at<cx::Point3f>(y, x) = normalize(cx::Point3f(-dzdx, -dzdy, 1.0f));
-#endif
+							if (r + 1 < h)
+								loadPlanarRow(unsigned(r + 1), 0, w, idv, scale, rows[2] + 1, stride);
+							else
+								std::fill(rows[2], rows[2] + 3 * stride, NAN);
+							normalsRow(rows[0] + 1, rows[1] + 1, rows[2] + 1, stride, w, normals.row<float>(unsigned(r)));
+							std::rotate(rows, rows + 1, rows + 3);
 						}
-					}
+					};
+					if (pool && pool->numThreads() > 1)
+						pool->parallelForRange(h, 32, band);
+					else
+						band(0, h);
 				}
 
-				/** Compute bounding box coordinates.
-					@param[out] min3	point with minimum coordinates fo x, y, z.
-					@param[out] max3	point with maximum coordinates fo x, y, z.
-					@param[in] idv		invalid data value used in z to indicate an invalid data point
+				/** Compute bounding box coordinates in world units, scale and offset are applied.
+					Supported pixel formats: CX_PF_COORD3D_ABC8, CX_PF_COORD3D_ABC16 and CX_PF_COORD3D_ABC32f in packed and planar layout.
+					@param[out] min3		point with minimum coordinates fo x, y, z.
+					@param[out] max3		point with maximum coordinates fo x, y, z.
+					@param[in] idv			invalid data value used in z (in raw point units) to indicate an invalid data point, NaN is always treated as invalid.
+					@param[out] centroid	optional, mean of all valid points.
+					@param[in] pool			optional thread pool, rows are processed in parallel bands.
+					@return number of valid points. If there is no valid point min3, max3 and centroid are set to NaN.
 				*/
-				void computeBoundingBox(cx::Point3f& min3, cx::Point3f& max3, float idv = NAN)
+				size_t computeBoundingBox(cx::Point3f& min3, cx::Point3f& max3, float idv = NAN, cx::Point3f* centroid = nullptr, ThreadPool* pool = nullptr) const
 				{
-					if (points.pixelFormat() != CX_PF_COORD3D_ABC32f)
+					if (!isPointFormat(points.pixelFormat()))
 						throw std::runtime_error("pixelFormat not supported");
 
-					min3 = cx::Point3f(FLT_MAX, FLT_MAX, FLT_MAX);
-					max3 = cx::Point3f(FLT_MIN, FLT_MIN, FLT_MIN);
-					for (unsigned y = 0; y < points.height(); y++)
-					{
-						cx::Point3f* row = points.row<cx::Point3f>(y);
-						for (unsigned x = 0; x < points.width(); x++)
+					BoundsAcc acc;
+					std::mutex mtx;
+					auto band = [&](size_t r0, size_t r1) {
+						const unsigned blockSize = 256;
+						float blk[3 * blockSize];
+						BoundsAcc local;
+						for (size_t r = r0; r < r1; r++)
 						{
-							const cx::Point3f p = row[x];
-							if (!isnan(p.z) && p.z != idv)
+							if (points.pixelFormat() == CX_PF_COORD3D_ABC32f)
+							{
+								boundsRowAbc32f(points.row<float>(unsigned(r)), points.width(), idv, local);
+								continue;
+							}
+							for (unsigned x = 0; x < points.width(); x += blockSize)
 							{
-								if (p.x < min3.x)	min3.x = p.x;
-								if (p.y < min3.y)	min3.y = p.y;
-								if (p.z < min3.z)	min3.z = p.z;
-								if (p.x > max3.x)	max3.x = p.x;
-								if (p.y > max3.y)	max3.y = p.y;
-								if (p.z > max3.z)	max3.z = p.z;
+								unsigned n = std::min(blockSize, points.width() - x);
+								loadPlanarRow(unsigned(r), x, n, idv, cx::Point3f(1.0f, 1.0f, 1.0f), blk, blockSize);
+								boundsBlock(blk, blockSize, n, local);
 							}
 						}
+						std::lock_guard<std::mutex> lck(mtx);
+						acc.merge(local);
+					};
+					if (pool && pool->numThreads() > 1)
+						pool->parallelForRange(points.height(), 16, band);
+					else
+						band(0, points.height());
+
+					if (acc.count == 0)
+					{
+						min3 = max3 = cx::Point3f(NAN, NAN, NAN);
+						if (centroid)
+							*centroid = min3;
+						return 0;
+					}
+					const float s[3] = { scale.x, scale.y, scale.z };
+					const float o[3] = { offset.x, offset.y, offset.z };
+					float lo[3], hi[3], c[3];
+					for (int k = 0; k < 3; k++)
+					{
+						lo[k] = acc.mn[k] * s[k] + o[k];
+						hi[k] = acc.mx[k] * s[k] + o[k];
+						if (s[k] < 0)
+							std::swap(lo[k], hi[k]);
+						c[k] = float(acc.sum[k] / double(acc.count) * s[k] + o[k]);
 					}
-					min3.x = min3.x * scale.x + offset.x;
-					min3.y = min3.y * scale.y + offset.y;
-					min3.z = min3.z * scale.z + offset.z;
-					max3.x = max3.x * scale.x + offset.x;
-					max3.y = max3.y * scale.y + offset.y;
-					max3.z = max3.z * scale.z + offset.z;
-				}
-											
+					min3 = cx::Point3f(lo[0], lo[1], lo[2]);
+					max3 = cx::Point3f(hi[0], hi[1], hi[2]);
+					if (centroid)
+						*centroid = cx::Point3f(c[0], c[1], c[2]);
+					return acc.count;
+				}
+
 				/** Create a shared_ptr PointCloud object with empty size.
 					Points, normals and colors are empty.
 				*/
@@ -166,17 +232,364 @@ namespace AT {
 					return std::make_shared<PointCloud>(h, w, pf);
 				}
 
+				/** Create a shared_ptr PointCloud object, the points are created with a buffer of pool, see \ref createPooled.
+					Normals and colors are empty.
+				*/
+				static PointCloud::Ptr createShared(unsigned int h, unsigned int w, cx_pixel_format pf, ImagePool& pool)
+				{
+					PointCloud::Ptr pc = std::make_shared<PointCloud>();
+					pc->createPooled(pc->points, h, w, pf, pool);
+					return pc;
+				}
+
+				/** Creates points, normals or colors of this point cloud with a buffer of pool, e.g. for a new point cloud per frame without allocation.
+					A pooled image of the same size and pixel format is kept, computeNormals writes into pooled normals of matching size.
+					The buffer goes back to the pool when the point cloud and its copies are destroyed or the image is created again by this function.
+					@param img	points, normals or colors of this point cloud.
+				*/
+				void createPooled(cx::Image& img, unsigned int h, unsigned int w, cx_pixel_format pf, ImagePool& pool)
+				{
+					std::shared_ptr<void>& handle = pooledHandle(img);
+					if (handle && img.height() == h && img.width() == w && img.pixelFormat() == pf)
+						return;
+					img = cx::Image();
+					handle = pool.acquire(h, w, pf, img);
+				}
+
+			private:
+				std::shared_ptr<void>& pooledHandle(const cx::Image& img)
+				{
+					if (&img == &points)
+						return m_pooled[0];
+					if (&img == &normals)
+						return m_pooled[1];
+					if (&img == &colors)
+						return m_pooled[2];
+					throw std::runtime_error("PointCloud: image is not part of the point cloud");
+				}
+
+				bool isPooled(cx::Image& img, unsigned int h, unsigned int w, cx_pixel_format pf)
+				{
+					return pooledHandle(img) && img.height() == h && img.width() == w && img.pixelFormat() == pf;
+				}
+
+				// partial result of computeBoundingBox in raw point units
+				struct BoundsAcc
+				{
+					BoundsAcc() : count(0)
+					{
+						for (int k = 0; k < 3; k++)
+						{
+							mn[k] = INFINITY;
+							mx[k] = -INFINITY;
+							sum[k] = 0;
+						}
+					}
+					void merge(const BoundsAcc& other)
+					{
+						for (int k = 0; k < 3; k++)
+						{
+							mn[k] = std::min(mn[k], other.mn[k]);
+							mx[k] = std::max(mx[k], other.mx[k]);
+							sum[k] += other.sum[k];
+						}
+						count += other.count;
+					}
+					float mn[3];
+					float mx[3];
+					double sum[3];
+					size_t count;
+				};
+
+				static bool isPointFormat(cx_pixel_format pf)
+				{
+					return pf == CX_PF_COORD3D_ABC8 || pf == CX_PF_COORD3D_ABC8_PLANAR || pf == CX_PF_COORD3D_ABC16 || pf == CX_PF_COORD3D_ABC16_PLANAR
+						|| pf == CX_PF_COORD3D_ABC32f || pf == CX_PF_COORD3D_ABC32f_PLANAR;
+				}
+
+				// convert the points [x0, x0+n) of row y into planar x, y, z buffers multiplied by s, invalid points are set to NaN
+				void loadPlanarRow(unsigned y, unsigned x0, unsigned n, float idv, const cx::Point3f& s, float* dst, size_t stride) const
+				{
+					switch (points.pixelFormat())
+					{
+					case CX_PF_COORD3D_ABC8:			loadPlanarRow<uint8_t>(y, x0, n, 3, 0, idv, s, dst, stride); break;
+					case CX_PF_COORD3D_ABC8_PLANAR:		loadPlanarRow<uint8_t>(y, x0, n, 1, points.planePitch(), idv, s, dst, stride); break;
+					case CX_PF_COORD3D_ABC16:			loadPlanarRow<uint16_t>(y, x0, n, 3, 0, idv, s, dst, stride); break;
+					case CX_PF_COORD3D_ABC16_PLANAR:	loadPlanarRow<uint16_t>(y, x0, n, 1, points.planePitch(), idv, s, dst, stride); break;
+					case CX_PF_COORD3D_ABC32f:			loadPlanarRow<float>(y, x0, n, 3, 0, idv, s, dst, stride); break;
+					case CX_PF_COORD3D_ABC32f_PLANAR:	loadPlanarRow<float>(y, x0, n, 1, points.planePitch(), idv, s, dst, stride); break;
+					default: throw std::runtime_error("pixelFormat not supported");
+					}
+				}
+
+				template<typename T>
+				void loadPlanarRow(unsigned y, unsigned x0, unsigned n, size_t step, size_t planePitch, float idv, const cx::Point3f& s, float* dst, size_t stride) const
+				{
+					const char* base = (const char*)points.data() + size_t(y) * points.linePitch();
+					const T* a = (const T*)base + size_t(x0) * step;
+					const T* b = planePitch ? (const T*)(base + planePitch) + x0 : a + 1;
+					const T* c = planePitch ? (const T*)(base + 2 * planePitch) + x0 : a + 2;
+					float* dx = dst;
+					float* dy = dst + stride;
+					float* dz = dst + 2 * stride;
+					for (unsigned x = 0; x < n; x++)
+					{
+						float z = float(c[x * step]);
+						bool valid = !std::isnan(z) && z != idv;
+						dx[x] = valid ? float(a[x * step]) * s.x : NAN;
+						dy[x] = valid ? float(b[x * step]) * s.y : NAN;
+						dz[x] = valid ? z * s.z : NAN;
+					}
+				}
+
+				// min, max and sum of the planar block, invalid points are NaN
+				static void boundsBlock(const float* blk, size_t stride, unsigned n, BoundsAcc& acc)
+				{
+					unsigned x = 0;
+					float sum[3] = { 0, 0, 0 };
+#if defined(CX_C3D_POINTCLOUD_SSE2)
+					if (n >= 4)
+					{
+						__m128 vmin[3], vmax[3], vsum[3];
+						for (int k = 0; k < 3; k++)
+						{
+							vmin[k] = _mm_set1_ps(acc.mn[k]);
+							vmax[k] = _mm_set1_ps(acc.mx[k]);
+							vsum[k] = _mm_setzero_ps();
+						}
+						unsigned count = 0;
+						for (; x + 4 <= n; x += 4)
+						{
+							__m128 valid = _mm_cmpord_ps(_mm_loadu_ps(blk + 2 * stride + x), _mm_setzero_ps());
+							count += popcount4(_mm_movemask_ps(valid));
+							for (int k = 0; k < 3; k++)
+							{
+								// min/max return the second operand if the first is NaN
+								__m128 v = _mm_loadu_ps(blk + k * stride + x);
+								vmin[k] = _mm_min_ps(v, vmin[k]);
+								vmax[k] = _mm_max_ps(v, vmax[k]);
+								vsum[k] = _mm_add_ps(vsum[k], _mm_and_ps(valid, v));
+							}
+						}
+						for (int k = 0; k < 3; k++)
+						{
+							float t[4];
+							_mm_storeu_ps(t, vmin[k]);
+							acc.mn[k] = std::min(std::min(t[0], t[1]), std::min(t[2], t[3]));
+							_mm_storeu_ps(t, vmax[k]);
+							acc.mx[k] = std::max(std::max(t[0], t[1]), std::max(t[2], t[3]));
+							_mm_storeu_ps(t, vsum[k]);
+							sum[k] = (t[0] + t[1]) + (t[2] + t[3]);
+						}
+						acc.count += count;
+					}
+#endif
+					for (; x < n; x++)
+					{
+						if (std::isnan(blk[2 * stride + x]))
+							continue;
+						for (int k = 0; k < 3; k++)
+						{
+							float v = blk[k * stride + x];
+							acc.mn[k] = std::min(acc.mn[k], v);
+							acc.mx[k] = std::max(acc.mx[k], v);
+							sum[k] += v;
+						}
+						acc.count++;
+					}
+					for (int k = 0; k < 3; k++)
+						acc.sum[k] += sum[k];
+				}
+
+				// min, max and sum of a packed ABC32f row, the 3 registers of 4 points are reduced without deinterleaving
+				static void boundsRowAbc32f(const float* p, unsigned n, float idv, BoundsAcc& acc)
+				{
+					unsigned x = 0;
+					double sum[3] = { 0, 0, 0 };
+#if defined(CX_C3D_POINTCLOUD_SSE2)
+					if (n >= 4)
+					{
+						// lane k of register i holds component (i + k) % 3
+						static const int comp[3][4] = { { 0, 1, 2, 0 }, { 1, 2, 0, 1 }, { 2, 0, 1, 2 } };
+						const __m128 nanBits = _mm_castsi128_ps(_mm_set1_epi32(-1));
+						const __m128 vidv = _mm_set1_ps(idv);
+						__m128 vmin[3], vmax[3], vsum[3];
+						for (int i = 0; i < 3; i++)
+						{
+							vmin[i] = _mm_set1_ps(INFINITY);
+							vmax[i] = _mm_set1_ps(-INFINITY);
+							vsum[i] = _mm_setzero_ps();
+						}
+						unsigned count = 0;
+						for (; x + 4 <= n; x += 4, p += 12)
+						{
+							__m128 r[3] = { _mm_loadu_ps(p), _mm_loadu_ps(p + 4), _mm_loadu_ps(p + 8) };
+							__m128 t = _mm_shuffle_ps(r[0], r[1], _MM_SHUFFLE(1, 1, 2, 2));
+							__m128 u = _mm_shuffle_ps(r[2], r[2], _MM_SHUFFLE(3, 3, 0, 0));
+							__m128 z = _mm_shuffle_ps(t, u, _MM_SHUFFLE(2, 0, 2, 0));
+							__m128 valid = _mm_and_ps(_mm_cmpord_ps(z, z), _mm_cmpneq_ps(z, vidv));
+							count += popcount4(_mm_movemask_ps(valid));
+							__m128 m[3] = {
+								_mm_shuffle_ps(valid, valid, _MM_SHUFFLE(1, 0, 0, 0)),
+								_mm_shuffle_ps(valid, valid, _MM_SHUFFLE(2, 2, 1, 1)),
+								_mm_shuffle_ps(valid, valid, _MM_SHUFFLE(3, 3, 3, 2)) };
+							for (int i = 0; i < 3; i++)
+							{
+								// invalid lanes are set to NaN, min/max return the second operand if the first is NaN
+								__m128 v = _mm_or_ps(r[i], _mm_andnot_ps(m[i], nanBits));
+								vmin[i] = _mm_min_ps(v, vmin[i]);
+								vmax[i] = _mm_max_ps(v, vmax[i]);
+								vsum[i] = _mm_add_ps(vsum[i], _mm_and_ps(m[i], r[i]));
+							}
+						}
+						for (int i = 0; i < 3; i++)
+						{
+							float tmin[4], tmax[4], tsum[4];
+							_mm_storeu_ps(tmin, vmin[i]);
+							_mm_storeu_ps(tmax, vmax[i]);
+							_mm_storeu_ps(tsum, vsum[i]);
+							for (int k = 0; k < 4; k++)
+							{
+								int c = comp[i][k];
+								acc.mn[c] = std::min(acc.mn[c], tmin[k]);
+								acc.mx[c] = std::max(acc.mx[c], tmax[k]);
+								sum[c] += tsum[k];
+							}
+						}
+						acc.count += count;
+					}
+#endif
+					for (; x < n; x++, p += 3)
+					{
+						if (std::isnan(p[2]) || p[2] == idv)
+							continue;
+						for (int k = 0; k < 3; k++)
+						{
+							acc.mn[k] = std::min(acc.mn[k], p[k]);
+							acc.mx[k] = std::max(acc.mx[k], p[k]);
+							sum[k] += p[k];
+						}
+						acc.count++;
+					}
+					for (int k = 0; k < 3; k++)
+						acc.sum[k] += sum[k];
+				}
+
+#if defined(CX_C3D_POINTCLOUD_SSE2)
+				static unsigned popcount4(int m)
+				{
+					return unsigned((m & 1) + ((m >> 1) & 1) + ((m >> 2) & 1) + ((m >> 3) & 1));
+				}
+#endif
+
+				// normals of row c from the planar rows t (above), c and b (below), result is written interleaved to dst
+				static void normalsRow(const float* t, const float* c, const float* b, size_t stride, unsigned w, float* dst)
+				{
+					unsigned x = 0;
+#if defined(CX_C3D_POINTCLOUD_SSE2)
+					const __m128 zero = _mm_setzero_ps();
+					const __m128 signMask = _mm_set1_ps(-0.0f);
+					for (; x + 4 <= w; x += 4)
+					{
+						// invalid points are NaN in all coordinates, so the z coordinate is sufficient for the validity masks
+						__m128 cz = _mm_loadu_ps(c + 2 * stride + x);
+						__m128 rValid = _mm_cmpord_ps(_mm_loadu_ps(c + 2 * stride + x + 1), zero);
+						__m128 lValid = _mm_cmpord_ps(_mm_loadu_ps(c + 2 * stride + x - 1), zero);
+						__m128 bValid = _mm_cmpord_ps(_mm_loadu_ps(b + 2 * stride + x), zero);
+						__m128 tValid = _mm_cmpord_ps(_mm_loadu_ps(t + 2 * stride + x), zero);
+						__m128 tx[3], ty[3];
+						for (int k = 0; k < 3; k++)
+						{
+							// central difference if both neighbours are valid, otherwise one-sided
+							const float* cc = c + k * stride + x;
+							__m128 cv = _mm_loadu_ps(cc);
+							__m128 r = _mm_loadu_ps(cc + 1);
+							__m128 l = _mm_loadu_ps(cc - 1);
+							__m128 bv = _mm_loadu_ps(b + k * stride + x);
+							__m128 tv = _mm_loadu_ps(t + k * stride + x);
+							tx[k] = _mm_sub_ps(selectPs(rValid, r, cv), selectPs(lValid, l, cv));
+							ty[k] = _mm_sub_ps(selectPs(bValid, bv, cv), selectPs(tValid, tv, cv));
+						}
+						__m128 nx = _mm_sub_ps(_mm_mul_ps(tx[1], ty[2]), _mm_mul_ps(tx[2], ty[1]));
+						__m128 ny = _mm_sub_ps(_mm_mul_ps(tx[2], ty[0]), _mm_mul_ps(tx[0], ty[2]));
+						__m128 nz = _mm_sub_ps(_mm_mul_ps(tx[0], ty[1]), _mm_mul_ps(tx[1], ty[0]));
+						// invalid centre point propagates NaN, orientation towards positive z
+						nz = _mm_add_ps(nz, _mm_mul_ps(cz, zero));
+						__m128 flip = _mm_and_ps(nz, signMask);
+						__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+						__m128 inv = _mm_xor_ps(_mm_div_ps(_mm_set1_ps(1.0f), len), flip);
+						nx = _mm_mul_ps(nx, inv);
+						ny = _mm_mul_ps(ny, inv);
+						nz = _mm_mul_ps(nz, inv);
+						// interleave to xyz
+						float tmp[12];
+						_mm_storeu_ps(tmp, nx);
+						_mm_storeu_ps(tmp + 4, ny);
+						_mm_storeu_ps(tmp + 8, nz);
+						for (int i = 0; i < 4; i++)
+						{
+							dst[3 * (x + i)] = tmp[i];
+							dst[3 * (x + i) + 1] = tmp[4 + i];
+							dst[3 * (x + i) + 2] = tmp[8 + i];
+						}
+					}
+#endif
+					for (; x < w; x++)
+					{
+						bool rValid = !std::isnan(c[2 * stride + x + 1]);
+						bool lValid = !std::isnan(c[2 * stride + x - 1]);
+						bool bValid = !std::isnan(b[2 * stride + x]);
+						bool tValid = !std::isnan(t[2 * stride + x]);
+						float tx[3], ty[3];
+						for (int k = 0; k < 3; k++)
+						{
+							const float* cc = c + k * stride + x;
+							tx[k] = (rValid ? cc[1] : cc[0]) - (lValid ? cc[-1] : cc[0]);
+							ty[k] = (bValid ? b[k * stride + x] : cc[0]) - (tValid ? t[k * stride + x] : cc[0]);
+						}
+						float n[3] = { tx[1] * ty[2] - tx[2] * ty[1], tx[2] * ty[0] - tx[0] * ty[2], tx[0] * ty[1] - tx[1] * ty[0] };
+						n[2] += c[2 * stride + x] * 0.0f;
+						float inv = 1.0f / std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+						if (n[2] < 0)
+							inv = -inv;
+						dst[3 * x] = n[0] * inv;
+						dst[3 * x + 1] = n[1] * inv;
+						dst[3 * x + 2] = n[2] * inv;
+					}
+				}
+
+#if defined(CX_C3D_POINTCLOUD_SSE2)
+				static __m128 selectPs(__m128 mask, __m128 a, __m128 b)
+				{
+					return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+				}
+#endif
+
+			public:
+
 				cx::Image points;		//!< Only valid after calculation or loading from file. Note: must be of type CX_PF_COORD3D_ABC32f (CV_32FC3) in order to use vtk(WCloud) visualization.
 				cx::Image normals;		//!< point cloud normals calculated from points or loaded from file.
 				cx::Image colors;		//!< point cloud colors, eg. intensity or scatter component of multip-part acquisition. Supported types: CX_PF_MONO_8, CX_PF_MONO_16.
 				cx::Point3f scale;	//!< scaling factor for conversion points into real world coordinates, for CX_PF_COORD3D_ABC32f typically (1, 1, 1)
 				cx::Point3f offset;	//!< offset for conversion points into real world coordinates, for CX_PF_COORD3D_ABC32f typically (0, 0, 0)
+
+				//! Returns true if the images reference a memory mapped file, see \ref PointCloudStoreReader.
+				bool isMapped() const { return m_mapping != nullptr; }
+
+			private:
+				friend class PointCloudStoreReader;
+				MappedFile::Ptr m_mapping;	//!< keeps the file mapped while the images reference it, shared by copies of the point cloud
+				std::shared_ptr<void> m_pooled[3];	//!< return the buffers of points, normals and colors to the ImagePool when released, see \ref createPooled
 			};
 
 			typedef PointCloud::Ptr PointCloudPtr;
 
 
 			/** Calculate point cloud from RangeMap
+
+				\note
+				The function sets CX_3D_PARAM_METRIC_O and CX_3D_PARAM_METRIC_S of the calibration on every call, which may invalidate the LUT cache.
+				For continuous processing use \ref MetricContext, it sets up the calibration and the cache only once.
 			*/
 			inline void calculatePointCloud(cx::c3d::Calib& cal, const cx::Image& rangeMap, PointCloud& pc, int flags=CX_3D_METRIC_MARK_Z_INVALID_DATA)
 			{
@@ -0,0 +1,655 @@
+/**
+@file : PointCloudStore.h
+@package : cx_3d library
+@brief C++ chunked on-disk container for organized point clouds with random row access
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef CX_C3D_POINTCLOUDSTORE_H_INCLUDED
+#define CX_C3D_POINTCLOUDSTORE_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <limits>
+#include "AT/cx/base.h"
+#include "AT/cx/Image.h"
+#include "AT/cx/MappedFile.h"
+#include "AT/cx/c3d/PointCloud.h"
+
+namespace AT {
+	namespace cx {
+		namespace c3d {
+			//! @addtogroup cx_wrapper_cpp
+			//! @{
+
+			/** Point cloud store file format (*.cxpc), all values are stored in little endian byte order.
+
+				The file starts with PcsFileHeader padded to PCS_PAGE bytes, followed by blocks of fixed size PcsFileHeader::blockSize.
+				Block b starts at PcsFileHeader::dataOffset + b * blockSize and holds up to rowsPerBlock rows of the organized point cloud.
+				A block starts with PcsBlockHeader, the block headers form the index (row, encoder and timestamp range of every block).
+				The sections of a block start at PcsFileHeader::sectionOffset relative to the block, each padded to PCS_ALIGN bytes:
+				points, normals (optional), colors (optional), timestamps (uint64 per row) and encoder values (int32 per row).
+
+				PcsFileHeader::numRows is written after the block data, a reader sees only rows that are completely written.
+				This allows reading the file while it is appended by another process.
+			*/
+			enum pcs_format
+			{
+				PCS_FILE_MAGIC = 0x43505843,		//!< "CXPC"
+				PCS_BLOCK_MAGIC = 0x4B424350,		//!< "PCBK"
+				PCS_VERSION = 1,
+				PCS_PAGE = 4096,					//!< alignment of blocks
+				PCS_ALIGN = 64						//!< alignment of sections within a block
+			};
+
+			//! Sections of a point cloud store block
+			enum pcs_section
+			{
+				PCS_SECTION_POINTS = 0,
+				PCS_SECTION_NORMALS = 1,
+				PCS_SECTION_COLORS = 2,
+				PCS_SECTION_TIMESTAMPS = 3,
+				PCS_SECTION_ENCODER = 4,
+				PCS_NUM_SECTIONS = 5
+			};
+
+			struct PcsFileHeader
+			{
+				uint32_t magic;
+				uint32_t version;
+				uint32_t width;
+				uint32_t rowsPerBlock;
+				uint32_t pointFormat;		//!< CX_PF_COORD3D_ABC8, CX_PF_COORD3D_ABC16 or CX_PF_COORD3D_ABC32f
+				uint32_t normalFormat;		//!< CX_PF_COORD3D_ABC32f or 0 if no normals are stored
+				uint32_t colorFormat;		//!< CX_PF_MONO_8, CX_PF_MONO_16 or 0 if no colors are stored
+				uint32_t reserved0;
+				float scale[3];
+				float offset[3];
+				uint64_t blockSize;
+				uint64_t dataOffset;
+				uint64_t sectionOffset[PCS_NUM_SECTIONS];
+				uint64_t numRows;			//!< number of completely written rows, updated last
+				uint8_t reserved[136];
+			};
+
+			struct PcsBlockHeader
+			{
+				uint32_t magic;
+				uint32_t numRows;			//!< valid rows in this block
+				uint64_t firstRow;
+				int32_t minEncoder;
+				int32_t maxEncoder;
+				uint64_t minTimestamp;
+				uint64_t maxTimestamp;
+				uint8_t reserved[24];
+			};
+
+			static_assert(sizeof(PcsFileHeader) == 256, "PcsFileHeader layout");
+			static_assert(sizeof(PcsBlockHeader) == 64, "PcsBlockHeader layout");
+
+			inline int pcsSeek(FILE* f, uint64_t pos)
+			{
+#ifdef _MSC_VER
+				return _fseeki64(f, (__int64)pos, SEEK_SET);
+#else
+				return fseeko(f, (off_t)pos, SEEK_SET);
+#endif
+			}
+
+			inline unsigned pcsBytesPerPixel(uint32_t pf)
+			{
+				switch (pf)
+				{
+				case 0:							return 0;
+				case CX_PF_MONO_8:				return 1;
+				case CX_PF_MONO_16:				return 2;
+				case CX_PF_COORD3D_ABC8:		return 3;
+				case CX_PF_COORD3D_ABC16:		return 6;
+				case CX_PF_COORD3D_ABC32f:		return 12;
+				default: throw std::runtime_error("PointCloudStore: unsupported pixel format");
+				}
+			}
+
+			/** bytes per row of each section and the resulting section offsets and block size.
+				Throws if width or rowsPerBlock is 0 or a block would not fit into memory, e.g. for a corrupt header.
+			*/
+			inline void pcsLayout(PcsFileHeader& hdr, size_t rowBytes[PCS_NUM_SECTIONS])
+			{
+				if (hdr.width == 0 || hdr.rowsPerBlock == 0)
+					throw std::runtime_error("PointCloudStore: invalid size");
+				const uint64_t bpp[PCS_NUM_SECTIONS] = { pcsBytesPerPixel(hdr.pointFormat), pcsBytesPerPixel(hdr.normalFormat), pcsBytesPerPixel(hdr.colorFormat), 0, 0 };
+				// the limit keeps all sizes and offsets within a block free of overflow, also in size_t on 32 bit systems
+				const uint64_t maxBlockSize = std::numeric_limits<size_t>::max() / 4;
+				uint64_t pos = sizeof(PcsBlockHeader);
+				for (int s = 0; s < PCS_NUM_SECTIONS; s++)
+				{
+					uint64_t bytes = (s == PCS_SECTION_TIMESTAMPS) ? sizeof(uint64_t) : (s == PCS_SECTION_ENCODER) ? sizeof(int32_t) : uint64_t(hdr.width) * bpp[s];
+					pos = (pos + PCS_ALIGN - 1) / PCS_ALIGN * PCS_ALIGN;
+					if (bytes > 0 && hdr.rowsPerBlock > (maxBlockSize - pos) / bytes)
+						throw std::runtime_error("PointCloudStore: block size too large");
+					rowBytes[s] = size_t(bytes);
+					hdr.sectionOffset[s] = pos;
+					pos += bytes * hdr.rowsPerBlock;
+				}
+				hdr.blockSize = (pos + PCS_PAGE - 1) / PCS_PAGE * PCS_PAGE;
+				hdr.dataOffset = PCS_PAGE;
+			}
+
+			/** Class PointCloudStoreWriter appends organized point clouds row by row to a point cloud store file.
+				Rows are collected in a block buffer, full blocks are written with one call. flush() writes the incomplete block and makes its rows visible to readers.
+
+				\code{.cpp}
+					cx::c3d::PointCloudStoreWriter writer("scan.cxpc", pc.points.width(), CX_PF_COORD3D_ABC32f, pc.scale, pc.offset);
+					while (grabbing)
+					{
+						// ... calculate pc from the range map of one buffer
+						writer.append(pc, timestamps.data(), encoder.data());
+					}
+					writer.close();
+				\endcode
+			*/
+			class PointCloudStoreWriter
+			{
+			public:
+				typedef std::shared_ptr<PointCloudStoreWriter> Ptr;
+
+				/** Create the store file, an existing file is overwritten.
+					@param fileName		file name, typically with extension .cxpc
+					@param width		width of the organized point cloud
+					@param pointFormat	CX_PF_COORD3D_ABC8, CX_PF_COORD3D_ABC16 or CX_PF_COORD3D_ABC32f
+					@param scale		scale of the points, see PointCloud::scale
+					@param offset		offset of the points, see PointCloud::offset
+					@param hasNormals	store normals, format CX_PF_COORD3D_ABC32f
+					@param colorFormat	CX_PF_MONO_8, CX_PF_MONO_16 or 0 to store no colors
+					@param rowsPerBlock	rows per block, the unit of writing and of zero copy reads
+				*/
+				PointCloudStoreWriter(const std::string& fileName, unsigned width, cx_pixel_format pointFormat, const cx::Point3f& scale = cx::Point3f(1.0f, 1.0f, 1.0f), const cx::Point3f& offset = cx::Point3f(0.0f, 0.0f, 0.0f),
+					bool hasNormals = false, unsigned colorFormat = 0, unsigned rowsPerBlock = 256) : m_file(nullptr), m_blockRows(0), m_numBlocks(0)
+				{
+					if (pointFormat != CX_PF_COORD3D_ABC8 && pointFormat != CX_PF_COORD3D_ABC16 && pointFormat != CX_PF_COORD3D_ABC32f)
+						throw std::runtime_error("PointCloudStore: unsupported point format");
+					if (colorFormat != 0 && colorFormat != CX_PF_MONO_8 && colorFormat != CX_PF_MONO_16)
+						throw std::runtime_error("PointCloudStore: unsupported color format");
+					if (width == 0 || rowsPerBlock == 0)
+						throw std::runtime_error("PointCloudStore: invalid size");
+					memset(&m_hdr, 0, sizeof(m_hdr));
+					m_hdr.magic = PCS_FILE_MAGIC;
+					m_hdr.version = PCS_VERSION;
+					m_hdr.width = width;
+					m_hdr.rowsPerBlock = rowsPerBlock;
+					m_hdr.pointFormat = pointFormat;
+					m_hdr.normalFormat = hasNormals ? CX_PF_COORD3D_ABC32f : 0;
+					m_hdr.colorFormat = colorFormat;
+					m_hdr.scale[0] = scale.x; m_hdr.scale[1] = scale.y; m_hdr.scale[2] = scale.z;
+					m_hdr.offset[0] = offset.x; m_hdr.offset[1] = offset.y; m_hdr.offset[2] = offset.z;
+					pcsLayout(m_hdr, m_rowBytes);
+					m_block.assign((size_t)m_hdr.blockSize, 0);
+
+					m_file = fopen(fileName.c_str(), "wb");
+					if (!m_file)
+						throw std::runtime_error("PointCloudStore: can not create " + fileName);
+					writeHeader();
+				}
+
+				~PointCloudStoreWriter()
+				{
+					try
+					{
+						close();
+					}
+					catch (...)
+					{
+					}
+				}
+
+				/** Append all rows of the organized point cloud.
+					@param pc			point cloud with the width and point format of the store. Normals and colors are required if the store has them.
+					@param timestamps	optional timestamp per row, e.g. from the chunk data of the buffer
+					@param encoder		optional encoder value per row
+				*/
+				void append(const PointCloud& pc, const uint64_t* timestamps = nullptr, const int32_t* encoder = nullptr)
+				{
+					if (!m_file)
+						throw std::runtime_error("PointCloudStore: writer is closed");
+					if (pc.points.width() != m_hdr.width || pc.points.pixelFormat() != (cx_pixel_format)m_hdr.pointFormat)
+						throw std::runtime_error("PointCloudStore: point cloud does not match store format");
+					if (m_hdr.normalFormat && (pc.normals.width() != m_hdr.width || pc.normals.height() != pc.points.height() || pc.normals.pixelFormat() != (cx_pixel_format)m_hdr.normalFormat))
+						throw std::runtime_error("PointCloudStore: normals missing or do not match store format");
+					if (m_hdr.colorFormat && (pc.colors.width() != m_hdr.width || pc.colors.height() != pc.points.height() || pc.colors.pixelFormat() != (cx_pixel_format)m_hdr.colorFormat))
+						throw std::runtime_error("PointCloudStore: colors missing or do not match store format");
+
+					for (unsigned r = 0; r < pc.points.height(); r++)
+					{
+						uint8_t* blk = m_block.data();
+						unsigned i = m_blockRows;
+						memcpy(blk + m_hdr.sectionOffset[PCS_SECTION_POINTS] + i * m_rowBytes[PCS_SECTION_POINTS], pc.points.row<uint8_t>(r), m_rowBytes[PCS_SECTION_POINTS]);
+						if (m_hdr.normalFormat)
+							memcpy(blk + m_hdr.sectionOffset[PCS_SECTION_NORMALS] + i * m_rowBytes[PCS_SECTION_NORMALS], pc.normals.row<uint8_t>(r), m_rowBytes[PCS_SECTION_NORMALS]);
+						if (m_hdr.colorFormat)
+							memcpy(blk + m_hdr.sectionOffset[PCS_SECTION_COLORS] + i * m_rowBytes[PCS_SECTION_COLORS], pc.colors.row<uint8_t>(r), m_rowBytes[PCS_SECTION_COLORS]);
+						uint64_t ts = timestamps ? timestamps[r] : 0;
+						int32_t enc = encoder ? encoder[r] : int32_t(m_hdr.numRows + m_blockRows);
+						memcpy(blk + m_hdr.sectionOffset[PCS_SECTION_TIMESTAMPS] + i * sizeof(uint64_t), &ts, sizeof(ts));
+						memcpy(blk + m_hdr.sectionOffset[PCS_SECTION_ENCODER] + i * sizeof(int32_t), &enc, sizeof(enc));
+
+						PcsBlockHeader& bh = blockHeader();
+						if (i == 0)
+						{
+							bh.firstRow = m_hdr.numRows;
+							bh.minEncoder = bh.maxEncoder = enc;
+							bh.minTimestamp = bh.maxTimestamp = ts;
+						}
+						bh.minEncoder = std::min(bh.minEncoder, enc);
+						bh.maxEncoder = std::max(bh.maxEncoder, enc);
+						bh.minTimestamp = std::min(bh.minTimestamp, ts);
+						bh.maxTimestamp = std::max(bh.maxTimestamp, ts);
+						bh.numRows = ++m_blockRows;
+						if (m_blockRows == m_hdr.rowsPerBlock)
+						{
+							// numRows of the file header counts the rows of all complete blocks plus the flushed rows of the current block
+							writeBlock();
+							m_hdr.numRows += m_blockRows;
+							writeHeader();
+							m_blockRows = 0;
+							m_numBlocks++;
+							memset(m_block.data(), 0, m_block.size());
+						}
+					}
+				}
+
+				/** Write the incomplete block and the header, the rows appended so far become visible to readers.
+				*/
+				void flush()
+				{
+					if (!m_file || m_blockRows == 0)
+						return;
+					writeBlock();
+					uint64_t numRows = m_hdr.numRows;
+					m_hdr.numRows += m_blockRows;
+					writeHeader();
+					m_hdr.numRows = numRows;
+				}
+
+				void close()
+				{
+					if (!m_file)
+						return;
+					flush();
+					FILE* f = m_file;
+					m_file = nullptr;
+					if (fclose(f) != 0)
+						throw std::runtime_error("PointCloudStore: write error");
+				}
+
+				uint64_t numRows() const { return m_hdr.numRows + m_blockRows; }
+				unsigned width() const { return m_hdr.width; }
+
+			private:
+				PointCloudStoreWriter(const PointCloudStoreWriter&);
+				PointCloudStoreWriter& operator=(const PointCloudStoreWriter&);
+
+				PcsBlockHeader& blockHeader()
+				{
+					PcsBlockHeader* bh = (PcsBlockHeader*)m_block.data();
+					bh->magic = PCS_BLOCK_MAGIC;
+					return *bh;
+				}
+
+				void writeBlock()
+				{
+					bool ok = pcsSeek(m_file, m_hdr.dataOffset + m_numBlocks * m_hdr.blockSize) == 0;
+					ok = ok && fwrite(m_block.data(), m_block.size(), 1, m_file) == 1;
+					ok = ok && fflush(m_file) == 0;
+					if (!ok)
+						throw std::runtime_error("PointCloudStore: write error");
+				}
+
+				void writeHeader()
+				{
+					std::vector<uint8_t> page(PCS_PAGE, 0);
+					memcpy(page.data(), &m_hdr, sizeof(m_hdr));
+					bool ok = pcsSeek(m_file, 0) == 0;
+					ok = ok && fwrite(page.data(), page.size(), 1, m_file) == 1;
+					ok = ok && fflush(m_file) == 0;
+					if (!ok)
+						throw std::runtime_error("PointCloudStore: write error");
+				}
+
+				FILE* m_file;
+				PcsFileHeader m_hdr;
+				size_t m_rowBytes[PCS_NUM_SECTIONS];
+				std::vector<uint8_t> m_block;
+				unsigned m_blockRows;			// rows in the current block
+				uint64_t m_numBlocks;			// complete blocks written
+			};
+
+			/** Class PointCloudStoreReader provides random access to the rows of a point cloud store file.
+				The file is memory mapped shared and read only. Rows within one block are returned without copying,
+				the returned images reference the mapping and must not be written. The returned point cloud and its copies keep the mapping alive,
+				images taken out of the point cloud do not. refresh() picks up rows appended by a writer in another process.
+
+				\code{.cpp}
+					cx::c3d::PointCloudStoreReader reader("scan.cxpc");
+					size_t r0, r1;
+					reader.findRowsByEncoder(encStart, encEnd, r0, r1);
+					reader.forEachBlock(r0, r1, [&](size_t firstRow, const cx::c3d::PointCloud& part, const uint64_t* ts, const int32_t* enc) {
+						// process part.points, no data is copied
+					});
+				\endcode
+			*/
+			class PointCloudStoreReader
+			{
+			public:
+				typedef std::shared_ptr<PointCloudStoreReader> Ptr;
+				//! Called with the first row, a zero copy view of the rows and the timestamps and encoder values of the rows. The pointers reference the mapping kept alive by the view.
+				typedef std::function<void(size_t firstRow, const PointCloud& part, const uint64_t* timestamps, const int32_t* encoder)> BlockFunc;
+
+				PointCloudStoreReader() : m_numRows(0)
+				{
+					memset(&m_hdr, 0, sizeof(m_hdr));
+				}
+
+				explicit PointCloudStoreReader(const std::string& fileName) : m_numRows(0)
+				{
+					open(fileName);
+				}
+
+				void open(const std::string& fileName)
+				{
+					close();
+					m_fileName = fileName;
+					MappedFile::Ptr file = MappedFile::createShared(fileName, true);
+					if (file->size() < sizeof(PcsFileHeader))
+						throw std::runtime_error("PointCloudStore: file too small " + fileName);
+					memcpy(&m_hdr, file->data(), sizeof(m_hdr));
+					if (m_hdr.magic != PCS_FILE_MAGIC)
+						throw std::runtime_error("PointCloudStore: not a point cloud store " + fileName);
+					if (m_hdr.version != PCS_VERSION)
+						throw std::runtime_error("PointCloudStore: unsupported version " + fileName);
+					PcsFileHeader check = m_hdr;
+					pcsLayout(check, m_rowBytes);
+					if (check.blockSize != m_hdr.blockSize || check.dataOffset != m_hdr.dataOffset || memcmp(check.sectionOffset, m_hdr.sectionOffset, sizeof(check.sectionOffset)) != 0)
+						throw std::runtime_error("PointCloudStore: corrupt header " + fileName);
+					m_map = file;
+					updateRows();
+				}
+
+				void close()
+				{
+					m_map.reset();
+					m_numRows = 0;
+					memset(&m_hdr, 0, sizeof(m_hdr));
+				}
+
+				bool isOpen() const { return m_map != nullptr; }
+
+				/** Update the number of rows from the header, maps the file again if it has grown.
+					Point clouds returned before stay valid, they keep the previous mapping alive. The reader only holds the current mapping,
+					so a mapping is released as soon as no point cloud references it. References returned by blockHeader() are invalidated.
+					@return number of rows
+				*/
+				size_t refresh()
+				{
+					if (!isOpen())
+						return 0;
+					uint64_t numRows = headerRows();
+					if (numRows > m_numRows && numRows > mappedRows())
+						m_map = MappedFile::createShared(m_fileName, true);
+					updateRows();
+					return m_numRows;
+				}
+
+				size_t numRows() const { return m_numRows; }
+				unsigned width() const { return m_hdr.width; }
+				unsigned rowsPerBlock() const { return m_hdr.rowsPerBlock; }
+				size_t numBlocks() const { return (m_numRows + m_hdr.rowsPerBlock - 1) / m_hdr.rowsPerBlock; }
+				cx_pixel_format pointFormat() const { return (cx_pixel_format)m_hdr.pointFormat; }
+				bool hasNormals() const { return m_hdr.normalFormat != 0; }
+				bool hasColors() const { return m_hdr.colorFormat != 0; }
+				cx::Point3f scale() const { return cx::Point3f(m_hdr.scale[0], m_hdr.scale[1], m_hdr.scale[2]); }
+				cx::Point3f offset() const { return cx::Point3f(m_hdr.offset[0], m_hdr.offset[1], m_hdr.offset[2]); }
+
+				//! Returns the index entry of block b, the reference is valid until the next refresh() or close().
+				const PcsBlockHeader& blockHeader(size_t b) const
+				{
+					if (b >= numBlocks())
+						throw std::out_of_range("PointCloudStore: block index out of range");
+					return *(const PcsBlockHeader*)block(b);
+				}
+
+				/** Call func for the rows [r0, r1) once per block, the point cloud references the mapped file.
+				*/
+				void forEachBlock(size_t r0, size_t r1, const BlockFunc& func) const
+				{
+					checkRange(r0, r1);
+					while (r0 < r1)
+					{
+						size_t b = r0 / m_hdr.rowsPerBlock;
+						size_t n = std::min<size_t>(r1, (b + 1) * m_hdr.rowsPerBlock) - r0;
+						PointCloud part;
+						const uint64_t* ts;
+						const int32_t* enc;
+						view(r0, n, part, ts, enc);
+						func(r0, part, ts, enc);
+						r0 += n;
+					}
+				}
+
+				/** Get rows [r0, r1) as point cloud.
+					If the rows are within one block the point cloud references the mapped file, otherwise the rows are copied.
+					@return true if no data was copied.
+				*/
+				bool getRows(size_t r0, size_t r1, PointCloud& pc, std::vector<uint64_t>* timestamps = nullptr, std::vector<int32_t>* encoder = nullptr) const
+				{
+					checkRange(r0, r1);
+					size_t n = r1 - r0;
+					if (timestamps)
+						timestamps->resize(n);
+					if (encoder)
+						encoder->resize(n);
+					bool zeroCopy = n == 0 || r0 / m_hdr.rowsPerBlock == (r1 - 1) / m_hdr.rowsPerBlock;
+					if (zeroCopy)
+					{
+						const uint64_t* ts = nullptr;
+						const int32_t* enc = nullptr;
+						if (n)
+							view(r0, n, pc, ts, enc);
+						copyInfo(ts, enc, n, timestamps ? timestamps->data() : nullptr, encoder ? encoder->data() : nullptr);
+						return true;
+					}
+
+					reset(pc);
+					pc.points.create(unsigned(n), m_hdr.width, pointFormat());
+					if (hasNormals())
+						pc.normals.create(unsigned(n), m_hdr.width, (cx_pixel_format)m_hdr.normalFormat);
+					if (hasColors())
+						pc.colors.create(unsigned(n), m_hdr.width, (cx_pixel_format)m_hdr.colorFormat);
+					forEachBlock(r0, r1, [&](size_t firstRow, const PointCloud& part, const uint64_t* ts, const int32_t* enc) {
+						unsigned dst = unsigned(firstRow - r0);
+						for (unsigned r = 0; r < part.points.height(); r++)
+						{
+							memcpy(pc.points.row<uint8_t>(dst + r), part.points.row<uint8_t>(r), m_rowBytes[PCS_SECTION_POINTS]);
+							if (hasNormals())
+								memcpy(pc.normals.row<uint8_t>(dst + r), part.normals.row<uint8_t>(r), m_rowBytes[PCS_SECTION_NORMALS]);
+							if (hasColors())
+								memcpy(pc.colors.row<uint8_t>(dst + r), part.colors.row<uint8_t>(r), m_rowBytes[PCS_SECTION_COLORS]);
+						}
+						copyInfo(ts, enc, part.points.height(), timestamps ? timestamps->data() + dst : nullptr, encoder ? encoder->data() + dst : nullptr);
+					});
+					return false;
+				}
+
+				/** Find the rows with encoder values in [minEncoder, maxEncoder].
+					Blocks are skipped by the index, the result is the range from the first to the last matching row.
+					@return false if no row matches.
+				*/
+				bool findRowsByEncoder(int32_t minEncoder, int32_t maxEncoder, size_t& r0, size_t& r1) const
+				{
+					r0 = r1 = 0;
+					bool found = false;
+					for (size_t b = 0; b < numBlocks(); b++)
+					{
+						const PcsBlockHeader& bh = blockHeader(b);
+						if (bh.maxEncoder < minEncoder || bh.minEncoder > maxEncoder)
+							continue;
+						// row range from the block index, the row counts of the block header are not trusted
+						size_t first = b * m_hdr.rowsPerBlock;
+						size_t n = std::min<size_t>(m_hdr.rowsPerBlock, m_numRows - first);
+						const int32_t* enc = (const int32_t*)(block(b) + m_hdr.sectionOffset[PCS_SECTION_ENCODER]);
+						for (size_t i = 0; i < n; i++)
+						{
+							if (enc[i] < minEncoder || enc[i] > maxEncoder)
+								continue;
+							if (!found)
+								r0 = first + i;
+							r1 = first + i + 1;
+							found = true;
+						}
+					}
+					return found;
+				}
+
+				/** Returns the first row with timestamp >= ts, rows must be appended in timestamp order.
+					Returns numRows() if all rows are older.
+				*/
+				size_t findRowByTimestamp(uint64_t ts) const
+				{
+					size_t lo = 0, hi = numBlocks();
+					while (lo < hi)
+					{
+						size_t mid = (lo + hi) / 2;
+						if (blockHeader(mid).maxTimestamp < ts)
+							lo = mid + 1;
+						else
+							hi = mid;
+					}
+					if (lo == numBlocks())
+						return m_numRows;
+					const uint64_t* t = (const uint64_t*)(block(lo) + m_hdr.sectionOffset[PCS_SECTION_TIMESTAMPS]);
+					size_t first = lo * m_hdr.rowsPerBlock;
+					size_t n = std::min<size_t>(m_hdr.rowsPerBlock, m_numRows - first);
+					return first + size_t(std::lower_bound(t, t + n, ts) - t);
+				}
+
+				static PointCloudStoreReader::Ptr createShared(const std::string& fileName)
+				{
+					return std::make_shared<PointCloudStoreReader>(fileName);
+				}
+
+			private:
+				PointCloudStoreReader(const PointCloudStoreReader&);
+				PointCloudStoreReader& operator=(const PointCloudStoreReader&);
+
+				uint64_t headerRows() const
+				{
+					// the header is read from the file, not from the mapping, so a header written after the mapping was created is seen
+					PcsFileHeader hdr;
+					std::unique_ptr<FILE, int(*)(FILE*)> f(fopen(m_fileName.c_str(), "rb"), fclose);
+					if (!f || fread(&hdr, sizeof(hdr), 1, f.get()) != 1 || hdr.magic != PCS_FILE_MAGIC)
+						throw std::runtime_error("PointCloudStore: can not read header " + m_fileName);
+					return hdr.numRows;
+				}
+
+				// rows of the complete blocks within the current mapping, computed by division so a corrupt row count can not overflow
+				uint64_t mappedRows() const
+				{
+					if (m_map->size() < m_hdr.dataOffset)
+						return 0;
+					return (m_map->size() - m_hdr.dataOffset) / m_hdr.blockSize * m_hdr.rowsPerBlock;
+				}
+
+				void updateRows()
+				{
+					const PcsFileHeader* hdr = (const PcsFileHeader*)m_map->data();
+					uint64_t numRows = std::max<uint64_t>(hdr->numRows, m_numRows);
+					// rows of blocks beyond the mapped size are not visible
+					m_numRows = size_t(std::min(numRows, mappedRows()));
+				}
+
+				const uint8_t* block(size_t b) const
+				{
+					return m_map->data() + m_hdr.dataOffset + b * m_hdr.blockSize;
+				}
+
+				void checkRange(size_t r0, size_t r1) const
+				{
+					if (r0 > r1 || r1 > m_numRows)
+						throw std::out_of_range("PointCloudStore: row range out of range");
+				}
+
+				// zero copy view of n rows starting at r0, all rows must be in one block
+				void view(size_t r0, size_t n, PointCloud& pc, const uint64_t*& ts, const int32_t*& enc) const
+				{
+					size_t b = r0 / m_hdr.rowsPerBlock;
+					size_t i = r0 % m_hdr.rowsPerBlock;
+					uint8_t* blk = (uint8_t*)block(b);
+					reset(pc);
+					pc.m_mapping = m_map;
+					uint8_t* p = blk + m_hdr.sectionOffset[PCS_SECTION_POINTS] + i * m_rowBytes[PCS_SECTION_POINTS];
+					pc.points.create(unsigned(n), m_hdr.width, pointFormat(), p, n * m_rowBytes[PCS_SECTION_POINTS], m_rowBytes[PCS_SECTION_POINTS]);
+					if (hasNormals())
+					{
+						p = blk + m_hdr.sectionOffset[PCS_SECTION_NORMALS] + i * m_rowBytes[PCS_SECTION_NORMALS];
+						pc.normals.create(unsigned(n), m_hdr.width, (cx_pixel_format)m_hdr.normalFormat, p, n * m_rowBytes[PCS_SECTION_NORMALS], m_rowBytes[PCS_SECTION_NORMALS]);
+					}
+					if (hasColors())
+					{
+						p = blk + m_hdr.sectionOffset[PCS_SECTION_COLORS] + i * m_rowBytes[PCS_SECTION_COLORS];
+						pc.colors.create(unsigned(n), m_hdr.width, (cx_pixel_format)m_hdr.colorFormat, p, n * m_rowBytes[PCS_SECTION_COLORS], m_rowBytes[PCS_SECTION_COLORS]);
+					}
+					ts = (const uint64_t*)(blk + m_hdr.sectionOffset[PCS_SECTION_TIMESTAMPS]) + i;
+					enc = (const int32_t*)(blk + m_hdr.sectionOffset[PCS_SECTION_ENCODER]) + i;
+				}
+
+				// PointCloud has no move assignment and the copy assignment of Image does not free an owned buffer, so the images are freed explicitly
+				void reset(PointCloud& pc) const
+				{
+					pc.points.free();
+					pc.normals.free();
+					pc.colors.free();
+					pc.m_mapping.reset();
+					pc.scale = scale();
+					pc.offset = offset();
+				}
+
+				static void copyInfo(const uint64_t* ts, const int32_t* enc, size_t n, uint64_t* dstTs, int32_t* dstEnc)
+				{
+					if (dstTs && n)
+						memcpy(dstTs, ts, n * sizeof(uint64_t));
+					if (dstEnc && n)
+						memcpy(dstEnc, enc, n * sizeof(int32_t));
+				}
+
+				std::string m_fileName;
+				MappedFile::Ptr m_map;			// current mapping, older mappings are kept alive by the point clouds referencing them
+				PcsFileHeader m_hdr;
+				size_t m_rowBytes[PCS_NUM_SECTIONS];
+				size_t m_numRows;
+			};
+
+			//! @} cx_wrapper_cpp
+		}
+	}
+}
+
+#endif	// CX_C3D_POINTCLOUDSTORE_H_INCLUDED
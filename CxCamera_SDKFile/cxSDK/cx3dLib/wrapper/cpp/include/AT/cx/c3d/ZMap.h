@@ -21,11 +21,18 @@ POSSIBILITY OF SUCH DAMAGE.
 #ifndef CX_C3D_ZMAP_H_INCLUDED
 #define CX_C3D_ZMAP_H_INCLUDED
 
+#include <vector>
+#include <functional>
+#include <cmath>
+#include <stdexcept>
 #include "cx_3d_metric.h"
 #include "cx_3d_calib.h"
 #include "AT/cx/base.h"
+#include "AT/cx/ThreadPool.h"
+#include "AT/cx/ImagePool.h"
 #include "AT/cx/c3d/Calib.h"
 #include "AT/cx/c3d/PointCloud.h"
+#include "AT/cx/c3d/ZMapFile.h"
 
 namespace AT {
 	namespace cx {
@@ -36,50 +43,127 @@ namespace AT {
 			/** ZMap class represents a telecentric projection of 3D Data onto XY plane. 
 				It contains the image and the scaling parameters needed to convert a pixel of the ZMap into real coordinates.
 				It supports two types of ZMap pixel formats: CX_PF_COORD3D_C32f and CX_PF_COORD3D_C16. The ZMap is based on cx::Image class.
+				The native file format (*.zmap) stores the image together with scale, offset and the invalid data value, see \ref ZMapFileHeader.
 			*/
 			class ZMap
 			{
 			public:
 				typedef std::shared_ptr<ZMap> Ptr;
 
-				ZMap() : img(0, 0, CX_PF_COORD3D_C32f), scale(1.0f, 1.0f, 1.0f), offset(0.0f, 0.0f, 0.0f) {}
-				ZMap(unsigned int h, unsigned int w, cx_pixel_format pf = CX_PF_COORD3D_C32f, const cx::Point3f s = cx::Point3f(1.0f, 1.0f, 1.0f), const cx::Point3f o = cx::Point3f(0.0f, 0.0f, 0.0f)) : img(h, w, pf), scale(s), offset(o) {}
+				ZMap() : img(0, 0, CX_PF_COORD3D_C32f), scale(1.0f, 1.0f, 1.0f), offset(0.0f, 0.0f, 0.0f), ivd(NAN) {}
+				ZMap(unsigned int h, unsigned int w, cx_pixel_format pf = CX_PF_COORD3D_C32f, const cx::Point3f s = cx::Point3f(1.0f, 1.0f, 1.0f), const cx::Point3f o = cx::Point3f(0.0f, 0.0f, 0.0f)) : img(h, w, pf), scale(s), offset(o), ivd(NAN) {}
 
 				void create(unsigned int h, unsigned int w, cx_pixel_format pf = CX_PF_COORD3D_C32f, const cx::Point3f s = cx::Point3f(1.0f, 1.0f, 1.0f), const cx::Point3f o = cx::Point3f(0.0f, 0.0f, 0.0f))
 				{
+					if (m_mapping || m_pooled)
+					{
+						img = cx::Image();
+						m_mapping.reset();
+						m_pooled.reset();
+					}
 					img.create(h, w, pf);
 					scale = s;
 					offset = o;
 				}
 
-				/** Save ZMap image
-					
-					\note
-					The current implementation does not support saving of scale and offset.
+				/** Creates the image with a buffer of pool, e.g. for a new ZMap per frame without allocation.
+					A pooled image of the same size and pixel format is kept. The buffer goes back to the pool when the ZMap and its copies are destroyed,
+					the image is created again or a file is loaded.
+				*/
+				void create(unsigned int h, unsigned int w, cx_pixel_format pf, ImagePool& pool, const cx::Point3f s = cx::Point3f(1.0f, 1.0f, 1.0f), const cx::Point3f o = cx::Point3f(0.0f, 0.0f, 0.0f))
+				{
+					if (!m_pooled || img.height() != h || img.width() != w || img.pixelFormat() != pf)
+					{
+						img = cx::Image();
+						m_mapping.reset();
+						m_pooled = pool.acquire(h, w, pf, img);
+					}
+					scale = s;
+					offset = o;
+				}
+
+				/** Save ZMap
+					Files with extension .zmap are written in the native format including scale, offset and ivd, see \ref saveZMapFile.
+					Files with extension .ply are written as binary point cloud in world coordinates, pixels with value ivd are skipped, see \ref PlyWriter.
+					For other extensions only the image is saved.
+					@param fileName		file name
+					@param compression	compression of the native format, ignored for other formats.
 				*/
-				void save(const std::string& fileName) const
+				void save(const std::string& fileName, zmap_compression compression = ZMAP_COMPRESSION_NONE) const
 				{
-					img.save(fileName);
+					if (isZMapFileName(fileName))
+						saveZMapFile(fileName, img, scale, offset, ivd, compression);
+					else if (isPlyFileName(fileName))
+						savePly(fileName, img, scale, offset, ivd);
+					else
+						img.save(fileName);
 				}
 
-				/** Load ZMap image
-					
-					\note
-					The current implementation does not support loading of scale and offset.
+				/** Load ZMap
+					Files with extension .zmap are read in the native format including scale, offset and ivd.
+					For other extensions only the image is loaded, scale, offset and ivd are not changed.
 				*/
 				void load(const std::string& fileName)
 				{
-					img.load(fileName);
+					cx::Image tmp;
+					if (isZMapFileName(fileName))
+					{
+						cx::Point3f s, o;
+						float v;
+						loadZMapFile(fileName, tmp, s, o, v);
+						scale = s;
+						offset = o;
+						ivd = v;
+					}
+					else
+						tmp.load(fileName);
+					img = std::move(tmp);
+					m_mapping.reset();
+					m_pooled.reset();
+				}
+
+				/** Load ZMap in native format (*.zmap) by memory mapping the file.
+					Uncompressed files are not copied, the image references the mapped file and pages are loaded on first access.
+					The mapping is private, changing the image does not modify the file. Compressed files are decompressed.
+				*/
+				void loadMapped(const std::string& fileName)
+				{
+					cx::Image tmp;
+					cx::Point3f s, o;
+					float v;
+					MappedFile::Ptr mapping = mapZMapFile(fileName, tmp, s, o, v);
+					img = std::move(tmp);
+					m_mapping = mapping;
+					m_pooled.reset();
+					scale = s;
+					offset = o;
+					ivd = v;
 				}
 
+				//! Returns true if the image references a memory mapped file.
+				bool isMapped() const { return m_mapping != nullptr; }
+
 				static ZMap::Ptr makeShared(unsigned int h, unsigned int w, cx_pixel_format pf = CX_PF_COORD3D_C32f, const cx::Point3f s = cx::Point3f(1.0f, 1.0f, 1.0f), const cx::Point3f o = cx::Point3f(0.0f, 0.0f, 0.0f))
 				{
 					return std::make_shared<ZMap>(h, w, pf, s, o);
 				}
 
+				//! Creates a ZMap with a buffer of pool, see \ref create.
+				static ZMap::Ptr makeShared(unsigned int h, unsigned int w, cx_pixel_format pf, ImagePool& pool, const cx::Point3f s = cx::Point3f(1.0f, 1.0f, 1.0f), const cx::Point3f o = cx::Point3f(0.0f, 0.0f, 0.0f))
+				{
+					ZMap::Ptr zMap = std::make_shared<ZMap>();
+					zMap->create(h, w, pf, pool, s, o);
+					return zMap;
+				}
+
 				cx::Image img;			//!< ZMap image, we support two types of ZMaps, CX_PF_COORD3D_C32f and CX_PF_COORD3D_C16.
 				cx::Point3f scale;		//!< scaling factor for conversion into real world coordinates
 				cx::Point3f offset;		//!< offset for conversion into real world coordinates
+				float ivd;				//!< invalid data value of z, stored in the native file format. NaN if not used.
+
+			private:
+				MappedFile::Ptr m_mapping;	//!< keeps the file mapped while img references it
+				std::shared_ptr<void> m_pooled;	//!< returns the buffer of img to the ImagePool when released
 			};
 
 			typedef ZMap::Ptr ZMapPtr;
@@ -89,6 +173,10 @@ namespace AT {
 				@param rangeMap	the sensor range image
 				@param zMap		the ZMap to calculate. The image must be initialized with the desired resolution and pixelformat. The scale and offset must be set according to the desired sampling, see also \ref cx_3d_range2rectifiedC.
 				@param flags	use CX_3D_METRIC_NEAREST_POINT | CX_3D_METRIC_FILL_HOLES or CX_3D_METRIC_INTERP_IDW, optional you can also add CX_3D_METRIC_MARK_Z_INVALID_DATA
+
+				\note
+				The function sets CX_3D_PARAM_METRIC_O and CX_3D_PARAM_METRIC_S of the calibration on every call, which may invalidate the LUT cache.
+				For continuous processing use \ref MetricContext, it sets up the calibration and the cache only once.
 			*/
 			inline void calculateZMap(cx::c3d::Calib& cal, const cx::Image& rangeMap, cx::c3d::ZMap& zMap, int flags = CX_3D_METRIC_MARK_Z_INVALID_DATA | CX_3D_METRIC_INTERP_IDW)
 			{
@@ -106,49 +194,231 @@ namespace AT {
 				cx::checkOk(cx_3d_rangeWithChunk2rectifiedC(cal, rangeMap, xs, ys, encoderValue, zMap.img, flags));
 			}
 
-			/** Calculate PointCloud points from ZMap.
-				Function does not alter pc.normals nor pc.colors.
-				PointCloud will be created with type CX_PF_COORD3D_ABC32f.
-			*/
-			inline void convertToPointCloud(const cx::c3d::ZMap& zmap, cx::c3d::PointCloud& pc, float ivd = 0.0f)
-			{	
-				pc.points.create(zmap.img.height(), zmap.img.width(), CX_PF_COORD3D_ABC32f);
-				if (zmap.img.pixelFormat() == CX_PF_COORD3D_C32f)
+			//! Output layout of \ref convertToPointCloud
+			enum pointcloud_layout
+			{
+				POINTCLOUD_ORGANIZED = 0,	//!< point cloud has the size of the ZMap, invalid pixels keep the invalid value in z
+				POINTCLOUD_COMPACTED = 1	//!< point cloud has 1 row with the valid points only, in row major order of the ZMap
+			};
+
+			namespace detail {
+				// number of valid pixels of a ZMap row, NaN and the invalid data value are invalid
+				template<typename T>
+				inline size_t zmapRowCount(const T* z, unsigned n, float ivd)
 				{
-					for (unsigned r = 0; r < zmap.img.height(); r++)
+					size_t count = 0;
+					for (unsigned c = 0; c < n; c++)
 					{
-						const float* zMapRowPtr = zmap.img.row<float>(r);
-						cx::Point3f* pcRowPtr = pc.points.row<cx::Point3f>(r);
-						for (unsigned c = 0; c < zmap.img.width(); c++)
-						{
-							float z = zMapRowPtr[c];
-							cx::Point3f p;
-							p.x = float(c) * zmap.scale.x + zmap.offset.x;
-							p.y = float(r) * zmap.scale.y + zmap.offset.y;
-							p.z = (z == ivd) ? z : z * zmap.scale.z + zmap.offset.z;
-							pcRowPtr[c] = p;
-						}
+						float v = float(z[c]);
+						count += (!std::isnan(v) && v != ivd) ? 1 : 0;
 					}
+					return count;
 				}
-				else if (zmap.img.pixelFormat() == CX_PF_COORD3D_C16)
+
+				// z row as float, C32f rows are used directly, C16 rows are converted into tmp
+				inline const float* zmapRowFloat(const cx::Image& img, unsigned r, float* tmp)
 				{
-					for (unsigned r = 0; r < zmap.img.height(); r++)
+					if (img.pixelFormat() == CX_PF_COORD3D_C32f)
+						return img.row<float>(r);
+					const uint16_t* src = img.row<uint16_t>(r);
+					for (unsigned c = 0; c < img.width(); c++)
+						tmp[c] = float(src[c]);
+					return tmp;
+				}
+
+#if defined(CX_C3D_POINTCLOUD_SSE2)
+				// store 4 points interleaved as x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+				inline void storePoints4(__m128 vx, __m128 vy, __m128 vz, float* dst)
+				{
+					__m128 xy0 = _mm_unpacklo_ps(vx, vy);
+					__m128 xy1 = _mm_unpackhi_ps(vx, vy);
+					__m128 t = _mm_shuffle_ps(vz, vx, _MM_SHUFFLE(1, 1, 0, 0));
+					__m128 a = _mm_shuffle_ps(vy, vz, _MM_SHUFFLE(1, 1, 1, 1));
+					__m128 d = _mm_shuffle_ps(vz, xy1, _MM_SHUFFLE(2, 2, 2, 2));
+					__m128 e = _mm_shuffle_ps(xy1, vz, _MM_SHUFFLE(3, 3, 3, 3));
+					_mm_storeu_ps(dst, _mm_shuffle_ps(xy0, t, _MM_SHUFFLE(2, 0, 1, 0)));
+					_mm_storeu_ps(dst + 4, _mm_shuffle_ps(a, xy1, _MM_SHUFFLE(1, 0, 2, 0)));
+					_mm_storeu_ps(dst + 8, _mm_shuffle_ps(d, e, _MM_SHUFFLE(2, 0, 2, 0)));
+				}
+#endif
+
+				// write the points of 1 row, xs holds the precomputed x coordinates of all columns. Invalid pixels keep the invalid data value in z.
+				inline void zmapRowToPoints(const float* z, const float* xs, unsigned n, float y, float ivd, float sz, float oz, float* dst)
+				{
+					unsigned c = 0;
+#if defined(CX_C3D_POINTCLOUD_SSE2)
+					const __m128 vy = _mm_set1_ps(y);
+					const __m128 vivd = _mm_set1_ps(ivd);
+					const __m128 vsz = _mm_set1_ps(sz);
+					const __m128 voz = _mm_set1_ps(oz);
+					for (; c + 4 <= n; c += 4, dst += 12)
+					{
+						__m128 vz = _mm_loadu_ps(z + c);
+						__m128 isIvd = _mm_cmpeq_ps(vz, vivd);
+						vz = _mm_or_ps(_mm_and_ps(isIvd, vz), _mm_andnot_ps(isIvd, _mm_add_ps(_mm_mul_ps(vz, vsz), voz)));
+						storePoints4(_mm_loadu_ps(xs + c), vy, vz, dst);
+					}
+#endif
+					for (; c < n; c++, dst += 3)
+					{
+						dst[0] = xs[c];
+						dst[1] = y;
+						dst[2] = (z[c] == ivd) ? z[c] : z[c] * sz + oz;
+					}
+				}
+
+				// write the valid points of 1 row and optional their pixel index, returns the number of points written
+				inline size_t zmapRowToValidPoints(const float* z, const float* xs, unsigned n, float y, float ivd, float sz, float oz, float* dst, uint32_t* idx, uint32_t idx0)
+				{
+					size_t k = 0;
+					unsigned c = 0;
+#if defined(CX_C3D_POINTCLOUD_SSE2)
+					const __m128 vy = _mm_set1_ps(y);
+					const __m128 vivd = _mm_set1_ps(ivd);
+					const __m128 vsz = _mm_set1_ps(sz);
+					const __m128 voz = _mm_set1_ps(oz);
+					for (; c + 4 <= n; c += 4)
 					{
-						const uint16_t* zMapRowPtr = zmap.img.row<uint16_t>(r);
-						cx::Point3f* pcRowPtr = pc.points.row<cx::Point3f>(r);
-						for (unsigned c = 0; c < zmap.img.width(); c++)
+						__m128 vz = _mm_loadu_ps(z + c);
+						int mask = _mm_movemask_ps(_mm_and_ps(_mm_cmpord_ps(vz, vz), _mm_cmpneq_ps(vz, vivd)));
+						if (mask == 0)
+							continue;
+						if (mask == 0xF)
+						{
+							// all valid, the common case inside of objects
+							storePoints4(_mm_loadu_ps(xs + c), vy, _mm_add_ps(_mm_mul_ps(vz, vsz), voz), dst + 3 * k);
+							if (idx)
+								for (unsigned i = 0; i < 4; i++)
+									idx[k + i] = idx0 + c + i;
+							k += 4;
+							continue;
+						}
+						for (unsigned i = 0; i < 4; i++)
 						{
-							float z = zMapRowPtr[c];
-							cx::Point3f p;
-							p.x = float(c) * zmap.scale.x + zmap.offset.x;
-							p.y = float(r) * zmap.scale.y + zmap.offset.y;
-							p.z = (z == ivd) ? z : z * zmap.scale.z + zmap.offset.z;
-							pcRowPtr[c] = p;
+							if (!(mask & (1 << i)))
+								continue;
+							dst[3 * k] = xs[c + i];
+							dst[3 * k + 1] = y;
+							dst[3 * k + 2] = z[c + i] * sz + oz;
+							if (idx)
+								idx[k] = idx0 + c + i;
+							k++;
 						}
 					}
+#endif
+					for (; c < n; c++)
+					{
+						if (std::isnan(z[c]) || z[c] == ivd)
+							continue;
+						dst[3 * k] = xs[c];
+						dst[3 * k + 1] = y;
+						dst[3 * k + 2] = z[c] * sz + oz;
+						if (idx)
+							idx[k] = idx0 + c;
+						k++;
+					}
+					return k;
 				}
-				else
+			}
+
+			/** Calculate PointCloud points from ZMap.
+				Function does not alter pc.normals nor pc.colors.
+				PointCloud will be created with type CX_PF_COORD3D_ABC32f, the points are in world coordinates, pc.scale and pc.offset are set to identity.
+				Supported ZMap pixel formats: CX_PF_COORD3D_C32f and CX_PF_COORD3D_C16.
+				The x coordinates are computed once for all columns, the y coordinate once per row.
+				@param zmap		the ZMap to convert.
+				@param pc		the output point cloud.
+				@param ivd		invalid data value of the ZMap. In the organized layout invalid pixels keep this value in z, in the compacted layout they are removed together with NaN values.
+				@param layout	organized (same size as ZMap) or compacted (1 row with the valid points only).
+				@param indexMap	optional for the compacted layout, returns for every point the pixel index row*width+column in the ZMap.
+				@param pool		optional thread pool, rows are processed in parallel bands.
+				@return number of points written.
+			*/
+			inline size_t convertToPointCloud(const cx::c3d::ZMap& zmap, cx::c3d::PointCloud& pc, float ivd, pointcloud_layout layout, std::vector<uint32_t>* indexMap = nullptr, ThreadPool* pool = nullptr)
+			{
+				cx_pixel_format pf = zmap.img.pixelFormat();
+				if (pf != CX_PF_COORD3D_C32f && pf != CX_PF_COORD3D_C16)
 					throw std::runtime_error("unsupported pixel format");
+				unsigned w = zmap.img.width();
+				unsigned h = zmap.img.height();
+
+				std::vector<float> xs(w);
+				for (unsigned c = 0; c < w; c++)
+					xs[c] = float(c) * zmap.scale.x + zmap.offset.x;
+				pc.scale = cx::Point3f(1.0f, 1.0f, 1.0f);
+				pc.offset = cx::Point3f(0.0f, 0.0f, 0.0f);
+
+				auto run = [&](const std::function<void(size_t, size_t)>& band) {
+					if (pool && pool->numThreads() > 1)
+						pool->parallelForRange(h, 16, band);
+					else
+						band(0, h);
+				};
+
+				if (layout == POINTCLOUD_ORGANIZED)
+				{
+					if (indexMap)
+						indexMap->clear();
+					pc.points.create(h, w, CX_PF_COORD3D_ABC32f);
+					run([&](size_t r0, size_t r1) {
+						std::vector<float> tmp(w);
+						for (size_t r = r0; r < r1; r++)
+						{
+							float y = float(r) * zmap.scale.y + zmap.offset.y;
+							detail::zmapRowToPoints(detail::zmapRowFloat(zmap.img, unsigned(r), tmp.data()), xs.data(), w, y, ivd, zmap.scale.z, zmap.offset.z, pc.points.row<float>(unsigned(r)));
+						}
+					});
+					return size_t(w) * h;
+				}
+
+				// count valid points per row, the prefix sum gives the output position of each row
+				std::vector<size_t> rowStart(size_t(h) + 1, 0);
+				run([&](size_t r0, size_t r1) {
+					for (size_t r = r0; r < r1; r++)
+					{
+						if (pf == CX_PF_COORD3D_C16)
+							rowStart[r + 1] = detail::zmapRowCount(zmap.img.row<uint16_t>(unsigned(r)), w, ivd);
+						else
+							rowStart[r + 1] = detail::zmapRowCount(zmap.img.row<float>(unsigned(r)), w, ivd);
+					}
+				});
+				for (unsigned r = 0; r < h; r++)
+					rowStart[r + 1] += rowStart[r];
+				size_t n = rowStart[h];
+
+				pc.points.create(n ? 1 : 0, unsigned(n), CX_PF_COORD3D_ABC32f);
+				if (indexMap)
+					indexMap->resize(n);
+				if (n == 0)
+					return 0;
+				float* dst = pc.points.row<float>(0);
+				uint32_t* idx = indexMap ? indexMap->data() : nullptr;
+				run([&](size_t r0, size_t r1) {
+					std::vector<float> tmp(w);
+					for (size_t r = r0; r < r1; r++)
+					{
+						if (rowStart[r + 1] == rowStart[r])
+							continue;
+						float y = float(r) * zmap.scale.y + zmap.offset.y;
+						detail::zmapRowToValidPoints(detail::zmapRowFloat(zmap.img, unsigned(r), tmp.data()), xs.data(), w, y, ivd, zmap.scale.z, zmap.offset.z,
+							dst + 3 * rowStart[r], idx ? idx + rowStart[r] : nullptr, uint32_t(r * w));
+					}
+				});
+				return n;
+			}
+
+			/** Calculate PointCloud points from ZMap.
+				Function does not alter pc.normals nor pc.colors.
+				PointCloud will be created with type CX_PF_COORD3D_ABC32f with the size of the ZMap, see \ref convertToPointCloud for the compacted layout.
+				The points are in world coordinates, pc.scale and pc.offset are not changed by this overload.
+			*/
+			inline void convertToPointCloud(const cx::c3d::ZMap& zmap, cx::c3d::PointCloud& pc, float ivd = 0.0f)
+			{
+				cx::Point3f scale = pc.scale;
+				cx::Point3f offset = pc.offset;
+				convertToPointCloud(zmap, pc, ivd, POINTCLOUD_ORGANIZED);
+				pc.scale = scale;
+				pc.offset = offset;
 			}
 
 			//! @} cx_wrapper_cpp
@@ -0,0 +1,325 @@
+/**
+@file : ZMapFile.h
+@package : cx_3d library
+@brief C++ native Z-Map file format with scale, offset and invalid data value
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef CX_C3D_ZMAPFILE_H_INCLUDED
+#define CX_C3D_ZMAPFILE_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "AT/cx/base.h"
+#include "AT/cx/Image.h"
+#include "AT/cx/MappedFile.h"
+
+// zstd compression is optional, define CX_C3D_WITH_ZSTD and link libzstd to enable it
+#if defined(CX_C3D_WITH_ZSTD)
+	#include <zstd.h>
+#endif
+
+namespace AT {
+	namespace cx {
+		namespace c3d {
+			//! @addtogroup cx_wrapper_cpp
+			//! @{
+
+			/** Native Z-Map file format (*.zmap), all values are stored in little endian byte order.
+
+				The file starts with ZMapFileHeader (128 bytes).
+				Uncompressed files store the rows at ZMapFileHeader::dataOffset, each row padded to ZMAP_FILE_ALIGN bytes.
+				The file can be memory mapped and used as image without copying, see \ref mapZMapFile.
+				Compressed files store a block table at ZMapFileHeader::dataOffset with one ZMapFileBlock per block of rowsPerBlock rows,
+				followed by the compressed blocks. Compressed rows are not padded.
+			*/
+			enum zmap_file_format
+			{
+				ZMAP_FILE_MAGIC = 0x50414D5A,		//!< "ZMAP"
+				ZMAP_FILE_VERSION = 1,
+				ZMAP_FILE_ALIGN = 64				//!< row alignment of uncompressed files, suitable for SIMD loads
+			};
+
+			//! Compression of native Z-Map files
+			enum zmap_compression
+			{
+				ZMAP_COMPRESSION_NONE = 0,
+				ZMAP_COMPRESSION_ZSTD = 1			//!< requires CX_C3D_WITH_ZSTD
+			};
+
+			struct ZMapFileHeader
+			{
+				uint32_t magic;
+				uint32_t version;
+				uint32_t width;
+				uint32_t height;
+				uint32_t pixelFormat;		//!< CX_PF_COORD3D_C32f or CX_PF_COORD3D_C16
+				uint32_t compression;		//!< \ref zmap_compression
+				float scale[3];
+				float offset[3];
+				float ivd;					//!< invalid data value of z
+				uint32_t rowsPerBlock;		//!< rows per compressed block
+				uint64_t linePitch;			//!< bytes per row in the file
+				uint64_t dataOffset;		//!< offset of the first row or of the block table
+				uint64_t dataSize;			//!< size of the data section starting at dataOffset
+				uint8_t reserved[48];
+			};
+
+			struct ZMapFileBlock
+			{
+				uint64_t offset;			//!< offset of the compressed block in the file
+				uint64_t size;				//!< compressed size in bytes
+			};
+
+			static_assert(sizeof(ZMapFileHeader) == 128, "ZMapFileHeader layout");
+			static_assert(sizeof(ZMapFileBlock) == 16, "ZMapFileBlock layout");
+
+			//! Returns true if fileName has the extension of the native Z-Map format (*.zmap).
+			inline bool isZMapFileName(const std::string& fileName)
+			{
+				size_t pos = fileName.find_last_of('.');
+				if (pos == std::string::npos)
+					return false;
+				std::string ext = fileName.substr(pos + 1);
+				std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return char(tolower((unsigned char)c)); });
+				return ext == "zmap";
+			}
+
+			inline unsigned zmapBytesPerPixel(unsigned pf)
+			{
+				if (pf == CX_PF_COORD3D_C32f)
+					return 4;
+				if (pf == CX_PF_COORD3D_C16)
+					return 2;
+				throw std::runtime_error("ZMapFile: unsupported pixel format");
+			}
+
+			/** Write Z-Map image with scale, offset and invalid data value in the native format.
+				@param fileName			file name, typically with extension .zmap
+				@param img				Z-Map image, CX_PF_COORD3D_C32f or CX_PF_COORD3D_C16
+				@param compression		\ref zmap_compression
+				@param rowsPerBlock		rows per compressed block, blocks can be decompressed independently
+				@param level			compression level
+			*/
+			inline void saveZMapFile(const std::string& fileName, const cx::Image& img, const cx::Point3f& scale, const cx::Point3f& offset, float ivd,
+				zmap_compression compression = ZMAP_COMPRESSION_NONE, unsigned rowsPerBlock = 64, int level = 1)
+			{
+				unsigned bpp = zmapBytesPerPixel(img.pixelFormat());
+#if !defined(CX_C3D_WITH_ZSTD)
+				(void)level;
+				if (compression != ZMAP_COMPRESSION_NONE)
+					throw std::runtime_error("ZMapFile: compression not supported, build with CX_C3D_WITH_ZSTD");
+#endif
+				ZMapFileHeader hdr;
+				memset(&hdr, 0, sizeof(hdr));
+				hdr.magic = ZMAP_FILE_MAGIC;
+				hdr.version = ZMAP_FILE_VERSION;
+				hdr.width = img.width();
+				hdr.height = img.height();
+				hdr.pixelFormat = img.pixelFormat();
+				hdr.compression = compression;
+				hdr.scale[0] = scale.x; hdr.scale[1] = scale.y; hdr.scale[2] = scale.z;
+				hdr.offset[0] = offset.x; hdr.offset[1] = offset.y; hdr.offset[2] = offset.z;
+				hdr.ivd = ivd;
+				hdr.rowsPerBlock = std::max(1u, std::min(rowsPerBlock, img.height()));
+				hdr.dataOffset = sizeof(ZMapFileHeader);
+				size_t rowBytes = size_t(img.width()) * bpp;
+
+				std::unique_ptr<FILE, int(*)(FILE*)> f(fopen(fileName.c_str(), "wb"), fclose);
+				if (!f)
+					throw std::runtime_error("ZMapFile: can not create " + fileName);
+				setvbuf(f.get(), NULL, _IOFBF, 1 << 20);
+
+				if (compression == ZMAP_COMPRESSION_NONE)
+				{
+					hdr.linePitch = (rowBytes + ZMAP_FILE_ALIGN - 1) / ZMAP_FILE_ALIGN * ZMAP_FILE_ALIGN;
+					hdr.dataSize = hdr.linePitch * img.height();
+					bool ok = fwrite(&hdr, sizeof(hdr), 1, f.get()) == 1;
+					if (img.linePitch() == hdr.linePitch)
+						ok = ok && (hdr.dataSize == 0 || fwrite(img.data(), (size_t)hdr.dataSize, 1, f.get()) == 1);
+					else
+					{
+						static const uint8_t pad[ZMAP_FILE_ALIGN] = {};
+						size_t padBytes = size_t(hdr.linePitch - rowBytes);
+						for (unsigned r = 0; ok && r < img.height(); r++)
+						{
+							ok = fwrite(img.row<uint8_t>(r), rowBytes, 1, f.get()) == 1;
+							ok = ok && (padBytes == 0 || fwrite(pad, padBytes, 1, f.get()) == 1);
+						}
+					}
+					if (!ok)
+						throw std::runtime_error("ZMapFile: write error " + fileName);
+				}
+#if defined(CX_C3D_WITH_ZSTD)
+				else if (compression == ZMAP_COMPRESSION_ZSTD)
+				{
+					hdr.linePitch = rowBytes;
+					size_t numBlocks = (size_t(img.height()) + hdr.rowsPerBlock - 1) / hdr.rowsPerBlock;
+					std::vector<ZMapFileBlock> table(numBlocks);
+					uint64_t pos = hdr.dataOffset + numBlocks * sizeof(ZMapFileBlock);
+					// header and table are rewritten when the block sizes are known
+					bool ok = fwrite(&hdr, sizeof(hdr), 1, f.get()) == 1;
+					ok = ok && (numBlocks == 0 || fwrite(table.data(), numBlocks * sizeof(ZMapFileBlock), 1, f.get()) == 1);
+
+					size_t blockBytes = rowBytes * hdr.rowsPerBlock;
+					std::vector<uint8_t> raw(blockBytes);
+					std::vector<uint8_t> packed(ZSTD_compressBound(blockBytes));
+					std::unique_ptr<ZSTD_CCtx, size_t(*)(ZSTD_CCtx*)> cctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+					for (size_t b = 0; ok && b < numBlocks; b++)
+					{
+						unsigned r0 = unsigned(b * hdr.rowsPerBlock);
+						unsigned r1 = std::min(img.height(), r0 + hdr.rowsPerBlock);
+						for (unsigned r = r0; r < r1; r++)
+							memcpy(raw.data() + (r - r0) * rowBytes, img.row<uint8_t>(r), rowBytes);
+						size_t sz = ZSTD_compressCCtx(cctx.get(), packed.data(), packed.size(), raw.data(), (r1 - r0) * rowBytes, level);
+						if (ZSTD_isError(sz))
+							throw std::runtime_error(std::string("ZMapFile: compression failed, ") + ZSTD_getErrorName(sz));
+						table[b].offset = pos;
+						table[b].size = sz;
+						pos += sz;
+						ok = fwrite(packed.data(), sz, 1, f.get()) == 1;
+					}
+					hdr.dataSize = pos - hdr.dataOffset;
+					ok = ok && fseek(f.get(), 0, SEEK_SET) == 0;
+					ok = ok && fwrite(&hdr, sizeof(hdr), 1, f.get()) == 1;
+					ok = ok && (numBlocks == 0 || fwrite(table.data(), numBlocks * sizeof(ZMapFileBlock), 1, f.get()) == 1);
+					if (!ok)
+						throw std::runtime_error("ZMapFile: write error " + fileName);
+				}
+#endif
+				else
+					throw std::runtime_error("ZMapFile: unsupported compression");
+
+				if (fclose(f.release()) != 0)
+					throw std::runtime_error("ZMapFile: write error " + fileName);
+			}
+
+			/* checks the header against the file size, returns the header
+				All sizes are checked without overflow: the image must fit into size_t, uncompressed rows into the data section,
+				compressed rows have no padding (linePitch == width * bytes per pixel), so the decompressed rows fit into the image rows.
+			*/
+			inline ZMapFileHeader checkZMapFileHeader(const uint8_t* data, size_t size, const std::string& fileName)
+			{
+				ZMapFileHeader hdr;
+				if (size < sizeof(hdr))
+					throw std::runtime_error("ZMapFile: file too small " + fileName);
+				memcpy(&hdr, data, sizeof(hdr));
+				if (hdr.magic != ZMAP_FILE_MAGIC)
+					throw std::runtime_error("ZMapFile: not a zmap file " + fileName);
+				if (hdr.version != ZMAP_FILE_VERSION)
+					throw std::runtime_error("ZMapFile: unsupported version " + fileName);
+				uint64_t rowBytes = uint64_t(hdr.width) * zmapBytesPerPixel(hdr.pixelFormat);
+				if (hdr.linePitch < rowBytes || hdr.rowsPerBlock == 0 || hdr.dataOffset < sizeof(hdr) || hdr.dataOffset > size || hdr.dataSize > size - hdr.dataOffset)
+					throw std::runtime_error("ZMapFile: corrupt header " + fileName);
+				if (hdr.height > 0 && hdr.linePitch > uint64_t(std::numeric_limits<size_t>::max()) / hdr.height)
+					throw std::runtime_error("ZMapFile: corrupt header " + fileName);
+				if (hdr.compression == ZMAP_COMPRESSION_NONE)
+				{
+					if (hdr.height > 0 && hdr.linePitch > hdr.dataSize / hdr.height)
+						throw std::runtime_error("ZMapFile: truncated file " + fileName);
+				}
+				else if (hdr.linePitch != rowBytes)
+					throw std::runtime_error("ZMapFile: corrupt header " + fileName);
+				return hdr;
+			}
+
+			/** Memory map a native Z-Map file, uncompressed files are used without copying.
+				The returned image references the mapping, the mapping must be kept alive as long as the image is used.
+				Compressed files are decompressed into an image owning its buffer, in this case the returned mapping is empty.
+				@return the mapping holding the image data.
+			*/
+			inline MappedFile::Ptr mapZMapFile(const std::string& fileName, cx::Image& img, cx::Point3f& scale, cx::Point3f& offset, float& ivd)
+			{
+				MappedFile::Ptr file = MappedFile::createShared(fileName);
+				ZMapFileHeader hdr = checkZMapFileHeader(file->data(), file->size(), fileName);
+				scale = cx::Point3f(hdr.scale[0], hdr.scale[1], hdr.scale[2]);
+				offset = cx::Point3f(hdr.offset[0], hdr.offset[1], hdr.offset[2]);
+				ivd = hdr.ivd;
+
+				if (hdr.compression == ZMAP_COMPRESSION_NONE)
+				{
+					img.create(hdr.height, hdr.width, (cx_pixel_format)hdr.pixelFormat, file->data() + hdr.dataOffset, (size_t)(hdr.linePitch * hdr.height), (size_t)hdr.linePitch);
+					return file;
+				}
+#if defined(CX_C3D_WITH_ZSTD)
+				if (hdr.compression == ZMAP_COMPRESSION_ZSTD)
+				{
+					// checkZMapFileHeader guarantees linePitch == width * bytes per pixel, i.e. the row size of the image
+					size_t rowBytes = (size_t)hdr.linePitch;
+					size_t rowsPerBlock = std::min<size_t>(hdr.rowsPerBlock, hdr.height);
+					size_t numBlocks = rowsPerBlock ? (size_t(hdr.height) + rowsPerBlock - 1) / rowsPerBlock : 0;
+					if (numBlocks > hdr.dataSize / sizeof(ZMapFileBlock))
+						throw std::runtime_error("ZMapFile: corrupt block table " + fileName);
+					img.create(hdr.height, hdr.width, (cx_pixel_format)hdr.pixelFormat);
+					std::vector<uint8_t> raw(img.linePitch() == rowBytes ? 0 : rowBytes * rowsPerBlock);
+					std::unique_ptr<ZSTD_DCtx, size_t(*)(ZSTD_DCtx*)> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+					for (size_t b = 0; b < numBlocks; b++)
+					{
+						unsigned r0 = unsigned(b * rowsPerBlock);
+						unsigned r1 = unsigned(std::min<size_t>(hdr.height, r0 + rowsPerBlock));
+						// the table is not necessarily aligned in the mapping
+						ZMapFileBlock block;
+						memcpy(&block, file->data() + hdr.dataOffset + b * sizeof(ZMapFileBlock), sizeof(block));
+						if (block.offset > file->size() || block.size > file->size() - block.offset)
+							throw std::runtime_error("ZMapFile: corrupt block table " + fileName);
+						// rows are decompressed directly into the image if it has no row padding
+						uint8_t* dst = raw.empty() ? img.row<uint8_t>(r0) : raw.data();
+						size_t expected = (r1 - r0) * rowBytes;
+						size_t sz = ZSTD_decompressDCtx(dctx.get(), dst, expected, file->data() + block.offset, (size_t)block.size);
+						if (ZSTD_isError(sz) || sz != expected)
+							throw std::runtime_error("ZMapFile: corrupt block " + fileName);
+						if (!raw.empty())
+						{
+							for (unsigned r = r0; r < r1; r++)
+								memcpy(img.row<uint8_t>(r), raw.data() + (r - r0) * rowBytes, rowBytes);
+						}
+					}
+					return MappedFile::Ptr();
+				}
+#endif
+				throw std::runtime_error("ZMapFile: unsupported compression " + fileName);
+			}
+
+			/** Load a native Z-Map file into an image owning its buffer.
+			*/
+			inline void loadZMapFile(const std::string& fileName, cx::Image& img, cx::Point3f& scale, cx::Point3f& offset, float& ivd)
+			{
+				cx::Image mapped;
+				MappedFile::Ptr file = mapZMapFile(fileName, mapped, scale, offset, ivd);
+				if (!file)
+				{
+					img = std::move(mapped);
+					return;
+				}
+				img.create(mapped.height(), mapped.width(), mapped.pixelFormat());
+				size_t rowBytes = size_t(mapped.width()) * zmapBytesPerPixel(mapped.pixelFormat());
+				for (unsigned r = 0; r < mapped.height(); r++)
+					memcpy(img.row<uint8_t>(r), mapped.row<uint8_t>(r), rowBytes);
+			}
+
+			//! @} cx_wrapper_cpp
+		}
+	}
+}
+
+#endif	// CX_C3D_ZMAPFILE_H_INCLUDED
@@ -0,0 +1,377 @@
+/**
+@file : ZMapStitcher.h
+@package : cx_3d library
+@brief C++ streaming Z-Map calculation from consecutive range frames
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef CX_C3D_ZMAPSTITCHER_H_INCLUDED
+#define CX_C3D_ZMAPSTITCHER_H_INCLUDED
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include "cx_3d_metric.h"
+#include "AT/cx/base.h"
+#include "AT/cx/Image.h"
+#include "AT/cx/ChunkView.h"
+#include "AT/cx/c3d/Calib.h"
+#include "AT/cx/c3d/ZMap.h"
+
+namespace AT {
+	namespace cx {
+		namespace c3d {
+			//! @addtogroup cx_wrapper_cpp
+			//! @{
+
+			/** ZMapStitcher calculates a Z-Map from a continuous stream of range frames.
+				Every profile is placed in world y by its profile coordinate, typically the encoder value from the chunk data (\ref CX_3D_METRIC_USE_CHUNK_Y).
+				Profiles are buffered across frame boundaries and the Z-Map is calculated in tiles of output rows with cx_3d_rangeWithChunk2rectifiedC.
+				A tile is calculated as soon as the encoder has passed all profiles that can project into the tile plus a halo of rows,
+				so IDW interpolation and hole filling see the same neighborhood as a rectification of the complete scan and there are no seams at frame or tile boundaries.
+
+				Finished rows are passed to a callback, optionally all rows are accumulated and returned by result().
+				Only the profiles needed for the next tile are kept in memory.
+
+				\code{.cpp}
+					cx::c3d::ZMapStitcher stitcher(calib, 2048, cx::Point3f(0.05f, 0.1f, 0.01f), cx::Point3f(-50.0f, 0.0f, 0.0f));
+					stitcher.setCallback([&](const cx::c3d::ZMap& rows, uint64_t firstRow) {
+						// process rows [firstRow, firstRow + rows.img.height()) ...
+					});
+					while (grabbing)
+					{
+						// ...
+						stitcher.addFrame(rangeImg, encoderValues.data());
+					}
+					stitcher.flush();
+				\endcode
+
+				\note Row 0 of the Z-Map is at world y = offset.y, the scan must move towards increasing row numbers. If it moves in the other direction use a negative scale.y.
+				The encoder value must be monotonic within the scan.
+			*/
+			class ZMapStitcher
+			{
+			public:
+				typedef std::shared_ptr<ZMapStitcher> Ptr;
+				typedef std::function<void(const ZMap& rows, uint64_t firstRow)> RowsCallback;	//!< rows are only valid during the call
+
+				/** Create stitcher.
+					@param calib	calibration, the stitcher works on a copy.
+					@param width	number of Z-Map columns.
+					@param scale	scale of the Z-Map, see CX_3D_PARAM_METRIC_S.
+					@param offset	offset of the Z-Map, offset.y is the world y of row 0.
+					@param idv		invalid data value, see CX_3D_PARAM_METRIC_IDV.
+					@param pf		pixel format of the Z-Map, CX_PF_COORD3D_C32f or CX_PF_COORD3D_C16.
+					@param flags	rectification flags, see \ref cx_3d_metric_flags.
+					@param tileRows	number of rows calculated at once.
+					@param haloRows	number of additional rows calculated at the tile borders, should cover the neighborhood of IDW interpolation and hole filling.
+				*/
+				ZMapStitcher(const CalibPtr& calib, unsigned width, const cx::Point3f& scale, const cx::Point3f& offset, float idv = NAN, cx_pixel_format pf = CX_PF_COORD3D_C32f,
+					int flags = CX_3D_METRIC_MARK_Z_INVALID_DATA | CX_3D_METRIC_INTERP_IDW, unsigned tileRows = 256, unsigned haloRows = 4)
+					: m_width(width), m_scale(scale), m_offset(offset), m_idv(idv), m_pf(pf), m_flags(flags), m_tileRows(tileRows), m_haloRows(haloRows),
+					m_dyDp(0.0), m_yMin0(0.0), m_yMax0(0.0), m_accumulate(false)
+				{
+					if (!calib || !calib->isValid())
+						throw std::runtime_error("ZMapStitcher: invalid calibration");
+					if (width == 0 || tileRows == 0 || scale.y == 0.0f)
+						throw std::runtime_error("ZMapStitcher: invalid geometry");
+					if (pf != CX_PF_COORD3D_C32f && pf != CX_PF_COORD3D_C16)
+						throw std::runtime_error("ZMapStitcher: unsupported pixel format");
+					m_calib = calib->clone();
+					if (!m_calib->getProfileExtent(m_dyDp, m_yMin0, m_yMax0))
+						throw std::runtime_error("ZMapStitcher: calibration does not provide the profile extent, CX_3D_PARAM_ROC missing");
+					m_calib->setParam(CX_3D_PARAM_METRIC_S, m_scale);
+					m_calib->setParam(CX_3D_PARAM_METRIC_IDV, m_idv);
+					m_tile.create(m_tileRows + 2 * m_haloRows, m_width, m_pf);
+					reset();
+				}
+
+				static ZMapStitcher::Ptr createShared(const CalibPtr& calib, unsigned width, const cx::Point3f& scale, const cx::Point3f& offset, float idv = NAN, cx_pixel_format pf = CX_PF_COORD3D_C32f,
+					int flags = CX_3D_METRIC_MARK_Z_INVALID_DATA | CX_3D_METRIC_INTERP_IDW, unsigned tileRows = 256, unsigned haloRows = 4)
+				{
+					return std::make_shared<ZMapStitcher>(calib, width, scale, offset, idv, pf, flags, tileRows, haloRows);
+				}
+
+				void setCallback(const RowsCallback& callback) { m_callback = callback; }
+
+				/** Keep all finished rows, the complete Z-Map is returned by result().
+				*/
+				void setAccumulate(bool accumulate) { m_accumulate = accumulate; }
+
+				/** Discard buffered profiles and accumulated rows, the next frame starts at row 0.
+				*/
+				void reset()
+				{
+					m_rows.clear();
+					m_enc.clear();
+					m_xs.clear();
+					m_ys.clear();
+					m_accum.clear();
+					m_nextRow = 0;
+					m_dir = 0;
+					m_firstEnc = 0;
+					m_lastEnc = 0;
+					m_numProfiles = 0;
+					m_rangeWidth = 0;
+				}
+
+				/** Add range frame.
+					@param rangeMap			range image, one profile per row.
+					@param encoderValue		profile coordinate per row, e.g. the encoder value from chunk data.
+					@param xs				optional AOI-xs per row, used with CX_3D_METRIC_USE_CHUNK_X0.
+					@param ys				optional AOI-ys per row, used with CX_3D_METRIC_USE_CHUNK_Z0.
+				*/
+				void addFrame(const cx::Image& rangeMap, const int32_t* encoderValue, const uint16_t* xs = nullptr, const uint16_t* ys = nullptr)
+				{
+					if (rangeMap.isEmpty())
+						return;
+					if (encoderValue == nullptr)
+						throw std::runtime_error("ZMapStitcher: encoder values required");
+					if (m_rangeWidth == 0)
+					{
+						m_rangeWidth = rangeMap.width();
+						m_rangePf = rangeMap.pixelFormat();
+						m_rangeRowBytes = size_t(rangeMap.width()) * bitsPerPixel(rangeMap.pixelFormat()) / 8;
+					}
+					else if (rangeMap.width() != m_rangeWidth || rangeMap.pixelFormat() != m_rangePf)
+						throw std::runtime_error("ZMapStitcher: range image format changed");
+
+					size_t n0 = m_enc.size();
+					m_rows.resize((n0 + rangeMap.height()) * m_rangeRowBytes);
+					for (unsigned r = 0; r < rangeMap.height(); r++)
+						memcpy(&m_rows[(n0 + r) * m_rangeRowBytes], rangeMap.row<uint8_t>(r), m_rangeRowBytes);
+					m_enc.insert(m_enc.end(), encoderValue, encoderValue + rangeMap.height());
+					if (xs)
+						m_xs.insert(m_xs.end(), xs, xs + rangeMap.height());
+					if (ys)
+						m_ys.insert(m_ys.end(), ys, ys + rangeMap.height());
+
+					if (m_numProfiles == 0)
+						m_firstEnc = encoderValue[0];
+					m_numProfiles += rangeMap.height();
+					m_lastEnc = m_enc.back();
+					if (m_dir == 0 && m_lastEnc != m_firstEnc)
+					{
+						m_dir = (m_lastEnc > m_firstEnc) ? 1 : -1;
+						if (m_dir * m_dyDp / m_scale.y < 0.0)
+							throw std::runtime_error("ZMapStitcher: scan moves towards negative rows, invert the sign of scale.y");
+					}
+
+					// calculate all tiles the encoder has passed
+					double p0, p1;
+					while (m_dir != 0)
+					{
+						tileProfiles(m_nextRow, p0, p1);
+						if ((m_dir > 0) ? (m_lastEnc <= p1) : (m_lastEnc >= p0))
+							break;
+						calculateTile(p0, p1);
+					}
+				}
+
+				/** @overload
+					Use encoder value and AOI start of the profile info chunk, one cx_chunk_profile_info_t per row of the range image.
+				*/
+				void addFrame(const cx::Image& rangeMap, const cx_chunk_profile_info_t* chunk)
+				{
+					m_chunkEnc.resize(rangeMap.height());
+					m_chunkXs.resize(rangeMap.height());
+					m_chunkYs.resize(rangeMap.height());
+					extractProfileInfo(CameraInfoView(chunk, rangeMap.height()), m_chunkXs.data(), m_chunkYs.data(), m_chunkEnc.data(), nullptr, rangeMap.height());
+					addFrame(rangeMap, m_chunkEnc.data(), (m_flags & CX_3D_METRIC_USE_CHUNK_X0) ? m_chunkXs.data() : nullptr, (m_flags & CX_3D_METRIC_USE_CHUNK_Z0) ? m_chunkYs.data() : nullptr);
+				}
+
+				/** Calculate the remaining rows covered by the received profiles, call at the end of a scan.
+				*/
+				void flush()
+				{
+					if (m_numProfiles == 0)
+						return;
+					double p0, p1;
+					int dir = scanDir();
+					for (;;)
+					{
+						tileProfiles(m_nextRow, p0, p1);
+						if ((dir > 0) ? (p0 > m_lastEnc) : (p1 < m_lastEnc))
+							break;
+						calculateTile(p0, p1);
+					}
+					m_rows.clear();
+					m_enc.clear();
+					m_xs.clear();
+					m_ys.clear();
+				}
+
+				uint64_t numRows() const { return m_nextRow; }							//!< number of finished rows
+				size_t numBufferedProfiles() const { return m_enc.size(); }			//!< number of profiles waiting for the next tile
+
+				/** Returns the accumulated Z-Map, see setAccumulate.
+				*/
+				ZMap result() const
+				{
+					ZMap zMap;
+					size_t rowBytes = size_t(m_width) * bitsPerPixel(m_pf) / 8;
+					unsigned h = unsigned(m_accum.size() / rowBytes);
+					zMap.create(h, m_width, m_pf, m_scale, m_offset);
+					for (unsigned r = 0; r < h; r++)
+						memcpy(zMap.img.row<uint8_t>(r), &m_accum[r * rowBytes], rowBytes);
+					return zMap;
+				}
+
+			private:
+				ZMapStitcher(const ZMapStitcher&);
+				ZMapStitcher& operator=(const ZMapStitcher&);
+
+				// direction of the profile coordinate towards increasing rows, from the calibration as long as the encoder has not moved
+				int scanDir() const
+				{
+					if (m_dir != 0)
+						return m_dir;
+					return (m_dyDp / m_scale.y > 0.0) ? 1 : -1;
+				}
+
+				// GenICam pixel format values encode the number of bits per pixel in bits 16..23
+				static size_t bitsPerPixel(cx_pixel_format pf) { return (size_t(pf) >> 16) & 0xFF; }
+
+				// range of profile coordinates that can project into the tile starting at row0 including halo
+				void tileProfiles(uint64_t row0, double& p0, double& p1) const
+				{
+					double ya = m_offset.y + (double(row0) - double(m_haloRows)) * m_scale.y;
+					double yb = m_offset.y + double(row0 + m_tileRows + m_haloRows) * m_scale.y;
+					if (ya > yb)
+						std::swap(ya, yb);
+					p0 = (m_dyDp > 0) ? (ya - m_yMax0) / m_dyDp : (yb - m_yMin0) / m_dyDp;
+					p1 = (m_dyDp > 0) ? (yb - m_yMin0) / m_dyDp : (ya - m_yMax0) / m_dyDp;
+					p0 -= 2.0;		// neighbor profiles used for interpolation
+					p1 += 2.0;
+				}
+
+				void calculateTile(double p0, double p1)
+				{
+					size_t first = m_enc.size(), last = 0;
+					for (size_t i = 0; i < m_enc.size(); i++)
+					{
+						if (m_enc[i] >= p0 && m_enc[i] <= p1)
+						{
+							first = std::min(first, i);
+							last = i;
+						}
+					}
+
+					if (first > last)
+						fillInvalid();
+					else
+					{
+						unsigned n = unsigned(last - first + 1);
+						cx::Image src(n, m_rangeWidth, m_rangePf, &m_rows[first * m_rangeRowBytes], n * m_rangeRowBytes, m_rangeRowBytes);
+						const uint16_t* xs = m_xs.empty() ? nullptr : &m_xs[first];
+						const uint16_t* ys = m_ys.empty() ? nullptr : &m_ys[first];
+						cx::Point3f o(m_offset.x, m_offset.y + (float(m_nextRow) - float(m_haloRows)) * m_scale.y, m_offset.z);
+						m_calib->setParam(CX_3D_PARAM_METRIC_O, o);
+						cx::checkOk("cx_3d_rangeWithChunk2rectifiedC", cx_3d_rangeWithChunk2rectifiedC(*m_calib, src, xs, ys, &m_enc[first], m_tile, m_flags | CX_3D_METRIC_USE_CHUNK_Y));
+					}
+
+					// emit rows without halo
+					ZMap rows;
+					rows.img = m_tile.rowRange(m_haloRows, m_haloRows + m_tileRows);
+					rows.scale = m_scale;
+					rows.offset = cx::Point3f(m_offset.x, m_offset.y + float(m_nextRow) * m_scale.y, m_offset.z);
+					if (m_accumulate)
+					{
+						size_t rowBytes = size_t(m_width) * bitsPerPixel(m_pf) / 8;
+						size_t n0 = m_accum.size();
+						m_accum.resize(n0 + m_tileRows * rowBytes);
+						for (unsigned r = 0; r < m_tileRows; r++)
+							memcpy(&m_accum[n0 + r * rowBytes], rows.img.row<uint8_t>(r), rowBytes);
+					}
+					if (m_callback)
+						m_callback(rows, m_nextRow);
+					m_nextRow += m_tileRows;
+
+					// drop profiles that can't contribute to the next tile
+					double q0, q1;
+					tileProfiles(m_nextRow, q0, q1);
+					size_t numDrop = 0;
+					int dir = scanDir();
+					while (numDrop < m_enc.size() && ((dir > 0) ? (m_enc[numDrop] < q0) : (m_enc[numDrop] > q1)))
+						numDrop++;
+					if (numDrop > 0)
+					{
+						m_rows.erase(m_rows.begin(), m_rows.begin() + numDrop * m_rangeRowBytes);
+						m_enc.erase(m_enc.begin(), m_enc.begin() + numDrop);
+						if (!m_xs.empty())
+							m_xs.erase(m_xs.begin(), m_xs.begin() + numDrop);
+						if (!m_ys.empty())
+							m_ys.erase(m_ys.begin(), m_ys.begin() + numDrop);
+					}
+				}
+
+				void fillInvalid()
+				{
+					bool mark = (m_flags & CX_3D_METRIC_MARK_Z_INVALID_DATA) != 0;
+					for (unsigned r = 0; r < m_tile.height(); r++)
+					{
+						if (m_pf == CX_PF_COORD3D_C32f)
+							std::fill(m_tile.row<float>(r), m_tile.row<float>(r) + m_width, mark ? m_idv : 0.0f);
+						else
+							std::fill(m_tile.row<uint16_t>(r), m_tile.row<uint16_t>(r) + m_width, (mark && !std::isnan(m_idv)) ? uint16_t(m_idv + 0.5f) : uint16_t(0));
+					}
+				}
+
+				CalibPtr m_calib;
+				unsigned m_width;
+				cx::Point3f m_scale;
+				cx::Point3f m_offset;
+				float m_idv;
+				cx_pixel_format m_pf;
+				int m_flags;
+				unsigned m_tileRows;
+				unsigned m_haloRows;
+				double m_dyDp;						// world y per profile coordinate
+				double m_yMin0, m_yMax0;			// world y range of profile 0
+				bool m_accumulate;
+				RowsCallback m_callback;
+				cx::Image m_tile;					// tile result including halo
+
+				// buffered profiles
+				unsigned m_rangeWidth;
+				cx_pixel_format m_rangePf;
+				size_t m_rangeRowBytes;
+				std::vector<uint8_t> m_rows;
+				std::vector<int32_t> m_enc;
+				std::vector<uint16_t> m_xs;
+				std::vector<uint16_t> m_ys;
+				std::vector<int32_t> m_chunkEnc;
+				std::vector<uint16_t> m_chunkXs;
+				std::vector<uint16_t> m_chunkYs;
+
+				uint64_t m_nextRow;					// first row of the next tile
+				int m_dir;							// encoder direction, 0 until known
+				int32_t m_firstEnc;
+				int32_t m_lastEnc;
+				uint64_t m_numProfiles;
+				std::vector<uint8_t> m_accum;
+			};
+
+			typedef ZMapStitcher::Ptr ZMapStitcherPtr;
+
+			//! @} cx_wrapper_cpp
+		}	// namespace c3d
+	}	// namespace cx
+}	// namespace AT
+#endif	// CX_C3D_ZMAPSTITCHER_H_INCLUDED
@@ -5,6 +5,7 @@
 @copyright (c) 2017, Automation Technology GmbH.
 
 @version 01.09.2017 initial version
+@version 16.10.2026 slot map with generation counters, lock-free getObj
 
 *************************************************************************************/
 #pragma once
@@ -12,43 +13,91 @@
 #define CX_HANDLEFACTORY_H_INCLUDED
 
 #include <assert.h>
-#include <list>
+#include <stdint.h>
+#include <stddef.h>
 #include <mutex>
-#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
 
 namespace AT {
 	namespace cx {
 
 	/** HandleFactory template
 
-		Class is thread safe and uses a mutex for protecting its handle container.
+		Handles are slots in a slot map: the handle encodes the slot index and a generation counter, which is incremented when the handle is deleted.
+		getObj is lock-free and O(1), a deleted or reused slot is detected by the generation, stale handles return NULL.
+		createHandle, deleteHandle and deleteBack are O(1) and serialized by a mutex, slots are allocated in chunks which are never moved.
+		Creating a handle for an object that already has a handle returns the existing handle.
+
+		Class is thread safe.
 		Typically this class is used as singleton, all items should have been released before the factory gets deleted.
 		The implementation does not automatically release objects when destructor is called.
-		For creating a unique handle from object a cast operator from object type T to handle type H must exist.
+		The handle type H must be a pointer type or an integer type that can hold a pointer.
 	*/
 	template<typename T, typename H=void*>
 	class HandleFactory {
 	public:
 		typedef T object_type;
 		typedef H handle_type;
-		typedef std::list<handle_type> HandleContainer;
 
-		HandleFactory() {}
-		~HandleFactory() {}
+		HandleFactory() : m_count(0), m_numSlots(0), m_oldest(NO_SLOT), m_newest(NO_SLOT)
+		{
+			for (size_t i = 0; i < MAX_CHUNKS; i++)
+				m_chunks[i].store(NULL, std::memory_order_relaxed);
+		}
+
+		~HandleFactory()
+		{
+			for (size_t i = 0; i < MAX_CHUNKS; i++)
+				delete[] m_chunks[i].load(std::memory_order_relaxed);
+		}
 
 		bool isEmpty() const
 		{
-			std::lock_guard<std::mutex> lck(m_mtx);
-			return m_handles.empty();
+			return m_count.load(std::memory_order_acquire) == 0;
 		}
 
+		/** creates a handle for the given object, returns CX_INVALID_HANDLE if obj is NULL or no slot is available.
+		*/
 		handle_type createHandle(object_type* obj)
 		{
-			handle_type h = obj;
+			if (obj == NULL)
+				return (handle_type)CX_INVALID_HANDLE;
 			std::lock_guard<std::mutex> lck(m_mtx);
-			if(std::find(m_handles.begin(), m_handles.end(), h) == m_handles.end())
-				m_handles.push_front(h);
-			return h;
+			typename ObjectMap::iterator it = m_objects.find(obj);
+			if (it != m_objects.end())
+				return makeHandle(it->second, slot(it->second).gen.load(std::memory_order_relaxed));
+
+			uint32_t idx;
+			if (!m_freeSlots.empty())
+			{
+				idx = m_freeSlots.back();
+				m_freeSlots.pop_back();
+			}
+			else
+			{
+				if (m_numSlots >= MAX_CHUNKS * CHUNK_SIZE || m_numSlots > INDEX_MASK - 1)
+					return (handle_type)CX_INVALID_HANDLE;
+				idx = m_numSlots;
+				if (m_chunks[idx / CHUNK_SIZE].load(std::memory_order_relaxed) == NULL)
+					m_chunks[idx / CHUNK_SIZE].store(new Slot[CHUNK_SIZE], std::memory_order_release);
+				m_numSlots++;
+			}
+			m_objects[obj] = idx;
+
+			Slot& s = slot(idx);
+			s.obj.store(obj, std::memory_order_release);
+			// link as newest, deleteBack removes the oldest handle first
+			s.prev = m_newest;
+			s.next = NO_SLOT;
+			if (m_newest != NO_SLOT)
+				slot(m_newest).next = idx;
+			else
+				m_oldest = idx;
+			m_newest = idx;
+			m_count.fetch_add(1, std::memory_order_release);
+			return makeHandle(idx, s.gen.load(std::memory_order_relaxed));
 		}
 
 		/** deletes the given handle and return the linked object.
@@ -56,18 +105,16 @@ namespace AT {
 		*/
 		object_type* deleteHandle(handle_type h)
 		{
-			object_type* obj = NULL;
-			if (CX_INVALID_HANDLE != h)
-			{
-				std::lock_guard<std::mutex> lck(m_mtx);
-				typename HandleContainer::iterator it = std::find(m_handles.begin(), m_handles.end(), h);
-				if (it != m_handles.end())
-				{
-					obj = reinterpret_cast<object_type*>(*it);
-					m_handles.erase(it);
-				}
-			}
-			return obj;
+			uint32_t idx, gen;
+			if (!decodeHandle(h, idx, gen))
+				return NULL;
+			std::lock_guard<std::mutex> lck(m_mtx);
+			if (idx >= m_numSlots)
+				return NULL;
+			Slot& s = slot(idx);
+			if (s.gen.load(std::memory_order_relaxed) != gen || s.obj.load(std::memory_order_relaxed) == NULL)
+				return NULL;
+			return release(idx);
 		}
 
 		/** deletes the last handle and returns the linked object.
@@ -80,35 +127,113 @@ namespace AT {
 		*/
 		object_type* deleteBack()
 		{
-			object_type* obj = NULL;
 			std::lock_guard<std::mutex> lck(m_mtx);
-			if (!m_handles.empty())
-			{
-				obj = reinterpret_cast<object_type*>(m_handles.back());
-				m_handles.pop_back();
-			}
-			return obj;
+			if (m_oldest == NO_SLOT)
+				return NULL;
+			return release(m_oldest);
 		}
 
 		/** return Object for given handle.
 			returns NULL if handle was not found.
 		*/
-		object_type* getObj(handle_type h)
+		object_type* getObj(handle_type h) const
 		{
-			object_type* obj = NULL;
-			if (CX_INVALID_HANDLE != h)
-			{
-				std::lock_guard<std::mutex> lck(m_mtx);
-				typename HandleContainer::iterator it = std::find(m_handles.begin(), m_handles.end(), h);
-				if (it != m_handles.end())
-					obj = reinterpret_cast<object_type*>(*it);
-			}
+			uint32_t idx, gen;
+			if (!decodeHandle(h, idx, gen))
+				return NULL;
+			const Slot* chunk = m_chunks[idx / CHUNK_SIZE].load(std::memory_order_acquire);
+			if (chunk == NULL)
+				return NULL;
+			const Slot& s = chunk[idx % CHUNK_SIZE];
+			// the generation is incremented before the object is cleared, a changed generation means the handle was deleted meanwhile
+			if (s.gen.load(std::memory_order_acquire) != gen)
+				return NULL;
+			object_type* obj = s.obj.load(std::memory_order_acquire);
+			if (s.gen.load(std::memory_order_acquire) != gen)
+				return NULL;
 			return obj;
 		}
 
 	private:
-		std::mutex m_mtx;           // mutex for handle container
-		HandleContainer m_handles;
+		HandleFactory(const HandleFactory&);
+		HandleFactory& operator=(const HandleFactory&);
+
+		enum {
+			CHUNK_SIZE = 1024,
+			MAX_CHUNKS = 4096
+		};
+		static const uint32_t NO_SLOT = 0xFFFFFFFF;
+		// 64 bit handles use 32 bit index and generation, 32 bit handles 20 bit index and 12 bit generation
+		static const unsigned INDEX_BITS = (sizeof(uintptr_t) >= 8) ? 32 : 20;
+		static const uint32_t INDEX_MASK = (INDEX_BITS >= 32) ? 0xFFFFFFFF : 0x000FFFFF;
+		static const uint32_t GEN_MASK = (INDEX_BITS >= 32) ? 0xFFFFFFFF : 0x00000FFF;
+
+		struct Slot
+		{
+			Slot() : obj(NULL), gen(0), prev(NO_SLOT), next(NO_SLOT) {}
+			std::atomic<object_type*> obj;
+			std::atomic<uint32_t> gen;
+			uint32_t prev;		// creation order list, protected by m_mtx
+			uint32_t next;
+		};
+
+		typedef std::unordered_map<const object_type*, uint32_t> ObjectMap;
+
+		Slot& slot(uint32_t idx) const
+		{
+			return m_chunks[idx / CHUNK_SIZE].load(std::memory_order_relaxed)[idx % CHUNK_SIZE];
+		}
+
+		// index is stored +1, so no valid handle equals CX_INVALID_HANDLE
+		static handle_type makeHandle(uint32_t idx, uint32_t gen)
+		{
+			uintptr_t v = ((uintptr_t)(gen & GEN_MASK) << INDEX_BITS) | (uintptr_t)(idx + 1);
+			return (handle_type)v;
+		}
+
+		static bool decodeHandle(handle_type h, uint32_t& idx, uint32_t& gen)
+		{
+			uintptr_t v = (uintptr_t)h;
+			uint32_t i = (uint32_t)(v & INDEX_MASK);
+			if (i == 0 || i > MAX_CHUNKS * CHUNK_SIZE)
+				return false;
+			idx = i - 1;
+			gen = (uint32_t)((v >> INDEX_BITS) & GEN_MASK);
+			return true;
+		}
+
+		// call with m_mtx locked
+		object_type* release(uint32_t idx)
+		{
+			Slot& s = slot(idx);
+			object_type* obj = s.obj.load(std::memory_order_relaxed);
+			s.gen.store((s.gen.load(std::memory_order_relaxed) + 1) & GEN_MASK, std::memory_order_release);
+			s.obj.store(NULL, std::memory_order_release);
+
+			if (s.prev != NO_SLOT)
+				slot(s.prev).next = s.next;
+			else
+				m_oldest = s.next;
+			if (s.next != NO_SLOT)
+				slot(s.next).prev = s.prev;
+			else
+				m_newest = s.prev;
+			s.prev = s.next = NO_SLOT;
+
+			m_objects.erase(obj);
+			m_freeSlots.push_back(idx);
+			m_count.fetch_sub(1, std::memory_order_release);
+			return obj;
+		}
+
+		std::mutex m_mtx;           // mutex for slot allocation and release
+		std::atomic<Slot*> m_chunks[MAX_CHUNKS];
+		std::atomic<size_t> m_count;
+		uint32_t m_numSlots;
+		uint32_t m_oldest;
+		uint32_t m_newest;
+		std::vector<uint32_t> m_freeSlots;
+		ObjectMap m_objects;
 	};
 
 	} // namespace cx
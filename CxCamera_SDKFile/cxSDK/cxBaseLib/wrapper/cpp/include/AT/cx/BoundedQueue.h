@@ -0,0 +1,150 @@
+/**
+@file : BoundedQueue.h
+@package : cx_base library
+@brief C++ bounded lock-free queue
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_BOUNDEDQUEUE_H_INCLUDED
+#define AT_CX_BOUNDEDQUEUE_H_INCLUDED
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
+
+namespace AT {
+	namespace cx {
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		/** Bounded multi-producer/multi-consumer queue without locks.
+			The queue is a ring buffer of fixed capacity where every cell carries a sequence number, producers and consumers claim cells with a single compare-and-swap.
+			tryPush and tryPop never block and never allocate, the storage is allocated once in the constructor.
+
+			\code{.cpp}
+				cx::BoundedQueue<int> q(4);
+				q.tryPush(1);
+				int v;
+				if (q.tryPop(v))
+					std::cout << v << std::endl;
+			\endcode
+
+			\note T must be default constructible and copy assignable, typically it is a pointer or a small value type.
+		*/
+		template<typename T>
+		class BoundedQueue
+		{
+		public:
+			explicit BoundedQueue(size_t capacity) : m_cells(capacity), m_capacity(capacity), m_enqueuePos(0), m_dequeuePos(0)
+			{
+				if (capacity == 0)
+					throw std::runtime_error("BoundedQueue: capacity must be greater than zero");
+				for (size_t i = 0; i < capacity; i++)
+					m_cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+
+			/** Append value at the end of the queue.
+				@return false if the queue is full, the value is not stored in that case.
+			*/
+			bool tryPush(const T& val)
+			{
+				size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+				for (;;)
+				{
+					Cell& cell = m_cells[pos % m_capacity];
+					size_t seq = cell.sequence.load(std::memory_order_acquire);
+					ptrdiff_t dif = (ptrdiff_t)seq - (ptrdiff_t)pos;
+					if (dif == 0)
+					{
+						if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						{
+							cell.data = val;
+							cell.sequence.store(pos + 1, std::memory_order_release);
+							return true;
+						}
+					}
+					else if (dif < 0)
+						return false;
+					else
+						pos = m_enqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+
+			/** Remove value from the front of the queue.
+				@return false if the queue is empty, val is not modified in that case.
+			*/
+			bool tryPop(T& val)
+			{
+				size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+				for (;;)
+				{
+					Cell& cell = m_cells[pos % m_capacity];
+					size_t seq = cell.sequence.load(std::memory_order_acquire);
+					ptrdiff_t dif = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+					if (dif == 0)
+					{
+						if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						{
+							val = cell.data;
+							cell.sequence.store(pos + m_capacity, std::memory_order_release);
+							return true;
+						}
+					}
+					else if (dif < 0)
+						return false;
+					else
+						pos = m_dequeuePos.load(std::memory_order_relaxed);
+				}
+			}
+
+			/** Returns the number of queued elements.
+				\note The value is a snapshot only, it may be outdated already when returned if other threads are working on the queue.
+			*/
+			size_t size() const
+			{
+				size_t deq = m_dequeuePos.load(std::memory_order_acquire);
+				size_t enq = m_enqueuePos.load(std::memory_order_acquire);
+				return (enq > deq) ? ((enq - deq < m_capacity) ? enq - deq : m_capacity) : 0;
+			}
+
+			bool empty() const { return size() == 0; }
+
+			size_t capacity() const { return m_capacity; }
+
+		private:
+			BoundedQueue(const BoundedQueue&);
+			BoundedQueue& operator=(const BoundedQueue&);
+
+			struct Cell
+			{
+				Cell() : sequence(0), data() {}
+				std::atomic<size_t> sequence;
+				T data;
+			};
+
+			std::vector<Cell> m_cells;
+			const size_t m_capacity;
+			char m_pad0[64];
+			std::atomic<size_t> m_enqueuePos;
+			char m_pad1[64];					// producer and consumer positions on separate cache lines
+			std::atomic<size_t> m_dequeuePos;
+		};
+
+		//! @} cx_wrapper_cpp
+	}	// namespace cx
+}	// namespace AT
+#endif	// AT_CX_BOUNDEDQUEUE_H_INCLUDED
@@ -0,0 +1,183 @@
+/**
+@file : ChunkView.h
+@package : cx_base library
+@brief C++ typed read access to chunk data without copy
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_CHUNKVIEW_H_INCLUDED
+#define AT_CX_CHUNKVIEW_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cx_chunk_data.h"
+#include "cx_chunk_data_structs.h"
+#include "cx_endianness.h"
+
+namespace AT {
+	namespace cx {
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		/** ChunkTraits describe the chunk records: the chunk id and the per-profile fields in host byte order.
+			Chunk data of cx cameras is little endian, the accessors convert with cxtoh16/32/64 (see cx_endianness.h). Fields not present in a record return 0.
+		*/
+		template<typename T> struct ChunkTraits;
+
+		template<> struct ChunkTraits<cx_chunk_camera_info_t>
+		{
+			static uint32_t id() { return CX_CHUNK_CAMERA_INFO_ID; }
+			static int32_t encoderValue(const cx_chunk_camera_info_t& c) { return (int32_t)cxtoh32((uint32_t)c.encoderValue); }
+			static uint64_t timestamp(const cx_chunk_camera_info_t& c) { return (uint64_t(cxtoh32(c.timeStamp64H)) << 32) | cxtoh32(c.timeStamp64L); }
+			static uint64_t frameId(const cx_chunk_camera_info_t& c) { return cxtoh32(c.frameId); }
+			static uint16_t aoiXs(const cx_chunk_camera_info_t& c) { return cxtoh16(c.AOI_xs); }
+			static uint16_t aoiYs(const cx_chunk_camera_info_t& c) { return cxtoh16(c.AOI_ys); }
+		};
+
+		template<> struct ChunkTraits<cx_chunk_c6_line_info_t>
+		{
+			static uint32_t id() { return CX_CHUNK_C6_LINE_INFO_ID; }
+			static int32_t encoderValue(const cx_chunk_c6_line_info_t& c) { return (int32_t)cxtoh32((uint32_t)c.encoderValue); }
+			static uint64_t timestamp(const cx_chunk_c6_line_info_t& c) { return cxtoh64(c.timeStamp_Exposure); }
+			static uint64_t frameId(const cx_chunk_c6_line_info_t& c) { return cxtoh64(c.frameId); }
+			static uint16_t aoiXs(const cx_chunk_c6_line_info_t& c) { return cxtoh16(c.AOI_xs); }
+			static uint16_t aoiYs(const cx_chunk_c6_line_info_t& c) { return cxtoh16(c.AOI_ys); }
+		};
+
+		template<> struct ChunkTraits<cx_chunk_irsx_image_info_t>
+		{
+			static uint32_t id() { return CX_CHUNK_IRSX_IMAGE_INFO_ID; }
+			static int32_t encoderValue(const cx_chunk_irsx_image_info_t& c) { return (int32_t)cxtoh32((uint32_t)c.encoderValue); }
+			static uint64_t timestamp(const cx_chunk_irsx_image_info_t& c) { return cxtoh64(c.timeStamp_Exposure); }
+			static uint64_t frameId(const cx_chunk_irsx_image_info_t& c) { return cxtoh64(c.frameId); }
+			static uint16_t aoiXs(const cx_chunk_irsx_image_info_t& c) { return cxtoh16(c.AOI_xs); }
+			static uint16_t aoiYs(const cx_chunk_irsx_image_info_t& c) { return cxtoh16(c.AOI_ys); }
+		};
+
+		template<> struct ChunkTraits<cx_c6_chunk_frame_info_t>
+		{
+			static uint32_t id() { return CX_C6_CHUNK_FRAME_INFO_ID; }
+			static int32_t encoderValue(const cx_c6_chunk_frame_info_t& c) { return (int32_t)cxtoh32((uint32_t)c.encoderValue); }
+			static uint64_t timestamp(const cx_c6_chunk_frame_info_t& c) { return cxtoh64(c.timeStamp); }
+			static uint64_t frameId(const cx_c6_chunk_frame_info_t& c) { return cxtoh64(c.frameId); }
+			static uint16_t aoiXs(const cx_c6_chunk_frame_info_t&) { return 0; }
+			static uint16_t aoiYs(const cx_c6_chunk_frame_info_t&) { return 0; }
+		};
+
+		template<> struct ChunkTraits<cx_c6_chunk_scan3d_region_info_t>
+		{
+			static uint32_t id() { return CX_C6_CHUNK_SCAN3D_REGION_INFO_ID; }
+			static int32_t encoderValue(const cx_c6_chunk_scan3d_region_info_t&) { return 0; }
+			static uint64_t timestamp(const cx_c6_chunk_scan3d_region_info_t&) { return 0; }
+			static uint64_t frameId(const cx_c6_chunk_scan3d_region_info_t&) { return 0; }
+			static uint16_t aoiXs(const cx_c6_chunk_scan3d_region_info_t& c) { return cxtoh16(c.regionOffsetX); }
+			static uint16_t aoiYs(const cx_c6_chunk_scan3d_region_info_t& c) { return cxtoh16(c.regionOffsetY); }
+		};
+
+		/** ChunkView gives typed read access to the records of a chunk, e.g. one cx_chunk_camera_info_t per profile.
+			The view references the chunk data of the buffer, nothing is copied or allocated. It is valid as long as the buffer is not queued again.
+
+			\code{.cpp}
+				cx::Chunk chunk = buffer.getChunkView();
+				cx::ChunkView<cx_chunk_camera_info_t> info(chunk);
+				for (size_t i = 0; i < info.size(); i++)
+					std::cout << info.encoderValue(i) << std::endl;
+			\endcode
+
+			\note Records are packed structs in camera byte order, use the accessors instead of reading the fields of operator[] directly in order to get host byte order.
+		*/
+		template<typename T>
+		class ChunkView
+		{
+		public:
+			typedef T value_type;
+			typedef ChunkTraits<T> traits;
+
+			ChunkView() : m_data(nullptr), m_size(0) {}
+
+			/** Create view on chunk data, the view is empty if the chunk id doesn't match the record type.
+			*/
+			explicit ChunkView(const cx_chunk_t& chunk) : m_data(nullptr), m_size(0)
+			{
+				if (chunk.descriptor == traits::id() && chunk.data != nullptr)
+				{
+					m_data = static_cast<const T*>(chunk.data);
+					m_size = chunk.length / sizeof(T);
+				}
+			}
+
+			//! Create view on an array of records.
+			ChunkView(const T* data, size_t size) : m_data(data), m_size(size) {}
+
+			bool empty() const { return m_size == 0; }
+			size_t size() const { return m_size; }			//!< number of records, typically one per profile
+			const T* data() const { return m_data; }
+			const T& operator[](size_t i) const { return m_data[i]; }
+			const T* begin() const { return m_data; }
+			const T* end() const { return m_data + m_size; }
+
+			int32_t encoderValue(size_t i) const { return traits::encoderValue(m_data[i]); }
+			uint64_t timestamp(size_t i) const { return traits::timestamp(m_data[i]); }
+			uint64_t frameId(size_t i) const { return traits::frameId(m_data[i]); }
+			uint16_t aoiXs(size_t i) const { return traits::aoiXs(m_data[i]); }
+			uint16_t aoiYs(size_t i) const { return traits::aoiYs(m_data[i]); }
+
+		private:
+			const T* m_data;
+			size_t m_size;
+		};
+
+		typedef ChunkView<cx_chunk_camera_info_t> CameraInfoView;
+		typedef ChunkView<cx_chunk_c6_line_info_t> C6LineInfoView;
+		typedef ChunkView<cx_c6_chunk_frame_info_t> C6FrameInfoView;
+		typedef ChunkView<cx_c6_chunk_scan3d_region_info_t> C6RegionInfoView;
+		typedef ChunkView<cx_chunk_irsx_image_info_t> IrsxImageInfoView;
+
+		/** Extract per-profile values of all records in one pass into caller provided arrays (structure of arrays).
+			The arrays match the parameters xs, ys and encoderValue of the chunk aware metric functions, e.g. cx_3d_rangeWithChunk2calibratedABC.
+			@param view			chunk records.
+			@param xs			AOI x-start per record, may be null.
+			@param ys			AOI y-start per record, may be null.
+			@param encoder		encoder value per record, may be null.
+			@param timestamp	timestamp per record, may be null.
+			@param maxCount		capacity of the arrays.
+			@return number of extracted records, min(view.size(), maxCount).
+		*/
+		template<typename T>
+		inline size_t extractProfileInfo(const ChunkView<T>& view, uint16_t* xs, uint16_t* ys, int32_t* encoder, uint64_t* timestamp, size_t maxCount)
+		{
+			typedef ChunkTraits<T> traits;
+			size_t n = (view.size() < maxCount) ? view.size() : maxCount;
+			const T* rec = view.data();
+			for (size_t i = 0; i < n; i++)
+			{
+				const T& r = rec[i];
+				if (xs)
+					xs[i] = traits::aoiXs(r);
+				if (ys)
+					ys[i] = traits::aoiYs(r);
+				if (encoder)
+					encoder[i] = traits::encoderValue(r);
+				if (timestamp)
+					timestamp[i] = traits::timestamp(r);
+			}
+			return n;
+		}
+
+		//! @} cx_wrapper_cpp
+	}	// namespace cx
+}	// namespace AT
+#endif	// AT_CX_CHUNKVIEW_H_INCLUDED
@@ -22,8 +22,12 @@ POSSIBILITY OF SUCH DAMAGE.
 #define AT_CX_IMAGE_H_INCLUDED
 
 #include <memory>
+#include <algorithm>
+#include <stdexcept>
 #include <assert.h>
 #include "AT/cx/base.h"
+#include "AT/cx/ThreadPool.h"
+#include "AT/cx/PackedDecode.h"
 
 namespace AT {
 	namespace cx {
@@ -113,6 +117,13 @@ namespace AT {
 			*/
 			template<typename _Tp> const _Tp* row(unsigned row) const;
 
+			/** Returns a sub image with the rows [r0, r1) of this image. No data is copied, the returned image is not owner of the data.
+				Works also for planar pixel formats, the plane pitch of this image is kept.
+				@param r0 first row
+				@param r1 row behind the last row
+			*/
+			Image rowRange(unsigned r0, unsigned r1) const;
+
 			/** Returns a pointer to the cx_img struct.
 				Cast operator is used for accessing cx-API functions that expect parameter of type cx_img_t.
 			*/
@@ -143,6 +154,7 @@ namespace AT {
 			void load(const std::string& fileName);
 
 			/** Decode image with CX_PF_MONO_12p/CX_PF_COORD3D_C12p pixel format to CX_PF_MONO_16/CX_PF_COORD3D_C16 pixel format.
+				Uses the library function cx_image_decode_mono12p, see \ref decodePacked for the decoder of the wrapper with SIMD kernels.
 				@param[in] src		source image.
 				@param[inout] dst	destination image
 			*/
@@ -150,10 +162,115 @@ namespace AT {
 			{
 				cx::checkOk(cx_image_decode_mono12p(src, dst));
 			}
+
+			/** Decode image with packed pixel format CX_PF_MONO_10p, CX_PF_MONO_12p or CX_PF_COORD3D_C12p to 16 bit.
+				Opt-in alternative to \ref decodeMono12p, the rows are decoded by the SIMD kernels of the wrapper instead of the library.
+				If dst already has the size of src and format CX_PF_MONO_16 or CX_PF_COORD3D_C16 the pixels are written into the existing buffer,
+				e.g. a caller provided CX_PF_COORD3D_C16 image that feeds the metric transform. Otherwise dst is allocated with \ref unpackedFormat.
+				@param[in] src		source image.
+				@param[inout] dst	destination image, must not share memory with src.
+				@param[in] pool		optional thread pool, rows are decoded in parallel bands.
+			*/
+			static void decodePacked(const cx::Image& src, cx::Image& dst, ThreadPool* pool = nullptr)
+			{
+				unsigned bits = packedBitsPerPixel(src.pixelFormat());
+				if (bits == 0)
+					throw std::runtime_error("Image: pixel format is not packed");
+				unsigned w = src.width();
+				unsigned h = src.height();
+				bool reuse = dst.data() != nullptr && dst.width() == w && dst.height() == h
+					&& (dst.pixelFormat() == CX_PF_MONO_16 || dst.pixelFormat() == CX_PF_COORD3D_C16);
+				if (!reuse)
+					dst.create(h, w, unpackedFormat(src.pixelFormat()));
+				size_t rowBytes = (size_t(w) * bits + 7) / 8;
+				size_t pitch = src.linePitch() ? src.linePitch() : rowBytes;
+				if (pitch < rowBytes || (h > 0 && src.dataSz() < pitch * (h - 1) + rowBytes))
+					throw std::runtime_error("Image: packed image data too small");
+
+				packed_kernel k = detectPackedKernel();
+				const uint8_t* s = (const uint8_t*)src.data();
+				auto band = [&](size_t r0, size_t r1) {
+					for (size_t r = r0; r < r1; r++)
+					{
+						// the SIMD kernels may read up to the line pitch, but not beyond the image data in the last row
+						size_t avail = std::min<size_t>(pitch, src.dataSz() - r * pitch);
+						unpackRow(bits, s + r * pitch, avail, dst.row<uint16_t>(unsigned(r)), w, k);
+					}
+				};
+				if (pool && pool->numThreads() > 1)
+					pool->parallelForRange(h, 64, band);
+				else
+					band(0, h);
+			}
 		};
 
 		typedef Image::Ptr ImagePtr;
 
+		/** Class ImageView is a non-owning view on image data, e.g. the image data of a DeviceBuffer.
+			An ImageView never allocates nor frees pixel data, it can be copied and returned by value at the cost of copying the cx_img_t header.
+
+			\code{.cpp}
+				cx::ImageView view = buffer.getImageView(0);
+				if (!view.isEmpty())
+					cx::c3d::calculatePointCloud(calib, view.image(), pc);
+			\endcode
+
+			\note The view is only valid as long as the referenced data is valid, for a DeviceBuffer until queueBuffer is called.
+		*/
+		class ImageView
+		{
+		public:
+			ImageView()											{ memset(&m_img, 0, sizeof(cx_img_t)); }		//!< Creates empty view
+			ImageView(const cx_img_t& img) : m_img(img)			{ m_img.flag &= ~CX_IMG_BUFFER_OWNER; }			//!< Creates view on the data of img
+			ImageView(const Image& img) : m_img(*(const cx_img_t*)img)	{ m_img.flag &= ~CX_IMG_BUFFER_OWNER; }	//!< Creates view on the data of img
+
+			bool isEmpty() const { return (m_img.height == 0 || m_img.width == 0 || m_img.data == nullptr) ? true : false; }
+			size_t size() const { return m_img.height * m_img.width; }
+
+			cx_pixel_format pixelFormat() const { return (cx_pixel_format)m_img.pixelFormat; }
+			unsigned height() const { return m_img.height; }
+			unsigned width() const { return m_img.width; }
+			size_t linePitch() const { return m_img.linePitch; }		//!< Total number of bytes between the starts of 2 consecutive rows.
+			size_t planePitch() const { return m_img.planePitch; }		//!< Total number of bytes between the starts of 2 consecutive planes. Zero for single plane image.
+			size_t dataSz() const { return m_img.dataSz; }				//!< Total data size of data buffer in bytes
+			void* data() const { return m_img.data; }
+
+			/** Returns a typed pointer to the specified image row.
+				@param r Index along the dimension 0
+			*/
+			template<typename _Tp> const _Tp* row(unsigned r) const
+			{
+				assert(r < m_img.height);
+				return (const _Tp*)((uint8_t*)m_img.data + r * m_img.linePitch);
+			}
+
+			/** Returns a reference to the specified array element.
+				@param r Index along the dimension 0
+				@param c Index along the dimension 1
+			*/
+			template<typename _Tp> const _Tp& at(unsigned r, unsigned c) const
+			{
+				assert(c < m_img.width);
+				return row<_Tp>(r)[c];
+			}
+
+			/** Returns the view as cx::Image reference, for functions expecting a cx::Image.
+				No data is copied, the returned image is not owner of the data.
+			*/
+			const Image& image() const { return *reinterpret_cast<const Image*>(&m_img); }
+
+			/** Returns a pointer to the cx_img struct.
+				Cast operator is used for accessing cx-API functions that expect parameter of type cx_img_t.
+			*/
+			operator const cx_img_t*() const { return &m_img; }
+			/** @overload
+			*/
+			operator cx_img_t*() { return &m_img; }
+
+		private:
+			cx_img_t m_img;
+		};
+
 
 		//! @} cx_wrapper_cpp
 
@@ -238,6 +355,14 @@ namespace AT {
 		{
 			cx_image_free(this);
 		}
+		inline Image Image::rowRange(unsigned r0, unsigned r1) const
+		{
+			assert(r0 <= r1 && r1 <= cx_img_t::height);
+			size_t sz = (r1 - r0) * cx_img_t::linePitch;
+			if (cx_img_t::planePitch > 0)
+				sz += cx_img_t::planePitch * (planes() - 1);
+			return Image(r1 - r0, cx_img_t::width, pixelFormat(), (uint8_t*)cx_img_t::data + r0 * cx_img_t::linePitch, sz, cx_img_t::linePitch, cx_img_t::planePitch);
+		}
 
 		template<typename _Tp> inline
 			_Tp* Image::row(unsigned r)
@@ -0,0 +1,435 @@
+/**
+@file : ImagePool.h
+@package : cx_base library
+@brief C++ pool of recycled image buffers
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_IMAGEPOOL_H_INCLUDED
+#define AT_CX_IMAGEPOOL_H_INCLUDED
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include "AT/cx/base.h"
+#include "AT/cx/Image.h"
+
+#ifdef _WIN32
+#	include <malloc.h>
+#	ifndef _WINDOWS_
+// virtual memory functions of kernel32 with the exact signatures of the Windows SDK, so windows.h is not pulled into every header including this one
+extern "C" {
+#		ifdef _WIN64
+	__declspec(dllimport) void* __stdcall VirtualAlloc(void* lpAddress, unsigned __int64 dwSize, unsigned long flAllocationType, unsigned long flProtect);
+	__declspec(dllimport) int __stdcall VirtualFree(void* lpAddress, unsigned __int64 dwSize, unsigned long dwFreeType);
+	__declspec(dllimport) unsigned __int64 __stdcall GetLargePageMinimum(void);
+#		else
+	__declspec(dllimport) void* __stdcall VirtualAlloc(void* lpAddress, unsigned long dwSize, unsigned long flAllocationType, unsigned long flProtect);
+	__declspec(dllimport) int __stdcall VirtualFree(void* lpAddress, unsigned long dwSize, unsigned long dwFreeType);
+	__declspec(dllimport) unsigned long __stdcall GetLargePageMinimum(void);
+#		endif
+}
+#	endif
+#else
+#	include <sys/mman.h>
+#endif
+
+namespace AT {
+	namespace cx {
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		/** Interface for allocators of image buffers, see \ref ImagePool.
+			Implement this interface to place image buffers in special memory, e.g. pinned memory of a GPU driver.
+		*/
+		class ImageAllocator
+		{
+		public:
+			typedef std::shared_ptr<ImageAllocator> Ptr;
+
+			virtual ~ImageAllocator() {}
+
+			//! Returns a buffer of at least size bytes, aligned to 64 bytes. Throws std::bad_alloc on failure.
+			virtual void* allocate(size_t size) = 0;
+			//! Releases a buffer returned by allocate, size is the size passed to allocate.
+			virtual void deallocate(void* ptr, size_t size) = 0;
+		};
+
+		/** Default allocator, buffers are aligned to 64 bytes.
+			With huge pages, buffers of at least 2 MB are allocated with huge pages if the system provides them (Linux: MAP_HUGETLB, else transparent huge pages;
+			Windows: MEM_LARGE_PAGES, requires the "Lock pages in memory" privilege). Otherwise normal pages are used.
+		*/
+		class AlignedImageAllocator : public ImageAllocator
+		{
+		public:
+			explicit AlignedImageAllocator(bool hugePages = false) : m_hugePages(hugePages)
+			{
+			}
+
+			void* allocate(size_t size) override
+			{
+				if (m_hugePages && size >= HUGE_PAGE_SIZE)
+				{
+					void* p = allocateHuge(size);
+					if (!p)
+						throw std::bad_alloc();
+					return p;
+				}
+				void* p = nullptr;
+#ifdef _WIN32
+				p = _aligned_malloc(size, ALIGNMENT);
+#else
+				if (posix_memalign(&p, ALIGNMENT, size) != 0)
+					p = nullptr;
+#endif
+				if (!p)
+					throw std::bad_alloc();
+				return p;
+			}
+
+			void deallocate(void* ptr, size_t size) override
+			{
+				if (!ptr)
+					return;
+				if (m_hugePages && size >= HUGE_PAGE_SIZE)
+				{
+#ifdef _WIN32
+					VirtualFree(ptr, 0, WIN_MEM_RELEASE);
+#else
+					munmap(ptr, roundHuge(size));
+#endif
+					return;
+				}
+#ifdef _WIN32
+				_aligned_free(ptr);
+#else
+				::free(ptr);
+#endif
+			}
+
+			bool hugePages() const { return m_hugePages; }
+
+		private:
+			enum { ALIGNMENT = 64 };
+#ifdef _WIN32
+			// values of MEM_* and PAGE_READWRITE of the Windows SDK
+			enum { WIN_MEM_COMMIT = 0x1000, WIN_MEM_RESERVE = 0x2000, WIN_MEM_RELEASE = 0x8000, WIN_MEM_LARGE_PAGES = 0x20000000, WIN_PAGE_READWRITE = 0x04 };
+#endif
+			static const size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+			static size_t roundHuge(size_t size) { return (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE; }
+
+			// falls back to normal pages mapped the same way, so deallocate releases both alike. Returns nullptr if no memory could be mapped.
+			static void* allocateHuge(size_t size)
+			{
+#ifdef _WIN32
+				size_t large = (size_t)GetLargePageMinimum();
+				void* p = nullptr;
+				if (large > 0)
+					p = VirtualAlloc(nullptr, (size + large - 1) / large * large, WIN_MEM_RESERVE | WIN_MEM_COMMIT | WIN_MEM_LARGE_PAGES, WIN_PAGE_READWRITE);
+				if (!p)
+					p = VirtualAlloc(nullptr, size, WIN_MEM_RESERVE | WIN_MEM_COMMIT, WIN_PAGE_READWRITE);
+				return p;
+#else
+				size_t sz = roundHuge(size);
+				void* p = MAP_FAILED;
+#	ifdef MAP_HUGETLB
+				p = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#	endif
+				if (p == MAP_FAILED)
+				{
+					p = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+					if (p == MAP_FAILED)
+						return nullptr;
+#	ifdef MADV_HUGEPAGE
+					madvise(p, sz, MADV_HUGEPAGE);
+#	endif
+				}
+				return p;
+#endif
+			}
+
+			bool m_hugePages;
+		};
+
+		//! Statistics of an ImagePool
+		struct ImagePoolStats
+		{
+			uint64_t hits;				//!< acquire calls served from a recycled buffer
+			uint64_t misses;			//!< acquire calls that allocated a new buffer
+			uint64_t evictions;			//!< released buffers freed because the cache limit was reached
+			size_t bytesInUse;			//!< bytes of buffers currently held by images
+			size_t bytesCached;			//!< bytes of free buffers kept for reuse
+			size_t buffersCached;		//!< number of free buffers kept for reuse
+		};
+
+		/** Class ImagePool hands out images backed by recycled buffers, keyed by pixel format and size.
+			When the last reference to an acquired image is released the buffer goes back to the pool instead of being freed.
+			A steady processing loop then works without allocations, page faults and allocator lock contention after the first frames.
+
+			The returned image is not owner of the buffer. Calling create() with a different size or format on it allocates a new buffer owned by the image,
+			the pooled buffer is returned to the pool nevertheless. Images are allocated without padding, planar formats get 3 consecutive planes.
+			The pool may be destroyed before the images it handed out, the remaining buffers are freed when the images are released.
+			Class is thread safe.
+
+			\code{.cpp}
+				cx::ImagePool pool;
+				while (grabbing)
+				{
+					cx::Image::Ptr img = pool.acquire(h, w, CX_PF_COORD3D_ABC32f);	// replaces cx::Image::createShared(h, w, CX_PF_COORD3D_ABC32f)
+					// ... fill and process img, the buffer is recycled when img goes out of scope
+				}
+			\endcode
+
+			Images held by value, e.g. ZMap::img or the images of a PointCloud, are pointed to a pooled buffer by the overload of acquire returning a handle,
+			see ZMap::create, PointCloud::createPooled and the createShared/makeShared factories taking a pool.
+		*/
+		class ImagePool
+		{
+		public:
+			typedef std::shared_ptr<ImagePool> Ptr;
+
+			/** @param maxCachedBytes	upper limit of the bytes kept in free buffers, released buffers above the limit are freed.
+				@param allocator		allocator for the buffers, default is AlignedImageAllocator without huge pages.
+			*/
+			explicit ImagePool(size_t maxCachedBytes = size_t(512) << 20, ImageAllocator::Ptr allocator = ImageAllocator::Ptr())
+				: m_state(std::make_shared<State>())
+			{
+				m_state->allocator = allocator ? allocator : std::make_shared<AlignedImageAllocator>();
+				m_state->maxCachedBytes = maxCachedBytes;
+			}
+
+			/** Returns an image of the given size and pixel format, the content of the image is undefined.
+			*/
+			Image::Ptr acquire(unsigned int h, unsigned int w, cx_pixel_format pf)
+			{
+				size_t linePitch, planePitch, size;
+				layout(h, w, pf, linePitch, planePitch, size);
+				Key key(pf, h, w);
+				void* ptr = take(key, size);
+
+				std::shared_ptr<State> state = m_state;
+				Image* img = new Image(h, w, pf, ptr, size, linePitch, planePitch);
+				return Image::Ptr(img, [state, key, ptr, size](Image* p) {
+					delete p;
+					state->release(key, ptr, size);
+				});
+			}
+
+			/** Points img to a buffer of the given size and pixel format, the content of the image is undefined. img is not owner of the buffer.
+				The buffer goes back to the pool when the last copy of the returned handle is released, img must not be used after that.
+				@return handle to be kept together with img.
+			*/
+			std::shared_ptr<void> acquire(unsigned int h, unsigned int w, cx_pixel_format pf, Image& img)
+			{
+				size_t linePitch, planePitch, size;
+				layout(h, w, pf, linePitch, planePitch, size);
+				Key key(pf, h, w);
+				void* ptr = take(key, size);
+
+				std::shared_ptr<State> state = m_state;
+				std::shared_ptr<void> handle(ptr, [state, key, size](void* p) {
+					state->release(key, p, size);
+				});
+				img = Image(h, w, pf, ptr, size, linePitch, planePitch);
+				return handle;
+			}
+
+			ImagePoolStats stats() const
+			{
+				std::lock_guard<std::mutex> lck(m_state->mtx);
+				return m_state->stats;
+			}
+
+			//! Resets the hit, miss and eviction counters.
+			void resetStats()
+			{
+				std::lock_guard<std::mutex> lck(m_state->mtx);
+				m_state->stats.hits = m_state->stats.misses = m_state->stats.evictions = 0;
+			}
+
+			//! Frees all cached buffers, buffers in use are not affected.
+			void clear()
+			{
+				std::lock_guard<std::mutex> lck(m_state->mtx);
+				m_state->freeAll();
+			}
+
+			size_t maxCachedBytes() const
+			{
+				std::lock_guard<std::mutex> lck(m_state->mtx);
+				return m_state->maxCachedBytes;
+			}
+
+			void setMaxCachedBytes(size_t maxCachedBytes)
+			{
+				std::lock_guard<std::mutex> lck(m_state->mtx);
+				m_state->maxCachedBytes = maxCachedBytes;
+				if (m_state->stats.bytesCached > maxCachedBytes)
+					m_state->freeAll();
+			}
+
+			static ImagePool::Ptr createShared(size_t maxCachedBytes = size_t(512) << 20, ImageAllocator::Ptr allocator = ImageAllocator::Ptr())
+			{
+				return std::make_shared<ImagePool>(maxCachedBytes, allocator);
+			}
+
+			/** Computes line pitch, plane pitch and buffer size of an unpadded image.
+				The bits per pixel are taken from the pixel format, planar formats (CX_PF_COORD3D_ABCxx_PLANAR) store one component per plane.
+			*/
+			static void layout(unsigned int h, unsigned int w, cx_pixel_format pf, size_t& linePitch, size_t& planePitch, size_t& size)
+			{
+				size_t bits = (size_t(pf) >> 16) & 0xFF;
+				if (bits == 0)
+					throw std::runtime_error("ImagePool: invalid pixel format");
+				bool planar = pf == CX_PF_COORD3D_ABC8_PLANAR || pf == CX_PF_COORD3D_ABC16_PLANAR || pf == CX_PF_COORD3D_ABC32f_PLANAR;
+				if (planar)
+				{
+					linePitch = size_t(w) * bits / 3 / 8;
+					planePitch = linePitch * h;
+					size = 3 * planePitch;
+				}
+				else
+				{
+					linePitch = (size_t(w) * bits + 7) / 8;
+					planePitch = 0;
+					size = linePitch * h;
+				}
+			}
+
+		private:
+			ImagePool(const ImagePool&);
+			ImagePool& operator=(const ImagePool&);
+
+			struct Key
+			{
+				Key(cx_pixel_format f, unsigned hh, unsigned ww) : pf(f), h(hh), w(ww) {}
+				bool operator<(const Key& o) const
+				{
+					if (pf != o.pf)
+						return pf < o.pf;
+					if (h != o.h)
+						return h < o.h;
+					return w < o.w;
+				}
+				cx_pixel_format pf;
+				unsigned h;
+				unsigned w;
+			};
+
+			// buffers are rounded up to full cache lines, so SIMD kernels may load the last 64 bytes of an image as a whole
+			static size_t allocSize(size_t size) { return (std::max<size_t>(size, 1) + 63) / 64 * 64; }
+
+			// returns a recycled or a new buffer and accounts it as in use
+			void* take(const Key& key, size_t size)
+			{
+				void* ptr = nullptr;
+				{
+					std::lock_guard<std::mutex> lck(m_state->mtx);
+					std::vector<void*>& freeList = m_state->freeBuffers[key];
+					if (!freeList.empty())
+					{
+						ptr = freeList.back();
+						freeList.pop_back();
+						m_state->stats.hits++;
+						m_state->stats.bytesCached -= size;
+						m_state->stats.buffersCached--;
+					}
+					else
+						m_state->stats.misses++;
+					m_state->stats.bytesInUse += size;
+				}
+				if (!ptr)
+				{
+					try
+					{
+						ptr = m_state->allocator->allocate(allocSize(size));
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lck(m_state->mtx);
+						m_state->stats.bytesInUse -= size;
+						throw;
+					}
+				}
+				return ptr;
+			}
+
+			// shared with the deleters of the handed out images, lives until the pool and all its images are destroyed
+			struct State
+			{
+				State() : maxCachedBytes(0)
+				{
+					memset(&stats, 0, sizeof(stats));
+				}
+
+				~State()
+				{
+					freeAll();
+				}
+
+				void release(const Key& key, void* ptr, size_t size)
+				{
+					std::lock_guard<std::mutex> lck(mtx);
+					stats.bytesInUse -= size;
+					if (stats.bytesCached + size > maxCachedBytes)
+					{
+						stats.evictions++;
+						allocator->deallocate(ptr, allocSize(size));
+						return;
+					}
+					freeBuffers[key].push_back(ptr);
+					stats.bytesCached += size;
+					stats.buffersCached++;
+				}
+
+				// call with mtx locked
+				void freeAll()
+				{
+					for (auto& it : freeBuffers)
+					{
+						size_t linePitch, planePitch, size;
+						layout(it.first.h, it.first.w, it.first.pf, linePitch, planePitch, size);
+						for (void* p : it.second)
+							allocator->deallocate(p, allocSize(size));
+					}
+					freeBuffers.clear();
+					stats.bytesCached = 0;
+					stats.buffersCached = 0;
+				}
+
+				mutable std::mutex mtx;
+				ImageAllocator::Ptr allocator;
+				std::map<Key, std::vector<void*> > freeBuffers;
+				size_t maxCachedBytes;
+				ImagePoolStats stats;
+			};
+
+			std::shared_ptr<State> m_state;
+		};
+
+		//! @} cx_wrapper_cpp
+	}
+}
+
+#endif	// AT_CX_IMAGEPOOL_H_INCLUDED
@@ -0,0 +1,182 @@
+/**
+@file : MappedFile.h
+@package : cx_base library
+@brief C++ read only memory mapped file
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_MAPPEDFILE_H_INCLUDED
+#define AT_CX_MAPPEDFILE_H_INCLUDED
+
+#include <stdint.h>
+#include <string>
+#include <memory>
+#include <stdexcept>
+
+#ifdef _WIN32
+#	include <io.h>
+#	include <fcntl.h>
+#	include <sys/stat.h>
+#	ifndef _WINDOWS_
+// file mapping functions of kernel32 with the exact signatures of the Windows SDK, so windows.h is not pulled into every header including this one
+extern "C" {
+	struct _SECURITY_ATTRIBUTES;
+	__declspec(dllimport) void* __stdcall CreateFileMappingA(void* hFile, struct _SECURITY_ATTRIBUTES* lpAttributes, unsigned long flProtect, unsigned long dwMaximumSizeHigh, unsigned long dwMaximumSizeLow, const char* lpName);
+#		ifdef _WIN64
+	__declspec(dllimport) void* __stdcall MapViewOfFile(void* hFileMappingObject, unsigned long dwDesiredAccess, unsigned long dwFileOffsetHigh, unsigned long dwFileOffsetLow, unsigned __int64 dwNumberOfBytesToMap);
+#		else
+	__declspec(dllimport) void* __stdcall MapViewOfFile(void* hFileMappingObject, unsigned long dwDesiredAccess, unsigned long dwFileOffsetHigh, unsigned long dwFileOffsetLow, unsigned long dwNumberOfBytesToMap);
+#		endif
+	__declspec(dllimport) int __stdcall UnmapViewOfFile(const void* lpBaseAddress);
+	__declspec(dllimport) int __stdcall CloseHandle(void* hObject);
+}
+#	endif
+#else
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
+namespace AT {
+	namespace cx {
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		/** Class MappedFile maps a whole file into memory.
+			By default the mapping is private copy-on-write: the memory can be modified, but changes are never written back to the file.
+			A shared read only mapping sees changes of the file made by other processes, e.g. for reading a file while it is written.
+			Pages are loaded on first access, so opening a large file is cheap.
+		*/
+		class MappedFile
+		{
+		public:
+			typedef std::shared_ptr<MappedFile> Ptr;
+
+			MappedFile() : m_data(nullptr), m_size(0)
+			{
+			}
+
+			explicit MappedFile(const std::string& fileName, bool sharedReadOnly = false) : m_data(nullptr), m_size(0)
+			{
+				open(fileName, sharedReadOnly);
+			}
+
+			~MappedFile()
+			{
+				close();
+			}
+
+			/** Map the file, throws std::runtime_error if the file can not be opened or mapped.
+				@param fileName			file to map
+				@param sharedReadOnly	map the file shared and read only instead of private copy-on-write, writing to the memory is not allowed.
+			*/
+			void open(const std::string& fileName, bool sharedReadOnly = false)
+			{
+				close();
+#ifdef _WIN32
+				// the file is opened with the CRT (shared for reading and writing), the handle of the descriptor is owned by the descriptor
+				int fd = _open(fileName.c_str(), _O_RDONLY | _O_BINARY);
+				if (fd < 0)
+					throw std::runtime_error("MappedFile: can not open " + fileName);
+				struct _stat64 st;
+				if (_fstat64(fd, &st) != 0)
+				{
+					_close(fd);
+					throw std::runtime_error("MappedFile: can not get size of " + fileName);
+				}
+				if (st.st_size > 0)
+				{
+					void* file = (void*)_get_osfhandle(fd);
+					void* mapping = CreateFileMappingA(file, nullptr, sharedReadOnly ? WIN_PAGE_READONLY : WIN_PAGE_WRITECOPY, 0, 0, nullptr);
+					void* ptr = mapping ? MapViewOfFile(mapping, sharedReadOnly ? WIN_FILE_MAP_READ : WIN_FILE_MAP_COPY, 0, 0, 0) : nullptr;
+					if (mapping)
+						CloseHandle(mapping);
+					if (ptr == nullptr)
+					{
+						_close(fd);
+						throw std::runtime_error("MappedFile: can not map " + fileName);
+					}
+					m_data = (uint8_t*)ptr;
+				}
+				_close(fd);
+				m_size = (size_t)st.st_size;
+#else
+				int fd = ::open(fileName.c_str(), O_RDONLY);
+				if (fd < 0)
+					throw std::runtime_error("MappedFile: can not open " + fileName);
+				struct stat st;
+				if (fstat(fd, &st) != 0)
+				{
+					::close(fd);
+					throw std::runtime_error("MappedFile: can not get size of " + fileName);
+				}
+				if (st.st_size > 0)
+				{
+					void* ptr = sharedReadOnly ? mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0) : mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+					if (ptr == MAP_FAILED)
+					{
+						::close(fd);
+						throw std::runtime_error("MappedFile: can not map " + fileName);
+					}
+					m_data = (uint8_t*)ptr;
+				}
+				::close(fd);
+				m_size = (size_t)st.st_size;
+#endif
+			}
+
+			void close()
+			{
+				if (m_data)
+				{
+#ifdef _WIN32
+					UnmapViewOfFile(m_data);
+#else
+					munmap(m_data, m_size);
+#endif
+				}
+				m_data = nullptr;
+				m_size = 0;
+			}
+
+			bool isOpen() const { return m_data != nullptr; }
+			uint8_t* data() const { return m_data; }
+			size_t size() const { return m_size; }
+
+			static MappedFile::Ptr createShared(const std::string& fileName, bool sharedReadOnly = false)
+			{
+				return std::make_shared<MappedFile>(fileName, sharedReadOnly);
+			}
+
+		private:
+			MappedFile(const MappedFile&);
+			MappedFile& operator=(const MappedFile&);
+
+#ifdef _WIN32
+			// values of PAGE_READONLY, PAGE_WRITECOPY, FILE_MAP_READ and FILE_MAP_COPY
+			enum { WIN_PAGE_READONLY = 0x02, WIN_PAGE_WRITECOPY = 0x08, WIN_FILE_MAP_READ = 0x04, WIN_FILE_MAP_COPY = 0x01 };
+#endif
+
+			uint8_t* m_data;
+			size_t m_size;
+		};
+
+		//! @} cx_wrapper_cpp
+	}
+}
+
+#endif	// AT_CX_MAPPEDFILE_H_INCLUDED
@@ -0,0 +1,344 @@
+/**
+@file : PackedDecode.h
+@package : cx_base library
+@brief C++ SIMD kernels for unpacking Mono10p, Mono12p and Coord3D_C12p rows
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_PACKEDDECODE_H_INCLUDED
+#define AT_CX_PACKEDDECODE_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdexcept>
+#include "cx_pixel_format.h"
+
+// SSSE3 and AVX2 kernels are compiled with function target attributes, no global compiler flags are needed
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define CX_PACKED_SSSE3
+	#define CX_PACKED_AVX2
+	#define CX_PACKED_TARGET_SSSE3 __attribute__((target("ssse3")))
+	#define CX_PACKED_TARGET_AVX2 __attribute__((target("avx2")))
+	#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+	#define CX_PACKED_SSSE3
+	#define CX_PACKED_AVX2
+	#define CX_PACKED_TARGET_SSSE3
+	#define CX_PACKED_TARGET_AVX2
+	#include <intrin.h>
+	#include <immintrin.h>
+#endif
+#if defined(__aarch64__) || defined(_M_ARM64)
+	#define CX_PACKED_NEON
+	#include <arm_neon.h>
+#endif
+
+namespace AT {
+	namespace cx {
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		//! Implementations of the unpack kernels
+		enum packed_kernel
+		{
+			PACKED_KERNEL_SCALAR = 0,	//!< portable C++ implementation
+			PACKED_KERNEL_SSSE3 = 1,	//!< x86 SSSE3, 8 pixel per iteration
+			PACKED_KERNEL_AVX2 = 2,		//!< x86-64 AVX2, 16 pixel per iteration
+			PACKED_KERNEL_NEON = 3		//!< ARM64 NEON, 8 pixel per iteration
+		};
+
+		/** Returns the bits per pixel of the packed pixel formats CX_PF_MONO_10p (10), CX_PF_MONO_12p and CX_PF_COORD3D_C12p (12), 0 for other formats.
+			The formats follow the PFNC packing: pixels are a continuous little endian bit stream, each row starts at a byte boundary.
+		*/
+		inline unsigned packedBitsPerPixel(cx_pixel_format pf)
+		{
+			switch (pf)
+			{
+			case CX_PF_MONO_10p:		return 10;
+			case CX_PF_MONO_12p:		return 12;
+			case CX_PF_COORD3D_C12p:	return 12;
+			default:					return 0;
+			}
+		}
+
+		//! Returns the 16 bit pixel format a packed format is decoded to: CX_PF_COORD3D_C16 for CX_PF_COORD3D_C12p, CX_PF_MONO_16 otherwise.
+		inline cx_pixel_format unpackedFormat(cx_pixel_format pf)
+		{
+			if (packedBitsPerPixel(pf) == 0)
+				throw std::runtime_error("PackedDecode: pixel format is not packed");
+			return (pf == CX_PF_COORD3D_C12p) ? CX_PF_COORD3D_C16 : CX_PF_MONO_16;
+		}
+
+		namespace detail {
+			inline void unpack10pScalar(const uint8_t* src, uint16_t* dst, unsigned x, unsigned w)
+			{
+				for (; x + 4 <= w; x += 4)
+				{
+					const uint8_t* s = src + size_t(x) / 4 * 5;
+					dst[x] = uint16_t(s[0] | ((s[1] & 0x03) << 8));
+					dst[x + 1] = uint16_t((s[1] >> 2) | ((s[2] & 0x0F) << 6));
+					dst[x + 2] = uint16_t((s[2] >> 4) | ((s[3] & 0x3F) << 4));
+					dst[x + 3] = uint16_t((s[3] >> 6) | (s[4] << 2));
+				}
+				for (; x < w; x++)
+				{
+					size_t bit = size_t(x) * 10;
+					const uint8_t* s = src + bit / 8;
+					dst[x] = uint16_t(((s[0] | (s[1] << 8)) >> (bit & 7)) & 0x3FF);
+				}
+			}
+
+			inline void unpack12pScalar(const uint8_t* src, uint16_t* dst, unsigned x, unsigned w)
+			{
+				for (; x + 2 <= w; x += 2)
+				{
+					const uint8_t* s = src + size_t(x) / 2 * 3;
+					dst[x] = uint16_t(s[0] | ((s[1] & 0x0F) << 8));
+					dst[x + 1] = uint16_t((s[1] >> 4) | (s[2] << 4));
+				}
+				if (x < w)
+				{
+					const uint8_t* s = src + size_t(x) / 2 * 3;
+					dst[x] = uint16_t(s[0] | ((s[1] & 0x0F) << 8));
+				}
+			}
+
+#if defined(CX_PACKED_SSSE3)
+			// 8 pixel of 10 bit are read from 10 bytes: every lane gets the 2 bytes containing its pixel, the variable right shift by 0, 2, 4 or 6 bits
+			// is done by a multiplication, which moves the pixel to the upper bits, and a fixed right shift by 6.
+			// The kernels return the number of decoded pixels, a multiple of 8, the 16 byte loads never read beyond srcBytes.
+			CX_PACKED_TARGET_SSSE3 inline unsigned unpack10pSsse3(const uint8_t* src, size_t srcBytes, uint16_t* dst, unsigned w)
+			{
+				const __m128i shuf = _mm_setr_epi8(0, 1, 1, 2, 2, 3, 3, 4, 5, 6, 6, 7, 7, 8, 8, 9);
+				const __m128i mul = _mm_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1);
+				unsigned x = 0;
+				for (; x + 8 <= w && size_t(x) / 8 * 10 + 16 <= srcBytes; x += 8)
+				{
+					__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + size_t(x) / 8 * 10)), shuf);
+					v = _mm_srli_epi16(_mm_mullo_epi16(v, mul), 6);
+					_mm_storeu_si128((__m128i*)(dst + x), v);
+				}
+				return x;
+			}
+
+			// 8 pixel of 12 bit are read from 12 bytes, even pixels are the low 12 bits of their 2 bytes, odd pixels the high 12 bits.
+			CX_PACKED_TARGET_SSSE3 inline unsigned unpack12pSsse3(const uint8_t* src, size_t srcBytes, uint16_t* dst, unsigned w)
+			{
+				const __m128i shuf = _mm_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11);
+				const __m128i maskEven = _mm_set1_epi32(0x00000FFF);
+				const __m128i maskOdd = _mm_set1_epi32((int)0xFFFF0000);
+				unsigned x = 0;
+				for (; x + 8 <= w && size_t(x) / 8 * 12 + 16 <= srcBytes; x += 8)
+				{
+					__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + size_t(x) / 8 * 12)), shuf);
+					v = _mm_or_si128(_mm_and_si128(v, maskEven), _mm_and_si128(_mm_srli_epi16(v, 4), maskOdd));
+					_mm_storeu_si128((__m128i*)(dst + x), v);
+				}
+				return x;
+			}
+#endif
+
+#if defined(CX_PACKED_AVX2)
+			// same as the SSSE3 kernels, the upper 128 bit lane decodes the following 8 pixels
+			CX_PACKED_TARGET_AVX2 inline unsigned unpack10pAvx2(const uint8_t* src, size_t srcBytes, uint16_t* dst, unsigned w)
+			{
+				const __m256i shuf = _mm256_setr_epi8(0, 1, 1, 2, 2, 3, 3, 4, 5, 6, 6, 7, 7, 8, 8, 9, 0, 1, 1, 2, 2, 3, 3, 4, 5, 6, 6, 7, 7, 8, 8, 9);
+				const __m256i mul = _mm256_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1, 64, 16, 4, 1, 64, 16, 4, 1);
+				unsigned x = 0;
+				for (; x + 16 <= w && size_t(x) / 8 * 10 + 26 <= srcBytes; x += 16)
+				{
+					const uint8_t* s = src + size_t(x) / 8 * 10;
+					__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)s)), _mm_loadu_si128((const __m128i*)(s + 10)), 1);
+					v = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_shuffle_epi8(v, shuf), mul), 6);
+					_mm256_storeu_si256((__m256i*)(dst + x), v);
+				}
+				return x;
+			}
+
+			CX_PACKED_TARGET_AVX2 inline unsigned unpack12pAvx2(const uint8_t* src, size_t srcBytes, uint16_t* dst, unsigned w)
+			{
+				const __m256i shuf = _mm256_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11, 0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11);
+				const __m256i maskEven = _mm256_set1_epi32(0x00000FFF);
+				const __m256i maskOdd = _mm256_set1_epi32((int)0xFFFF0000);
+				unsigned x = 0;
+				for (; x + 16 <= w && size_t(x) / 8 * 12 + 28 <= srcBytes; x += 16)
+				{
+					const uint8_t* s = src + size_t(x) / 8 * 12;
+					__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)s)), _mm_loadu_si128((const __m128i*)(s + 12)), 1);
+					v = _mm256_shuffle_epi8(v, shuf);
+					v = _mm256_or_si256(_mm256_and_si256(v, maskEven), _mm256_and_si256(_mm256_srli_epi16(v, 4), maskOdd));
+					_mm256_storeu_si256((__m256i*)(dst + x), v);
+				}
+				return x;
+			}
+#endif
+
+#if defined(CX_PACKED_NEON)
+			// NEON has variable shifts per lane, the pixel is shifted down and masked
+			inline unsigned unpack10pNeon(const uint8_t* src, size_t srcBytes, uint16_t* dst, unsigned w)
+			{
+				static const uint8_t shufIdx[16] = { 0, 1, 1, 2, 2, 3, 3, 4, 5, 6, 6, 7, 7, 8, 8, 9 };
+				static const int16_t shiftIdx[8] = { 0, -2, -4, -6, 0, -2, -4, -6 };
+				const uint8x16_t shuf = vld1q_u8(shufIdx);
+				const int16x8_t shift = vld1q_s16(shiftIdx);
+				const uint16x8_t mask = vdupq_n_u16(0x3FF);
+				unsigned x = 0;
+				for (; x + 8 <= w && size_t(x) / 8 * 10 + 16 <= srcBytes; x += 8)
+				{
+					uint16x8_t v = vreinterpretq_u16_u8(vqtbl1q_u8(vld1q_u8(src + size_t(x) / 8 * 10), shuf));
+					vst1q_u16(dst + x, vandq_u16(vshlq_u16(v, shift), mask));
+				}
+				return x;
+			}
+
+			inline unsigned unpack12pNeon(const uint8_t* src, size_t srcBytes, uint16_t* dst, unsigned w)
+			{
+				static const uint8_t shufIdx[16] = { 0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11 };
+				static const int16_t shiftIdx[8] = { 0, -4, 0, -4, 0, -4, 0, -4 };
+				static const uint16_t maskIdx[8] = { 0x0FFF, 0xFFFF, 0x0FFF, 0xFFFF, 0x0FFF, 0xFFFF, 0x0FFF, 0xFFFF };
+				const uint8x16_t shuf = vld1q_u8(shufIdx);
+				const int16x8_t shift = vld1q_s16(shiftIdx);
+				const uint16x8_t mask = vld1q_u16(maskIdx);
+				unsigned x = 0;
+				for (; x + 8 <= w && size_t(x) / 8 * 12 + 16 <= srcBytes; x += 8)
+				{
+					uint16x8_t v = vreinterpretq_u16_u8(vqtbl1q_u8(vld1q_u8(src + size_t(x) / 8 * 12), shuf));
+					vst1q_u16(dst + x, vandq_u16(vshlq_u16(v, shift), mask));
+				}
+				return x;
+			}
+#endif
+
+			inline bool cpuHasSsse3()
+			{
+#if defined(CX_PACKED_SSSE3) && defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 1);
+				return (info[2] & (1 << 9)) != 0;
+#elif defined(CX_PACKED_SSSE3)
+				__builtin_cpu_init();
+				return __builtin_cpu_supports("ssse3") != 0;
+#else
+				return false;
+#endif
+			}
+
+			inline bool cpuHasAvx2()
+			{
+#if defined(CX_PACKED_AVX2) && defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 0);
+				if (info[0] < 7)
+					return false;
+				__cpuid(info, 1);
+				bool osxsave = (info[2] & (1 << 27)) != 0;
+				if (!osxsave || (_xgetbv(0) & 6) != 6)
+					return false;
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+#elif defined(CX_PACKED_AVX2)
+				__builtin_cpu_init();
+				return __builtin_cpu_supports("avx2") != 0;
+#else
+				return false;
+#endif
+			}
+		}
+
+		inline bool packedKernelSupported(packed_kernel k)
+		{
+			switch (k)
+			{
+			case PACKED_KERNEL_SCALAR:	return true;
+#if defined(CX_PACKED_SSSE3)
+			case PACKED_KERNEL_SSSE3:	return detail::cpuHasSsse3();
+#endif
+#if defined(CX_PACKED_AVX2)
+			case PACKED_KERNEL_AVX2:	return detail::cpuHasAvx2();
+#endif
+#if defined(CX_PACKED_NEON)
+			case PACKED_KERNEL_NEON:	return true;
+#endif
+			default:					return false;
+			}
+		}
+
+		//! Returns the fastest kernel supported by the CPU, the detection runs once.
+		inline packed_kernel detectPackedKernel()
+		{
+			static const packed_kernel k = packedKernelSupported(PACKED_KERNEL_AVX2) ? PACKED_KERNEL_AVX2
+				: packedKernelSupported(PACKED_KERNEL_NEON) ? PACKED_KERNEL_NEON
+				: packedKernelSupported(PACKED_KERNEL_SSSE3) ? PACKED_KERNEL_SSSE3
+				: PACKED_KERNEL_SCALAR;
+			return k;
+		}
+
+		/** Unpack one row of a packed pixel format to 16 bit.
+			@param bits			bits per pixel, 10 or 12, see \ref packedBitsPerPixel
+			@param src			packed row
+			@param srcBytes		readable bytes of the row, at least (w * bits + 7) / 8. SIMD kernels process more pixels at once if more bytes are readable, e.g. the line pitch.
+			@param dst			destination row of w pixels
+			@param w			number of pixels
+			@param k			kernel, the kernel must be supported by the CPU.
+		*/
+		inline void unpackRow(unsigned bits, const uint8_t* src, size_t srcBytes, uint16_t* dst, unsigned w, packed_kernel k = detectPackedKernel())
+		{
+			if (srcBytes < (size_t(w) * bits + 7) / 8)
+				throw std::runtime_error("PackedDecode: source row too short");
+			unsigned x = 0;
+			if (bits == 10)
+			{
+				switch (k)
+				{
+#if defined(CX_PACKED_AVX2)
+				case PACKED_KERNEL_AVX2: x = detail::unpack10pAvx2(src, srcBytes, dst, w); break;
+#endif
+#if defined(CX_PACKED_SSSE3)
+				case PACKED_KERNEL_SSSE3: x = detail::unpack10pSsse3(src, srcBytes, dst, w); break;
+#endif
+#if defined(CX_PACKED_NEON)
+				case PACKED_KERNEL_NEON: x = detail::unpack10pNeon(src, srcBytes, dst, w); break;
+#endif
+				default: break;
+				}
+				detail::unpack10pScalar(src, dst, x, w);
+			}
+			else if (bits == 12)
+			{
+				switch (k)
+				{
+#if defined(CX_PACKED_AVX2)
+				case PACKED_KERNEL_AVX2: x = detail::unpack12pAvx2(src, srcBytes, dst, w); break;
+#endif
+#if defined(CX_PACKED_SSSE3)
+				case PACKED_KERNEL_SSSE3: x = detail::unpack12pSsse3(src, srcBytes, dst, w); break;
+#endif
+#if defined(CX_PACKED_NEON)
+				case PACKED_KERNEL_NEON: x = detail::unpack12pNeon(src, srcBytes, dst, w); break;
+#endif
+				default: break;
+				}
+				detail::unpack12pScalar(src, dst, x, w);
+			}
+			else
+				throw std::runtime_error("PackedDecode: unsupported bits per pixel");
+		}
+
+		//! @} cx_wrapper_cpp
+	}
+}
+
+#endif	// AT_CX_PACKEDDECODE_H_INCLUDED
@@ -0,0 +1,227 @@
+/**
+@file : ThreadPool.h
+@package : cx_base library
+@brief C++ thread pool for data parallel processing
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_THREADPOOL_H_INCLUDED
+#define AT_CX_THREADPOOL_H_INCLUDED
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <stdint.h>
+
+namespace AT {
+	namespace cx {
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		/** Class ThreadPool runs data parallel loops on a fixed set of worker threads.
+			The calling thread takes part in the work, so a pool with numThreads=N uses N-1 worker threads.
+
+			\code{.cpp}
+				cx::ThreadPool pool(8);
+				pool.parallelFor(img.height(), [&](size_t row) {
+					// process row ...
+				});
+			\endcode
+
+			\note parallelFor calls from different threads are serialized, nested calls from within a task are executed serially by the calling task.
+		*/
+		class ThreadPool
+		{
+		public:
+			typedef std::shared_ptr<ThreadPool> Ptr;
+
+			/** Create thread pool.
+				@param numThreads	number of threads including the calling thread, 0 uses std::thread::hardware_concurrency.
+			*/
+			explicit ThreadPool(unsigned numThreads = 0) : m_numThreads(numThreads), m_generation(0), m_stop(false), m_activeWorkers(0), m_func(nullptr), m_numTasks(0), m_nextTask(0), m_doneTasks(0)
+			{
+				if (m_numThreads == 0)
+					m_numThreads = std::max(1u, std::thread::hardware_concurrency());
+				for (unsigned i = 1; i < m_numThreads; i++)
+					m_workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+			}
+
+			~ThreadPool()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stop = true;
+				}
+				m_wakeWorkers.notify_all();
+				for (size_t i = 0; i < m_workers.size(); i++)
+					m_workers[i].join();
+			}
+
+			static ThreadPool::Ptr createShared(unsigned numThreads = 0)
+			{
+				return std::make_shared<ThreadPool>(numThreads);
+			}
+
+			/** Process pool shared by the wrapper functions if no pool is given explicitly, uses all hardware threads.
+			*/
+			static ThreadPool& defaultPool()
+			{
+				static ThreadPool pool;
+				return pool;
+			}
+
+			unsigned numThreads() const { return m_numThreads; }
+
+			/** Call func(taskIdx) for taskIdx in [0, numTasks) in parallel and wait until all tasks are finished.
+				If a task throws, the remaining tasks are still executed and the first exception is rethrown to the caller.
+			*/
+			void parallelFor(size_t numTasks, const std::function<void(size_t)>& func)
+			{
+				if (numTasks == 0)
+					return;
+				if (numTasks == 1 || m_workers.empty() || isWorkerThread())
+				{
+					for (size_t i = 0; i < numTasks; i++)
+						func(i);
+					return;
+				}
+
+				std::lock_guard<std::mutex> submitLock(m_submitMutex);
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_func = &func;
+					m_numTasks = numTasks;
+					m_nextTask = 0;
+					m_doneTasks = 0;
+					m_exception = std::exception_ptr();
+					m_generation++;
+				}
+				m_wakeWorkers.notify_all();
+
+				isWorkerThread() = true;
+				runTasks();
+				isWorkerThread() = false;
+
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_tasksDone.wait(lock, [this]() { return m_doneTasks == m_numTasks && m_activeWorkers == 0; });
+				m_func = nullptr;
+				if (m_exception)
+					std::rethrow_exception(m_exception);
+			}
+
+			/** Split range [0, count) in chunks of at least minChunk elements and call func(begin, end) in parallel for each chunk.
+			*/
+			void parallelForRange(size_t count, size_t minChunk, const std::function<void(size_t, size_t)>& func)
+			{
+				if (count == 0)
+					return;
+				size_t numChunks = std::min<size_t>(m_numThreads, (count + minChunk - 1) / std::max<size_t>(minChunk, 1));
+				numChunks = std::max<size_t>(numChunks, 1);
+				parallelFor(numChunks, [&](size_t chunkIdx) {
+					size_t begin = count * chunkIdx / numChunks;
+					size_t end = count * (chunkIdx + 1) / numChunks;
+					func(begin, end);
+				});
+			}
+
+		private:
+			ThreadPool(const ThreadPool&);
+			ThreadPool& operator=(const ThreadPool&);
+
+			static bool& isWorkerThread()
+			{
+				static thread_local bool inPool = false;
+				return inPool;
+			}
+
+			void runTasks()
+			{
+				for (;;)
+				{
+					size_t idx = m_nextTask++;
+					if (idx >= m_numTasks)
+						break;
+					try
+					{
+						(*m_func)(idx);
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						if (!m_exception)
+							m_exception = std::current_exception();
+					}
+					if (++m_doneTasks == m_numTasks)
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						m_tasksDone.notify_all();
+					}
+				}
+			}
+
+			void workerLoop()
+			{
+				isWorkerThread() = true;
+				uint64_t generation = 0;
+				for (;;)
+				{
+					{
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_wakeWorkers.wait(lock, [&]() { return m_stop || (m_generation != generation && m_func != nullptr); });
+						if (m_stop)
+							return;
+						generation = m_generation;
+						m_activeWorkers++;
+					}
+					runTasks();
+					{
+						// the caller waits until all workers left runTasks before the next job is set up
+						std::lock_guard<std::mutex> lock(m_mutex);
+						m_activeWorkers--;
+						m_tasksDone.notify_all();
+					}
+				}
+			}
+
+			unsigned m_numThreads;
+			std::vector<std::thread> m_workers;
+			std::mutex m_submitMutex;
+			std::mutex m_mutex;
+			std::condition_variable m_wakeWorkers;
+			std::condition_variable m_tasksDone;
+			uint64_t m_generation;
+			bool m_stop;
+			unsigned m_activeWorkers;
+
+			const std::function<void(size_t)>* m_func;
+			std::atomic<size_t> m_numTasks;
+			std::atomic<size_t> m_nextTask;
+			std::atomic<size_t> m_doneTasks;
+			std::exception_ptr m_exception;
+		};
+
+		typedef ThreadPool::Ptr ThreadPoolPtr;
+
+		//! @} cx_wrapper_cpp
+	}	// namespace cx
+}	// namespace AT
+#endif	// AT_CX_THREADPOOL_H_INCLUDED
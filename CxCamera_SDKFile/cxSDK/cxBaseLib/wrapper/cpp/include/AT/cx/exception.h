@@ -34,8 +34,13 @@ namespace AT {
 		class RuntimeError : public std::runtime_error
 		{
 		public:
-			RuntimeError(cx_status_t err) : std::runtime_error(std::string("cx runtime error: ") + cx_status_getText(err)) {}
-			RuntimeError(const std::string& func, cx_status_t err) : std::runtime_error(func + " :" + cx_status_getText(err)) {}
+			RuntimeError(cx_status_t err) : std::runtime_error(std::string("cx runtime error: ") + cx_status_getText(err)), m_status(err) {}
+			RuntimeError(const std::string& func, cx_status_t err) : std::runtime_error(func + " :" + cx_status_getText(err)), m_status(err) {}
+
+			cx_status_t status() const { return m_status; }		//!< status that caused the exception
+
+		private:
+			cx_status_t m_status;
 		};
 
 		/** exception that is thrown wenn conversion to or from variant fails within Variant assigment or cast operators.
@@ -0,0 +1,521 @@
+/**
+@file : AcquisitionPipeline.h
+@package : cx_cam library
+@brief C++ multi-threaded acquisition pipeline
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_ACQUISITIONPIPELINE_H_INCLUDED
+#define AT_CX_ACQUISITIONPIPELINE_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <stdexcept>
+
+#include "AT/cx/base.h"
+#include "AT/cx/BoundedQueue.h"
+#include "AT/cx/Device.h"
+
+namespace AT {
+	namespace cx {
+
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		/** Class AcquisitionPipeline decouples buffer acquisition from buffer processing.
+			A grabber thread calls Device::tryWaitForBuffer and hands every DeviceBuffer to the first processing stage.
+			Each stage owns a bounded lock-free queue and a number of worker threads running the user supplied stage function.
+			After the last stage has finished (or a stage dropped the frame) the buffer is queued back to the device automatically, stage functions must not call DeviceBuffer::queueBuffer.
+
+			\code{.cpp}
+				auto cam = cx::DeviceFactory::openDevice(uri);
+				cx::AcquisitionPipeline pipeline(cam);
+				pipeline.addStage("range2abc", [&](cx::AcquisitionPipeline::Frame& frame) {
+					cx::Image rangeImg;
+					frame.buffer.getImage(rangeImg);
+					// compute point cloud ...
+					return true;
+				}, 4, 8, cx::AcquisitionPipeline::BACKPRESSURE_DROP_OLDEST);
+				pipeline.addStage("sink", [&](cx::AcquisitionPipeline::Frame& frame) {
+					// store or display results ...
+					return true;
+				});
+				cam->allocAndQueueBuffers(16);
+				cam->startAcquisition();
+				pipeline.start();
+				// ...
+				pipeline.stop();
+				cam->stopAcquisition();
+				cam->freeBuffers();
+			\endcode
+
+			\note Stages with more than one worker may process frames out of order, use Frame::sequence if the order is relevant.
+			The number of device buffers should be larger than the sum of all queue depths plus the number of workers, otherwise the device runs out of buffers before backpressure takes effect.
+		*/
+		class AcquisitionPipeline
+		{
+		public:
+			typedef std::shared_ptr<AcquisitionPipeline> Ptr;
+
+			/** Behaviour of a stage when its input queue is full.
+			*/
+			enum backpressure_policy {
+				BACKPRESSURE_BLOCK = 0,			//!< the upstream thread waits until space is available, for the first stage this stalls the grabber and the device buffers fill up
+				BACKPRESSURE_DROP_OLDEST = 1,	//!< the oldest queued frame is released and the new frame is queued
+				BACKPRESSURE_DROP_NEWEST = 2,	//!< the new frame is released, the queue content is kept
+			};
+
+			/** Frame passed through the stages.
+				Frames are allocated once in start() and recycled, the context object is created once per frame by the context factory and can hold per frame results (e.g. a point cloud) that are reused for every buffer.
+			*/
+			struct Frame
+			{
+				Frame() : buffer(CX_INVALID_HANDLE), sequence(0) {}
+
+				cx::DeviceBuffer buffer;							//!< acquired buffer, queued back to the device after the last stage
+				uint64_t sequence;									//!< running number assigned by the grabber thread
+				std::chrono::steady_clock::time_point grabTime;		//!< host time when the buffer was received
+				std::shared_ptr<void> context;						//!< user context created by the context factory, see setContextFactory
+			};
+
+			/** Stage function, called from a worker thread for every frame.
+				@return true to forward the frame to the next stage, false to drop the frame.
+				Exceptions thrown by the function are counted as errors and drop the frame.
+			*/
+			typedef std::function<bool(Frame& frame)> StageFunction;
+
+			/** Statistics of a single stage.
+			*/
+			struct StageStats
+			{
+				std::string name;			//!< name of the stage
+				size_t queueDepth;			//!< number of frames waiting in the input queue
+				size_t queueCapacity;		//!< capacity of the input queue
+				unsigned numWorkers;		//!< number of worker threads
+				uint64_t processed;			//!< number of frames processed by the stage function
+				uint64_t dropped;			//!< number of frames dropped because of backpressure or by the stage function
+				uint64_t errors;			//!< number of frames dropped because the stage function has thrown an exception
+			};
+
+			AcquisitionPipeline(const DevicePtr& device) : m_device(device), m_timeout(100), m_running(false), m_stopGrabber(false), m_numFrames(0), m_grabberWaiting(false),
+				m_grabbed(0), m_timeouts(0), m_grabErrors(0), m_requeueErrors(0)
+			{
+				if (!m_device)
+					throw std::runtime_error("AcquisitionPipeline: invalid device");
+			}
+
+			~AcquisitionPipeline()
+			{
+				stop(false);
+			}
+
+			static Ptr createShared(const DevicePtr& device)
+			{
+				return std::make_shared<AcquisitionPipeline>(device);
+			}
+
+			/** Append a processing stage.
+				@param name			name of the stage, used in statistics and error reports.
+				@param func			stage function.
+				@param numWorkers	number of worker threads running the stage function.
+				@param queueDepth	capacity of the stage input queue.
+				@param policy		behaviour when the input queue is full.
+				@return index of the stage.
+			*/
+			size_t addStage(const std::string& name, const StageFunction& func, unsigned numWorkers = 1, size_t queueDepth = 4, backpressure_policy policy = BACKPRESSURE_BLOCK)
+			{
+				if (m_running)
+					throw std::runtime_error("AcquisitionPipeline: stages can't be added while the pipeline is running");
+				if (!func || numWorkers == 0)
+					throw std::runtime_error("AcquisitionPipeline: invalid stage " + name);
+				m_stages.push_back(std::unique_ptr<Stage>(new Stage(name, func, numWorkers, queueDepth, policy)));
+				return m_stages.size() - 1;
+			}
+
+			/** Set factory for user contexts, called once for every frame in start().
+			*/
+			void setContextFactory(const std::function<std::shared_ptr<void>()>& factory)
+			{
+				m_contextFactory = factory;
+			}
+
+			/** Set handler called from the worker thread when a stage function throws an exception.
+				Exceptions not derived from std::exception are passed as std::runtime_error.
+			*/
+			void setErrorHandler(const std::function<void(const std::string& stageName, const std::exception& e)>& handler)
+			{
+				m_errorHandler = handler;
+			}
+
+			/** Set the timeout in ms used by the grabber thread in each call to Device::tryWaitForBuffer.
+				The timeout limits the latency of stop(), it does not limit the time to wait for the next buffer.
+			*/
+			void setGrabTimeout(unsigned timeout) { m_timeout = timeout; }
+
+			/** Start grabber and worker threads.
+				The device acquisition must be started separately, see Device::allocAndQueueBuffers and Device::startAcquisition.
+			*/
+			void start()
+			{
+				if (m_running)
+					return;
+				if (m_stages.empty())
+					throw std::runtime_error("AcquisitionPipeline: no stages defined");
+
+				// every frame is either free, queued in a stage, processed by a worker or held by the grabber
+				size_t numFrames = 1;
+				for (size_t i = 0; i < m_stages.size(); i++)
+					numFrames += m_stages[i]->queue.capacity() + m_stages[i]->numWorkers;
+				if (numFrames != m_numFrames || !m_freeFrames)
+				{
+					m_frames.clear();
+					m_frames.resize(numFrames);
+					m_freeFrames.reset(new BoundedQueue<Frame*>(numFrames));
+					m_numFrames = numFrames;
+				}
+				Frame* f = nullptr;
+				while (m_freeFrames->tryPop(f))
+					;
+				for (size_t i = 0; i < m_frames.size(); i++)
+				{
+					m_frames[i].buffer = DeviceBuffer(CX_INVALID_HANDLE);
+					if (m_contextFactory && !m_frames[i].context)
+						m_frames[i].context = m_contextFactory();
+					m_freeFrames->tryPush(&m_frames[i]);
+				}
+
+				m_stopGrabber = false;
+				m_running = true;
+				for (size_t i = 0; i < m_stages.size(); i++)
+				{
+					Stage& stage = *m_stages[i];
+					stage.closing = false;
+					stage.abort = false;
+					for (unsigned w = 0; w < stage.numWorkers; w++)
+						stage.workers.push_back(std::thread(&AcquisitionPipeline::workerLoop, this, i));
+				}
+				m_grabber = std::thread(&AcquisitionPipeline::grabberLoop, this);
+			}
+
+			/** Stop grabber and worker threads.
+				@param drain	if true, frames already in the pipeline are processed by all stages before the workers exit, otherwise they are released unprocessed.
+			*/
+			void stop(bool drain = true)
+			{
+				if (!m_running)
+					return;
+
+				m_stopGrabber = true;
+				if (m_grabber.joinable())
+					m_grabber.join();
+
+				// close the stages in order, so frames drained from stage i can still be passed to stage i+1
+				for (size_t i = 0; i < m_stages.size(); i++)
+				{
+					Stage& stage = *m_stages[i];
+					{
+						std::lock_guard<std::mutex> lock(stage.mutex);
+						stage.closing = true;
+						stage.abort = !drain;
+					}
+					stage.notEmpty.notify_all();
+					stage.notFull.notify_all();
+					for (size_t w = 0; w < stage.workers.size(); w++)
+						stage.workers[w].join();
+					stage.workers.clear();
+
+					Frame* f;
+					while (stage.queue.tryPop(f))
+						releaseFrame(f);
+				}
+				m_running = false;
+			}
+
+			bool isRunning() const { return m_running; }
+
+			size_t numStages() const { return m_stages.size(); }
+
+			/** Returns number of frames waiting in the input queue of the given stage.
+			*/
+			size_t getQueueDepth(size_t stageIdx) const
+			{
+				return m_stages.at(stageIdx)->queue.size();
+			}
+
+			StageStats getStageStats(size_t stageIdx) const
+			{
+				const Stage& stage = *m_stages.at(stageIdx);
+				StageStats stats;
+				stats.name = stage.name;
+				stats.queueDepth = stage.queue.size();
+				stats.queueCapacity = stage.queue.capacity();
+				stats.numWorkers = stage.numWorkers;
+				stats.processed = stage.processed;
+				stats.dropped = stage.dropped;
+				stats.errors = stage.errors;
+				return stats;
+			}
+
+			uint64_t numGrabbed() const { return m_grabbed; }				//!< number of buffers received from the device
+			uint64_t numTimeouts() const { return m_timeouts; }				//!< number of tryWaitForBuffer calls that timed out
+			uint64_t numGrabErrors() const { return m_grabErrors; }			//!< number of tryWaitForBuffer calls that failed with other errors than timeout
+			uint64_t numRequeueErrors() const { return m_requeueErrors; }	//!< number of failed DeviceBuffer::queueBuffer calls
+
+		private:
+			AcquisitionPipeline(const AcquisitionPipeline&);
+			AcquisitionPipeline& operator=(const AcquisitionPipeline&);
+
+			struct Stage
+			{
+				Stage(const std::string& n, const StageFunction& f, unsigned nw, size_t depth, backpressure_policy p)
+					: name(n), func(f), numWorkers(nw), policy(p), queue(depth), closing(false), abort(false),
+					waitingConsumers(0), waitingProducers(0), processed(0), dropped(0), errors(0) {}
+
+				std::string name;
+				StageFunction func;
+				unsigned numWorkers;
+				backpressure_policy policy;
+				BoundedQueue<Frame*> queue;
+				std::vector<std::thread> workers;
+
+				// the mutex is only taken by threads going to sleep and by threads waking them up, the data path is lock-free
+				std::mutex mutex;
+				std::condition_variable notEmpty;
+				std::condition_variable notFull;
+				std::atomic<bool> closing;
+				std::atomic<bool> abort;
+				std::atomic<int> waitingConsumers;
+				std::atomic<int> waitingProducers;
+
+				std::atomic<uint64_t> processed;
+				std::atomic<uint64_t> dropped;
+				std::atomic<uint64_t> errors;
+			};
+
+			static void wakeOne(Stage& stage, std::atomic<int>& waiting, std::condition_variable& cv)
+			{
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (waiting.load() > 0)
+				{
+					std::lock_guard<std::mutex> lock(stage.mutex);
+					cv.notify_one();
+				}
+			}
+
+			// queue the buffer back to the device and return the frame to the free list
+			void releaseFrame(Frame* f)
+			{
+				if (f->buffer.isValid())
+				{
+					try
+					{
+						f->buffer.queueBuffer();
+					}
+					catch (const std::exception&)
+					{
+						m_requeueErrors++;
+					}
+					f->buffer = DeviceBuffer(CX_INVALID_HANDLE);
+				}
+				m_freeFrames->tryPush(f);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (m_grabberWaiting.load())
+				{
+					std::lock_guard<std::mutex> lock(m_freeMutex);
+					m_freeAvailable.notify_one();
+				}
+			}
+
+			// pass frame to stage stageIdx, or release it after the last stage
+			void dispatch(size_t stageIdx, Frame* f)
+			{
+				if (stageIdx >= m_stages.size())
+				{
+					releaseFrame(f);
+					return;
+				}
+
+				Stage& stage = *m_stages[stageIdx];
+				while (!stage.queue.tryPush(f))
+				{
+					if (stage.policy == BACKPRESSURE_DROP_NEWEST)
+					{
+						stage.dropped++;
+						releaseFrame(f);
+						return;
+					}
+					else if (stage.policy == BACKPRESSURE_DROP_OLDEST)
+					{
+						Frame* oldest = nullptr;
+						if (stage.queue.tryPop(oldest))
+						{
+							stage.dropped++;
+							releaseFrame(oldest);
+						}
+					}
+					else
+					{
+						std::unique_lock<std::mutex> lock(stage.mutex);
+						stage.waitingProducers++;
+						std::atomic_thread_fence(std::memory_order_seq_cst);
+						if (stage.queue.size() >= stage.queue.capacity() && !stage.abort)
+							stage.notFull.wait_for(lock, std::chrono::milliseconds(100));
+						stage.waitingProducers--;
+						if (stage.abort)
+						{
+							lock.unlock();
+							releaseFrame(f);
+							return;
+						}
+					}
+				}
+				wakeOne(stage, stage.waitingConsumers, stage.notEmpty);
+			}
+
+			// wait for next frame of a stage, returns false when the stage is closed and drained
+			bool popFrame(Stage& stage, Frame*& f)
+			{
+				for (;;)
+				{
+					if (stage.queue.tryPop(f))
+					{
+						wakeOne(stage, stage.waitingProducers, stage.notFull);
+						return true;
+					}
+					std::unique_lock<std::mutex> lock(stage.mutex);
+					if (stage.closing)
+						return stage.queue.tryPop(f);
+					stage.waitingConsumers++;
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if (stage.queue.empty() && !stage.closing)
+						stage.notEmpty.wait_for(lock, std::chrono::milliseconds(100));
+					stage.waitingConsumers--;
+				}
+			}
+
+			void workerLoop(size_t stageIdx)
+			{
+				Stage& stage = *m_stages[stageIdx];
+				Frame* f = nullptr;
+				while (popFrame(stage, f))
+				{
+					if (stage.abort)
+					{
+						releaseFrame(f);
+						continue;
+					}
+
+					bool forward = false;
+					try
+					{
+						forward = stage.func(*f);
+						stage.processed++;
+						if (!forward)
+							stage.dropped++;
+					}
+					catch (const std::exception& e)
+					{
+						stage.errors++;
+						if (m_errorHandler)
+							m_errorHandler(stage.name, e);
+					}
+					catch (...)
+					{
+						stage.errors++;
+						if (m_errorHandler)
+							m_errorHandler(stage.name, std::runtime_error("AcquisitionPipeline: unknown exception in stage " + stage.name));
+					}
+
+					if (forward)
+						dispatch(stageIdx + 1, f);
+					else
+						releaseFrame(f);
+				}
+			}
+
+			void grabberLoop()
+			{
+				while (!m_stopGrabber)
+				{
+					// frames are sized so that this only waits if stages hold more frames than configured
+					Frame* f = nullptr;
+					if (!m_freeFrames->tryPop(f))
+					{
+						std::unique_lock<std::mutex> lock(m_freeMutex);
+						m_grabberWaiting = true;
+						std::atomic_thread_fence(std::memory_order_seq_cst);
+						if (m_freeFrames->empty())
+							m_freeAvailable.wait_for(lock, std::chrono::milliseconds(10));
+						m_grabberWaiting = false;
+						continue;
+					}
+
+					cx_status_t status = m_device->tryWaitForBuffer(f->buffer, m_timeout);
+					if (status != CX_STATUS_OK)
+					{
+						if (status == CX_STATUS_TIMEOUT)
+							m_timeouts++;
+						else
+						{
+							m_grabErrors++;
+							std::this_thread::sleep_for(std::chrono::milliseconds(1));	// don't spin on a failing device
+						}
+						m_freeFrames->tryPush(f);
+						continue;
+					}
+
+					f->sequence = m_grabbed++;
+					f->grabTime = std::chrono::steady_clock::now();
+					dispatch(0, f);
+				}
+			}
+
+			DevicePtr m_device;
+			std::vector<std::unique_ptr<Stage>> m_stages;
+			std::function<std::shared_ptr<void>()> m_contextFactory;
+			std::function<void(const std::string&, const std::exception&)> m_errorHandler;
+			unsigned m_timeout;
+
+			std::thread m_grabber;
+			std::atomic<bool> m_running;
+			std::atomic<bool> m_stopGrabber;
+
+			std::vector<Frame> m_frames;
+			size_t m_numFrames;
+			std::unique_ptr<BoundedQueue<Frame*>> m_freeFrames;
+			std::mutex m_freeMutex;
+			std::condition_variable m_freeAvailable;
+			std::atomic<bool> m_grabberWaiting;
+
+			std::atomic<uint64_t> m_grabbed;
+			std::atomic<uint64_t> m_timeouts;
+			std::atomic<uint64_t> m_grabErrors;
+			std::atomic<uint64_t> m_requeueErrors;
+		};
+
+		typedef AcquisitionPipeline::Ptr AcquisitionPipelinePtr;
+
+		//! @} cx_wrapper_cpp
+	}	// namespace cx
+}	// namespace AT
+#endif	// AT_CX_ACQUISITIONPIPELINE_H_INCLUDED
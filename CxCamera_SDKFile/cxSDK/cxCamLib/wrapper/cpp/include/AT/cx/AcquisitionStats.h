@@ -0,0 +1,396 @@
+/**
+@file : AcquisitionStats.h
+@package : cx_cam library
+@brief C++ lock-free counters and latency histograms of the acquisition path
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_ACQUISITIONSTATS_H_INCLUDED
+#define AT_CX_ACQUISITIONSTATS_H_INCLUDED
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace AT {
+	namespace cx {
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		/** Histogram with logarithmic buckets for values from 0 to 2^64-1, e.g. latencies in ns.
+			Values below 64 are counted exactly, larger values in 32 sub-buckets per power of two, i.e. with a relative resolution of about 3%.
+			record() is wait-free and can be called from several threads, snapshot() reads the buckets without lock while recording continues.
+		*/
+		class LatencyHistogram
+		{
+		public:
+			enum
+			{
+				SUB_BITS = 5,
+				SUB_COUNT = 1 << SUB_BITS,
+				NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT
+			};
+
+			//! Copy of the histogram, percentiles are computed from the copy.
+			struct Snapshot
+			{
+				Snapshot() : count(0), sum(0), min(0), max(0) {}
+
+				std::vector<uint64_t> buckets;
+				uint64_t count;
+				uint64_t sum;
+				uint64_t min;
+				uint64_t max;
+
+				double mean() const { return count ? double(sum) / double(count) : 0.0; }
+
+				/** Returns the value below or equal to which the given percentage of the recorded values lies, within the bucket resolution.
+					@param p	percentile 0..100
+				*/
+				uint64_t percentile(double p) const
+				{
+					if (count == 0)
+						return 0;
+					uint64_t total = 0;
+					for (size_t i = 0; i < buckets.size(); i++)
+						total += buckets[i];
+					uint64_t target = uint64_t(p / 100.0 * double(total) + 0.5);
+					target = (target < 1) ? 1 : (target > total ? total : target);
+					uint64_t n = 0;
+					for (size_t i = 0; i < buckets.size(); i++)
+					{
+						n += buckets[i];
+						if (n >= target)
+						{
+							uint64_t v = (i + 1 < size_t(NUM_BUCKETS)) ? lowerBound(i + 1) - 1 : std::numeric_limits<uint64_t>::max();
+							return (v < max) ? ((v > min) ? v : min) : max;
+						}
+					}
+					return max;
+				}
+			};
+
+			LatencyHistogram() : m_buckets(new std::atomic<uint64_t>[NUM_BUCKETS])
+			{
+				reset();
+			}
+
+			void record(uint64_t v)
+			{
+				m_buckets[index(v)].fetch_add(1, std::memory_order_relaxed);
+				m_sum.fetch_add(v, std::memory_order_relaxed);
+				uint64_t cur = m_min.load(std::memory_order_relaxed);
+				while (v < cur && !m_min.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+					;
+				cur = m_max.load(std::memory_order_relaxed);
+				while (v > cur && !m_max.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+					;
+				m_count.fetch_add(1, std::memory_order_release);
+			}
+
+			Snapshot snapshot() const
+			{
+				Snapshot s;
+				s.count = m_count.load(std::memory_order_acquire);
+				s.sum = m_sum.load(std::memory_order_relaxed);
+				s.min = s.count ? m_min.load(std::memory_order_relaxed) : 0;
+				s.max = m_max.load(std::memory_order_relaxed);
+				s.buckets.resize(NUM_BUCKETS);
+				for (size_t i = 0; i < size_t(NUM_BUCKETS); i++)
+					s.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+				return s;
+			}
+
+			//! Clears the histogram, values recorded concurrently may be partially lost.
+			void reset()
+			{
+				for (size_t i = 0; i < size_t(NUM_BUCKETS); i++)
+					m_buckets[i].store(0, std::memory_order_relaxed);
+				m_count.store(0, std::memory_order_relaxed);
+				m_sum.store(0, std::memory_order_relaxed);
+				m_min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+				m_max.store(0, std::memory_order_relaxed);
+			}
+
+			static size_t index(uint64_t v)
+			{
+				if (v < 2 * SUB_COUNT)
+					return size_t(v);
+				unsigned shift = msb(v) - SUB_BITS;
+				return size_t(shift + 1) * SUB_COUNT + size_t((v >> shift) - SUB_COUNT);
+			}
+
+			//! Smallest value counted in the bucket.
+			static uint64_t lowerBound(size_t idx)
+			{
+				if (idx < 2 * SUB_COUNT)
+					return idx;
+				unsigned shift = unsigned(idx / SUB_COUNT) - 1;
+				return uint64_t(idx % SUB_COUNT + SUB_COUNT) << shift;
+			}
+
+		private:
+			LatencyHistogram(const LatencyHistogram&);
+			LatencyHistogram& operator=(const LatencyHistogram&);
+
+			static unsigned msb(uint64_t v)
+			{
+				unsigned n = 0;
+				for (unsigned s = 32; s > 0; s >>= 1)
+				{
+					if (v >> s)
+					{
+						v >>= s;
+						n += s;
+					}
+				}
+				return n;
+			}
+
+			std::unique_ptr<std::atomic<uint64_t>[]> m_buckets;
+			std::atomic<uint64_t> m_count;
+			std::atomic<uint64_t> m_sum;
+			std::atomic<uint64_t> m_min;
+			std::atomic<uint64_t> m_max;
+		};
+
+		/** AcquisitionStats collects counters, gauges and histograms of an acquisition stream, see Device::enableStats.
+			All values are atomics, they are updated by the threads receiving and queuing buffers and can be read lock-free from any thread, e.g. by a monitoring thread at 1 Hz.
+			A snapshot is not an atomic copy of all values, counters updated during snapshot() may be one buffer apart.
+
+			The latency is measured from the camera timestamp of the buffer (exposure timestamp of the chunk data if available, otherwise CX_BUFFER_INFO_TIMESTAMP)
+			to the host time when the buffer is returned by the wait function. Camera and host clocks are not synchronized, so the latency is relative
+			to the lowest latency observed since reset(): a value of 0 corresponds to the fastest delivery, the histogram shows the additional delay and jitter.
+			Set the tick frequency of the camera timestamp with setTimestampFrequency (default 1 GHz, i.e. ns).
+
+			\code{.cpp}
+				cam->enableStats();
+				// monitoring thread
+				while (running)
+				{
+					std::this_thread::sleep_for(std::chrono::seconds(1));
+					cam->pollStreamStats();		// optional, reads corrupt and resend counters of the transport layer
+					cx::AcquisitionStats::Snapshot s = cam->stats()->snapshot();
+					std::cout << s.toString() << std::endl;
+				}
+			\endcode
+		*/
+		class AcquisitionStats
+		{
+		public:
+			struct Snapshot
+			{
+				double elapsed;						//!< seconds since reset
+				uint64_t delivered;					//!< buffers returned by the wait functions
+				uint64_t incomplete;				//!< buffers with CX_BUFFER_INFO_IS_INCOMPLETE
+				uint64_t corrupt;					//!< corrupt buffers reported by the transport layer, see Device::pollStreamStats
+				uint64_t resendRequests;			//!< resend requests reported by the transport layer, see Device::pollStreamStats
+				uint64_t missingFrames;				//!< gaps in the chunk frame counter
+				uint64_t frameIdResets;				//!< frame counter going backwards, e.g. after an acquisition restart
+				uint64_t requeued;					//!< buffers queued back to the device
+				int64_t buffersAllocated;			//!< buffers allocated with allocAndQueueBuffers
+				int64_t buffersHeld;				//!< buffers delivered and not yet queued back
+				int64_t maxBuffersHeld;				//!< maximum of buffersHeld
+				LatencyHistogram::Snapshot latency;	//!< camera timestamp to host delivery in ns, relative to the lowest latency
+				LatencyHistogram::Snapshot interval;//!< interval between deliveries in ns
+
+				double frameRate() const { return (elapsed > 0.0) ? double(delivered) / elapsed : 0.0; }
+
+				//! Returns the values as "name=value" pairs separated by spaces, latencies in us.
+				std::string toString() const
+				{
+					std::string s = "delivered=" + std::to_string(delivered) + " incomplete=" + std::to_string(incomplete) + " corrupt=" + std::to_string(corrupt)
+						+ " resends=" + std::to_string(resendRequests) + " missing=" + std::to_string(missingFrames) + " resets=" + std::to_string(frameIdResets)
+						+ " held=" + std::to_string(buffersHeld) + "/" + std::to_string(buffersAllocated) + " maxHeld=" + std::to_string(maxBuffersHeld)
+						+ " fps=" + std::to_string(frameRate());
+					s += " latency_us(p50/p99/max)=" + std::to_string(latency.percentile(50) / 1000) + "/" + std::to_string(latency.percentile(99) / 1000) + "/" + std::to_string(latency.max / 1000);
+					s += " interval_us(p50/p99/max)=" + std::to_string(interval.percentile(50) / 1000) + "/" + std::to_string(interval.percentile(99) / 1000) + "/" + std::to_string(interval.max / 1000);
+					return s;
+				}
+			};
+
+			AcquisitionStats() : m_tickToNs(1.0), m_buffersAllocated(0), m_held(0), m_maxHeld(0)
+			{
+				reset();
+			}
+
+			//! Frequency of the camera timestamp in Hz, e.g. the value of GevTimestampTickFrequency.
+			void setTimestampFrequency(double hz)
+			{
+				m_tickToNs.store((hz > 0.0) ? 1e9 / hz : 1.0, std::memory_order_relaxed);
+				m_minOffset.store(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+			}
+
+			/** Record a delivered buffer.
+				@param incomplete		CX_BUFFER_INFO_IS_INCOMPLETE of the buffer.
+				@param hasFrameId		true if frameId is valid.
+				@param frameId			chunk frame counter.
+				@param frameIdBits		width of the frame counter field in bits (1..64), counters narrower than 64 bit are unwrapped, see frameIdDelta.
+				@param hasTimestamp		true if cameraTicks is valid.
+				@param cameraTicks		camera timestamp of the buffer.
+				@param hostNs			host time of the delivery, see hostTime().
+			*/
+			void recordDelivery(bool incomplete, bool hasFrameId, uint64_t frameId, unsigned frameIdBits, bool hasTimestamp, uint64_t cameraTicks, int64_t hostNs)
+			{
+				m_delivered.fetch_add(1, std::memory_order_relaxed);
+				if (incomplete)
+					m_incomplete.fetch_add(1, std::memory_order_relaxed);
+
+				int64_t held = m_held.fetch_add(1, std::memory_order_relaxed) + 1;
+				int64_t maxHeld = m_maxHeld.load(std::memory_order_relaxed);
+				while (held > maxHeld && !m_maxHeld.compare_exchange_weak(maxHeld, held, std::memory_order_relaxed))
+					;
+
+				int64_t last = m_lastHostNs.exchange(hostNs, std::memory_order_relaxed);
+				if (last != 0 && hostNs > last)
+					m_interval.record(uint64_t(hostNs - last));
+
+				if (hasFrameId)
+				{
+					// the stored value is frameId + 1, 0 marks the first buffer
+					uint64_t prev = m_lastFrameId.exchange(frameId + 1, std::memory_order_relaxed);
+					if (prev != 0)
+					{
+						int64_t delta = frameIdDelta(prev - 1, frameId, frameIdBits);
+						if (delta > 1)
+							m_missing.fetch_add(uint64_t(delta - 1), std::memory_order_relaxed);
+						else if (delta <= 0)
+							m_resets.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+
+				if (hasTimestamp)
+				{
+					int64_t offset = hostNs - int64_t(double(cameraTicks) * m_tickToNs.load(std::memory_order_relaxed));
+					int64_t minOffset = m_minOffset.load(std::memory_order_relaxed);
+					while (offset < minOffset && !m_minOffset.compare_exchange_weak(minOffset, offset, std::memory_order_relaxed))
+						;
+					m_latency.record(uint64_t(offset - std::min(offset, minOffset)));
+				}
+			}
+
+			//! Record a buffer queued back to the device.
+			void recordRequeue()
+			{
+				m_requeued.fetch_add(1, std::memory_order_relaxed);
+				m_held.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			void setBuffersAllocated(int64_t n)
+			{
+				m_buffersAllocated.store(n, std::memory_order_relaxed);
+				m_held.store(0, std::memory_order_relaxed);
+			}
+
+			//! Set the counters read from the transport layer, negative values are ignored.
+			void setStreamCounters(int64_t corrupt, int64_t resendRequests)
+			{
+				if (corrupt >= 0)
+					m_corrupt.store(uint64_t(corrupt), std::memory_order_relaxed);
+				if (resendRequests >= 0)
+					m_resends.store(uint64_t(resendRequests), std::memory_order_relaxed);
+			}
+
+			Snapshot snapshot() const
+			{
+				Snapshot s;
+				s.elapsed = double(hostTime() - m_start.load(std::memory_order_relaxed)) * 1e-9;
+				s.delivered = m_delivered.load(std::memory_order_relaxed);
+				s.incomplete = m_incomplete.load(std::memory_order_relaxed);
+				s.corrupt = m_corrupt.load(std::memory_order_relaxed);
+				s.resendRequests = m_resends.load(std::memory_order_relaxed);
+				s.missingFrames = m_missing.load(std::memory_order_relaxed);
+				s.frameIdResets = m_resets.load(std::memory_order_relaxed);
+				s.requeued = m_requeued.load(std::memory_order_relaxed);
+				s.buffersAllocated = m_buffersAllocated.load(std::memory_order_relaxed);
+				s.buffersHeld = m_held.load(std::memory_order_relaxed);
+				s.maxBuffersHeld = m_maxHeld.load(std::memory_order_relaxed);
+				s.latency = m_latency.snapshot();
+				s.interval = m_interval.snapshot();
+				return s;
+			}
+
+			/** Clears counters and histograms, the gauges of allocated and held buffers are kept.
+			*/
+			void reset()
+			{
+				m_start.store(hostTime(), std::memory_order_relaxed);
+				m_delivered.store(0, std::memory_order_relaxed);
+				m_incomplete.store(0, std::memory_order_relaxed);
+				m_corrupt.store(0, std::memory_order_relaxed);
+				m_resends.store(0, std::memory_order_relaxed);
+				m_missing.store(0, std::memory_order_relaxed);
+				m_resets.store(0, std::memory_order_relaxed);
+				m_requeued.store(0, std::memory_order_relaxed);
+				m_maxHeld.store(m_held.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				m_lastHostNs.store(0, std::memory_order_relaxed);
+				m_lastFrameId.store(0, std::memory_order_relaxed);
+				m_minOffset.store(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+				m_latency.reset();
+				m_interval.reset();
+			}
+
+			/** Returns the signed distance from frame counter prev to cur for a counter of the given width in bits.
+				The difference is taken modulo 2^bits and mapped to -2^(bits-1)..2^(bits-1)-1, i.e. a wrap around counts as a step forward and a jump back by less than half the range as a reset.
+			*/
+			static int64_t frameIdDelta(uint64_t prev, uint64_t cur, unsigned bits)
+			{
+				uint64_t diff = cur - prev;
+				if (bits == 0 || bits >= 64)
+					return int64_t(diff);
+				uint64_t range = uint64_t(1) << bits;
+				diff &= range - 1;
+				return (diff >= range / 2) ? int64_t(diff) - int64_t(range) : int64_t(diff);
+			}
+
+			//! Host time in ns of the steady clock, the time base of recordDelivery.
+			static int64_t hostTime()
+			{
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			}
+
+		private:
+			AcquisitionStats(const AcquisitionStats&);
+			AcquisitionStats& operator=(const AcquisitionStats&);
+
+			std::atomic<double> m_tickToNs;
+			std::atomic<int64_t> m_start;
+			std::atomic<uint64_t> m_delivered;
+			std::atomic<uint64_t> m_incomplete;
+			std::atomic<uint64_t> m_corrupt;
+			std::atomic<uint64_t> m_resends;
+			std::atomic<uint64_t> m_missing;
+			std::atomic<uint64_t> m_resets;
+			std::atomic<uint64_t> m_requeued;
+			std::atomic<int64_t> m_buffersAllocated;
+			std::atomic<int64_t> m_held;
+			std::atomic<int64_t> m_maxHeld;
+			std::atomic<int64_t> m_lastHostNs;
+			std::atomic<uint64_t> m_lastFrameId;
+			std::atomic<int64_t> m_minOffset;
+			LatencyHistogram m_latency;
+			LatencyHistogram m_interval;
+		};
+
+		//! @} cx_wrapper_cpp
+	}	// namespace cx
+}	// namespace AT
+#endif	// AT_CX_ACQUISITIONSTATS_H_INCLUDED
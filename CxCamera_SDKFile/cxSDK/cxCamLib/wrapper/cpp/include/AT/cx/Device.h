@@ -22,13 +22,24 @@ POSSIBILITY OF SUCH DAMAGE.
 #define AT_CX_DEVICE_H_INCLUDED
 
 #include <string>
+#include <vector>
 #include <memory>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <chrono>
 
 #include "AT/cx/base.h"
 #include "cx_cam.h"
 #include "cx_cam_param.h"
 #include "AT/cx/DeviceInfo.h"
 #include "AT/cx/DeviceBuffer.h"
+#include "AT/cx/FeatureBag.h"
+#include "AT/cx/ChunkView.h"
+#include "AT/cx/AcquisitionStats.h"
 
 namespace AT {
 	namespace cx {
@@ -38,21 +49,24 @@ namespace AT {
 		//! @{
 
 		/** Class Device
+			Parameter access and the acquisition functions are virtual, so a device without cx_cam handle (e.g. cx::ReplayDevice) can be used in place of a camera.
+			Every write access through this object increments the parameter generation, caches of parameter values (e.g. cx::ParamSnapshot) compare it to detect stale values.
 		*/
 		class Device
 		{
 		public:
 			typedef std::shared_ptr<Device> Ptr;
 
-			Device() : m_hDevice(CX_INVALID_HANDLE) {}
-			Device(CX_DEVICE_HANDLE h) : m_hDevice(h) {}	//!< don't instanciate Device directly, use DeviceFactory. Contructor must be public for std::make_shared<Device>
+			Device() : m_hDevice(CX_INVALID_HANDLE), m_paramGeneration(0), m_stats(new AcquisitionStats()), m_statsEnabled(false), m_corruptCounter("DataStream::NumBuffersCorrupt") {}
+			Device(CX_DEVICE_HANDLE h) : m_hDevice(h), m_paramGeneration(0), m_stats(new AcquisitionStats()), m_statsEnabled(false), m_corruptCounter("DataStream::NumBuffersCorrupt") {}	//!< don't instanciate Device directly, use DeviceFactory. Contructor must be public for std::make_shared<Device>
 
-			~Device()
+			virtual ~Device()
 			{
+				releaseDelivery();
 				close();
 			}
 
-			bool isOpen() const
+			virtual bool isOpen() const
 			{
 				return (m_hDevice != CX_INVALID_HANDLE);
 			}
@@ -66,7 +80,7 @@ namespace AT {
 				OPEN_CONTROL = 2,			//!< Application can read and write to the device. But other applications are allowed to read from the device.
 			};
 
-			void open(const std::string& uri, open_mode openMode = OPEN_EXCLUSIVE)
+			virtual void open(const std::string& uri, open_mode openMode = OPEN_EXCLUSIVE)
 			{
 				close();
 
@@ -79,7 +93,7 @@ namespace AT {
 				cx::checkOk("cx_openDevice", cx_openDevice(uri_access.c_str(), &m_hDevice));
 			}
 
-			void close()
+			virtual void close()
 			{
 				if (isOpen())
 				{
@@ -88,23 +102,62 @@ namespace AT {
 				}
 			}
 
-			void setParam(const std::string& prm, const cx::Variant& val)
+			virtual void setParam(const std::string& prm, const cx::Variant& val)
 			{
+				invalidateParams();
 				cx::checkOk("cx_setParam", cx_setParam(m_hDevice, prm.c_str(), val));
 			}
 
-			void getParam(const std::string& prm, cx::Variant& val)
+			virtual void getParam(const std::string& prm, cx::Variant& val)
 			{
 				cx::checkOk("cx_getParam", cx_getParam(m_hDevice, prm.c_str(), val));
 			}
 
-			void getParamInfo(cx_param_info infoType, const std::string& prm, cx::Variant& val)
+			virtual void getParamInfo(cx_param_info infoType, const std::string& prm, cx::Variant& val)
 			{
 				cx::checkOk("cx_getParamInfo", cx_getParamInfo(m_hDevice, infoType, prm.c_str(), val));
 			}
 
+			/** Read several parameters by name.
+				This is a convenience loop over getParam, every parameter is a separate round trip to the device.
+				The cx_cam API does not expose the register addresses of GenICam nodes, so named parameters can not be batched.
+				Use getRegisters to read known register addresses in one round trip, see also \ref ParamSnapshot for caching.
+				@param names	parameter names
+				@param status	optional status per parameter. If given, failing parameters return an empty variant and the status, otherwise the first failure throws.
+			*/
+			std::vector<cx::Variant> getParams(const std::vector<std::string>& names, std::vector<cx_status_t>* status = nullptr)
+			{
+				std::vector<cx::Variant> vals(names.size());
+				if (status)
+					status->assign(names.size(), CX_STATUS_OK);
+				for (size_t i = 0; i < names.size(); i++)
+				{
+					if (!status)
+					{
+						getParam(names[i], vals[i]);
+						continue;
+					}
+					try
+					{
+						getParam(names[i], vals[i]);
+					}
+					catch (const cx::RuntimeError& e)
+					{
+						(*status)[i] = e.status();
+						vals[i] = cx::Variant();
+					}
+				}
+				return vals;
+			}
+
+			/** Returns the parameter generation, it is incremented by every write access through this object (setParam, setRegister, setMemory, uploadFile).
+				Writes by other applications or by the C API on the same handle are not counted.
+			*/
+			uint64_t paramGeneration() const { return m_paramGeneration.load(std::memory_order_acquire); }
+
 			void setRegister(uint32_t regAddress, uint32_t regValue)
 			{
+				invalidateParams();
 				cx::checkOk("cx_setRegister", cx_setRegister(m_hDevice, regAddress, regValue));
 			}
 
@@ -113,6 +166,22 @@ namespace AT {
 				cx::checkOk("cx_getRegister", cx_getRegister(m_hDevice, regAddress, &regValueOut));
 			}
 
+			/** Read several registers with as few READ_REGISTER commands as possible, up to MAX_REGISTERS_PER_READ registers per command.
+				@param regAddresses		register addresses
+				@param regValuesOut		register values, caller must take care about the byte order of data.
+				@param count			number of registers
+			*/
+			void getRegisters(const uint32_t* regAddresses, uint32_t* regValuesOut, size_t count)
+			{
+				std::vector<uint32_t> addr(regAddresses, regAddresses + count);
+				for (size_t i = 0; i < count; i += MAX_REGISTERS_PER_READ)
+				{
+					uint16_t n = (uint16_t)std::min<size_t>(count - i, MAX_REGISTERS_PER_READ);
+					std::vector<uint16_t> errIndex(n, 0);
+					cx::checkOk("cx_getRegisterMulti", cx_getRegisterMulti(m_hDevice, n, addr.data() + i, regValuesOut + i, errIndex.data()));
+				}
+			}
+
 			void getMemory(uint32_t startRegAddress, uint8_t* dstBuf, uint32_t length)
 			{
 				cx::checkOk("cx_getMemory", cx_getMemory(m_hDevice, startRegAddress, dstBuf, length));
@@ -120,16 +189,19 @@ namespace AT {
 
 			void setMemory(uint32_t startRegAddress, const uint8_t* srcBuf, uint32_t length)
 			{
+				invalidateParams();
 				cx::checkOk("cx_setMemory", cx_setMemory(m_hDevice, startRegAddress, srcBuf, length));
 			}
 
 			void uploadFile(const std::string& srcFilePath, const std::string& deviceDst)
 			{
+				invalidateParams();
 				cx::checkOk("cx_uploadFile", cx_uploadFile(m_hDevice, srcFilePath.c_str(), deviceDst.c_str()));
 			}
 
 			void uploadFileFromBuffer(const std::string& buffer, const std::string& deviceDst)
 			{
+				invalidateParams();
 				cx::checkOk("cx_uploadFileFromBuffer", cx_uploadFileFromBuffer(m_hDevice, (const uint8_t*)buffer.c_str(), buffer.size(), deviceDst.c_str()));
 			}
 
@@ -149,40 +221,279 @@ namespace AT {
 				return buffer;
 			}
 
+			/** Saves the current device configuration as GenICam FeatureBag, see CX_CAM_FILE_FEATURE_BAG.
+				The configuration can be restored with applyConfiguration().
+			*/
+			void saveConfiguration(std::string& config)
+			{
+				config = downloadFileToBuffer(CX_CAM_FILE_FEATURE_BAG);
+			}
+
+			/** Restores a configuration saved with saveConfiguration().
+				Only the features that differ from the current device configuration are uploaded, in the order of the saved FeatureBag together with the selector values they need.
+				The changes are sent as one FeatureBag upload instead of a setParam call per feature.
+				If the upload fails or verification finds features that differ from the configuration, the features changed so far are set back to their previous values
+				and the error is thrown, so the device is not left half configured.
+				@param config	FeatureBag text
+				@param verify	reads the configuration back and throws std::runtime_error if a feature was not applied
+				@return number of changed features, selectors excluded
+			*/
+			size_t applyConfiguration(const std::string& config, bool verify = true)
+			{
+				FeatureBag target(config);
+				FeatureBag before(downloadFileToBuffer(CX_CAM_FILE_FEATURE_BAG));
+				FeatureBag changes = target.diff(before);
+				size_t numChanged = changes.numValues();
+				if (numChanged == 0)
+					return 0;
+				try
+				{
+					uploadFileFromBuffer(changes.toString(), CX_CAM_FILE_FEATURE_BAG);
+					if (verify)
+					{
+						std::vector<std::string> failed = target.diff(FeatureBag(downloadFileToBuffer(CX_CAM_FILE_FEATURE_BAG))).valueNames();
+						if (!failed.empty())
+						{
+							std::string msg = "Device: configuration not applied for " + failed[0];
+							if (failed.size() > 1)
+								msg += " and " + std::to_string((unsigned long long)failed.size() - 1) + " more features";
+							throw std::runtime_error(msg);
+						}
+					}
+				}
+				catch (...)
+				{
+					// roll back, errors of the rollback are ignored to report the original error
+					try
+					{
+						FeatureBag undo = before.diff(FeatureBag(downloadFileToBuffer(CX_CAM_FILE_FEATURE_BAG)));
+						if (undo.numValues() > 0)
+							uploadFileFromBuffer(undo.toString(), CX_CAM_FILE_FEATURE_BAG);
+					}
+					catch (...)
+					{
+					}
+					throw;
+				}
+				return numChanged;
+			}
+
 			void getFileInfo(cx_file_info infoType, const std::string& deviceFile, cx::Variant& val)
 			{
 				cx::checkOk("cx_getFileInfo", cx_getFileInfo(m_hDevice, infoType, deviceFile.c_str(), val));
 			}
 
-			void allocAndQueueBuffers(int numBuffers=3)
+			virtual void allocAndQueueBuffers(int numBuffers=3)
 			{
 				cx::checkOk("cx_allocAndQueueBuffers", cx_allocAndQueueBuffers(m_hDevice, numBuffers));
+				recordAllocation(numBuffers);
 			}
 
-			void freeBuffers()
+			virtual void freeBuffers()
 			{
 				cx::checkOk("cx_freeBuffers", cx_freeBuffers(m_hDevice));
+				recordAllocation(0);
 			}
 
-			DeviceBuffer waitForBuffer(unsigned int timeout, bool noThrow=false)
+			virtual DeviceBuffer waitForBuffer(unsigned int timeout, bool noThrow=false)
 			{
 				CX_BUFFER_HANDLE hBuffer = CX_INVALID_HANDLE;
 				cx_status_t status = cx_waitForBuffer(m_hDevice, &hBuffer, timeout);
 				if(noThrow==false)
 					cx::checkOk("cx_waitForBuffer", status);
-				return DeviceBuffer(hBuffer);
+				DeviceBuffer buffer(hBuffer);
+				if (status == CX_STATUS_OK)
+					recordBuffer(buffer);
+				return buffer;
 			}
 
-			void startAcquisition()
+			/** Wait for next acquisition buffer without allocation and without throwing, e.g. on timeout.
+				The caller owned buffer object is reused, on success it references the new buffer, otherwise it is invalid and holds no source or statistics of a previous buffer.
+
+				\code{.cpp}
+					cx::DeviceBuffer buffer;
+					while (running)
+					{
+						cx_status_t status = cam->tryWaitForBuffer(buffer, 100);
+						if (status == CX_STATUS_TIMEOUT)
+							continue;
+						cx::checkOk("cx_waitForBuffer", status);
+						cx::ImageView img = buffer.getImageView();
+						// do processing of img ...
+						buffer.queueBuffer();
+					}
+				\endcode
+
+				@param[out] buffer	buffer object that receives the acquisition buffer.
+				@param[in] timeout	timeout in ms.
+				@return CX_STATUS_OK on success, CX_STATUS_TIMEOUT if no buffer was available in time, error value otherwise.
+			*/
+			virtual cx_status_t tryWaitForBuffer(DeviceBuffer& buffer, unsigned int timeout)
+			{
+				buffer = DeviceBuffer();
+				cx_status_t status = cx_waitForBuffer(m_hDevice, &buffer.m_hBuffer, timeout);
+				if (status != CX_STATUS_OK)
+					buffer.m_hBuffer = CX_INVALID_HANDLE;
+				else
+					recordBuffer(buffer);
+				return status;
+			}
+
+			virtual void startAcquisition()
 			{
 				cx::checkOk("cx_startAcquisition", cx_startAcquisition(m_hDevice));
 			}
 
-			void stopAcquisition()
+			virtual void stopAcquisition()
 			{
 				cx::checkOk("cx_stopAcquisition", cx_stopAcquisition(m_hDevice));
 			}
 
+			//! Callback for buffer delivery, see onBuffer.
+			typedef std::function<void(DeviceBuffer& buffer)> BufferCallback;
+
+			//! Counters of the buffer delivery.
+			struct DeliveryStats
+			{
+				uint64_t delivered;			//!< number of buffers passed to the callback
+				uint64_t timeouts;			//!< number of waits without buffer
+				uint64_t errors;			//!< number of failed waits other than timeout
+				uint64_t callbackErrors;	//!< number of exceptions thrown by the callback
+				uint64_t requeueErrors;		//!< number of failed cx_queueBuffer calls after the callback
+			};
+
+			/** Deliver acquisition buffers to a callback running in delivery threads owned by the device object, no grab loop is needed in user code.
+				The threads take turns waiting for the next buffer, so a buffer is passed to the callback by the thread that received it without any hand over.
+				The buffer is queued back when the callback returns, unless the callback keeps it with DeviceBuffer::detach(). The callback must not call DeviceBuffer::queueBuffer.
+				Exceptions thrown by the callback are counted in DeliveryStats::callbackErrors.
+
+				\code{.cpp}
+					cam->allocAndQueueBuffers(8);
+					cam->onBuffer([&](cx::DeviceBuffer& buffer) {
+						cx::ImageView img = buffer.getImageView();
+						// do processing of img ...
+					}, 2);
+					cam->startAcquisition();
+					// ...
+					cam->stopDelivery();
+					cam->stopAcquisition();
+					cam->freeBuffers();
+				\endcode
+
+				\note The cx_cam library has no push delivery of buffers, the threads wait with tryWaitForBuffer. Stopping takes up to one timeout.
+				With more than one thread the callbacks of consecutive buffers run concurrently and may finish out of order.
+				\note Subclasses overriding tryWaitForBuffer must call releaseDelivery() in their own destructor (see cx::ReplayDevice), ~Device runs after the subclass members are destroyed.
+				@param callback		called for every buffer, an empty function stops the delivery.
+				@param numThreads	number of delivery threads, should not exceed the number of device buffers.
+				@param timeout		wait timeout in ms, determines how fast stopDelivery() returns.
+			*/
+			void onBuffer(const BufferCallback& callback, unsigned numThreads = 1, unsigned timeout = 100)
+			{
+				stopDelivery();
+				if (!callback)
+					return;
+				m_delivery.reset(new Delivery());
+				m_delivery->callback = callback;
+				m_delivery->timeout = timeout;
+				numThreads = std::max(numThreads, 1u);
+				m_delivery->inFlight.assign(numThreads, nullptr);
+				for (unsigned i = 0; i < numThreads; i++)
+					m_delivery->threads.push_back(std::thread(&Device::deliveryLoop, this, m_delivery.get(), i));
+			}
+
+			/** Stop the delivery threads, returns after the running callbacks have finished. Must not be called from a callback.
+			*/
+			void stopDelivery()
+			{
+				if (!m_delivery)
+					return;
+				for (size_t i = 0; i < m_delivery->threads.size(); i++)
+				{
+					if (m_delivery->threads[i].get_id() == std::this_thread::get_id())
+						throw std::runtime_error("Device: stopDelivery called from the buffer callback");
+				}
+				m_delivery->stop = true;
+				for (size_t i = 0; i < m_delivery->threads.size(); i++)
+				{
+					if (m_delivery->threads[i].joinable())
+						m_delivery->threads[i].join();
+				}
+				m_delivery->threads.clear();
+			}
+
+			bool isDelivering() const { return m_delivery && !m_delivery->threads.empty(); }
+
+			//! Counters of the current or last delivery.
+			DeliveryStats deliveryStats() const
+			{
+				DeliveryStats s = DeliveryStats();
+				if (m_delivery)
+				{
+					s.delivered = m_delivery->delivered;
+					s.timeouts = m_delivery->timeouts;
+					s.errors = m_delivery->errors;
+					s.callbackErrors = m_delivery->callbackErrors;
+					s.requeueErrors = m_delivery->requeueErrors;
+				}
+				return s;
+			}
+
+			/** Enable or disable the acquisition statistics, see cx::AcquisitionStats.
+				Every buffer returned by waitForBuffer or tryWaitForBuffer is recorded, this includes the buffers of onBuffer, cx::AcquisitionPipeline and cx::DeviceGroup.
+				The cost per buffer is a few buffer info queries, no GenApi access. The buffer gauges are kept also while the statistics are disabled.
+				Enabling doesn't reset the values, call AcquisitionStats::reset() for that. Can be called while buffers are delivered.
+				@return the statistics object, it lives as long as the device object.
+			*/
+			AcquisitionStats& enableStats(bool enable = true)
+			{
+				m_statsEnabled.store(enable, std::memory_order_release);
+				return *m_stats;
+			}
+
+			bool statsEnabled() const { return m_statsEnabled.load(std::memory_order_acquire); }
+
+			//! Returns the statistics, the object is created with the device and can be read lock-free from any thread.
+			AcquisitionStats* stats() { return m_stats.get(); }
+			const AcquisitionStats* stats() const { return m_stats.get(); }
+
+			/** Set the names of the transport layer counters read by pollStreamStats, an empty name disables the counter.
+				The default reads "DataStream::NumBuffersCorrupt", the name of the resend counter depends on the transport layer and is empty by default.
+				\note The names are not synchronized with pollStreamStats, set them before the acquisition and the monitoring thread are started.
+			*/
+			void setStreamCounterNames(const std::string& corrupt, const std::string& resendRequests)
+			{
+				m_corruptCounter = corrupt;
+				m_resendCounter = resendRequests;
+			}
+
+			/** Read the corrupt and resend counters of the transport layer into the statistics.
+				The counters are GenApi parameters, call this at a low rate (e.g. 1 Hz) from the monitoring thread instead of per frame.
+			*/
+			void pollStreamStats()
+			{
+				if (!statsEnabled())
+					return;
+				int64_t counters[2] = { -1, -1 };
+				const std::string* names[2] = { &m_corruptCounter, &m_resendCounter };
+				for (int i = 0; i < 2; i++)
+				{
+					if (names[i]->empty())
+						continue;
+					try
+					{
+						cx::Variant val;
+						getParam(*names[i], val);
+						if (val.type == CX_VT_INT)
+							counters[i] = (int64_t)val;
+					}
+					catch (const std::exception&)
+					{
+						// counter not available on this transport layer
+					}
+				}
+				m_stats->setStreamCounters(counters[0], counters[1]);
+			}
+
 			CX_EVENT_HANDLE registerEvent(const std::string& name, cx_event_cb cb, void* userParam)
 			{
 				CX_EVENT_HANDLE hEvent;
@@ -202,8 +513,170 @@ namespace AT {
 
 			CX_DEVICE_HANDLE getHandle() const { return m_hDevice; }
 
+			//! GVCP READREG commands carry up to 135 addresses in one packet, 128 leaves room for protocol overhead.
+			enum { MAX_REGISTERS_PER_READ = 128 };
+
+		protected:
+			/** Stop the delivery threads without throwing, for destructors. Must be called by the destructors of subclasses overriding tryWaitForBuffer.
+				If the last reference to the device is released in the buffer callback, the calling thread can't be joined. Its buffer is queued back while the device still exists
+				and invalidated, the thread is detached and deletes the delivery object when the callback returns, without touching the device.
+			*/
+			void releaseDelivery() noexcept
+			{
+				if (!m_delivery)
+					return;
+				m_delivery->stop = true;
+				bool self = false;
+				for (size_t i = 0; i < m_delivery->threads.size(); i++)
+				{
+					if (m_delivery->threads[i].get_id() == std::this_thread::get_id())
+					{
+						DeviceBuffer& buffer = *m_delivery->inFlight[i];
+						if (buffer.isValid() && buffer.requeue() != CX_STATUS_OK)
+							m_delivery->requeueErrors++;
+						buffer = DeviceBuffer();
+						m_delivery->threads[i].detach();
+						m_delivery->orphaned = true;
+						self = true;
+					}
+					else if (m_delivery->threads[i].joinable())
+						m_delivery->threads[i].join();
+				}
+				m_delivery->threads.clear();
+				if (self)
+					m_delivery.release();		// deleted by the detached thread
+			}
+
+			//! Marks cached parameter values as stale, must be called by overrides of setParam.
+			void invalidateParams() { m_paramGeneration.fetch_add(1, std::memory_order_acq_rel); }
+
+			//! Records a delivered buffer in the statistics, must be called by overrides of tryWaitForBuffer for every delivered buffer.
+			void recordBuffer(DeviceBuffer& buffer)
+			{
+				if (!m_statsEnabled.load(std::memory_order_acquire))
+					return;
+				int64_t hostNs = AcquisitionStats::hostTime();
+				buffer.m_stats = m_stats.get();
+
+				cx::Variant val;
+				bool incomplete = buffer.getBufferInfo(CX_BUFFER_INFO_IS_INCOMPLETE, val) == CX_STATUS_OK && (int)val != 0;
+
+				// frame counter and exposure timestamp of the first chunk record
+				int numChunks = 1;
+				if (buffer.getBufferInfo(CX_BUFFER_INFO_NUM_CHUNK, val) == CX_STATUS_OK)
+					numChunks = (int)val;
+				uint64_t frameId = 0, timestamp = 0;
+				unsigned frameIdBits = 64;
+				bool hasFrameId = false;
+				for (int i = 0; i < numChunks && !hasFrameId; i++)
+				{
+					cx::Chunk chunk = buffer.getChunkView(i);
+					hasFrameId = chunkInfo<cx_chunk_camera_info_t>(chunk, frameId, frameIdBits, timestamp) || chunkInfo<cx_c6_chunk_frame_info_t>(chunk, frameId, frameIdBits, timestamp)
+						|| chunkInfo<cx_chunk_c6_line_info_t>(chunk, frameId, frameIdBits, timestamp) || chunkInfo<cx_chunk_irsx_image_info_t>(chunk, frameId, frameIdBits, timestamp);
+				}
+				bool hasTimestamp = (timestamp != 0);
+				if (!hasTimestamp && buffer.getBufferInfo(CX_BUFFER_INFO_TIMESTAMP, val) == CX_STATUS_OK)
+				{
+					timestamp = (uint64_t)(int64_t)val;
+					hasTimestamp = true;
+				}
+				m_stats->recordDelivery(incomplete, hasFrameId, frameId, frameIdBits, hasTimestamp, timestamp, hostNs);
+			}
+
+			//! Sets the buffer gauges of the statistics, must be called by overrides of allocAndQueueBuffers and freeBuffers.
+			void recordAllocation(int numBuffers)
+			{
+				m_stats->setBuffersAllocated(numBuffers);
+			}
+
 		private:
+			Device(const Device&);
+			Device& operator=(const Device&);
+
+			struct Delivery
+			{
+				Delivery() : timeout(100), orphaned(false), stop(false), delivered(0), timeouts(0), errors(0), callbackErrors(0), requeueErrors(0) {}
+
+				BufferCallback callback;
+				unsigned timeout;
+				std::vector<std::thread> threads;
+				std::vector<DeviceBuffer*> inFlight;	// buffer object of each thread, only accessed by the thread itself
+				bool orphaned;							// the device was destroyed in the callback, only accessed by the calling thread
+				std::mutex waitMutex;					// only one thread waits for a buffer at a time
+				std::atomic<bool> stop;
+				std::atomic<uint64_t> delivered;
+				std::atomic<uint64_t> timeouts;
+				std::atomic<uint64_t> errors;
+				std::atomic<uint64_t> callbackErrors;
+				std::atomic<uint64_t> requeueErrors;
+			};
+
+			void deliveryLoop(Delivery* d, unsigned idx)
+			{
+				DeviceBuffer buffer;
+				d->inFlight[idx] = &buffer;
+				while (!d->stop)
+				{
+					cx_status_t status;
+					{
+						std::lock_guard<std::mutex> lock(d->waitMutex);
+						if (d->stop)
+							break;
+						status = tryWaitForBuffer(buffer, d->timeout);
+					}
+					if (status != CX_STATUS_OK)
+					{
+						if (status == CX_STATUS_TIMEOUT)
+							d->timeouts++;
+						else
+						{
+							d->errors++;
+							std::this_thread::sleep_for(std::chrono::milliseconds(1));	// don't spin on a failing device
+						}
+						continue;
+					}
+
+					d->delivered++;
+					try
+					{
+						d->callback(buffer);
+					}
+					catch (...)
+					{
+						d->callbackErrors++;
+					}
+					// the device was destroyed in the callback, this thread owns the delivery object now
+					if (d->orphaned)
+					{
+						delete d;
+						return;
+					}
+					// a detached buffer is invalid here, its token queues it back
+					if (buffer.isValid() && buffer.requeue() != CX_STATUS_OK)
+						d->requeueErrors++;
+				}
+			}
+
+			// frameIdBits is the width of the counter field, counters narrower than 64 bit wrap around
+			template<typename T>
+			static bool chunkInfo(const cx_chunk_t& chunk, uint64_t& frameId, unsigned& frameIdBits, uint64_t& timestamp)
+			{
+				cx::ChunkView<T> view(chunk);
+				if (view.empty())
+					return false;
+				frameId = view.frameId(0);
+				frameIdBits = unsigned(sizeof(T::frameId) * 8);
+				timestamp = view.timestamp(0);
+				return true;
+			}
+
 			CX_DEVICE_HANDLE m_hDevice;
+			std::atomic<uint64_t> m_paramGeneration;
+			std::unique_ptr<Delivery> m_delivery;
+			std::unique_ptr<AcquisitionStats> m_stats;
+			std::atomic<bool> m_statsEnabled;
+			std::string m_corruptCounter;
+			std::string m_resendCounter;
 		};
 
 		typedef Device::Ptr DevicePtr;
@@ -25,6 +25,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "AT/cx/base.h"
 #include "cx_cam.h"
 #include "cx_cam_param.h"
+#include "AT/cx/AcquisitionStats.h"
 #include "AT/cx/Device.h"
 
 namespace AT {
@@ -33,12 +34,31 @@ namespace AT {
 		//! @addtogroup cx_wrapper_cpp
 		//! @{
 
+		/** BufferSource is the interface for devices that deliver buffers without a cx_cam device handle, e.g. cx::ReplayDevice.
+			The functions have the same signature and semantics as the corresponding cx_cam functions, the buffer handle is only meaningful to the source that created it.
+		*/
+		class BufferSource
+		{
+		public:
+			virtual ~BufferSource() {}
+			virtual cx_status_t getBufferImage(CX_BUFFER_HANDLE hBuffer, int partIdx, cx_img_t* img) = 0;					//!< see \ref cx_getBufferImage
+			virtual cx_status_t getBufferChunk(CX_BUFFER_HANDLE hBuffer, int chunkIdx, cx_chunk_t* chunk) = 0;				//!< see \ref cx_getBufferChunk
+			virtual cx_status_t getBufferInfo(CX_BUFFER_HANDLE hBuffer, int param, cx_variant_t* val) = 0;					//!< see \ref cx_getBufferInfo
+			virtual cx_status_t getBufferPartInfo(CX_BUFFER_HANDLE hBuffer, int partIdx, int param, cx_variant_t* val) = 0;	//!< see \ref cx_getBufferPartInfo
+			virtual cx_status_t queueBuffer(CX_BUFFER_HANDLE hBuffer) = 0;												//!< see \ref cx_queueBuffer
+		};
+
 		/** DeviceBuffer class is wrapping the CX_BUFFER_HANDLE.
+			Buffers of a cx::BufferSource (e.g. cx::ReplayDevice) are dispatched to the source instead of the cx_cam library.
 		*/
+		class BufferToken;
+
 		class DeviceBuffer
 		{
+			friend class Device;
+			friend class BufferToken;
 		public:
-			DeviceBuffer(CX_BUFFER_HANDLE hBuffer) : m_hBuffer(hBuffer) {}
+			DeviceBuffer(CX_BUFFER_HANDLE hBuffer = CX_INVALID_HANDLE, BufferSource* source = nullptr) : m_hBuffer(hBuffer), m_source(source), m_stats(nullptr) {}
 			~DeviceBuffer() {}
 
 			bool isValid() const
@@ -63,7 +83,7 @@ namespace AT {
 			cx::ImagePtr getImage(int partIdx=0)
 			{
 				cx::ImagePtr img = std::make_shared<cx::Image>();
-				cx::checkOk("cx_getBufferImage", cx_getBufferImage(m_hBuffer, partIdx, *img));
+				cx::checkOk("cx_getBufferImage", getBufferImage(partIdx, *img));
 				return img;
 			}
 
@@ -84,43 +104,196 @@ namespace AT {
 			*/
 			void getImage(cx::Image& img, int partIdx=0)
 			{
-				cx::checkOk("cx_getBufferImage", cx_getBufferImage(m_hBuffer, partIdx, img));
+				cx::checkOk("cx_getBufferImage", getBufferImage(partIdx, img));
+			}
+
+			/** Get a non-owning view on an image from acquisition buffer. The function neither allocates nor throws, an empty view is returned on error.
+
+				\code{.cpp}
+					cx::DeviceBuffer buffer;
+					while (cam->tryWaitForBuffer(buffer, 100) == CX_STATUS_OK)
+					{
+						cx::ImageView img = buffer.getImageView();
+						if (!img.isEmpty())
+						{
+							// do processing of img ...
+						}
+						buffer.queueBuffer();
+					}
+				\endcode
+
+				\note
+				The view references the image data in the DeviceBuffer and is invalid after queueBuffer (\ref cx_queueBuffer).
+			*/
+			cx::ImageView getImageView(int partIdx=0) const
+			{
+				cx_img_t img;
+				memset(&img, 0, sizeof(cx_img_t));
+				if (getBufferImage(partIdx, &img) != CX_STATUS_OK)
+					return cx::ImageView();
+				return cx::ImageView(img);
+			}
+
+			/** Get chunk data from acquisition buffer by value. The function neither allocates nor throws, an empty chunk (length 0) is returned on error.
+				\note
+				The chunk references the data in the DeviceBuffer and is invalid after queueBuffer (\ref cx_queueBuffer).
+				Use cx::ChunkView for typed access to the chunk records.
+			*/
+			cx::Chunk getChunkView(int chunkIdx=0) const
+			{
+				cx::Chunk chunk;
+				if (getBufferChunk(chunkIdx, chunk) != CX_STATUS_OK)
+					return cx::Chunk();
+				return chunk;
 			}
 
 			cx::ChunkPtr getChunk(int chunkIdx=0)
 			{
 				cx::ChunkPtr chunk = std::make_shared<cx::Chunk>();
-				cx::checkOk("cx_getBufferChunk", cx_getBufferChunk(m_hBuffer, chunkIdx, *chunk));
+				cx::checkOk("cx_getBufferChunk", getBufferChunk(chunkIdx, *chunk));
 				return chunk;
 			}
 
 			void getChunk(cx::Chunk& chunk, int chunkIdx=0)
 			{
-				cx::checkOk("cx_getBufferChunk", cx_getBufferChunk(m_hBuffer, chunkIdx, chunk));
+				cx::checkOk("cx_getBufferChunk", getBufferChunk(chunkIdx, chunk));
 			}
 
 			void getInfo(cx_buffer_info param, cx::Variant& val)
 			{
-				cx::checkOk("cx_getBufferInfo", cx_getBufferInfo(m_hBuffer, param, val));
+				cx::checkOk("cx_getBufferInfo", getBufferInfo(param, val));
 			}
 
 			void getPartInfo(int partIdx, cx_buffer_part_info param, cx::Variant& val)
 			{
-				cx::checkOk("cx_getBufferPartInfo", cx_getBufferPartInfo(m_hBuffer, partIdx, param, val));
+				cx::checkOk("cx_getBufferPartInfo", getBufferPartInfo(partIdx, param, val));
+			}
+
+			//! Same as getInfo but returns the status instead of throwing, e.g. for infos not supported by every transport layer.
+			cx_status_t tryGetInfo(cx_buffer_info param, cx::Variant& val) const
+			{
+				return getBufferInfo(param, val);
+			}
+
+			//! Same as getPartInfo but returns the status instead of throwing.
+			cx_status_t tryGetPartInfo(int partIdx, cx_buffer_part_info param, cx::Variant& val) const
+			{
+				return getBufferPartInfo(partIdx, param, val);
 			}
 
 			void queueBuffer()
 			{
-				cx::checkOk("cx_queueBuffer", cx_queueBuffer(m_hBuffer));
+				cx::checkOk("cx_queueBuffer", requeue());
 			}
 
+			/** Hand the buffer over to a token, the buffer object is invalid afterwards.
+				Used in the callback of Device::onBuffer to keep the buffer after the callback returns, the token queues the buffer back when it is released or destroyed.
+			*/
+			BufferToken detach();
+
+			BufferSource* getSource() const { return m_source; }		//!< source of the buffer, nullptr for buffers of the cx_cam library
+
 		protected:
 			operator CX_BUFFER_HANDLE() const { return m_hBuffer; }
 
 		private:
+			cx_status_t getBufferImage(int partIdx, cx_img_t* img) const
+			{
+				return m_source ? m_source->getBufferImage(m_hBuffer, partIdx, img) : cx_getBufferImage(m_hBuffer, partIdx, img);
+			}
+
+			cx_status_t getBufferChunk(int chunkIdx, cx_chunk_t* chunk) const
+			{
+				return m_source ? m_source->getBufferChunk(m_hBuffer, chunkIdx, chunk) : cx_getBufferChunk(m_hBuffer, chunkIdx, chunk);
+			}
+
+			cx_status_t getBufferInfo(int param, cx_variant_t* val) const
+			{
+				return m_source ? m_source->getBufferInfo(m_hBuffer, param, val) : cx_getBufferInfo(m_hBuffer, param, val);
+			}
+
+			cx_status_t getBufferPartInfo(int partIdx, int param, cx_variant_t* val) const
+			{
+				return m_source ? m_source->getBufferPartInfo(m_hBuffer, partIdx, param, val) : cx_getBufferPartInfo(m_hBuffer, partIdx, param, val);
+			}
+
+			cx_status_t requeue() const
+			{
+				cx_status_t status = m_source ? m_source->queueBuffer(m_hBuffer) : cx_queueBuffer(m_hBuffer);
+				if (m_stats && status == CX_STATUS_OK)
+					m_stats->recordRequeue();
+				return status;
+			}
+
 			CX_BUFFER_HANDLE m_hBuffer;
+			BufferSource* m_source;
+			AcquisitionStats* m_stats;		// set by the device if statistics are enabled
+		};
+
+		/** BufferToken owns an acquisition buffer and queues it back to the device when it is released or destroyed.
+			The token is move-only, so exactly one owner is responsible for the buffer.
+
+			\code{.cpp}
+				cam->onBuffer([&](cx::DeviceBuffer& buffer) {
+					queue.push(buffer.detach());		// buffer is queued back when the consumer releases the token
+				});
+			\endcode
+		*/
+		class BufferToken
+		{
+		public:
+			BufferToken() {}
+			explicit BufferToken(const DeviceBuffer& buffer) : m_buffer(buffer) {}
+			BufferToken(BufferToken&& other) noexcept : m_buffer(other.m_buffer)
+			{
+				other.m_buffer = DeviceBuffer();
+			}
+			BufferToken& operator=(BufferToken&& other) noexcept
+			{
+				if (this != &other)
+				{
+					release();
+					m_buffer = other.m_buffer;
+					other.m_buffer = DeviceBuffer();
+				}
+				return *this;
+			}
+			~BufferToken()
+			{
+				release();
+			}
+
+			bool isValid() const { return m_buffer.isValid(); }
+
+			DeviceBuffer& buffer() { return m_buffer; }
+			DeviceBuffer* operator->() { return &m_buffer; }
+
+			/** Queue the buffer back to the device, the token is empty afterwards.
+				@return status of \ref cx_queueBuffer, CX_STATUS_OK for an empty token.
+			*/
+			cx_status_t release()
+			{
+				if (!m_buffer.isValid())
+					return CX_STATUS_OK;
+				cx_status_t status = m_buffer.requeue();
+				m_buffer = DeviceBuffer();
+				return status;
+			}
+
+		private:
+			BufferToken(const BufferToken&);
+			BufferToken& operator=(const BufferToken&);
+
+			DeviceBuffer m_buffer;
 		};
 
+		inline BufferToken DeviceBuffer::detach()
+		{
+			BufferToken token(*this);
+			m_hBuffer = CX_INVALID_HANDLE;
+			return token;
+		}
+
 		//! @} cx_wrapper_cpp
 	}	// namespace cx
 }	// namespace AT
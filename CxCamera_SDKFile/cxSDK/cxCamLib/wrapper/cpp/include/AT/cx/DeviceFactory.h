@@ -28,6 +28,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "cx_cam_param.h"
 #include "AT/cx/DeviceInfo.h"
 #include "AT/cx/Device.h"
+#include "AT/cx/ReplayDevice.h"
 
 namespace AT {
 	namespace cx {
@@ -112,9 +113,12 @@ namespace AT {
 				return std::make_shared<Device>();
 			}
 
+			/** Open device with given uri.
+				URIs of the form "replay://<file>?rate=<recorded|max|Hz>" open a recording with cx::ReplayDevice instead of a camera.
+			*/
 			static DevicePtr openDevice(const std::string& uri, Device::open_mode openMode=Device::OPEN_EXCLUSIVE)
 			{
-				DevicePtr dev = createDevice();
+				DevicePtr dev = ReplayDevice::isReplayUri(uri) ? DevicePtr(std::make_shared<ReplayDevice>()) : createDevice();
 				dev->open(uri, openMode);
 				return dev;
 			}
@@ -0,0 +1,578 @@
+/**
+@file : DeviceGroup.h
+@package : cx_cam library
+@brief C++ synchronized acquisition of several devices with frame alignment
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_DEVICEGROUP_H_INCLUDED
+#define AT_CX_DEVICEGROUP_H_INCLUDED
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <stdexcept>
+
+#include "AT/cx/base.h"
+#include "AT/cx/ChunkView.h"
+#include "AT/cx/Device.h"
+#include "AT/cx/DeviceFactory.h"
+
+namespace AT {
+	namespace cx {
+
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		/** Class DeviceGroup acquires from several devices and delivers the buffers belonging to the same frame as one tuple.
+			Every device has its own grabber thread, a slow or stalled device does not delay the buffers of the other devices.
+			Buffers are aligned by a key, the frame id or encoder value of the camera info chunk or the buffer timestamp. Buffers whose keys differ by at most the tolerance form a tuple.
+			If a device has no buffer within the tolerance, the tuple is delivered without it and the device is reported missing, see Tuple::numMissing.
+			A device is known to miss a frame as soon as it delivers a newer buffer. If it delivers nothing, the tuple is completed after the match timeout.
+
+			\code{.cpp}
+				auto group = cx::DeviceGroup::open({ uri0, uri1, uri2, uri3 });
+				group->setAlignment(cx::DeviceGroup::ALIGN_FRAME_ID);
+				group->start(16);
+				cx::DeviceGroup::Tuple tuple;
+				while (running)
+				{
+					if (group->tryWaitForTuple(tuple, 1000) != CX_STATUS_OK)
+						continue;
+					if (tuple.isComplete())
+					{
+						// fuse tuple.buffers[0..3] ...
+					}
+					group->queueTuple(tuple);
+				}
+				group->stop();
+			\endcode
+
+			\note The keys of every device must increase with every buffer, devices started at different times need a common frame id reset (e.g. by a common trigger) or a key function compensating the offset.
+			Frame ids and encoder values are unwrapped, wrap-arounds of the 32 bit chunk fields don't break the alignment.
+		*/
+		class DeviceGroup
+		{
+		public:
+			typedef std::shared_ptr<DeviceGroup> Ptr;
+
+			//! Key used for aligning the buffers of the devices.
+			enum align_mode {
+				ALIGN_FRAME_ID = 0,		//!< frame id of the first record of the camera info chunk
+				ALIGN_ENCODER = 1,		//!< encoder value of the first record of the camera info chunk
+				ALIGN_TIMESTAMP = 2,	//!< CX_BUFFER_INFO_TIMESTAMP, devices must have synchronized clocks (e.g. PTP)
+			};
+
+			/** Computes the alignment key of a buffer, called from the grabber thread of the device.
+				@return false if the buffer has no key, the buffer is queued back and counted as unkeyed.
+			*/
+			typedef std::function<bool(size_t deviceIdx, DeviceBuffer& buffer, int64_t& key)> KeyFunction;
+
+			/** Buffers of one frame, one entry per device in the order of addDevice.
+			*/
+			struct Tuple
+			{
+				Tuple() : key(0), numMissing(0), sequence(0) {}
+
+				std::vector<DeviceBuffer> buffers;		//!< buffer of each device, invalid if the device missed the frame
+				std::vector<int64_t> keys;				//!< alignment key of each buffer
+				int64_t key;							//!< smallest key of the tuple
+				size_t numMissing;						//!< number of devices without buffer
+				uint64_t sequence;						//!< running number of the delivered tuples
+
+				bool isComplete() const { return numMissing == 0; }
+				bool has(size_t deviceIdx) const { return buffers[deviceIdx].isValid(); }
+			};
+
+			//! Statistics of a single device.
+			struct DeviceStats
+			{
+				uint64_t grabbed;		//!< buffers received from the device
+				uint64_t timeouts;		//!< tryWaitForBuffer calls that timed out
+				uint64_t grabErrors;	//!< tryWaitForBuffer calls that failed with other errors than timeout
+				uint64_t unkeyed;		//!< buffers dropped because no key could be computed
+				uint64_t missing;		//!< tuples delivered without a buffer of this device
+				size_t pending;			//!< buffers waiting for their partners
+			};
+
+			DeviceGroup() : m_mode(ALIGN_FRAME_ID), m_tolerance(0), m_matchTimeout(100), m_grabTimeout(100), m_dropIncomplete(false),
+				m_running(false), m_stop(false), m_sequence(0), m_numComplete(0), m_numIncomplete(0), m_requeueErrors(0)
+			{
+			}
+
+			~DeviceGroup()
+			{
+				stop();
+			}
+
+			static Ptr createShared()
+			{
+				return std::make_shared<DeviceGroup>();
+			}
+
+			/** Opens all devices with DeviceFactory::openDevice and adds them to a new group.
+			*/
+			static Ptr open(const std::vector<std::string>& uris, Device::open_mode openMode = Device::OPEN_EXCLUSIVE)
+			{
+				Ptr group = createShared();
+				for (size_t i = 0; i < uris.size(); i++)
+					group->addDevice(DeviceFactory::openDevice(uris[i], openMode));
+				return group;
+			}
+
+			//! Adds an opened device, e.g. a cx::ReplayDevice for simulation. Returns the index of the device in the tuples.
+			size_t addDevice(const DevicePtr& device)
+			{
+				if (m_running)
+					throw std::runtime_error("DeviceGroup: devices can't be added while the group is running");
+				if (!device)
+					throw std::runtime_error("DeviceGroup: invalid device");
+				m_members.push_back(std::unique_ptr<Member>(new Member(device)));
+				return m_members.size() - 1;
+			}
+
+			size_t size() const { return m_members.size(); }
+			DevicePtr getDevice(size_t deviceIdx) const { return m_members.at(deviceIdx)->device; }
+
+			/** Set alignment key and tolerance, buffers with keys differing by at most tolerance belong to the same tuple.
+				The tolerance is given in frames, encoder increments or timestamp ticks.
+			*/
+			void setAlignment(align_mode mode, int64_t tolerance = 0)
+			{
+				m_mode = mode;
+				m_tolerance = tolerance;
+				m_keyFunction = KeyFunction();
+			}
+
+			//! Set a user defined key function instead of the align_mode, keys are used as returned without unwrapping.
+			void setKeyFunction(const KeyFunction& func, int64_t tolerance = 0)
+			{
+				m_keyFunction = func;
+				m_tolerance = tolerance;
+			}
+
+			//! Time in ms a buffer waits for partners of devices that delivered nothing, before its tuple is delivered incomplete.
+			void setMatchTimeout(unsigned timeout) { m_matchTimeout = timeout; }
+
+			//! Timeout in ms of Device::tryWaitForBuffer in the grabber threads, limits the latency of stop().
+			void setGrabTimeout(unsigned timeout) { m_grabTimeout = timeout; }
+
+			//! If true, incomplete tuples are queued back and counted instead of being delivered.
+			void setDropIncomplete(bool drop) { m_dropIncomplete = drop; }
+
+			/** Allocate buffers, start acquisition on all devices and start the grabber threads.
+				@param numBuffers	number of buffers per device, must cover the pending buffers during the match timeout plus the tuples held by the application.
+			*/
+			void start(int numBuffers = 8)
+			{
+				if (m_running)
+					return;
+				if (m_members.empty())
+					throw std::runtime_error("DeviceGroup: no devices");
+
+				for (size_t i = 0; i < m_members.size(); i++)
+				{
+					Member& m = *m_members[i];
+					m.pending.clear();
+					m.hasLast = false;
+					m.device->allocAndQueueBuffers(numBuffers);
+				}
+				m_stop = false;
+				m_running = true;
+				for (size_t i = 0; i < m_members.size(); i++)
+					m_members[i]->grabber = std::thread(&DeviceGroup::grabberLoop, this, i);
+
+				// start the devices close together, a failure stops the devices already started
+				size_t started = 0;
+				try
+				{
+					for (; started < m_members.size(); started++)
+						m_members[started]->device->startAcquisition();
+				}
+				catch (...)
+				{
+					stopThreads();
+					for (size_t i = 0; i < m_members.size(); i++)
+					{
+						try
+						{
+							if (i < started)
+								m_members[i]->device->stopAcquisition();
+							m_members[i]->device->freeBuffers();
+						}
+						catch (const std::exception&)
+						{
+						}
+					}
+					throw;
+				}
+			}
+
+			/** Stop the grabber threads, stop acquisition and free the buffers of all devices.
+				Tuples held by the application are invalid afterwards.
+			*/
+			void stop()
+			{
+				if (!m_running)
+					return;
+				stopThreads();
+				for (size_t i = 0; i < m_members.size(); i++)
+				{
+					Member& m = *m_members[i];
+					try
+					{
+						m.device->stopAcquisition();
+						m.device->freeBuffers();
+					}
+					catch (const std::exception&)
+					{
+					}
+					m.pending.clear();
+				}
+			}
+
+			bool isRunning() const { return m_running; }
+
+			/** Wait for the next tuple.
+				@param[out] tuple	receives the buffers, the previous buffers of the tuple must have been queued with queueTuple.
+				@param[in] timeout	timeout in ms.
+				@return CX_STATUS_OK if a tuple (complete or not) was delivered, CX_STATUS_TIMEOUT otherwise.
+			*/
+			cx_status_t tryWaitForTuple(Tuple& tuple, unsigned timeout)
+			{
+				auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+				std::unique_lock<std::mutex> lock(m_mutex);
+				for (;;)
+				{
+					auto now = std::chrono::steady_clock::now();
+					std::chrono::steady_clock::time_point expires;
+					while (match(tuple, now, expires))
+					{
+						if (tuple.isComplete())
+						{
+							m_numComplete++;
+							return CX_STATUS_OK;
+						}
+						m_numIncomplete++;
+						if (!m_dropIncomplete)
+							return CX_STATUS_OK;
+						requeue(tuple);
+					}
+					if (now >= deadline)
+						return CX_STATUS_TIMEOUT;
+					m_ready.wait_until(lock, std::min(deadline, expires));
+				}
+			}
+
+			//! Queue the buffers of the tuple back to their devices.
+			void queueTuple(Tuple& tuple)
+			{
+				requeue(tuple);
+			}
+
+			DeviceStats getDeviceStats(size_t deviceIdx) const
+			{
+				const Member& m = *m_members.at(deviceIdx);
+				DeviceStats stats;
+				stats.grabbed = m.grabbed;
+				stats.timeouts = m.timeouts;
+				stats.grabErrors = m.grabErrors;
+				stats.unkeyed = m.unkeyed;
+				stats.missing = m.missing;
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					stats.pending = m.pending.size();
+				}
+				return stats;
+			}
+
+			uint64_t numComplete() const { return m_numComplete; }			//!< number of complete tuples
+			uint64_t numIncomplete() const { return m_numIncomplete; }		//!< number of tuples with missing devices, delivered or dropped
+			uint64_t numRequeueErrors() const { return m_requeueErrors; }	//!< number of failed DeviceBuffer::queueBuffer calls
+
+		private:
+			DeviceGroup(const DeviceGroup&);
+			DeviceGroup& operator=(const DeviceGroup&);
+
+			struct Pending
+			{
+				DeviceBuffer buffer;
+				int64_t key;
+				std::chrono::steady_clock::time_point arrival;
+			};
+
+			struct Member
+			{
+				Member(const DevicePtr& dev) : device(dev), hasLast(false), lastRaw(0), lastKey(0), grabbed(0), timeouts(0), grabErrors(0), unkeyed(0), missing(0) {}
+
+				DevicePtr device;
+				std::thread grabber;
+				std::deque<Pending> pending;	// guarded by m_mutex, keys increase
+
+				// key unwrapping, only used by the grabber thread
+				bool hasLast;
+				uint64_t lastRaw;
+				int64_t lastKey;
+
+				std::atomic<uint64_t> grabbed;
+				std::atomic<uint64_t> timeouts;
+				std::atomic<uint64_t> grabErrors;
+				std::atomic<uint64_t> unkeyed;
+				std::atomic<uint64_t> missing;
+			};
+
+			template<typename T>
+			static bool chunkInfo(const cx_chunk_t& chunk, int64_t& frameId, int64_t& encoder)
+			{
+				cx::ChunkView<T> view(chunk);
+				if (view.empty())
+					return false;
+				frameId = (int64_t)view.frameId(0);
+				encoder = view.encoderValue(0);
+				return true;
+			}
+
+			// reads the raw key of the buffer from the chunk or the buffer info
+			bool rawKey(DeviceBuffer& buffer, int64_t& key) const
+			{
+				if (m_mode == ALIGN_TIMESTAMP)
+				{
+					cx::Variant val;
+					try
+					{
+						buffer.getInfo(CX_BUFFER_INFO_TIMESTAMP, val);
+					}
+					catch (const std::exception&)
+					{
+						return false;
+					}
+					key = (int64_t)val;
+					return true;
+				}
+
+				int numChunks = 1;
+				try
+				{
+					cx::Variant val;
+					buffer.getInfo(CX_BUFFER_INFO_NUM_CHUNK, val);
+					numChunks = (int)val;
+				}
+				catch (const std::exception&)
+				{
+				}
+				for (int i = 0; i < numChunks; i++)
+				{
+					cx::Chunk chunk = buffer.getChunkView(i);
+					int64_t frameId = 0, encoder = 0;
+					if (chunkInfo<cx_chunk_camera_info_t>(chunk, frameId, encoder) || chunkInfo<cx_c6_chunk_frame_info_t>(chunk, frameId, encoder)
+						|| chunkInfo<cx_chunk_c6_line_info_t>(chunk, frameId, encoder) || chunkInfo<cx_chunk_irsx_image_info_t>(chunk, frameId, encoder))
+					{
+						key = (m_mode == ALIGN_ENCODER) ? encoder : frameId;
+						return true;
+					}
+				}
+				return false;
+			}
+
+			bool computeKey(size_t idx, Member& m, DeviceBuffer& buffer, int64_t& key)
+			{
+				if (m_keyFunction)
+					return m_keyFunction(idx, buffer, key);
+				int64_t raw = 0;
+				if (!rawKey(buffer, raw))
+					return false;
+				if (m_mode == ALIGN_TIMESTAMP)
+				{
+					key = raw;
+					return true;
+				}
+				// unwrap the 32 bit chunk fields, consecutive buffers differ by less than 2^31
+				if (m.hasLast)
+					key = m.lastKey + (int32_t)(uint32_t)((uint64_t)raw - m.lastRaw);
+				else
+					key = raw;
+				m.hasLast = true;
+				m.lastRaw = (uint64_t)raw;
+				m.lastKey = key;
+				return true;
+			}
+
+			/** Builds a tuple from the oldest pending buffers, called with m_mutex locked.
+				Returns false if a device without pending buffer may still deliver the partner, expires is set to the time the tuple is completed without it.
+			*/
+			bool match(Tuple& tuple, std::chrono::steady_clock::time_point now, std::chrono::steady_clock::time_point& expires)
+			{
+				expires = std::chrono::steady_clock::time_point::max();
+				bool found = false;
+				int64_t ref = 0;
+				for (size_t i = 0; i < m_members.size(); i++)
+				{
+					const std::deque<Pending>& p = m_members[i]->pending;
+					if (!p.empty() && (!found || p.front().key < ref))
+					{
+						ref = p.front().key;
+						found = true;
+					}
+				}
+				if (!found)
+					return false;
+
+				// devices with a newer buffer have missed the frame, devices without buffer might deliver it later
+				bool waiting = false;
+				std::chrono::steady_clock::time_point oldest = now;
+				for (size_t i = 0; i < m_members.size(); i++)
+				{
+					const std::deque<Pending>& p = m_members[i]->pending;
+					if (p.empty())
+						waiting = true;
+					else if (p.front().key - ref <= m_tolerance && p.front().arrival < oldest)
+						oldest = p.front().arrival;
+				}
+				if (waiting)
+				{
+					expires = oldest + std::chrono::milliseconds(m_matchTimeout);
+					if (now < expires)
+						return false;
+				}
+
+				size_t n = m_members.size();
+				tuple.buffers.assign(n, DeviceBuffer());
+				tuple.keys.assign(n, 0);
+				tuple.key = ref;
+				tuple.numMissing = 0;
+				for (size_t i = 0; i < n; i++)
+				{
+					Member& m = *m_members[i];
+					if (!m.pending.empty() && m.pending.front().key - ref <= m_tolerance)
+					{
+						tuple.buffers[i] = m.pending.front().buffer;
+						tuple.keys[i] = m.pending.front().key;
+						m.pending.pop_front();
+					}
+					else
+					{
+						tuple.numMissing++;
+						m.missing++;
+					}
+				}
+				tuple.sequence = m_sequence++;
+				return true;
+			}
+
+			void requeue(Tuple& tuple)
+			{
+				for (size_t i = 0; i < tuple.buffers.size(); i++)
+				{
+					if (!tuple.buffers[i].isValid())
+						continue;
+					try
+					{
+						tuple.buffers[i].queueBuffer();
+					}
+					catch (const std::exception&)
+					{
+						m_requeueErrors++;
+					}
+					tuple.buffers[i] = DeviceBuffer();
+				}
+			}
+
+			void grabberLoop(size_t idx)
+			{
+				Member& m = *m_members[idx];
+				while (!m_stop)
+				{
+					Pending p;
+					cx_status_t status = m.device->tryWaitForBuffer(p.buffer, m_grabTimeout);
+					if (status != CX_STATUS_OK)
+					{
+						if (status == CX_STATUS_TIMEOUT)
+							m.timeouts++;
+						else
+						{
+							m.grabErrors++;
+							std::this_thread::sleep_for(std::chrono::milliseconds(1));	// don't spin on a failing device
+						}
+						continue;
+					}
+					m.grabbed++;
+					if (!computeKey(idx, m, p.buffer, p.key))
+					{
+						m.unkeyed++;
+						try
+						{
+							p.buffer.queueBuffer();
+						}
+						catch (const std::exception&)
+						{
+							m_requeueErrors++;
+						}
+						continue;
+					}
+					p.arrival = std::chrono::steady_clock::now();
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						m.pending.push_back(p);
+					}
+					m_ready.notify_all();
+				}
+			}
+
+			void stopThreads()
+			{
+				m_stop = true;
+				for (size_t i = 0; i < m_members.size(); i++)
+				{
+					if (m_members[i]->grabber.joinable())
+						m_members[i]->grabber.join();
+				}
+				m_running = false;
+				m_ready.notify_all();
+			}
+
+			std::vector<std::unique_ptr<Member>> m_members;
+			align_mode m_mode;
+			int64_t m_tolerance;
+			KeyFunction m_keyFunction;
+			unsigned m_matchTimeout;
+			unsigned m_grabTimeout;
+			bool m_dropIncomplete;
+
+			mutable std::mutex m_mutex;
+			std::condition_variable m_ready;
+			std::atomic<bool> m_running;
+			std::atomic<bool> m_stop;
+
+			uint64_t m_sequence;
+			std::atomic<uint64_t> m_numComplete;
+			std::atomic<uint64_t> m_numIncomplete;
+			std::atomic<uint64_t> m_requeueErrors;
+		};
+
+		typedef DeviceGroup::Ptr DeviceGroupPtr;
+
+		//! @} cx_wrapper_cpp
+	}	// namespace cx
+}	// namespace AT
+#endif	// AT_CX_DEVICEGROUP_H_INCLUDED
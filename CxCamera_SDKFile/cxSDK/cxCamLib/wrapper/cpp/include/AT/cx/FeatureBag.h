@@ -0,0 +1,224 @@
+/**
+@file : FeatureBag.h
+@package : cx_cam library
+@brief C++ parser and diff of GenICam FeatureBag configuration files
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_FEATUREBAG_H_INCLUDED
+#define AT_CX_FEATUREBAG_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+
+namespace AT {
+	namespace cx {
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		/** Class FeatureBag holds the features of a GenICam FeatureBag file (CX_CAM_FILE_FEATURE_BAG) in file order.
+			The file is a text file with one "Name<TAB>Value" line per feature, preceded by comment lines starting with '#'.
+			GenApi writes the features in an order that can be loaded again, selectors are written before the features depending on them.
+
+			Every feature records the selector values in effect at its position in the file. Following the SFNC naming, features named "...Selector" are treated as selectors.
+			Two bags written by the same device model list their features in the same order, so features are identified by their name and selector values,
+			see key(). diff() uses this to build a bag with only the changed features and the selector writes they need.
+		*/
+		class FeatureBag
+		{
+		public:
+			typedef std::vector<std::pair<std::string, std::string> > Selection;	//!< selector names and values
+
+			struct Feature
+			{
+				std::string name;
+				std::string value;
+				Selection selection;	//!< selector values in effect when the feature is written, in file order
+			};
+
+			FeatureBag() {}
+			explicit FeatureBag(const std::string& text) { parse(text); }
+
+			//! Parses the text of a FeatureBag file, lines without value are ignored.
+			void parse(const std::string& text)
+			{
+				m_header.clear();
+				m_features.clear();
+				m_selection.clear();
+				size_t pos = 0;
+				while (pos < text.size())
+				{
+					size_t end = text.find('\n', pos);
+					if (end == std::string::npos)
+						end = text.size();
+					std::string line = text.substr(pos, end - pos);
+					pos = end + 1;
+					if (!line.empty() && line[line.size() - 1] == '\r')
+						line.resize(line.size() - 1);
+					if (line.empty())
+						continue;
+					if (line[0] == '#')
+					{
+						// comments of the file header identify the file format and must be kept for loading
+						if (m_features.empty())
+							m_header.push_back(line);
+						continue;
+					}
+					size_t sep = line.find('\t');
+					if (sep == std::string::npos)
+						sep = line.find(' ');
+					if (sep == std::string::npos || sep == 0)
+						continue;
+					size_t val = line.find_first_not_of(" \t", sep);
+					append(line.substr(0, sep), val == std::string::npos ? std::string() : line.substr(val));
+				}
+			}
+
+			//! Returns the text of the FeatureBag file.
+			std::string toString() const
+			{
+				std::string s;
+				for (size_t i = 0; i < m_header.size(); i++)
+					s += m_header[i] + "\n";
+				for (size_t i = 0; i < m_features.size(); i++)
+					s += m_features[i].name + "\t" + m_features[i].value + "\n";
+				return s;
+			}
+
+			//! Appends a feature, a selector changes the selection of the following features.
+			void append(const std::string& name, const std::string& value)
+			{
+				Feature f;
+				f.name = name;
+				f.value = value;
+				f.selection = m_selection;
+				m_features.push_back(f);
+				if (!isSelector(name))
+					return;
+				for (size_t i = 0; i < m_selection.size(); i++)
+				{
+					if (m_selection[i].first == name)
+					{
+						m_selection[i].second = value;
+						return;
+					}
+				}
+				m_selection.push_back(std::make_pair(name, value));
+			}
+
+			const std::vector<Feature>& features() const { return m_features; }
+			const std::vector<std::string>& header() const { return m_header; }
+
+			//! Returns the selector values after the last feature.
+			const Selection& selection() const { return m_selection; }
+
+			//! Number of features which are not selectors.
+			size_t numValues() const
+			{
+				size_t n = 0;
+				for (size_t i = 0; i < m_features.size(); i++)
+					n += isSelector(m_features[i].name) ? 0 : 1;
+				return n;
+			}
+
+			//! Returns the names of the features which are not selectors, selected features as "Name[Selector=Value,...]".
+			std::vector<std::string> valueNames() const
+			{
+				std::vector<std::string> names;
+				for (size_t i = 0; i < m_features.size(); i++)
+				{
+					if (!isSelector(m_features[i].name))
+						names.push_back(key(m_features[i]));
+				}
+				return names;
+			}
+
+			/** Returns a bag with the features of this bag which are missing or have a different value in current.
+				The selectors of each changed feature are written before it, only if they differ from the previous selector write.
+				Selectors written by the diff are finally set to the last values of this bag. Returns an empty bag (numValues() == 0) if nothing changed.
+			*/
+			FeatureBag diff(const FeatureBag& current) const
+			{
+				std::map<std::string, std::string> cur;
+				for (size_t i = 0; i < current.m_features.size(); i++)
+				{
+					const Feature& f = current.m_features[i];
+					if (!isSelector(f.name))
+						cur[key(f)] = f.value;
+				}
+
+				FeatureBag out;
+				out.m_header = m_header;
+				std::map<std::string, std::string> written;
+				for (size_t i = 0; i < m_features.size(); i++)
+				{
+					const Feature& f = m_features[i];
+					if (isSelector(f.name))
+						continue;
+					auto it = cur.find(key(f));
+					if (it != cur.end() && it->second == f.value)
+						continue;
+					for (size_t k = 0; k < f.selection.size(); k++)
+					{
+						auto w = written.find(f.selection[k].first);
+						if (w == written.end() || w->second != f.selection[k].second)
+						{
+							out.append(f.selection[k].first, f.selection[k].second);
+							written[f.selection[k].first] = f.selection[k].second;
+						}
+					}
+					out.append(f.name, f.value);
+				}
+				for (size_t k = 0; k < m_selection.size(); k++)
+				{
+					auto w = written.find(m_selection[k].first);
+					if (w != written.end() && w->second != m_selection[k].second)
+						out.append(m_selection[k].first, m_selection[k].second);
+				}
+				return out;
+			}
+
+			//! Returns the identifier of a feature: "Name" or "Name[Selector=Value,...]"
+			static std::string key(const Feature& f)
+			{
+				if (f.selection.empty())
+					return f.name;
+				std::string k = f.name + "[";
+				for (size_t i = 0; i < f.selection.size(); i++)
+					k += (i ? "," : "") + f.selection[i].first + "=" + f.selection[i].second;
+				return k + "]";
+			}
+
+			//! Returns true for selector features, SFNC names selectors "...Selector".
+			static bool isSelector(const std::string& name)
+			{
+				static const std::string suffix = "Selector";
+				return name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+			}
+
+		private:
+			std::vector<std::string> m_header;
+			std::vector<Feature> m_features;
+			Selection m_selection;
+		};
+
+		//! @} cx_wrapper_cpp
+	}
+}
+
+#endif	// AT_CX_FEATUREBAG_H_INCLUDED
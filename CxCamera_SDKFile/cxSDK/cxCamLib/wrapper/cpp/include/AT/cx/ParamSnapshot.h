@@ -0,0 +1,510 @@
+/**
+@file : ParamSnapshot.h
+@package : cx_cam library
+@brief C++ cached reading of device parameters, batched reading of registers
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_PARAMSNAPSHOT_H_INCLUDED
+#define AT_CX_PARAMSNAPSHOT_H_INCLUDED
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include "AT/cx/base.h"
+#include "AT/cx/Variant.h"
+#include "AT/cx/Device.h"
+
+namespace AT {
+	namespace cx {
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		/** Class ParamSnapshot reads a set of device parameters with their infos in one pass and caches the results.
+			Parameters are requested with add() and read with fetch(), a later request reads only the parameters not yet cached.
+			The cache is dropped when the parameter generation of the device changes, i.e. after setParam, setRegister, setMemory or a file upload
+			through the Device object. Writes by other applications or through the C API on the same handle are not detected, call invalidate() in that case.
+
+			Selector dependent parameters are requested with addSelected(): fetch() walks the selector values once, reads all requested parameters for each value
+			and restores the selector. The values are stored as "Name[Selector=Value]", see selectedName().
+			Registers and memory blocks are read with the GVCP multi register command, up to Device::MAX_REGISTERS_PER_READ registers per round trip.
+
+			\note Named parameters are not batched. The cx_cam API does not expose the register addresses of GenICam nodes,
+			so parameters are read by name with one round trip per value and per info, the snapshot only saves repeated reads.
+			Parameters with known fixed addresses can be requested with addRegister() to read up to Device::MAX_REGISTERS_PER_READ of them in one round trip.
+
+			Class is not thread safe.
+
+			\code{.cpp}
+				cx::ParamSnapshot params(*cam);
+				params.add({ "SensorWidth", "SensorHeight" });
+				params.add("BinningHorizontal", cx::ParamSnapshot::FETCH_VALUE | cx::ParamSnapshot::FETCH_ACCESS_MODE | cx::ParamSnapshot::FETCH_VISIBILITY);
+				params.addSelected("RegionSelector", { "Width", "Height" }, cx::ParamSnapshot::FETCH_VALUE, { 1, 2 });
+				params.fetch();
+				int64_t w = params.get("SensorWidth");
+				int64_t h1 = params.get("Height", "RegionSelector", 1);
+			\endcode
+		*/
+		class ParamSnapshot
+		{
+		public:
+			typedef std::shared_ptr<ParamSnapshot> Ptr;
+
+			//! What is read for a parameter, the info flags are (1 << \ref cx_param_info).
+			enum fetch_flags
+			{
+				FETCH_VALUE = 1,										//!< parameter value
+				FETCH_TYPE = 1 << CX_PARAM_INFO_TYPE,					//!< CX_PARAM_INFO_TYPE
+				FETCH_RANGE = 1 << CX_PARAM_INFO_RANGE,					//!< CX_PARAM_INFO_RANGE
+				FETCH_ACCESS_MODE = 1 << CX_PARAM_INFO_ACCESSS_MODE,	//!< CX_PARAM_INFO_ACCESSS_MODE, a value is not read if the parameter is not readable
+				FETCH_VISIBILITY = 1 << CX_PARAM_INFO_VISIBILITY,		//!< CX_PARAM_INFO_VISIBILITY
+				FETCH_ENUM_INT_VALUE = 1 << CX_PARAM_INFO_ENUM_INT_VALUE	//!< CX_PARAM_INFO_ENUM_INT_VALUE
+			};
+
+			explicit ParamSnapshot(Device& device) : m_device(device), m_generation(device.paramGeneration()), m_numReads(0)
+			{
+			}
+
+			//! Request a parameter, flags is a combination of \ref fetch_flags.
+			ParamSnapshot& add(const std::string& name, int flags = FETCH_VALUE)
+			{
+				Entry& e = m_entries[name];
+				e.flags |= flags;
+				return *this;
+			}
+
+			//! @overload
+			ParamSnapshot& add(const std::vector<std::string>& names, int flags = FETCH_VALUE)
+			{
+				for (size_t i = 0; i < names.size(); i++)
+					add(names[i], flags);
+				return *this;
+			}
+
+			//! @overload
+			ParamSnapshot& add(std::initializer_list<std::string> names, int flags = FETCH_VALUE)
+			{
+				return add(std::vector<std::string>(names), flags);
+			}
+
+			/** Request parameters for several values of a selector.
+				@param selector			selector parameter, e.g. "RegionSelector"
+				@param names			parameters depending on the selector
+				@param flags			combination of \ref fetch_flags
+				@param selectorValues	integer values of the selector, the parameters are read for these values only. If empty all values from CX_PARAM_INFO_RANGE of the selector are used.
+			*/
+			ParamSnapshot& addSelected(const std::string& selector, const std::vector<std::string>& names, int flags = FETCH_VALUE, const std::vector<int64_t>& selectorValues = std::vector<int64_t>())
+			{
+				SelectorGroup& g = m_selectors[selector];
+				for (size_t i = 0; i < names.size(); i++)
+				{
+					if (selectorValues.empty())
+						g.names[names[i]] |= flags;
+					for (auto v : selectorValues)
+						g.values[v][names[i]] |= flags;
+				}
+				if (selectorValues.empty())
+					g.allValues = true;
+				for (auto v : selectorValues)
+					g.values[v];
+				return *this;
+			}
+
+			//! Request a 32 bit register, registers are read in batches with cx_getRegisterMulti.
+			ParamSnapshot& addRegister(const std::string& name, uint32_t address)
+			{
+				Block& b = m_blocks[name];
+				b.address = address;
+				b.length = 4;
+				b.isRegister = true;
+				b.fetched = false;
+				return *this;
+			}
+
+			//! Request a memory block, read with cx_getMemory in one round trip.
+			ParamSnapshot& addMemory(const std::string& name, uint32_t address, uint32_t length)
+			{
+				Block& b = m_blocks[name];
+				b.address = address;
+				b.length = length;
+				b.isRegister = false;
+				b.fetched = false;
+				return *this;
+			}
+
+			/** Read all requested values that are not cached.
+				Failures of single parameters are stored and thrown by get(), a failure of the device connection throws.
+			*/
+			void fetch()
+			{
+				if (m_generation != m_device.paramGeneration())
+					invalidate();
+
+				// selector groups first, they mark their entries which must not be read by name
+				for (auto& it : m_selectors)
+					fetchSelected(it.first, it.second);
+				for (auto& it : m_entries)
+				{
+					if (!it.second.selected)
+						fetchEntry(it.first, it.second);
+				}
+				fetchBlocks();
+
+				// selectors written by fetchSelected are restored, the cached values are still valid
+				m_generation = m_device.paramGeneration();
+			}
+
+			//! Drops all cached values, the next access reads them again.
+			void invalidate()
+			{
+				for (auto& it : m_entries)
+				{
+					it.second.fetched = 0;
+					it.second.infos.clear();
+				}
+				for (auto& it : m_selectors)
+					it.second.rangeFetched = false;
+				for (auto& it : m_blocks)
+					it.second.fetched = false;
+				m_generation = m_device.paramGeneration();
+			}
+
+			//! Returns true if no parameter was written through the device since the last fetch().
+			bool isCurrent() const { return m_generation == m_device.paramGeneration(); }
+
+			/** Returns the value of a parameter, the value is read if it is not cached.
+				Throws cx::RuntimeError with the status of the failed read.
+			*/
+			const cx::Variant& get(const std::string& name)
+			{
+				const Entry& e = require(name, FETCH_VALUE);
+				cx::checkOk(("ParamSnapshot " + name).c_str(), e.status);
+				return e.value;
+			}
+
+			//! Returns the value of a selected parameter requested with addSelected().
+			const cx::Variant& get(const std::string& name, const std::string& selector, int64_t selectorValue)
+			{
+				return get(selectedName(name, selector, selectorValue));
+			}
+
+			//! Returns false if the parameter can not be read.
+			bool tryGet(const std::string& name, cx::Variant& val)
+			{
+				const Entry& e = require(name, FETCH_VALUE);
+				if (e.status != CX_STATUS_OK)
+					return false;
+				val = e.value;
+				return true;
+			}
+
+			//! Returns a parameter info, the info is read if it is not cached. Throws cx::RuntimeError with the status of the failed read.
+			const cx::Variant& info(const std::string& name, cx_param_info infoType)
+			{
+				const Entry& e = require(name, 1 << infoType);
+				const Info& inf = e.infos.find(infoType)->second;
+				cx::checkOk(("ParamSnapshot " + name).c_str(), inf.status);
+				return inf.value;
+			}
+
+			//! Returns false if the info can not be read.
+			bool tryInfo(const std::string& name, cx_param_info infoType, cx::Variant& val)
+			{
+				const Entry& e = require(name, 1 << infoType);
+				const Info& inf = e.infos.find(infoType)->second;
+				if (inf.status != CX_STATUS_OK)
+					return false;
+				val = inf.value;
+				return true;
+			}
+
+			/** Returns true if the parameter is readable and not invisible, like the checks of optional parameters (e.g. binning) in calibration code.
+			*/
+			bool isAvailable(const std::string& name)
+			{
+				cx::Variant am, vis;
+				if (!tryInfo(name, CX_PARAM_INFO_ACCESSS_MODE, am) || (int64_t)am <= CX_PARAM_ACCESS_WO)
+					return false;
+				if (!tryInfo(name, CX_PARAM_INFO_VISIBILITY, vis) || (int64_t)vis >= CX_PARAM_VISIBILITY_INVISIBLE)
+					return false;
+				cx::Variant val;
+				return tryGet(name, val);
+			}
+
+			//! Returns the selector values used for the parameters of the selector, the values are read from CX_PARAM_INFO_RANGE if requested.
+			std::vector<int64_t> selectorValues(const std::string& selector)
+			{
+				auto it = m_selectors.find(selector);
+				if (it == m_selectors.end())
+					throw std::runtime_error("ParamSnapshot: selector not requested " + selector);
+				if (!isCurrent() || (it->second.allValues && !it->second.rangeFetched))
+					fetch();
+				std::vector<int64_t> vals;
+				for (auto& v : it->second.values)
+					vals.push_back(v.first);
+				return vals;
+			}
+
+			//! Returns a register requested with addRegister().
+			uint32_t getRegister(const std::string& name)
+			{
+				const Block& b = requireBlock(name);
+				return b.value;
+			}
+
+			//! Returns a memory block requested with addMemory().
+			const std::vector<uint8_t>& getMemory(const std::string& name)
+			{
+				return requireBlock(name).data;
+			}
+
+			//! Number of device accesses (reads and selector writes) performed so far, e.g. for measuring the effect of caching.
+			uint64_t numReads() const { return m_numReads; }
+
+			//! Returns the key of a selected parameter: "Name[Selector=Value]"
+			static std::string selectedName(const std::string& name, const std::string& selector, int64_t selectorValue)
+			{
+				return name + "[" + selector + "=" + std::to_string((long long)selectorValue) + "]";
+			}
+
+			static ParamSnapshot::Ptr createShared(Device& device)
+			{
+				return std::make_shared<ParamSnapshot>(device);
+			}
+
+		private:
+			ParamSnapshot(const ParamSnapshot&);
+			ParamSnapshot& operator=(const ParamSnapshot&);
+
+			struct Info
+			{
+				Info() : status(CX_STATUS_OK) {}
+				cx_status_t status;
+				cx::Variant value;
+			};
+
+			struct Entry
+			{
+				Entry() : flags(0), fetched(0), selected(false), status(CX_STATUS_OK) {}
+				int flags;			// requested fetch_flags
+				int fetched;		// fetch_flags read since the last invalidation
+				bool selected;		// entry of a selector group, read by fetchSelected
+				cx_status_t status;
+				cx::Variant value;
+				std::map<int, Info> infos;
+			};
+
+			struct SelectorGroup
+			{
+				SelectorGroup() : allValues(false), rangeFetched(false) {}
+				std::map<std::string, int> names;	// parameter names and their fetch flags for all values
+				std::map<int64_t, std::map<std::string, int> > values;	// selector values and the parameters requested for the value only
+				bool allValues;						// use all values of the selector range
+				bool rangeFetched;
+			};
+
+			struct Block
+			{
+				Block() : address(0), length(0), isRegister(true), fetched(false), value(0) {}
+				uint32_t address;
+				uint32_t length;
+				bool isRegister;
+				bool fetched;
+				uint32_t value;
+				std::vector<uint8_t> data;
+			};
+
+			const Entry& require(const std::string& name, int flags)
+			{
+				Entry& e = m_entries[name];
+				if ((e.flags & flags) != flags || !isCurrent())
+				{
+					e.flags |= flags;
+					fetch();
+				}
+				else if ((e.fetched & flags) != flags)
+					fetch();
+				return e;
+			}
+
+			const Block& requireBlock(const std::string& name)
+			{
+				auto it = m_blocks.find(name);
+				if (it == m_blocks.end())
+					throw std::runtime_error("ParamSnapshot: register not requested " + name);
+				if (!it->second.fetched || !isCurrent())
+					fetch();
+				return it->second;
+			}
+
+			// reads the missing infos and the value of the entry, prm is the device parameter name without selector suffix
+			void fetchEntry(const std::string& prm, Entry& e)
+			{
+				int missing = e.flags & ~e.fetched;
+				if (missing == 0)
+					return;
+				// infos first, the value is not read if the access mode says it is not readable
+				for (int t = CX_PARAM_INFO_TYPE; t <= CX_PARAM_INFO_ENUM_INT_VALUE; t++)
+				{
+					if (!(missing & (1 << t)))
+						continue;
+					Info& inf = e.infos[t];
+					inf.status = read([&]() { m_device.getParamInfo((cx_param_info)t, prm, inf.value); });
+					e.fetched |= 1 << t;
+				}
+				if (missing & FETCH_VALUE)
+				{
+					auto am = e.infos.find(CX_PARAM_INFO_ACCESSS_MODE);
+					if (am != e.infos.end() && am->second.status == CX_STATUS_OK && (int64_t)am->second.value <= CX_PARAM_ACCESS_WO)
+						e.status = CX_STATUS_NOT_IMPLEMENTED;
+					else
+						e.status = read([&]() { m_device.getParam(prm, e.value); });
+					e.fetched |= FETCH_VALUE;
+				}
+			}
+
+			void fetchSelected(const std::string& selector, SelectorGroup& g)
+			{
+				if (g.allValues && !g.rangeFetched)
+				{
+					cx::Variant range;
+					m_numReads++;
+					m_device.getParamInfo(CX_PARAM_INFO_RANGE, selector, range);
+					std::vector<int64_t> vals;
+					cx::checkOk("ParamSnapshot range of selector", range.get(vals));
+					for (auto v : vals)
+						g.values[v];
+					g.rangeFetched = true;
+				}
+
+				// values of the selector with missing entries and the parameters to read for them
+				std::vector<std::pair<int64_t, std::map<std::string, int> > > todo;
+				for (auto& v : g.values)
+				{
+					std::map<std::string, int> names = g.names;
+					for (auto& n : v.second)
+						names[n.first] |= n.second;
+					bool missing = false;
+					for (auto& n : names)
+					{
+						Entry& e = m_entries[selectedName(n.first, selector, v.first)];
+						e.selected = true;
+						e.flags |= n.second;
+						missing = missing || (e.flags & ~e.fetched) != 0;
+					}
+					if (missing)
+						todo.push_back(std::make_pair(v.first, names));
+				}
+				if (todo.empty())
+					return;
+
+				cx::Variant stored;
+				m_numReads++;
+				m_device.getParam(selector, stored);
+				try
+				{
+					for (auto& v : todo)
+					{
+						m_numReads++;
+						m_device.setParam(selector, cx::Variant(v.first));
+						for (auto& n : v.second)
+						{
+							fetchEntry(n.first, m_entries[selectedName(n.first, selector, v.first)]);
+						}
+					}
+				}
+				catch (...)
+				{
+					restoreSelector(selector, stored);
+					throw;
+				}
+				restoreSelector(selector, stored);
+			}
+
+			void restoreSelector(const std::string& selector, const cx::Variant& stored)
+			{
+				m_numReads++;
+				m_device.setParam(selector, stored);
+			}
+
+			void fetchBlocks()
+			{
+				std::vector<uint32_t> addr;
+				std::vector<Block*> regs;
+				for (auto& it : m_blocks)
+				{
+					Block& b = it.second;
+					if (b.fetched)
+						continue;
+					if (b.isRegister)
+					{
+						addr.push_back(b.address);
+						regs.push_back(&b);
+						continue;
+					}
+					b.data.resize(b.length);
+					m_numReads++;
+					m_device.getMemory(b.address, b.data.data(), b.length);
+					b.fetched = true;
+				}
+				if (addr.empty())
+					return;
+				std::vector<uint32_t> vals(addr.size(), 0);
+				m_numReads += (addr.size() + Device::MAX_REGISTERS_PER_READ - 1) / Device::MAX_REGISTERS_PER_READ;
+				m_device.getRegisters(addr.data(), vals.data(), addr.size());
+				for (size_t i = 0; i < regs.size(); i++)
+				{
+					regs[i]->value = vals[i];
+					regs[i]->fetched = true;
+				}
+			}
+
+			// calls func and returns the status of a cx::RuntimeError, connection errors are thrown
+			template<typename Func>
+			cx_status_t read(Func func)
+			{
+				m_numReads++;
+				try
+				{
+					func();
+					return CX_STATUS_OK;
+				}
+				catch (const cx::RuntimeError& e)
+				{
+					if (e.status() == CX_STATUS_DEVICE_NOT_OPEN || e.status() == CX_STATUS_TIMEOUT)
+						throw;
+					return e.status();
+				}
+			}
+
+			Device& m_device;
+			uint64_t m_generation;
+			uint64_t m_numReads;
+			std::map<std::string, Entry> m_entries;
+			std::map<std::string, SelectorGroup> m_selectors;
+			std::map<std::string, Block> m_blocks;
+		};
+
+		//! @} cx_wrapper_cpp
+	}
+}
+
+#endif	// AT_CX_PARAMSNAPSHOT_H_INCLUDED
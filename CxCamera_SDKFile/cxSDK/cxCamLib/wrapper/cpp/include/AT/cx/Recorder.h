@@ -0,0 +1,609 @@
+/**
+@file : Recorder.h
+@package : cx_cam library
+@brief C++ streaming recorder for acquisition buffers
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_RECORDER_H_INCLUDED
+#define AT_CX_RECORDER_H_INCLUDED
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+
+#ifdef _WIN32
+#	include <io.h>
+#	include <fcntl.h>
+#	include <sys/stat.h>
+#	include <malloc.h>
+#else
+#	include <unistd.h>
+#	include <fcntl.h>
+#endif
+
+#include "AT/cx/base.h"
+#include "AT/cx/BoundedQueue.h"
+#include "cx_cam.h"
+#include "AT/cx/Device.h"
+#include "AT/cx/Recording.h"
+
+namespace AT {
+	namespace cx {
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		/** Recorder writes acquisition buffers with all parts, part infos, chunks and the buffer timestamp into a recording (see Recording.h),
+			e.g. for replay with cx::ReplayDevice.
+
+			record() copies the buffer into large aligned blocks and returns, the buffer can be queued immediately afterwards.
+			A dedicated I/O thread writes the full blocks. The file is extended with preallocated segments (fallocate) and can be opened
+			with O_DIRECT to bypass the page cache on Linux. If all blocks are in flight, record() drops the buffer instead of waiting,
+			so the grab thread is never stalled by the disk (see Options::blockOnFull).
+			close() writes the index footer, which allows direct access by frame number and timestamp with cx::RecordingReader,
+			and releases the preallocated space behind the footer.
+
+			\code{.cpp}
+				cx::ParamMap params;
+				cam->getParam("Width", params["Width"]);
+				cx::Recorder rec("scan.cxrec", params);
+				cx::DeviceBuffer buffer;
+				while (running && cam->tryWaitForBuffer(buffer, 100) == CX_STATUS_OK)
+				{
+					rec.record(buffer);
+					buffer.queueBuffer();
+				}
+				rec.close();
+				std::cout << "dropped: " << rec.numDropped() << std::endl;
+			\endcode
+
+			\note record() must not be called concurrently from several threads.
+			Preallocation and O_DIRECT are only available on Linux, on other systems the options are ignored.
+		*/
+		class Recorder
+		{
+		public:
+			typedef std::shared_ptr<Recorder> Ptr;
+
+			//! Recorder options
+			struct Options
+			{
+				Options() : blockSize(8 << 20), numBlocks(32), segmentSize(uint64_t(1) << 30), directIO(false), blockOnFull(false) {}
+				size_t blockSize;		//!< size of the write blocks, multiple of 4096
+				size_t numBlocks;		//!< number of blocks, numBlocks*blockSize is the memory available to absorb disk stalls
+				uint64_t segmentSize;	//!< size of the preallocated file segments, 0 disables preallocation
+				bool directIO;			//!< open file with O_DIRECT
+				bool blockOnFull;		//!< wait for a free block instead of dropping the buffer
+			};
+
+			Recorder() : m_fd(-1), m_allocated(0), m_ioError(false), m_stop(false), m_ioWaiting(false), m_freeBlocks(0), m_block(nullptr), m_blockFill(0), m_streamPos(0),
+				m_numRecorded(0), m_numDropped(0), m_bytesWritten(0) {}
+
+			Recorder(const std::string& fileName, const ParamMap& params = ParamMap(), const Options& options = Options()) : Recorder()
+			{
+				open(fileName, params, options);
+			}
+
+			~Recorder()
+			{
+				try
+				{
+					close();
+				}
+				catch (const std::exception&)
+				{
+				}
+			}
+
+			/** Create recording, params are stored in the recording and returned by ReplayDevice::getParam.
+			*/
+			void open(const std::string& fileName, const ParamMap& params = ParamMap(), const Options& options = Options())
+			{
+				close();
+				if (options.blockSize == 0 || (options.blockSize % 4096) != 0 || options.numBlocks < 2)
+					throw std::runtime_error("Recorder: invalid block options");
+				m_options = options;
+				openFile(fileName);
+
+				m_blocks.resize(options.numBlocks);
+				m_freeQueue.reset(new BoundedQueue<uint8_t*>(options.numBlocks));
+				m_writeQueue.reset(new BoundedQueue<WriteItem>(options.numBlocks));
+				for (size_t i = 0; i < options.numBlocks; i++)
+				{
+					m_blocks[i] = allocBlock(options.blockSize);
+					m_freeQueue->tryPush(m_blocks[i]);
+				}
+				m_freeBlocks = options.numBlocks;
+				m_ioError = false;
+				m_stop = false;
+				m_numRecorded = 0;
+				m_numDropped = 0;
+				m_bytesWritten = 0;
+				m_streamPos = 0;
+				m_allocated = 0;
+				m_index.clear();
+				m_index.reserve(1 << 16);
+
+				// file header and parameter section are the first bytes of the stream
+				std::vector<uint8_t> prm;
+				for (ParamMap::const_iterator it = params.begin(); it != params.end(); ++it)
+					recAppendParam(prm, it->first, it->second);
+				RecFileHeader fh;
+				memset(&fh, 0, sizeof(fh));
+				memcpy(fh.magic, "CXREC", 5);
+				fh.version = REC_VERSION;
+				fh.numParams = (uint32_t)params.size();
+				fh.dataOffset = sizeof(fh) + prm.size();
+				reserveBlocks(fh.dataOffset);
+				append(&fh, sizeof(fh));
+				if (!prm.empty())
+					append(prm.data(), prm.size());
+
+				m_ioThread = std::thread(&Recorder::ioLoop, this);
+			}
+
+			/** Finish the recording: write the pending blocks, the index and the footer.
+			*/
+			void close()
+			{
+				if (m_fd < 0)
+					return;
+				// hand over the last partial block, the I/O thread writes it after all full blocks
+				if (m_block)
+				{
+					WriteItem item = { m_block, m_blockFill };
+					pushWrite(item);
+					m_block = nullptr;
+					m_blockFill = 0;
+				}
+				m_stop = true;
+				wakeIo();
+				if (m_ioThread.joinable())
+					m_ioThread.join();
+
+				bool ok = !m_ioError;
+				if (ok)
+				{
+					// index and footer with buffered writes, O_DIRECT requires aligned sizes
+					setDirect(false);
+					RecIndexFooter ft;
+					ft.indexOffset = m_streamPos;
+					ft.numEntries = m_index.size();
+					ft.magic = REC_INDEX_MAGIC;
+					ft.version = REC_VERSION;
+					uint64_t fileEnd = m_streamPos + m_index.size() * sizeof(RecIndexEntry) + sizeof(ft);
+					ok = writeAt(m_index.data(), m_index.size() * sizeof(RecIndexEntry), m_streamPos) &&
+						writeAt(&ft, sizeof(ft), m_streamPos + m_index.size() * sizeof(RecIndexEntry));
+#if defined(__linux__)
+					// release the segments preallocated beyond the footer, fallocate with FALLOC_FL_KEEP_SIZE reserves them without changing the file size
+					if (ok && m_allocated > fileEnd)
+						ok = (ftruncate(m_fd, (off_t)fileEnd) == 0);
+#else
+					(void)fileEnd;
+#endif
+				}
+#ifdef _WIN32
+				_close(m_fd);
+#else
+				::close(m_fd);
+#endif
+				m_fd = -1;
+				for (size_t i = 0; i < m_blocks.size(); i++)
+					freeBlock(m_blocks[i]);
+				m_blocks.clear();
+				m_freeQueue.reset();
+				m_writeQueue.reset();
+				if (!ok)
+					throw std::runtime_error("Recorder: writing " + m_fileName + " failed");
+			}
+
+			bool isOpen() const { return m_fd >= 0; }
+
+			/** Record buffer. The data is copied, the buffer can be queued after the call.
+				@return false if the buffer was dropped because all blocks are in flight, the record doesn't fit into the blocks (also with Options::blockOnFull) or a write error occurred.
+			*/
+			bool record(DeviceBuffer& buffer)
+			{
+				if (m_fd < 0 || m_ioError)
+					return false;
+
+				RecFrameHeader fh;
+				memset(&fh, 0, sizeof(fh));
+				fh.magic = REC_FRAME_MAGIC;
+				fh.frameIdx = m_index.size();
+				// infos not supported by the transport layer get defaults: no timestamp, complete, single part, no chunks
+				cx::Variant val;
+				if (buffer.tryGetInfo(CX_BUFFER_INFO_TIMESTAMP, val) == CX_STATUS_OK)
+					fh.timestamp = (uint64_t)(int64_t)val;
+				if (buffer.tryGetInfo(CX_BUFFER_INFO_IS_INCOMPLETE, val) == CX_STATUS_OK && (int64_t)val)
+					fh.flags |= REC_FLAG_INCOMPLETE;
+				bool multipart = buffer.tryGetInfo(CX_BUFFER_INFO_IS_MULTIPART, val) == CX_STATUS_OK && (int64_t)val != 0;
+				if (multipart)
+					fh.flags |= REC_FLAG_MULTIPART;
+				int numParts = 1;
+				if (multipart && buffer.tryGetInfo(CX_BUFFER_INFO_NUM_PARTS, val) == CX_STATUS_OK)
+					numParts = (int)val;
+				int numChunks = 0;
+				if (buffer.tryGetInfo(CX_BUFFER_INFO_NUM_CHUNK, val) == CX_STATUS_OK)
+					numChunks = (int)val;
+
+				// collect headers first, the record size must be known to reserve the blocks
+				uint64_t recordSize = sizeof(RecFrameHeader);
+				m_parts.clear();
+				for (int i = 0; i < numParts; i++)
+				{
+					cx::ImageView img = buffer.getImageView(i);
+					Part p;
+					memset(&p.info, 0, sizeof(p.info));
+					p.info.pixelFormat = img.pixelFormat();
+					p.info.width = img.width();
+					p.info.height = img.height();
+					p.info.deliveredHeight = img.height();
+					p.info.typeId = CX_BUFFER_PART_TYPE_ID_IMAGE2D;
+					p.info.linePitch = img.linePitch();
+					p.info.planePitch = img.planePitch();
+					p.info.dataSize = img.dataSz() ? img.dataSz() : img.linePitch() * img.height();
+					p.data = img.data();
+					if (p.data == nullptr)
+						p.info.dataSize = 0;
+					if (multipart)
+					{
+						p.info.typeId = partInfo(buffer, i, CX_BUFFER_PART_INFO_TYPE_ID, p.info.typeId);
+						p.info.purposeId = partInfo(buffer, i, CX_BUFFER_PART_INFO_DATA_PURPOSE_ID, 0);
+						p.info.regionId = partInfo(buffer, i, CX_BUFFER_PART_INFO_REGION_ID, 0);
+						p.info.sourceId = partInfo(buffer, i, CX_BUFFER_PART_INFO_SOURCE_ID, 0);
+						p.info.xOffset = partInfo(buffer, i, CX_BUFFER_PART_INFO_XOFFSET, 0);
+						p.info.yOffset = partInfo(buffer, i, CX_BUFFER_PART_INFO_YOFFSET, 0);
+						p.info.height = partInfo(buffer, i, CX_BUFFER_PART_INFO_HEIGHT, p.info.height);
+						p.info.deliveredHeight = partInfo(buffer, i, CX_BUFFER_PART_INFO_DELIVERED_HEIGHT, p.info.deliveredHeight);
+					}
+					recordSize += sizeof(RecPartHeader) + recAlign(p.info.dataSize);
+					m_parts.push_back(p);
+				}
+				m_chunks.clear();
+				for (int i = 0; i < numChunks; i++)
+				{
+					cx::Chunk c = buffer.getChunkView(i);
+					if (c.data == nullptr)
+						c.length = 0;
+					recordSize += sizeof(RecChunkHeader) + recAlign(c.length);
+					m_chunks.push_back(c);
+				}
+				fh.recordSize = recordSize;
+				fh.numParts = (uint32_t)m_parts.size();
+				fh.numChunks = (uint32_t)m_chunks.size();
+
+				if (!reserveBlocks(recordSize))
+				{
+					m_numDropped++;
+					return false;
+				}
+
+				RecIndexEntry e;
+				e.offset = m_streamPos;
+				e.timestamp = fh.timestamp;
+				m_index.push_back(e);
+
+				static const uint8_t zeros[REC_ALIGN] = { 0 };
+				append(&fh, sizeof(fh));
+				for (size_t i = 0; i < m_parts.size(); i++)
+				{
+					append(&m_parts[i].info, sizeof(RecPartHeader));
+					append(m_parts[i].data, (size_t)m_parts[i].info.dataSize);
+					append(zeros, (size_t)(recAlign(m_parts[i].info.dataSize) - m_parts[i].info.dataSize));
+				}
+				for (size_t i = 0; i < m_chunks.size(); i++)
+				{
+					RecChunkHeader ch;
+					ch.descriptor = m_chunks[i].descriptor;
+					ch.reserved = 0;
+					ch.length = m_chunks[i].length;
+					append(&ch, sizeof(ch));
+					append(m_chunks[i].data, m_chunks[i].length);
+					append(zeros, (size_t)(recAlign(ch.length) - ch.length));
+				}
+				m_numRecorded++;
+				return true;
+			}
+
+			uint64_t numRecorded() const { return m_numRecorded; }		//!< number of recorded buffers
+			uint64_t numDropped() const { return m_numDropped; }		//!< number of buffers dropped because all blocks were in flight
+			uint64_t bytesWritten() const { return m_bytesWritten; }	//!< bytes written to disk so far
+			bool hasError() const { return m_ioError; }					//!< a write failed, the recording stopped
+
+			static Ptr createShared() { return std::make_shared<Recorder>(); }
+
+		private:
+			Recorder(const Recorder&);
+			Recorder& operator=(const Recorder&);
+
+			struct Part
+			{
+				RecPartHeader info;
+				const void* data;
+			};
+
+			struct WriteItem
+			{
+				uint8_t* block;
+				size_t size;		// blockSize except for the last block
+			};
+
+			// part info or the default if the transport layer doesn't support it
+			static uint32_t partInfo(DeviceBuffer& buffer, int partIdx, cx_buffer_part_info param, uint32_t defaultValue)
+			{
+				cx::Variant val;
+				if (buffer.tryGetPartInfo(partIdx, param, val) != CX_STATUS_OK)
+					return defaultValue;
+				return (uint32_t)(int64_t)val;
+			}
+
+			static uint8_t* allocBlock(size_t size)
+			{
+#ifdef _WIN32
+				void* p = _aligned_malloc(size, 4096);
+#else
+				void* p = nullptr;
+				if (posix_memalign(&p, 4096, size) != 0)
+					p = nullptr;
+#endif
+				if (p == nullptr)
+					throw std::bad_alloc();
+				return (uint8_t*)p;
+			}
+
+			static void freeBlock(uint8_t* p)
+			{
+#ifdef _WIN32
+				_aligned_free(p);
+#else
+				free(p);
+#endif
+			}
+
+			void openFile(const std::string& fileName)
+			{
+				m_fileName = fileName;
+#ifdef _WIN32
+				m_fd = _open(fileName.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+				m_fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+				if (m_fd < 0)
+					throw std::runtime_error("Recorder: cannot create " + fileName);
+				if (m_options.directIO && !setDirect(true))
+					m_options.directIO = false;
+			}
+
+			bool setDirect(bool enable)
+			{
+#if defined(__linux__) && defined(O_DIRECT)
+				int flags = fcntl(m_fd, F_GETFL);
+				if (flags < 0)
+					return false;
+				flags = enable ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+				return fcntl(m_fd, F_SETFL, flags) == 0;
+#else
+				return !enable;
+#endif
+			}
+
+			bool writeAt(const void* data, size_t size, uint64_t pos)
+			{
+				const uint8_t* p = (const uint8_t*)data;
+				while (size > 0)
+				{
+#ifdef _WIN32
+					if (_lseeki64(m_fd, (__int64)pos, SEEK_SET) < 0)
+						return false;
+					int n = _write(m_fd, p, (unsigned)((size < (1u << 30)) ? size : (1u << 30)));
+#else
+					ssize_t n = pwrite(m_fd, p, size, (off_t)pos);
+#endif
+					if (n <= 0)
+						return false;
+					p += n;
+					pos += n;
+					size -= n;
+					m_bytesWritten += n;
+				}
+				return true;
+			}
+
+			// extend the file with preallocated segments ahead of the write position, avoids fragmentation and metadata updates per block
+			void preallocate(uint64_t end)
+			{
+#if defined(__linux__)
+				if (m_options.segmentSize == 0)
+					return;
+				while (m_allocated < end)
+				{
+					if (fallocate(m_fd, FALLOC_FL_KEEP_SIZE, (off_t)m_allocated, (off_t)m_options.segmentSize) != 0)
+					{
+						m_options.segmentSize = 0;	// not supported by file system
+						return;
+					}
+					m_allocated += m_options.segmentSize;
+				}
+#else
+				(void)end;
+#endif
+			}
+
+			// make sure enough blocks are free for size bytes, the blocks are taken in append()
+			bool reserveBlocks(uint64_t size)
+			{
+				size_t blockSize = m_options.blockSize;
+				size_t fill = m_block ? m_blockFill : blockSize;
+				uint64_t needed = (size > blockSize - fill) ? (size - (blockSize - fill) + blockSize - 1) / blockSize : 0;
+				// the partially filled block is held here, it is never returned by the I/O thread
+				if (needed > m_options.numBlocks - (m_block ? 1 : 0))
+					return false;
+				for (;;)
+				{
+					size_t avail = m_freeBlocks.load();
+					if (avail >= needed)
+					{
+						if (m_freeBlocks.compare_exchange_weak(avail, avail - (size_t)needed))
+							return true;
+						continue;
+					}
+					if (!m_options.blockOnFull || m_ioError)
+						return false;
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_cvFree.wait_for(lock, std::chrono::milliseconds(10));
+				}
+			}
+
+			void append(const void* data, size_t size)
+			{
+				const uint8_t* p = (const uint8_t*)data;
+				while (size > 0)
+				{
+					if (m_block == nullptr)
+					{
+						// reserved in reserveBlocks, the pop succeeds
+						while (!m_freeQueue->tryPop(m_block))
+							std::this_thread::yield();
+						m_blockFill = 0;
+					}
+					size_t n = m_options.blockSize - m_blockFill;
+					if (n > size)
+						n = size;
+					memcpy(m_block + m_blockFill, p, n);
+					m_blockFill += n;
+					m_streamPos += n;
+					p += n;
+					size -= n;
+					if (m_blockFill == m_options.blockSize)
+					{
+						WriteItem item = { m_block, m_blockFill };
+						pushWrite(item);
+						m_block = nullptr;
+						m_blockFill = 0;
+					}
+				}
+			}
+
+			void pushWrite(const WriteItem& item)
+			{
+				// capacity equals the number of blocks, the push succeeds
+				while (!m_writeQueue->tryPush(item))
+					std::this_thread::yield();
+				wakeIo();
+			}
+
+			void wakeIo()
+			{
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (m_ioWaiting.load())
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_cvWrite.notify_one();
+				}
+			}
+
+			// I/O thread: writes the blocks in stream order and returns them to the free queue
+			void ioLoop()
+			{
+				uint64_t filePos = 0;
+				for (;;)
+				{
+					WriteItem item;
+					if (!m_writeQueue->tryPop(item))
+					{
+						if (m_stop)
+						{
+							// m_stop is set after the last push, check the queue once more
+							if (!m_writeQueue->tryPop(item))
+								break;
+						}
+						else
+						{
+							std::unique_lock<std::mutex> lock(m_mutex);
+							m_ioWaiting = true;
+							std::atomic_thread_fence(std::memory_order_seq_cst);
+							if (m_writeQueue->empty() && !m_stop)
+								m_cvWrite.wait_for(lock, std::chrono::milliseconds(100));
+							m_ioWaiting = false;
+							continue;
+						}
+					}
+
+					if (!m_ioError)
+					{
+						preallocate(filePos + item.size);
+						// the last block is not a multiple of the alignment, write it without O_DIRECT
+						if (item.size != m_options.blockSize && m_options.directIO)
+							setDirect(false);
+						if (!writeAt(item.block, item.size, filePos))
+							m_ioError = true;
+						filePos += item.size;
+					}
+					m_freeQueue->tryPush(item.block);
+					m_freeBlocks++;
+					if (m_options.blockOnFull)
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						m_cvFree.notify_one();
+					}
+				}
+			}
+
+			Options m_options;
+			std::string m_fileName;
+			int m_fd;
+			uint64_t m_allocated;
+
+			std::vector<uint8_t*> m_blocks;
+			std::unique_ptr<BoundedQueue<uint8_t*> > m_freeQueue;
+			std::unique_ptr<BoundedQueue<WriteItem> > m_writeQueue;
+			std::thread m_ioThread;
+			std::mutex m_mutex;
+			std::condition_variable m_cvWrite;
+			std::condition_variable m_cvFree;
+			std::atomic<bool> m_ioError;
+			std::atomic<bool> m_stop;
+			std::atomic<bool> m_ioWaiting;
+			std::atomic<size_t> m_freeBlocks;
+
+			// state of the recording thread
+			uint8_t* m_block;
+			size_t m_blockFill;
+			uint64_t m_streamPos;
+			std::vector<RecIndexEntry> m_index;
+			std::vector<Part> m_parts;
+			std::vector<cx::Chunk> m_chunks;
+
+			std::atomic<uint64_t> m_numRecorded;
+			std::atomic<uint64_t> m_numDropped;
+			std::atomic<uint64_t> m_bytesWritten;
+		};
+
+		typedef Recorder::Ptr RecorderPtr;
+
+		//! @} cx_wrapper_cpp
+	}	// namespace cx
+}	// namespace AT
+#endif	// AT_CX_RECORDER_H_INCLUDED
@@ -0,0 +1,521 @@
+/**
+@file : Recording.h
+@package : cx_cam library
+@brief C++ container format and reader for recorded acquisition buffers
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_RECORDING_H_INCLUDED
+#define AT_CX_RECORDING_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#include "AT/cx/base.h"
+#include "cx_cam.h"
+
+namespace AT {
+	namespace cx {
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		/** Recording container format, all values are stored in little endian byte order.
+
+			The file starts with RecFileHeader followed by the parameter section (RecParamHeader, key, value, padded to 8 bytes).
+			Buffer records start at RecFileHeader::dataOffset, each record has a RecFrameHeader followed by
+			numParts times (RecPartHeader, part data) and numChunks times (RecChunkHeader, chunk data), every block padded to 8 bytes.
+			RecFrameHeader::recordSize includes all padding, writers may pad records to larger blocks (e.g. for unbuffered I/O).
+			A closed recording ends with an index (one RecIndexEntry per record) and RecIndexFooter, without footer the reader scans the records.
+			Version 1 part headers end before RecPartHeader::planePitch (REC_V1_PART_HEADER_SIZE bytes), the reader accepts both versions.
+
+			Parameter keys are GenICam node names, e.g. "Width". Selector dependent values are stored as "Name[Selector=Value]",
+			parameter infos as "Name#<cx_param_info>", e.g. "Scan3dExtractionSelector#2" for the CX_PARAM_INFO_RANGE.
+		*/
+		enum rec_format
+		{
+			REC_VERSION = 2,
+			REC_V1_PART_HEADER_SIZE = 56,		//!< size of RecPartHeader in version 1 files, without planePitch
+			REC_ALIGN = 8,
+			REC_FRAME_MAGIC = 0x52465542,		//!< "BUFR"
+			REC_INDEX_MAGIC = 0x58495843,		//!< "CXIX"
+			REC_FLAG_INCOMPLETE = 0x01,			//!< CX_BUFFER_INFO_IS_INCOMPLETE was set
+			REC_FLAG_MULTIPART = 0x02			//!< CX_BUFFER_INFO_IS_MULTIPART was set
+		};
+
+		struct RecFileHeader
+		{
+			char magic[8];			//!< "CXREC" zero padded
+			uint32_t version;		//!< REC_VERSION
+			uint32_t numParams;		//!< number of parameter entries
+			uint64_t dataOffset;	//!< file offset of the first buffer record
+		};
+
+		struct RecParamHeader
+		{
+			uint32_t keySize;		//!< key length in bytes without terminating zero
+			uint32_t type;			//!< \ref cx_vt_type
+			uint64_t valueSize;		//!< value size in bytes
+		};
+
+		struct RecFrameHeader
+		{
+			uint32_t magic;			//!< REC_FRAME_MAGIC
+			uint32_t flags;			//!< REC_FLAG_INCOMPLETE, REC_FLAG_MULTIPART
+			uint64_t recordSize;	//!< size of the record including this header and padding
+			uint64_t frameIdx;		//!< running number of the record in the recording
+			uint64_t timestamp;		//!< CX_BUFFER_INFO_TIMESTAMP
+			uint32_t numParts;
+			uint32_t numChunks;
+		};
+
+		struct RecPartHeader
+		{
+			uint32_t pixelFormat;		//!< CX_BUFFER_PART_INFO_DATA_FORMAT
+			uint32_t width;				//!< CX_BUFFER_PART_INFO_WIDTH
+			uint32_t height;			//!< CX_BUFFER_PART_INFO_HEIGHT
+			uint32_t deliveredHeight;	//!< CX_BUFFER_PART_INFO_DELIVERED_HEIGHT
+			uint32_t typeId;			//!< CX_BUFFER_PART_INFO_TYPE_ID
+			uint32_t purposeId;			//!< CX_BUFFER_PART_INFO_DATA_PURPOSE_ID
+			uint32_t regionId;			//!< CX_BUFFER_PART_INFO_REGION_ID
+			uint32_t sourceId;			//!< CX_BUFFER_PART_INFO_SOURCE_ID
+			uint32_t xOffset;			//!< CX_BUFFER_PART_INFO_XOFFSET
+			uint32_t yOffset;			//!< CX_BUFFER_PART_INFO_YOFFSET
+			uint64_t linePitch;			//!< bytes per image row
+			uint64_t dataSize;			//!< size of part data in bytes
+			uint64_t planePitch;		//!< bytes between the starts of 2 planes of planar formats, 0 for single plane images (version 2)
+		};
+
+		struct RecChunkHeader
+		{
+			uint32_t descriptor;	//!< \ref cx_chunk_id
+			uint32_t reserved;
+			uint64_t length;		//!< chunk data size in bytes
+		};
+
+		struct RecIndexEntry
+		{
+			uint64_t offset;		//!< file offset of the record
+			uint64_t timestamp;		//!< timestamp of the record
+		};
+
+		struct RecIndexFooter
+		{
+			uint64_t indexOffset;	//!< file offset of the first RecIndexEntry
+			uint64_t numEntries;	//!< number of index entries
+			uint32_t magic;			//!< REC_INDEX_MAGIC
+			uint32_t version;		//!< REC_VERSION
+		};
+
+		static_assert(sizeof(RecFileHeader) == 24, "wrong struct size, check struct packing and alignment");
+		static_assert(sizeof(RecParamHeader) == 16, "wrong struct size, check struct packing and alignment");
+		static_assert(sizeof(RecFrameHeader) == 40, "wrong struct size, check struct packing and alignment");
+		static_assert(sizeof(RecPartHeader) == 64, "wrong struct size, check struct packing and alignment");
+		static_assert(sizeof(RecChunkHeader) == 16, "wrong struct size, check struct packing and alignment");
+		static_assert(sizeof(RecIndexEntry) == 16, "wrong struct size, check struct packing and alignment");
+		static_assert(sizeof(RecIndexFooter) == 24, "wrong struct size, check struct packing and alignment");
+
+		typedef std::map<std::string, cx::Variant> ParamMap;
+
+		//! Round up to the next multiple of align (power of two).
+		inline uint64_t recAlign(uint64_t sz, uint64_t align = REC_ALIGN)
+		{
+			return (sz + align - 1) & ~(align - 1);
+		}
+
+		//! 64 bit file positioning
+		inline int recSeek(FILE* f, uint64_t pos)
+		{
+#ifdef _MSC_VER
+			return _fseeki64(f, (__int64)pos, SEEK_SET);
+#else
+			return fseeko(f, (off_t)pos, SEEK_SET);
+#endif
+		}
+
+		//! 64 bit file positioning relative to the end of file
+		inline int recSeekEnd(FILE* f, int64_t offset)
+		{
+#ifdef _MSC_VER
+			return _fseeki64(f, offset, SEEK_END);
+#else
+			return fseeko(f, (off_t)offset, SEEK_END);
+#endif
+		}
+
+		inline uint64_t recTell(FILE* f)
+		{
+#ifdef _MSC_VER
+			return (uint64_t)_ftelli64(f);
+#else
+			return (uint64_t)ftello(f);
+#endif
+		}
+
+		/** Append one parameter entry in recording format to dst.
+			Supported value types are integer, real, string and the array types.
+		*/
+		inline void recAppendParam(std::vector<uint8_t>& dst, const std::string& key, const cx::Variant& val)
+		{
+			std::vector<uint8_t> value;
+			const cx_variant_t* v = val;
+			if (v->type == CX_VT_INT || v->type == CX_VT_REAL)
+			{
+				value.resize(8);
+				memcpy(value.data(), &v->data, 8);
+			}
+			else if (v->type == CX_VT_STRING)
+			{
+				std::string str;
+				val.get(str);
+				value.assign(str.begin(), str.end());
+			}
+			else if (v->type & CX_VT_TYPE_ARRAY)
+			{
+				size_t sz = v->data.a.len * (v->type & CX_VT_SIZE_MASK);
+				value.resize(sz);
+				if (sz)
+					memcpy(value.data(), v->data.a.buf, sz);
+			}
+			else
+				throw std::runtime_error("Recording: unsupported parameter type for " + key);
+
+			RecParamHeader ph;
+			ph.keySize = (uint32_t)key.size();
+			ph.type = (uint32_t)v->type;
+			ph.valueSize = value.size();
+
+			size_t pos = dst.size();
+			dst.resize(pos + (size_t)recAlign(sizeof(ph) + key.size() + value.size()), 0);
+			memcpy(&dst[pos], &ph, sizeof(ph));
+			memcpy(&dst[pos + sizeof(ph)], key.data(), key.size());
+			if (!value.empty())
+				memcpy(&dst[pos + sizeof(ph) + key.size()], value.data(), value.size());
+		}
+
+		/** Parse one parameter entry at src, returns the number of bytes consumed or 0 if the entry is corrupt.
+		*/
+		inline size_t recParseParam(const uint8_t* src, size_t size, std::string& key, cx::Variant& val)
+		{
+			RecParamHeader ph;
+			if (size < sizeof(ph))
+				return 0;
+			memcpy(&ph, src, sizeof(ph));
+			uint64_t entrySize = recAlign(sizeof(ph) + (uint64_t)ph.keySize + ph.valueSize);
+			if (entrySize > size)
+				return 0;
+			const uint8_t* value = src + sizeof(ph) + ph.keySize;
+			key.assign((const char*)src + sizeof(ph), ph.keySize);
+			switch (ph.type)
+			{
+			case CX_VT_INT:
+			{
+				int64_t i = 0;
+				memcpy(&i, value, (ph.valueSize < 8) ? (size_t)ph.valueSize : 8);
+				val = i;
+				break;
+			}
+			case CX_VT_REAL:
+			{
+				double r = 0;
+				memcpy(&r, value, (ph.valueSize < 8) ? (size_t)ph.valueSize : 8);
+				val = r;
+				break;
+			}
+			case CX_VT_STRING:
+				val = std::string((const char*)value, (size_t)ph.valueSize);
+				break;
+			case CX_VT_BYTE_ARRAY:
+				val = std::vector<unsigned char>(value, value + ph.valueSize);
+				break;
+			case CX_VT_INT_ARRAY:
+			{
+				std::vector<int64_t> a((size_t)ph.valueSize / sizeof(int64_t));
+				if (!a.empty())
+					memcpy(a.data(), value, a.size() * sizeof(int64_t));
+				val = a;
+				break;
+			}
+			case CX_VT_REAL_ARRAY:
+			{
+				std::vector<double> a((size_t)ph.valueSize / sizeof(double));
+				if (!a.empty())
+					memcpy(a.data(), value, a.size() * sizeof(double));
+				val = a;
+				break;
+			}
+			default:
+				return 0;
+			}
+			return (size_t)entrySize;
+		}
+
+		/** RecordedFrame holds one buffer record of a recording. The part and chunk data reference the frame storage, which is reused by RecordingReader::readFrame.
+		*/
+		class RecordedFrame
+		{
+		public:
+			struct Part
+			{
+				RecPartHeader info;
+				const uint8_t* data;
+			};
+
+			RecordedFrame() { clear(); }
+
+			void clear()
+			{
+				memset(&header, 0, sizeof(header));
+				parts.clear();
+				chunks.clear();
+			}
+
+			/** Parse the record in storage, returns false if the record is corrupt.
+				@param version	RecFileHeader::version of the recording, determines the size of the part headers.
+			*/
+			bool parse(uint32_t version = REC_VERSION)
+			{
+				const size_t partHeaderSize = (version < 2) ? size_t(REC_V1_PART_HEADER_SIZE) : sizeof(RecPartHeader);
+				parts.clear();
+				chunks.clear();
+				if (storage.size() < sizeof(RecFrameHeader))
+					return false;
+				memcpy(&header, storage.data(), sizeof(header));
+				if (header.magic != REC_FRAME_MAGIC || header.recordSize > storage.size())
+					return false;
+
+				size_t pos = sizeof(RecFrameHeader);
+				size_t end = (size_t)header.recordSize;
+				for (uint32_t i = 0; i < header.numParts; i++)
+				{
+					Part p;
+					if (pos + partHeaderSize > end)
+						return false;
+					memset(&p.info, 0, sizeof(p.info));
+					memcpy(&p.info, &storage[pos], partHeaderSize);
+					pos += partHeaderSize;
+					if (p.info.dataSize > end - pos)
+						return false;
+					p.data = &storage[pos];
+					pos += (size_t)recAlign(p.info.dataSize);
+					parts.push_back(p);
+				}
+				for (uint32_t i = 0; i < header.numChunks; i++)
+				{
+					RecChunkHeader ch;
+					if (pos + sizeof(RecChunkHeader) > end)
+						return false;
+					memcpy(&ch, &storage[pos], sizeof(RecChunkHeader));
+					pos += sizeof(RecChunkHeader);
+					if (ch.length > end - pos)
+						return false;
+					cx_chunk_t c;
+					c.descriptor = ch.descriptor;
+					c.length = (size_t)ch.length;
+					c.data = &storage[pos];
+					pos += (size_t)recAlign(ch.length);
+					chunks.push_back(c);
+				}
+				return true;
+			}
+
+			RecFrameHeader header;
+			std::vector<Part> parts;
+			std::vector<cx_chunk_t> chunks;
+			std::vector<uint8_t> storage;	//!< raw record
+		};
+
+		/** RecordingReader gives random access to the buffer records of a recording.
+
+			\code{.cpp}
+				cx::RecordingReader rec("scan.cxrec");
+				cx::RecordedFrame frame;
+				for (size_t i = 0; i < rec.numFrames(); i++)
+				{
+					rec.readFrame(i, frame);
+					std::cout << frame.header.timestamp << " parts: " << frame.parts.size() << std::endl;
+				}
+			\endcode
+		*/
+		class RecordingReader
+		{
+		public:
+			typedef std::shared_ptr<RecordingReader> Ptr;
+
+			RecordingReader() : m_file(nullptr), m_fileSize(0), m_dataOffset(0), m_version(0) {}
+			explicit RecordingReader(const std::string& fileName) : m_file(nullptr), m_fileSize(0), m_dataOffset(0), m_version(0) { open(fileName); }
+			~RecordingReader() { close(); }
+
+			void open(const std::string& fileName)
+			{
+				close();
+				m_file = fopen(fileName.c_str(), "rb");
+				if (m_file == nullptr)
+					throw std::runtime_error("RecordingReader: cannot open " + fileName);
+				// sizes read from the file are checked against the file size before allocating, a corrupt file must not cause huge allocations
+				m_fileSize = (recSeekEnd(m_file, 0) == 0) ? recTell(m_file) : 0;
+
+				RecFileHeader fh;
+				if (recSeek(m_file, 0) != 0 || fread(&fh, sizeof(fh), 1, m_file) != 1 || strncmp(fh.magic, "CXREC", 8) != 0 || fh.version < 1 || fh.version > REC_VERSION
+					|| fh.dataOffset < sizeof(fh) || fh.dataOffset > m_fileSize)
+				{
+					close();
+					throw std::runtime_error("RecordingReader: " + fileName + " is not a recording");
+				}
+
+				// parameter section
+				std::vector<uint8_t> prm((size_t)fh.dataOffset - sizeof(fh));
+				if (!prm.empty() && fread(prm.data(), prm.size(), 1, m_file) != 1)
+				{
+					close();
+					throw std::runtime_error("RecordingReader: truncated parameter section in " + fileName);
+				}
+				size_t pos = 0;
+				for (uint32_t i = 0; i < fh.numParams; i++)
+				{
+					std::string key;
+					cx::Variant val;
+					size_t n = recParseParam(prm.data() + pos, prm.size() - pos, key, val);
+					if (n == 0)
+						break;
+					m_params[key] = val;
+					pos += n;
+				}
+				m_dataOffset = fh.dataOffset;
+				m_version = fh.version;
+
+				if (!readIndex())
+					scanRecords();
+			}
+
+			void close()
+			{
+				if (m_file)
+					fclose(m_file);
+				m_file = nullptr;
+				m_fileSize = 0;
+				m_version = 0;
+				m_index.clear();
+				m_params.clear();
+			}
+
+			bool isOpen() const { return m_file != nullptr; }
+			uint32_t version() const { return m_version; }									//!< format version of the recording, see REC_VERSION
+			size_t numFrames() const { return m_index.size(); }
+			const ParamMap& params() const { return m_params; }								//!< device parameters stored with the recording
+			const std::vector<RecIndexEntry>& index() const { return m_index; }
+
+			/** Read record idx into frame, the frame storage is reused.
+			*/
+			void readFrame(size_t idx, RecordedFrame& frame)
+			{
+				if (idx >= m_index.size())
+					throw std::out_of_range("RecordingReader: frame index out of range");
+				RecFrameHeader fh;
+				if (recSeek(m_file, m_index[idx].offset) != 0 || fread(&fh, sizeof(fh), 1, m_file) != 1 || fh.magic != REC_FRAME_MAGIC || fh.recordSize < sizeof(fh)
+					|| fh.recordSize > m_fileSize - m_index[idx].offset)
+					throw std::runtime_error("RecordingReader: corrupt record");
+				frame.storage.resize((size_t)fh.recordSize);
+				memcpy(frame.storage.data(), &fh, sizeof(fh));
+				size_t rest = (size_t)fh.recordSize - sizeof(fh);
+				if (rest > 0 && fread(&frame.storage[sizeof(fh)], rest, 1, m_file) != 1)
+					throw std::runtime_error("RecordingReader: truncated record");
+				if (!frame.parse(m_version))
+					throw std::runtime_error("RecordingReader: corrupt record");
+			}
+
+			/** Find the first record with a timestamp not less than timestamp, the timestamps must be increasing.
+				@return frame index, numFrames() if all records are older.
+			*/
+			size_t findFrame(uint64_t timestamp) const
+			{
+				struct Less
+				{
+					bool operator()(const RecIndexEntry& e, uint64_t ts) const { return e.timestamp < ts; }
+				};
+				return std::lower_bound(m_index.begin(), m_index.end(), timestamp, Less()) - m_index.begin();
+			}
+
+			static Ptr createShared(const std::string& fileName) { return std::make_shared<RecordingReader>(fileName); }
+
+		private:
+			RecordingReader(const RecordingReader&);
+			RecordingReader& operator=(const RecordingReader&);
+
+			bool readIndex()
+			{
+				RecIndexFooter ft;
+				if (recSeekEnd(m_file, -(int64_t)sizeof(ft)) != 0 || fread(&ft, sizeof(ft), 1, m_file) != 1)
+					return false;
+				uint64_t footerPos = m_fileSize - sizeof(ft);
+				if (ft.magic != REC_INDEX_MAGIC || ft.version != m_version || ft.indexOffset < m_dataOffset || ft.indexOffset > footerPos)
+					return false;
+				if (ft.numEntries > (footerPos - ft.indexOffset) / sizeof(RecIndexEntry))
+					return false;
+				m_index.resize((size_t)ft.numEntries);
+				if (recSeek(m_file, ft.indexOffset) != 0 || (!m_index.empty() && fread(m_index.data(), sizeof(RecIndexEntry), m_index.size(), m_file) != m_index.size()))
+				{
+					m_index.clear();
+					return false;
+				}
+				return true;
+			}
+
+			// recording without index (e.g. writer was not closed), collect the complete records
+			void scanRecords()
+			{
+				m_index.clear();
+				uint64_t pos = m_dataOffset;
+				RecFrameHeader fh;
+				while (recSeek(m_file, pos) == 0 && fread(&fh, sizeof(fh), 1, m_file) == 1)
+				{
+					if (fh.magic != REC_FRAME_MAGIC || fh.recordSize < sizeof(fh))
+						break;
+					// check that the record was written completely
+					if (fh.recordSize > sizeof(fh))
+					{
+						uint8_t last;
+						if (recSeek(m_file, pos + fh.recordSize - 1) != 0 || fread(&last, 1, 1, m_file) != 1)
+							break;
+					}
+					RecIndexEntry e;
+					e.offset = pos;
+					e.timestamp = fh.timestamp;
+					m_index.push_back(e);
+					pos += fh.recordSize;
+				}
+			}
+
+			FILE* m_file;
+			uint64_t m_fileSize;
+			uint64_t m_dataOffset;
+			uint32_t m_version;
+			ParamMap m_params;
+			std::vector<RecIndexEntry> m_index;
+		};
+
+		typedef RecordingReader::Ptr RecordingReaderPtr;
+
+		//! @} cx_wrapper_cpp
+	}	// namespace cx
+}	// namespace AT
+#endif	// AT_CX_RECORDING_H_INCLUDED
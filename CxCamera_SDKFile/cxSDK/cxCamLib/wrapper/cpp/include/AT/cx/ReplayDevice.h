@@ -0,0 +1,724 @@
+/**
+@file : ReplayDevice.h
+@package : cx_cam library
+@brief C++ device replaying recorded acquisition buffers
+@copyright (c) 2017, Automation Technology GmbH.
+@version 16.10.2026, AT: initial version
+*/
+/*************************************************************************************
+THIS SOFTWARE IS PROVIDED BY AUTOMATION TECHNOLOGY GMBH "AS IS" AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL AUTOMATION TECHNOLOGY GMBH BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+*************************************************************************************/
+#pragma once
+#ifndef AT_CX_REPLAYDEVICE_H_INCLUDED
+#define AT_CX_REPLAYDEVICE_H_INCLUDED
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+#include "AT/cx/base.h"
+#include "cx_cam.h"
+#include "cx_cam_param.h"
+#include "AT/cx/Device.h"
+#include "AT/cx/DeviceBuffer.h"
+#include "AT/cx/Recording.h"
+
+namespace AT {
+	namespace cx {
+		//! @addtogroup cx_wrapper_cpp
+		//! @{
+
+		/** ReplayDevice plays back a recording (see Recording.h) through the acquisition interface of cx::Device.
+			Buffers are delivered by allocAndQueueBuffers, startAcquisition, waitForBuffer and DeviceBuffer::getImage/getChunk/getPartInfo
+			with the recorded parts, part infos (purpose, region, source ids) and chunks, so processing code runs unchanged without camera.
+
+			The URI has the form replay://<file>?rate=<recorded|max|Hz>&loop=<0|1>, e.g. "replay:///data/scan.cxrec?rate=max".
+			- rate=recorded (default) delivers the buffers with the recorded timestamp intervals, using the recorded GevTimestampTickFrequency (default 1 GHz).
+			- rate=max delivers as fast as the application queues buffers, e.g. to measure the throughput limit of the processing.
+			- rate=<Hz> delivers with a fixed frame rate.
+
+			Unlike a camera, the replay never drops buffers: the playback waits until a buffer is queued, every run delivers the same buffers in the same order.
+
+			getParam returns the parameters stored with the recording, Width, Height, PixelFormat and PayloadSize are derived from the first buffer if not recorded.
+			setParam stores the value, written selectors (e.g. RegionSelector, Scan3dExtractionSelector) select the recorded values "Name[Selector=Value]".
+			getParamInfo returns recorded infos "Name#<cx_param_info>", access mode and visibility are simulated for all recorded parameters.
+
+			\code{.cpp}
+				auto cam = cx::DeviceFactory::openDevice("replay:///data/scan.cxrec?rate=max");
+				cam->allocAndQueueBuffers(8);
+				cam->startAcquisition();
+				cx::DeviceBuffer buffer;
+				while (cam->tryWaitForBuffer(buffer, 1000) == CX_STATUS_OK)
+				{
+					cx::ImageView range = buffer.getImageView(0);
+					// do processing ...
+					buffer.queueBuffer();
+				}
+				cam->stopAcquisition();
+			\endcode
+
+			\note Register, memory, file and event functions of cx::Device are not available.
+		*/
+		class ReplayDevice : public Device, public BufferSource
+		{
+		public:
+			typedef std::shared_ptr<ReplayDevice> Ptr;
+
+			//! playback rate mode
+			enum rate_mode {
+				RATE_RECORDED = 0,		//!< deliver with recorded timestamp intervals
+				RATE_FIXED = 1,			//!< deliver with fixed frame rate
+				RATE_MAX = 2			//!< deliver as fast as possible
+			};
+
+			ReplayDevice() : m_rateMode(RATE_RECORDED), m_rateHz(0), m_loop(false), m_tickFrequency(1e9), m_nextFrame(0), m_stop(false), m_acquiring(false), m_numDelivered(0), m_readErrors(0) {}
+
+			~ReplayDevice()
+			{
+				releaseDelivery();		// delivery threads call tryWaitForBuffer of this object
+				close();
+			}
+
+			static bool isReplayUri(const std::string& uri)
+			{
+				return uri.compare(0, 9, "replay://") == 0;
+			}
+
+			bool isOpen() const override
+			{
+				return m_reader.isOpen();
+			}
+
+			void open(const std::string& uri, open_mode openMode = OPEN_EXCLUSIVE) override
+			{
+				(void)openMode;
+				close();
+				if (!isReplayUri(uri))
+					throw std::runtime_error("ReplayDevice: invalid uri " + uri);
+
+				std::string path = uri.substr(9);
+				std::string query;
+				size_t q = path.find('?');
+				if (q != std::string::npos)
+				{
+					query = path.substr(q + 1);
+					path.resize(q);
+				}
+
+				rate_mode mode = RATE_RECORDED;
+				double hz = 0;
+				bool loop = false;
+				size_t pos = 0;
+				while (pos < query.size())
+				{
+					size_t end = query.find('&', pos);
+					if (end == std::string::npos)
+						end = query.size();
+					std::string item = query.substr(pos, end - pos);
+					size_t eq = item.find('=');
+					std::string key = item.substr(0, eq);
+					std::string value = (eq == std::string::npos) ? std::string() : item.substr(eq + 1);
+					if (key == "rate")
+					{
+						if (value == "max")
+							mode = RATE_MAX;
+						else if (value == "recorded")
+							mode = RATE_RECORDED;
+						else
+						{
+							hz = atof(value.c_str());
+							if (hz <= 0)
+								throw std::runtime_error("ReplayDevice: invalid rate " + value);
+							mode = RATE_FIXED;
+						}
+					}
+					else if (key == "loop")
+						loop = (value != "0");
+					pos = end + 1;
+				}
+
+				m_reader.open(path);
+				m_params = m_reader.params();
+				m_selectors.clear();
+				m_nextFrame = 0;
+				m_numDelivered = 0;
+				m_readErrors = 0;
+				addDerivedParams();
+				setPlaybackRate(mode, hz);
+				setLoop(loop);
+
+				ParamMap::const_iterator it = m_params.find("GevTimestampTickFrequency");
+				m_tickFrequency = 1e9;
+				if (it != m_params.end() && (double)it->second > 0)
+					m_tickFrequency = (double)it->second;
+			}
+
+			void close() override
+			{
+				if (!isOpen())
+					return;
+				stopPlayback();
+				releaseSlots();
+				m_reader.close();
+				m_params.clear();
+				m_selectors.clear();
+			}
+
+			/** Set playback rate, hz is only used for RATE_FIXED. Can be changed during acquisition.
+			*/
+			void setPlaybackRate(rate_mode mode, double hz = 0)
+			{
+				if (mode == RATE_FIXED && hz <= 0)
+					throw std::runtime_error("ReplayDevice: invalid fixed rate");
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_rateMode = mode;
+				m_rateHz = hz;
+			}
+
+			//! Restart at the first buffer after the last one, otherwise waitForBuffer times out at the end of the recording.
+			void setLoop(bool loop)
+			{
+				m_loop = loop;
+			}
+
+			/** Set the recording index of the next delivered buffer, only allowed while the acquisition is stopped.
+			*/
+			void seek(size_t frameIdx)
+			{
+				if (m_acquiring)
+					throw std::runtime_error("ReplayDevice: seek during acquisition");
+				if (frameIdx > m_reader.numFrames())
+					throw std::out_of_range("ReplayDevice: frame index out of range");
+				m_nextFrame = frameIdx;
+			}
+
+			size_t numFrames() const { return m_reader.numFrames(); }		//!< number of recorded buffers
+			uint64_t numDelivered() const { return m_numDelivered; }		//!< number of buffers returned by waitForBuffer
+			uint64_t numReadErrors() const { return m_readErrors; }			//!< number of corrupt records that were skipped
+			bool isFinished() const { return !m_loop && m_nextFrame >= m_reader.numFrames(); }	//!< all recorded buffers were read
+
+			void setParam(const std::string& prm, const cx::Variant& val) override
+			{
+				if (!isOpen())
+					cx::checkOk("cx_setParam", CX_STATUS_DEVICE_NOT_OPEN);
+				invalidateParams();
+				std::lock_guard<std::mutex> lock(m_paramMutex);
+				std::string key = findKey(prm);
+				m_params[key.empty() ? prm : key] = val;
+				if (isSelector(prm))
+				{
+					for (size_t i = 0; i < m_selectors.size(); i++)
+					{
+						if (m_selectors[i].first == prm)
+						{
+							m_selectors.erase(m_selectors.begin() + i);
+							break;
+						}
+					}
+					m_selectors.push_back(std::make_pair(prm, valueString(val)));
+				}
+			}
+
+			void getParam(const std::string& prm, cx::Variant& val) override
+			{
+				if (!isOpen())
+					cx::checkOk("cx_getParam", CX_STATUS_DEVICE_NOT_OPEN);
+				std::lock_guard<std::mutex> lock(m_paramMutex);
+				std::string key = findKey(prm);
+				if (key.empty())
+					cx::checkOk("cx_getParam", CX_STATUS_UNKNOWN_PARAMETER);
+				val = m_params[key];
+			}
+
+			void getParamInfo(cx_param_info infoType, const std::string& prm, cx::Variant& val) override
+			{
+				if (!isOpen())
+					cx::checkOk("cx_getParamInfo", CX_STATUS_DEVICE_NOT_OPEN);
+				std::lock_guard<std::mutex> lock(m_paramMutex);
+				std::string key = findKey(prm + "#" + std::to_string((int)infoType), prm);
+				if (!key.empty())
+				{
+					val = m_params[key];
+					return;
+				}
+				key = findKey(prm);
+				switch (infoType)
+				{
+				case CX_PARAM_INFO_ACCESSS_MODE:
+					val = (int64_t)(key.empty() ? CX_PARAM_ACCESS_NOT_IMPLEMENTED : CX_PARAM_ACCESS_RW);
+					return;
+				case CX_PARAM_INFO_VISIBILITY:
+					val = (int64_t)(key.empty() ? CX_PARAM_VISIBILITY_INVISIBLE : CX_PARAM_VISIBILITY_BEGINNER);
+					return;
+				case CX_PARAM_INFO_ENUM_INT_VALUE:
+					if (!key.empty() && ((const cx_variant_t*)m_params[key])->type == CX_VT_INT)
+					{
+						val = m_params[key];
+						return;
+					}
+					break;
+				default:
+					break;
+				}
+				cx::checkOk("cx_getParamInfo", key.empty() ? CX_STATUS_UNKNOWN_PARAMETER : CX_STATUS_NOT_SUPPORTED);
+			}
+
+			void allocAndQueueBuffers(int numBuffers = 3) override
+			{
+				if (!isOpen())
+					cx::checkOk("cx_allocAndQueueBuffers", CX_STATUS_DEVICE_NOT_OPEN);
+				if (m_acquiring)
+					cx::checkOk("cx_allocAndQueueBuffers", CX_STATUS_DEVICE_BUSY);
+				if (numBuffers <= 0)
+					cx::checkOk("cx_allocAndQueueBuffers", CX_STATUS_INVALID_PARAMETER);
+				releaseSlots();
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_free.reset(numBuffers);
+					m_ready.reset(numBuffers);
+					for (int i = 0; i < numBuffers; i++)
+					{
+						m_slots.push_back(std::unique_ptr<Slot>(new Slot()));
+						m_free.push_back(i);
+					}
+				}
+				recordAllocation(numBuffers);
+			}
+
+			void freeBuffers() override
+			{
+				if (m_acquiring)
+					cx::checkOk("cx_freeBuffers", CX_STATUS_DEVICE_BUSY);
+				releaseSlots();
+				recordAllocation(0);
+			}
+
+			DeviceBuffer waitForBuffer(unsigned int timeout, bool noThrow = false) override
+			{
+				DeviceBuffer buffer;
+				cx_status_t status = tryWaitForBuffer(buffer, timeout);
+				if (noThrow == false)
+					cx::checkOk("cx_waitForBuffer", status);
+				return buffer;
+			}
+
+			cx_status_t tryWaitForBuffer(DeviceBuffer& buffer, unsigned int timeout) override
+			{
+				buffer = DeviceBuffer();
+				if (!isOpen())
+					return CX_STATUS_DEVICE_NOT_OPEN;
+				int idx;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					if (!m_cvReady.wait_for(lock, std::chrono::milliseconds(timeout), [this] { return !m_ready.empty(); }))
+						return CX_STATUS_TIMEOUT;
+					idx = m_ready.front();
+					m_ready.pop_front();
+					m_slots[idx]->state = SLOT_DELIVERED;
+					m_numDelivered++;
+				}
+				buffer = DeviceBuffer(toHandle(idx), this);
+				recordBuffer(buffer);		// reads buffer infos, which lock m_mutex
+				return CX_STATUS_OK;
+			}
+
+			void startAcquisition() override
+			{
+				if (!isOpen())
+					cx::checkOk("cx_startAcquisition", CX_STATUS_DEVICE_NOT_OPEN);
+				if (m_slots.empty())
+					cx::checkOk("cx_startAcquisition", CX_STATUS_FAILED);
+				if (m_acquiring)
+					return;
+				m_stop = false;
+				m_acquiring = true;
+				m_producer = std::thread(&ReplayDevice::producerLoop, this);
+			}
+
+			void stopAcquisition() override
+			{
+				if (!isOpen())
+					cx::checkOk("cx_stopAcquisition", CX_STATUS_DEVICE_NOT_OPEN);
+				stopPlayback();
+			}
+
+			// BufferSource interface
+			cx_status_t getBufferImage(CX_BUFFER_HANDLE hBuffer, int partIdx, cx_img_t* img) override
+			{
+				const RecordedFrame* frame = deliveredFrame(hBuffer);
+				if (frame == nullptr || img == nullptr)
+					return CX_STATUS_INVALID_HANDLE;
+				if (frame->parts.empty())
+					return CX_STATUS_NO_DATA;
+				// like cx_getBufferImage, the part index is ignored for single part buffers
+				if (frame->parts.size() == 1)
+					partIdx = 0;
+				if (partIdx < 0 || partIdx >= (int)frame->parts.size())
+					return CX_STATUS_INVALID_PARAMETER;
+				const RecordedFrame::Part& part = frame->parts[partIdx];
+				if (img->flag & CX_IMG_BUFFER_OWNER)
+					cx_image_free(img);
+				img->pixelFormat = part.info.pixelFormat;
+				img->width = part.info.width;
+				img->height = part.info.deliveredHeight ? part.info.deliveredHeight : part.info.height;
+				img->flag = 0;
+				img->linePitch = (size_t)part.info.linePitch;
+				img->planePitch = (size_t)part.info.planePitch;
+				img->dataSz = (size_t)part.info.dataSize;
+				img->data = const_cast<uint8_t*>(part.data);
+				return CX_STATUS_OK;
+			}
+
+			cx_status_t getBufferChunk(CX_BUFFER_HANDLE hBuffer, int chunkIdx, cx_chunk_t* chunk) override
+			{
+				const RecordedFrame* frame = deliveredFrame(hBuffer);
+				if (frame == nullptr || chunk == nullptr)
+					return CX_STATUS_INVALID_HANDLE;
+				if (chunkIdx < 0 || chunkIdx >= (int)frame->chunks.size())
+					return CX_STATUS_INVALID_PARAMETER;
+				*chunk = frame->chunks[chunkIdx];
+				return CX_STATUS_OK;
+			}
+
+			cx_status_t getBufferInfo(CX_BUFFER_HANDLE hBuffer, int param, cx_variant_t* val) override
+			{
+				const RecordedFrame* frame = deliveredFrame(hBuffer);
+				if (frame == nullptr || val == nullptr)
+					return CX_STATUS_INVALID_HANDLE;
+				cx::Variant& v = *static_cast<cx::Variant*>(val);
+				switch (param)
+				{
+				case CX_BUFFER_INFO_TIMESTAMP: v = (uint64_t)frame->header.timestamp; break;
+				case CX_BUFFER_INFO_NUM_PARTS: v = (uint64_t)frame->parts.size(); break;
+				case CX_BUFFER_INFO_NUM_CHUNK: v = (uint64_t)frame->chunks.size(); break;
+				case CX_BUFFER_INFO_IS_INCOMPLETE: v = (frame->header.flags & REC_FLAG_INCOMPLETE) != 0; break;
+				case CX_BUFFER_INFO_IS_MULTIPART: v = (frame->header.flags & REC_FLAG_MULTIPART) != 0; break;
+				default: return CX_STATUS_INVALID_PARAMETER;
+				}
+				return CX_STATUS_OK;
+			}
+
+			cx_status_t getBufferPartInfo(CX_BUFFER_HANDLE hBuffer, int partIdx, int param, cx_variant_t* val) override
+			{
+				const RecordedFrame* frame = deliveredFrame(hBuffer);
+				if (frame == nullptr || val == nullptr)
+					return CX_STATUS_INVALID_HANDLE;
+				if (frame->parts.size() == 1)
+					partIdx = 0;
+				if (partIdx < 0 || partIdx >= (int)frame->parts.size())
+					return CX_STATUS_INVALID_PARAMETER;
+				const RecPartHeader& info = frame->parts[partIdx].info;
+				cx::Variant& v = *static_cast<cx::Variant*>(val);
+				switch (param)
+				{
+				case CX_BUFFER_PART_INFO_DATA_SIZE: v = (uint64_t)info.dataSize; break;
+				case CX_BUFFER_PART_INFO_TYPE_ID: v = info.typeId; break;
+				case CX_BUFFER_PART_INFO_DATA_FORMAT: v = info.pixelFormat; break;
+				case CX_BUFFER_PART_INFO_WIDTH: v = info.width; break;
+				case CX_BUFFER_PART_INFO_HEIGHT: v = info.height; break;
+				case CX_BUFFER_PART_INFO_XOFFSET: v = info.xOffset; break;
+				case CX_BUFFER_PART_INFO_YOFFSET: v = info.yOffset; break;
+				case CX_BUFFER_PART_INFO_SOURCE_ID: v = info.sourceId; break;
+				case CX_BUFFER_PART_INFO_REGION_ID: v = info.regionId; break;
+				case CX_BUFFER_PART_INFO_DATA_PURPOSE_ID: v = info.purposeId; break;
+				case CX_BUFFER_PART_INFO_DELIVERED_HEIGHT: v = info.deliveredHeight; break;
+				default: return CX_STATUS_INVALID_PARAMETER;
+				}
+				return CX_STATUS_OK;
+			}
+
+			cx_status_t queueBuffer(CX_BUFFER_HANDLE hBuffer) override
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				int idx = fromHandle(hBuffer);
+				if (idx < 0 || m_slots[idx]->state != SLOT_DELIVERED)
+					return CX_STATUS_INVALID_HANDLE;
+				m_slots[idx]->state = SLOT_QUEUED;
+				m_free.push_back(idx);
+				m_cvFree.notify_one();
+				return CX_STATUS_OK;
+			}
+
+			static Ptr createShared() { return std::make_shared<ReplayDevice>(); }
+
+		private:
+			ReplayDevice(const ReplayDevice&);
+			ReplayDevice& operator=(const ReplayDevice&);
+
+			enum slot_state {
+				SLOT_QUEUED,		// owned by the device, free or being filled
+				SLOT_READY,			// filled, waiting for waitForBuffer
+				SLOT_DELIVERED		// owned by the application until queueBuffer
+			};
+
+			struct Slot
+			{
+				Slot() : state(SLOT_QUEUED) {}
+				RecordedFrame frame;
+				slot_state state;
+			};
+
+			// queue of slot indices with a fixed capacity, unlike std::deque it doesn't allocate while buffers circulate
+			class SlotQueue
+			{
+			public:
+				SlotQueue() : m_head(0), m_count(0) {}
+				void reset(size_t capacity) { m_idx.assign(capacity, 0); m_head = 0; m_count = 0; }
+				bool empty() const { return m_count == 0; }
+				int front() const { return m_idx[m_head]; }
+				void pop_front() { m_head = (m_head + 1) % m_idx.size(); m_count--; }
+				void push_back(int idx) { m_idx[(m_head + m_count) % m_idx.size()] = idx; m_count++; }
+				void push_front(int idx)
+				{
+					m_head = (m_head + m_idx.size() - 1) % m_idx.size();
+					m_idx[m_head] = idx;
+					m_count++;
+				}
+			private:
+				std::vector<int> m_idx;
+				size_t m_head;
+				size_t m_count;
+			};
+
+			static CX_BUFFER_HANDLE toHandle(int idx) { return (CX_BUFFER_HANDLE)(uintptr_t)(idx + 1); }
+
+			// call with m_mutex locked
+			int fromHandle(CX_BUFFER_HANDLE hBuffer) const
+			{
+				intptr_t idx = (intptr_t)(uintptr_t)hBuffer - 1;
+				return (idx >= 0 && idx < (intptr_t)m_slots.size()) ? (int)idx : -1;
+			}
+
+			// the frame of a delivered buffer is owned by the application, no lock needed for reading it
+			const RecordedFrame* deliveredFrame(CX_BUFFER_HANDLE hBuffer)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				int idx = fromHandle(hBuffer);
+				if (idx < 0 || m_slots[idx]->state != SLOT_DELIVERED)
+					return nullptr;
+				return &m_slots[idx]->frame;
+			}
+
+			static bool isSelector(const std::string& prm)
+			{
+				return prm.size() > 8 && prm.compare(prm.size() - 8, 8, "Selector") == 0;
+			}
+
+			static std::string valueString(const cx::Variant& val)
+			{
+				const cx_variant_t* v = val;
+				if (v->type == CX_VT_INT)
+					return std::to_string((long long)v->data.i);
+				if (v->type == CX_VT_REAL)
+					return std::to_string(v->data.r);
+				std::string str;
+				val.get(str);
+				return str;
+			}
+
+			// find the recorded key of a parameter, selector qualified keys "Name[Selector=Value]" take precedence.
+			// For infos the qualified key is "Name[Selector=Value]#Info", prm is the plain key and name the parameter name. Call with m_paramMutex locked.
+			std::string findKey(const std::string& prm, const std::string& name = std::string()) const
+			{
+				const std::string& base = name.empty() ? prm : name;
+				std::string suffix = prm.substr(base.size());
+				for (size_t i = m_selectors.size(); i-- > 0;)
+				{
+					if (m_selectors[i].first == base)
+						continue;
+					std::string key = base + "[" + m_selectors[i].first + "=" + m_selectors[i].second + "]" + suffix;
+					if (m_params.find(key) != m_params.end())
+						return key;
+				}
+				if (m_params.find(prm) != m_params.end())
+					return prm;
+				return std::string();
+			}
+
+			// simulated parameters of the image format, derived from the first buffer
+			void addDerivedParams()
+			{
+				if (m_reader.numFrames() == 0)
+					return;
+				RecordedFrame frame;
+				try
+				{
+					m_reader.readFrame(0, frame);
+				}
+				catch (const std::exception&)
+				{
+					return;
+				}
+				if (frame.parts.empty())
+					return;
+				const RecPartHeader& info = frame.parts[0].info;
+				if (m_params.find(CX_CAM_IMAGE_WIDTH) == m_params.end())
+					m_params[CX_CAM_IMAGE_WIDTH] = (int64_t)info.width;
+				if (m_params.find(CX_CAM_IMAGE_HEIGHT) == m_params.end())
+					m_params[CX_CAM_IMAGE_HEIGHT] = (int64_t)info.height;
+				if (m_params.find(CX_CAM_PIXEL_FORMAT) == m_params.end())
+					m_params[CX_CAM_PIXEL_FORMAT] = (int64_t)info.pixelFormat;
+				if (m_params.find("PayloadSize") == m_params.end())
+				{
+					uint64_t payload = 0;
+					for (size_t i = 0; i < frame.parts.size(); i++)
+						payload += frame.parts[i].info.dataSize;
+					m_params["PayloadSize"] = (int64_t)payload;
+				}
+			}
+
+			void stopPlayback()
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stop = true;
+				}
+				m_cvFree.notify_all();
+				if (m_producer.joinable())
+					m_producer.join();
+				m_acquiring = false;
+			}
+
+			void releaseSlots()
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_slots.clear();
+				m_free.reset(0);
+				m_ready.reset(0);
+			}
+
+			// playback thread: fills queued slots in recording order and releases them at the due time
+			void producerLoop()
+			{
+				typedef std::chrono::steady_clock clock;
+				clock::time_point start = clock::now();
+				uint64_t ts0 = 0;
+				uint64_t count = 0;
+				bool restart = true;
+				rate_mode lastMode = m_rateMode;
+
+				while (!m_stop)
+				{
+					if (m_nextFrame >= m_reader.numFrames())
+					{
+						if (!m_loop || m_reader.numFrames() == 0)
+							break;
+						m_nextFrame = 0;
+						restart = true;
+					}
+
+					int idx;
+					{
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_cvFree.wait(lock, [this] { return m_stop || !m_free.empty(); });
+						if (m_stop)
+							break;
+						idx = m_free.front();
+						m_free.pop_front();
+					}
+
+					RecordedFrame& frame = m_slots[idx]->frame;
+					try
+					{
+						m_reader.readFrame(m_nextFrame++, frame);
+					}
+					catch (const std::exception&)
+					{
+						m_readErrors++;
+						std::lock_guard<std::mutex> lock(m_mutex);
+						m_free.push_front(idx);
+						continue;
+					}
+
+					rate_mode mode;
+					double hz;
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						mode = m_rateMode;
+						hz = m_rateHz;
+					}
+					if (mode != lastMode)
+						restart = true;
+					lastMode = mode;
+					if (restart)
+					{
+						start = clock::now();
+						ts0 = frame.header.timestamp;
+						count = 0;
+						restart = false;
+					}
+
+					if (mode != RATE_MAX)
+					{
+						double t = 0;
+						if (mode == RATE_FIXED)
+							t = double(count) / hz;
+						else if (frame.header.timestamp > ts0)
+							t = double(frame.header.timestamp - ts0) / m_tickFrequency;
+						clock::time_point due = start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(t));
+						std::unique_lock<std::mutex> lock(m_mutex);
+						m_cvFree.wait_until(lock, due, [this] { return m_stop.load(); });
+						if (m_stop)
+						{
+							m_free.push_front(idx);
+							break;
+						}
+					}
+					count++;
+
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+						m_slots[idx]->state = SLOT_READY;
+						m_ready.push_back(idx);
+					}
+					m_cvReady.notify_one();
+				}
+			}
+
+			RecordingReader m_reader;
+			ParamMap m_params;
+			std::vector<std::pair<std::string, std::string> > m_selectors;		// written selectors in order of writing
+			std::mutex m_paramMutex;
+
+			rate_mode m_rateMode;
+			double m_rateHz;
+			std::atomic<bool> m_loop;
+			double m_tickFrequency;
+			std::atomic<size_t> m_nextFrame;
+
+			std::vector<std::unique_ptr<Slot> > m_slots;
+			SlotQueue m_free;		// every slot index is in at most one queue, numBuffers is the capacity of both
+			SlotQueue m_ready;
+			std::mutex m_mutex;
+			std::condition_variable m_cvFree;
+			std::condition_variable m_cvReady;
+			std::thread m_producer;
+			std::atomic<bool> m_stop;
+			std::atomic<bool> m_acquiring;
+			std::atomic<uint64_t> m_numDelivered;
+			std::atomic<uint64_t> m_readErrors;
+		};
+
+		typedef ReplayDevice::Ptr ReplayDevicePtr;
+
+		//! @} cx_wrapper_cpp
+	}	// namespace cx
+}	// namespace AT
+#endif	// AT_CX_REPLAYDEVICE_H_INCLUDED